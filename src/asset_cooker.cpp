@@ -0,0 +1,566 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "asset_cooker.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <nlohmann/json.hpp>
+
+#include "material_pool.hpp"
+#include "model_cache.hpp"
+#include "settings.hpp"
+#include "texture_pool.hpp"
+#include "vertex.hpp"
+#include "util/hash.hpp"
+#include "util/log.hpp"
+#include "util/thread_pool.hpp"
+
+namespace internal
+{
+
+	using json = nlohmann::json;
+
+	// Bump when cooking changes in a way the keys of the assets don't capture.
+	static constexpr std::uint32_t cooker_version = 1;
+
+	static constexpr char const * default_report_name = "build_report.json";
+
+	// Model pool that doesn't upload anything. Exposes the import to the cooker.
+	class HeadlessModelPool : public ModelPool
+	{
+	public:
+		void Stage(gfx::CommandList*) final {}
+		void PostStage() final {}
+
+		template<typename V_T>
+		ModelHandle Cook(std::string const & path, MaterialPool* material_pool, TexturePool* texture_pool, ModelImportSettings const & settings,
+			util::ThreadPool* thread_pool)
+		{
+			return LoadFromPath<V_T>(path, material_pool, texture_pool, false, std::nullopt, settings, thread_pool, nullptr);
+		}
+
+		template<typename V_T>
+		static std::uint64_t GetKey(ModelImportSettings const & settings)
+		{
+			return GetCookedModelKey<V_T>(settings);
+		}
+
+	protected:
+		ModelHandle::MeshOffsets AllocateMesh(void*, std::uint32_t, std::uint32_t, void*, std::uint32_t, std::uint32_t, void*, std::uint32_t) final
+		{
+			return {};
+		}
+
+		void AllocateMeshShadingBuffers(std::vector<std::uint32_t>, std::vector<std::uint8_t>) final {}
+	};
+
+	// Texture pool that doesn't upload anything. Remembers which textures were created, since failed loads return an ID too.
+	class HeadlessTexturePool : public TexturePool
+	{
+	public:
+		void Stage(gfx::CommandList*) final {}
+		void PostStage() final {}
+		std::vector<gfx::StagingTexture*> GetTextures(std::vector<std::uint32_t>) final { return {}; }
+
+		bool IsLoaded(std::uint32_t id)
+		{
+			std::lock_guard<std::mutex> lock(m_loaded_mutex);
+			return m_loaded.find(id) != m_loaded.end();
+		}
+
+	private:
+		void Load_Impl(TextureData const &, std::uint32_t id, bool, bool) final
+		{
+			std::lock_guard<std::mutex> lock(m_loaded_mutex);
+			m_loaded.insert(id);
+		}
+
+		std::unordered_set<std::uint32_t> m_loaded;
+		std::mutex m_loaded_mutex;
+	};
+
+	class HeadlessMaterialPool : public MaterialPool
+	{
+	public:
+		void Update(MaterialHandle, MaterialData const &) final {}
+
+	private:
+		void Load_Impl(MaterialHandle&, MaterialData const &, TexturePool*) final {}
+	};
+
+	inline double SecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	inline char const * GetStatusName(CookStatus status)
+	{
+		switch (status)
+		{
+		case CookStatus::COOKED: return "cooked";
+		case CookStatus::UP_TO_DATE: return "up_to_date";
+		default: return "failed";
+		}
+	}
+
+	// False for unknown names.
+	template<typename T>
+	bool ParseName(std::string const & name, std::vector<std::pair<char const *, T>> const & names, T & value)
+	{
+		for (auto const & [n, v] : names)
+		{
+			if (name == n)
+			{
+				value = v;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	static const std::vector<std::pair<char const *, CookerVertexLayout>> vertex_layout_names = {
+		{ "vertex", CookerVertexLayout::VERTEX },
+		{ "compressed", CookerVertexLayout::COMPRESSED_VERTEX },
+	};
+
+	static const std::vector<std::pair<char const *, MeshletClusteringMode>> clustering_names = {
+		{ "sequential", MeshletClusteringMode::SEQUENTIAL },
+		{ "spatial", MeshletClusteringMode::SPATIAL },
+	};
+
+	static const std::vector<std::pair<char const *, TextureRole>> texture_role_names = {
+		{ "color", TextureRole::COLOR },
+		{ "color_opaque", TextureRole::COLOR_OPAQUE },
+		{ "normal", TextureRole::NORMAL },
+		{ "single_channel", TextureRole::SINGLE_CHANNEL },
+	};
+
+	inline bool ParseModelAsset(json const & entry, CookerModelAsset & asset)
+	{
+		asset.m_path = entry.at("path").get<std::string>();
+
+		auto& settings = asset.m_settings;
+		settings.m_num_lods = entry.value("lods", settings.m_num_lods);
+		settings.m_lod_triangle_ratio = entry.value("lod_triangle_ratio", settings.m_lod_triangle_ratio);
+		settings.m_lod_max_error = entry.value("lod_max_error", settings.m_lod_max_error);
+		settings.m_optimize_meshes = entry.value("optimize", settings.m_optimize_meshes);
+		settings.m_compact_indices = entry.value("compact_indices", settings.m_compact_indices);
+		settings.m_preserve_instancing = entry.value("instancing", settings.m_preserve_instancing);
+
+		auto vertex = entry.value("vertex", std::string("vertex"));
+		if (!ParseName(vertex, vertex_layout_names, asset.m_vertex_layout))
+		{
+			LOGE("Unknown vertex layout `{}` for model {}", vertex, asset.m_path);
+			return false;
+		}
+
+		auto clustering = entry.value("clustering", std::string("sequential"));
+		if (!ParseName(clustering, clustering_names, settings.m_meshlet_clustering))
+		{
+			LOGE("Unknown meshlet clustering `{}` for model {}", clustering, asset.m_path);
+			return false;
+		}
+
+		return true;
+	}
+
+	inline bool ParseTextureAsset(json const & entry, CookerTextureAsset & asset)
+	{
+		asset.m_path = entry.at("path").get<std::string>();
+		asset.m_mipmap = entry.value("mipmap", asset.m_mipmap);
+		asset.m_srgb = entry.value("srgb", asset.m_srgb);
+
+		auto role = entry.value("role", std::string("color"));
+		if (!ParseName(role, texture_role_names, asset.m_role))
+		{
+			LOGE("Unknown texture role `{}` for texture {}", role, asset.m_path);
+			return false;
+		}
+
+		return true;
+	}
+
+	template<typename V_T>
+	CookerAssetReport CookModelAs(CookerModelAsset const & asset, CookerAssetReport const * previous, std::string const & model_directory,
+		std::uint64_t texture_key, HeadlessTexturePool& texture_pool, util::ThreadPool* thread_pool)
+	{
+		auto start = std::chrono::steady_clock::now();
+
+		auto settings = asset.m_settings;
+		settings.m_cache_directory = model_directory;
+
+		auto model_key = HeadlessModelPool::GetKey<V_T>(settings);
+		auto texture_cache_key = texture_pool.GetProcessorCacheKey();
+		auto cache_path = ModelCache::GetCachePath(asset.m_path, model_directory, model_key);
+
+		CookerAssetReport report;
+		report.m_path = asset.m_path;
+		report.m_is_model = true;
+		report.m_key = util::HashValue(model_key, texture_key);
+		report.m_output = cache_path;
+
+		// The cooked model checks the sources, the key covers the settings of its textures.
+		if (previous && previous->m_status != CookStatus::FAILED && previous->m_key == report.m_key)
+		{
+			if (auto cooked_model = CookedModel::Open(cache_path, asset.m_path, model_directory, model_key, sizeof(V_T), texture_cache_key))
+			{
+				report.m_status = CookStatus::UP_TO_DATE;
+				report.m_num_meshes = cooked_model->GetHeader().m_num_meshes;
+				report.m_seconds = SecondsSince(start);
+				return report;
+			}
+		}
+
+		// Loading through the pools cooks the model and processes its textures like the client would.
+		HeadlessModelPool model_pool;
+		HeadlessMaterialPool material_pool;
+		auto handle = model_pool.Cook<V_T>(asset.m_path, &material_pool, &texture_pool, settings, thread_pool);
+
+		report.m_num_meshes = static_cast<std::uint32_t>(handle.m_mesh_handles.size());
+		report.m_status = !handle.m_mesh_handles.empty() && CookedModel::Open(cache_path, asset.m_path, model_directory, model_key, sizeof(V_T), texture_cache_key)
+			? CookStatus::COOKED : CookStatus::FAILED;
+		report.m_seconds = SecondsSince(start);
+
+		if (report.m_status == CookStatus::FAILED)
+		{
+			LOGE("Failed to cook model {}", asset.m_path);
+		}
+
+		return report;
+	}
+
+	inline CookerAssetReport CookModel(CookerModelAsset const & asset, CookerAssetReport const * previous, std::string const & model_directory,
+		std::uint64_t texture_key, HeadlessTexturePool& texture_pool, util::ThreadPool* thread_pool)
+	{
+		switch (asset.m_vertex_layout)
+		{
+		case CookerVertexLayout::COMPRESSED_VERTEX:
+			return CookModelAs<CompressedVertex>(asset, previous, model_directory, texture_key, texture_pool, thread_pool);
+		default:
+			return CookModelAs<Vertex>(asset, previous, model_directory, texture_key, texture_pool, thread_pool);
+		}
+	}
+
+	inline CookerAssetReport CookTexture(CookerTextureAsset const & asset, CookerAssetReport const * previous, std::uint64_t texture_key,
+		HeadlessTexturePool& texture_pool)
+	{
+		namespace fs = std::filesystem;
+
+		auto start = std::chrono::steady_clock::now();
+
+		std::uint32_t flags[] = { static_cast<std::uint32_t>(asset.m_role), asset.m_mipmap ? 1u : 0u, asset.m_srgb ? 1u : 0u };
+
+		CookerAssetReport report;
+		report.m_path = asset.m_path;
+		report.m_is_model = false;
+		report.m_key = util::HashValue(flags, texture_key);
+
+		std::error_code error;
+		report.m_source_size = fs::file_size(asset.m_path, error);
+		if (!error)
+		{
+			report.m_source_write_time = static_cast<std::int64_t>(fs::last_write_time(asset.m_path, error).time_since_epoch().count());
+		}
+
+		if (error)
+		{
+			LOGE("Failed to cook texture {}: {}", asset.m_path, error.message());
+			report.m_status = CookStatus::FAILED;
+			report.m_seconds = SecondsSince(start);
+			return report;
+		}
+
+		if (previous && previous->m_status != CookStatus::FAILED && previous->m_key == report.m_key
+			&& previous->m_source_size == report.m_source_size && previous->m_source_write_time == report.m_source_write_time)
+		{
+			report.m_status = CookStatus::UP_TO_DATE;
+			report.m_seconds = SecondsSince(start);
+			return report;
+		}
+
+		auto id = texture_pool.Load(asset.m_path, asset.m_mipmap, asset.m_srgb, asset.m_role);
+		report.m_status = texture_pool.IsLoaded(id) ? CookStatus::COOKED : CookStatus::FAILED;
+		report.m_seconds = SecondsSince(start);
+
+		if (report.m_status == CookStatus::FAILED)
+		{
+			LOGE("Failed to cook texture {}", asset.m_path);
+		}
+
+		return report;
+	}
+
+} /* internal */
+
+std::optional<CookerManifest> CookerManifest::Load(std::string const & path)
+{
+	namespace fs = std::filesystem;
+	using internal::json;
+
+	std::ifstream file(path);
+	if (!file)
+	{
+		LOGE("Failed to open manifest {}", path);
+		return std::nullopt;
+	}
+
+	try
+	{
+		auto document = json::parse(file);
+
+		CookerManifest manifest;
+		manifest.m_root = (fs::path(path).parent_path() / document.value("root", std::string())).lexically_normal().generic_string();
+		manifest.m_model_directory = document.value("model_directory", std::string(settings::cooked_model_directory));
+		manifest.m_texture_directory = document.value("texture_directory", std::string(settings::cooked_texture_directory));
+		manifest.m_report_path = document.value("report", (fs::path(manifest.m_model_directory) / internal::default_report_name).generic_string());
+		manifest.m_num_threads = document.value("threads", manifest.m_num_threads);
+		manifest.m_compress_textures = document.value("compress_textures", manifest.m_compress_textures);
+
+		if (manifest.m_root.empty())
+		{
+			manifest.m_root = ".";
+		}
+
+		if (manifest.m_model_directory.empty() || manifest.m_texture_directory.empty())
+		{
+			LOGE("Invalid manifest {}: the model and texture directories can't be empty", path);
+			return std::nullopt;
+		}
+
+		for (auto const & entry : document.value("models", json::array()))
+		{
+			if (!internal::ParseModelAsset(entry, manifest.m_models.emplace_back()))
+			{
+				return std::nullopt;
+			}
+		}
+
+		for (auto const & entry : document.value("textures", json::array()))
+		{
+			if (!internal::ParseTextureAsset(entry, manifest.m_textures.emplace_back()))
+			{
+				return std::nullopt;
+			}
+		}
+
+		return manifest;
+	}
+	catch (json::exception const & e)
+	{
+		LOGE("Invalid manifest {}: {}", path, e.what());
+		return std::nullopt;
+	}
+}
+
+std::uint32_t CookerReport::GetCount(CookStatus status) const
+{
+	return static_cast<std::uint32_t>(std::count_if(m_assets.begin(), m_assets.end(), [status](auto const & asset) { return asset.m_status == status; }));
+}
+
+std::optional<CookerReport> CookerReport::Read(std::string const & path)
+{
+	using internal::json;
+
+	std::ifstream file(path);
+	if (!file)
+	{
+		return std::nullopt;
+	}
+
+	try
+	{
+		auto document = json::parse(file);
+
+		CookerReport report;
+		report.m_seconds = document.at("seconds").get<double>();
+
+		for (auto const & entry : document.at("assets"))
+		{
+			auto& asset = report.m_assets.emplace_back();
+			asset.m_path = entry.at("path").get<std::string>();
+			asset.m_is_model = entry.at("type").get<std::string>() == "model";
+			asset.m_seconds = entry.at("seconds").get<double>();
+			asset.m_key = std::stoull(entry.at("key").get<std::string>(), nullptr, 16);
+			asset.m_output = entry.value("output", std::string());
+			asset.m_num_meshes = entry.value("num_meshes", 0u);
+			asset.m_source_size = entry.value("source_size", std::uint64_t(0));
+			asset.m_source_write_time = entry.value("source_write_time", std::int64_t(0));
+
+			auto status = entry.at("status").get<std::string>();
+			asset.m_status = status == internal::GetStatusName(CookStatus::COOKED) ? CookStatus::COOKED
+				: status == internal::GetStatusName(CookStatus::UP_TO_DATE) ? CookStatus::UP_TO_DATE : CookStatus::FAILED;
+		}
+
+		return report;
+	}
+	catch (std::exception const & e)
+	{
+		LOGW("Ignoring invalid build report {}: {}", path, e.what());
+		return std::nullopt;
+	}
+}
+
+bool CookerReport::Write(std::string const & path) const
+{
+	namespace fs = std::filesystem;
+	using internal::json;
+
+	json assets = json::array();
+	for (auto const & asset : m_assets)
+	{
+		json entry = {
+			{ "path", asset.m_path },
+			{ "type", asset.m_is_model ? "model" : "texture" },
+			{ "status", internal::GetStatusName(asset.m_status) },
+			{ "seconds", asset.m_seconds },
+			{ "key", fmt::format("{:016x}", asset.m_key) },
+		};
+
+		if (asset.m_is_model)
+		{
+			entry["output"] = asset.m_output;
+			entry["num_meshes"] = asset.m_num_meshes;
+		}
+		else
+		{
+			entry["source_size"] = asset.m_source_size;
+			entry["source_write_time"] = asset.m_source_write_time;
+		}
+
+		assets.push_back(std::move(entry));
+	}
+
+	json document = {
+		{ "seconds", m_seconds },
+		{ "num_cooked", GetCount(CookStatus::COOKED) },
+		{ "num_up_to_date", GetCount(CookStatus::UP_TO_DATE) },
+		{ "num_failed", GetCount(CookStatus::FAILED) },
+		{ "textures", {
+			{ "num_processed", m_texture_stats.m_num_processed },
+			{ "num_cache_hits", m_texture_stats.m_num_cache_hits },
+			{ "megapixels", m_texture_stats.m_megapixels },
+			{ "seconds", m_texture_stats.m_seconds },
+			{ "input_bytes", m_texture_stats.m_input_bytes },
+			{ "output_bytes", m_texture_stats.m_output_bytes },
+		} },
+		{ "assets", std::move(assets) },
+	};
+
+	std::error_code error;
+	if (auto directory = fs::path(path).parent_path(); !directory.empty())
+	{
+		fs::create_directories(directory, error);
+	}
+
+	std::ofstream file(path, std::ios::trunc);
+	file << document.dump(1, '\t') << '\n';
+	if (!file)
+	{
+		LOGE("Failed to write build report {}", path);
+		return false;
+	}
+
+	return true;
+}
+
+AssetCooker::AssetCooker(CookerManifest const & manifest)
+	: m_manifest(manifest)
+{
+
+}
+
+CookerReport AssetCooker::Cook(bool force)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::optional<CookerReport> previous_report;
+	if (!force)
+	{
+		previous_report = CookerReport::Read(m_manifest.m_report_path);
+	}
+
+	// Keyed by type and path, an asset listed twice is cooked twice.
+	std::unordered_map<std::string, CookerAssetReport const *> previous_assets;
+	if (previous_report)
+	{
+		for (auto const & asset : previous_report->m_assets)
+		{
+			previous_assets[(asset.m_is_model ? "m:" : "t:") + asset.m_path] = &asset;
+		}
+	}
+
+	auto get_previous = [&previous_assets](std::string const & path, bool is_model) -> CookerAssetReport const *
+	{
+		auto it = previous_assets.find((is_model ? "m:" : "t:") + path);
+		return it != previous_assets.end() ? it->second : nullptr;
+	};
+
+	TextureProcessorSettings texture_settings;
+	texture_settings.m_compress = m_manifest.m_compress_textures;
+	texture_settings.m_cache_directory = m_manifest.m_texture_directory;
+
+	// The pool is shared, so textures used by multiple assets are processed once.
+	internal::HeadlessTexturePool texture_pool;
+	texture_pool.SetProcessorSettings(texture_settings);
+
+	auto texture_key = util::HashValue(texture_settings.m_compress, util::HashValue(internal::cooker_version));
+
+	auto num_threads = m_manifest.m_num_threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : m_manifest.m_num_threads;
+
+	// Assets and their meshes get separate pools, since assets wait for their meshes.
+	util::ThreadPool asset_thread_pool(num_threads);
+	util::ThreadPool mesh_thread_pool(num_threads);
+
+	std::vector<std::future<CookerAssetReport>> futures;
+	for (auto const & asset : m_manifest.m_models)
+	{
+		futures.emplace_back(asset_thread_pool.Enqueue([&, previous = get_previous(asset.m_path, true)]()
+		{
+			return internal::CookModel(asset, previous, m_manifest.m_model_directory, texture_key, texture_pool, &mesh_thread_pool);
+		}));
+	}
+	for (auto const & asset : m_manifest.m_textures)
+	{
+		futures.emplace_back(asset_thread_pool.Enqueue([&, previous = get_previous(asset.m_path, false)]()
+		{
+			return internal::CookTexture(asset, previous, texture_key, texture_pool);
+		}));
+	}
+
+	CookerReport report;
+	for (std::size_t i = 0; i < futures.size(); i++)
+	{
+		auto& asset = report.m_assets.emplace_back();
+		asset.m_is_model = i < m_manifest.m_models.size();
+		asset.m_path = asset.m_is_model ? m_manifest.m_models[i].m_path : m_manifest.m_textures[i - m_manifest.m_models.size()].m_path;
+
+		// A loader that throws only fails its own asset.
+		try
+		{
+			asset = futures[i].get();
+		}
+		catch (std::exception const & e)
+		{
+			LOGE("Failed to cook {}: {}", asset.m_path, e.what());
+		}
+
+		LOG("{} {} ({:.2f}s)", internal::GetStatusName(asset.m_status), asset.m_path, asset.m_seconds);
+	}
+
+	report.m_texture_stats = texture_pool.GetProcessorStats().value_or(TextureProcessorStats{});
+	report.m_seconds = internal::SecondsSince(start);
+
+	return report;
+}
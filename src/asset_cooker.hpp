@@ -0,0 +1,124 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "model_pool.hpp"
+#include "texture_processor.hpp"
+
+// Vertex layouts a model can be cooked for. The cooked model only matches loads with the same vertex type.
+enum class CookerVertexLayout
+{
+	VERTEX, // `Vertex`
+	COMPRESSED_VERTEX, // `CompressedVertex`
+};
+
+struct CookerModelAsset
+{
+	std::string m_path;
+	CookerVertexLayout m_vertex_layout = CookerVertexLayout::VERTEX;
+	// `m_cache_directory` and `m_num_threads` are ignored, the manifest decides those.
+	ModelImportSettings m_settings;
+};
+
+// Textures loaded by path, like the extra material textures of a model.
+struct CookerTextureAsset
+{
+	std::string m_path;
+	TextureRole m_role = TextureRole::COLOR;
+	bool m_mipmap = true;
+	bool m_srgb = false;
+};
+
+// A scene manifest is a JSON file:
+//   {
+//     "root": "bin",                        Working directory of the client, optional. Relative to the manifest.
+//     "model_directory": "cooked",          Optional, defaults to `settings::cooked_model_directory`.
+//     "texture_directory": "cooked/textures", Optional, defaults to `settings::cooked_texture_directory`.
+//     "report": "cooked/report.json",       Optional, defaults to `build_report.json` in the model directory.
+//     "threads": 0,                         Assets cooked in parallel, optional. 0 uses all hardware threads.
+//     "compress_textures": true,            Optional.
+//     "models": [ { "path": "robot/scene.gltf", "vertex": "compressed", "lods": 2, "lod_triangle_ratio": 0.5,
+//                   "lod_max_error": 0.05, "optimize": true, "compact_indices": true, "instancing": false,
+//                   "clustering": "spatial" } ],
+//     "textures": [ { "path": "tree/displacement.png", "role": "single_channel", "mipmap": true, "srgb": false } ]
+//   }
+// Asset paths and directories are relative to the root, like the paths the client loads.
+struct CookerManifest
+{
+	std::string m_root;
+	std::string m_model_directory;
+	std::string m_texture_directory;
+	std::string m_report_path;
+	std::uint32_t m_num_threads = 0;
+	bool m_compress_textures = true;
+	std::vector<CookerModelAsset> m_models;
+	std::vector<CookerTextureAsset> m_textures;
+
+	// Logs and returns std::nullopt when the manifest can't be read or is invalid.
+	static std::optional<CookerManifest> Load(std::string const & path);
+};
+
+enum class CookStatus
+{
+	COOKED,
+	UP_TO_DATE, // Skipped, the outputs of the previous build are still valid.
+	FAILED,
+};
+
+struct CookerAssetReport
+{
+	std::string m_path;
+	bool m_is_model = true;
+	CookStatus m_status = CookStatus::FAILED;
+	double m_seconds = 0;
+	// Identifies the settings the asset was cooked with. A changed key always rebuilds the asset.
+	std::uint64_t m_key = 0;
+	std::string m_output; // Cooked model. Processed textures are named after their contents.
+	std::uint32_t m_num_meshes = 0;
+	// Of the source of texture assets. Models track their sources in the cooked model.
+	std::uint64_t m_source_size = 0;
+	std::int64_t m_source_write_time = 0;
+};
+
+struct CookerReport
+{
+	std::vector<CookerAssetReport> m_assets; // In manifest order, models first.
+	double m_seconds = 0;
+	TextureProcessorStats m_texture_stats;
+
+	std::uint32_t GetCount(CookStatus status) const;
+
+	// Returns std::nullopt when there is no report at `path` or when it can't be parsed.
+	static std::optional<CookerReport> Read(std::string const & path);
+	bool Write(std::string const & path) const;
+};
+
+// Imports the models and processes the textures of a manifest ahead of time without a GPU. The outputs are the cooked
+// models and processed textures the client loads instead of the sources when it uses the same directories.
+//
+// Assets are cooked in parallel with the same code the client runs, through model, material and texture pools that
+// don't upload anything. The report of the previous build makes rebuilds incremental: an asset is skipped when its key
+// is unchanged and its sources are unchanged, which for models is what the cooked model checks (sizes and write times,
+// or content hashes) and for textures the size and write time of the file.
+//
+// Paths are relative to the working directory. The loaders have to be registered with the pools.
+class AssetCooker
+{
+public:
+	explicit AssetCooker(CookerManifest const & manifest);
+
+	// Cooks every asset of the manifest. `force` ignores the previous build.
+	CookerReport Cook(bool force = false);
+
+private:
+	CookerManifest m_manifest;
+};
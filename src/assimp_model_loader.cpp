@@ -25,7 +25,7 @@ AssimpModelLoader::AssimpModelLoader()
 
 }
 
-AssimpModelLoader::AnonResource AssimpModelLoader::LoadFromDisc(std::string const & path)
+AssimpModelLoader::AnonResource AssimpModelLoader::LoadFromDisc(std::string const & path, util::ThreadPool*)
 {
 	Assimp::Importer importer;
 	const aiScene* scene = importer.ReadFile(path.data(),
@@ -34,7 +34,6 @@ AssimpModelLoader::AnonResource AssimpModelLoader::LoadFromDisc(std::string cons
 		aiProcess_CalcTangentSpace |
 		aiProcess_JoinIdenticalVertices |
 		aiProcess_OptimizeMeshes |
-		aiProcess_PreTransformVertices |
 		aiProcess_ImproveCacheLocality);
 
 	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
@@ -60,17 +59,38 @@ AssimpModelLoader::AnonResource AssimpModelLoader::LoadFromDisc(std::string cons
 	}
 
 	LoadMaterials(model.get(), scene, base_dir);
-	LoadMeshes(model.get(), scene, scene->mRootNode);
+	LoadMeshes(model.get(), scene);
+	LoadNodes(model.get(), scene->mRootNode, glm::mat4(1));
 
 	return model;
 }
 
-void AssimpModelLoader::LoadMeshes(ModelData* model, const aiScene* scene, aiNode* node)
+void AssimpModelLoader::LoadNodes(ModelData* model, aiNode* node, glm::mat4 const & parent_transform)
 {
+	// Assimp matrices are row major.
+	glm::mat4 transform;
+	static_assert(sizeof(transform) == sizeof(node->mTransformation));
+	memcpy(&transform, &node->mTransformation, sizeof(transform));
+	transform = parent_transform * glm::transpose(transform);
+
 	for (unsigned int i = 0; i < node->mNumMeshes; ++i)
+	{
+		auto mesh_id = node->mMeshes[i];
+		model->m_nodes.push_back({ mesh_id, model->m_meshes[mesh_id].m_material_id, transform });
+	}
+
+	for (unsigned int i = 0; i < node->mNumChildren; ++i)
+	{
+		LoadNodes(model, node->mChildren[i], transform);
+	}
+}
+
+void AssimpModelLoader::LoadMeshes(ModelData* model, const aiScene* scene)
+{
+	for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
 	{
 		MeshData mesh_data{};
-		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
+		aiMesh* mesh = scene->mMeshes[i];
 
 		//Copy data
 
@@ -128,18 +148,13 @@ void AssimpModelLoader::LoadMeshes(ModelData* model, const aiScene* scene, aiNod
 		mesh_data.m_num_indices = count;
 		mesh_data.m_indices_stride = 4;
 
-		model->m_meshes.push_back(mesh_data);
-	}
-
-	for (unsigned int i = 0; i < node->mNumChildren; ++i)
-	{
-		LoadMeshes(model, scene, node->mChildren[i]);
+		model->m_meshes.push_back(std::move(mesh_data));
 	}
 }
 
 void AssimpModelLoader::LoadMaterials(ModelData* model, const aiScene* scene, std::string base_path)
 {
-	auto image_loader = new STBImageLoader();
+	STBImageLoader image_loader;
 
 	model->m_materials.resize(scene->mNumMaterials);
 	for (unsigned int i = 0; i < scene->mNumMaterials; ++i)
@@ -160,7 +175,7 @@ void AssimpModelLoader::LoadMaterials(ModelData* model, const aiScene* scene, st
 			}
 			else
 			{
-				material_data.m_albedo_texture = *image_loader->LoadFromDisc(base_path + path.C_Str()).get();
+				material_data.m_albedo_texture = *image_loader.LoadFromDisc(base_path + path.C_Str(), nullptr).get();
 			}
 		}
 
@@ -179,8 +194,8 @@ void AssimpModelLoader::LoadMaterials(ModelData* model, const aiScene* scene, st
 				}
 				else
 				{
-					material_data.m_roughness_texture = *image_loader->LoadFromDisc(base_path + path.C_Str()).get();
-					material_data.m_metallic_texture = *image_loader->LoadFromDisc(base_path + path.C_Str()).get();
+					material_data.m_roughness_texture = *image_loader.LoadFromDisc(base_path + path.C_Str(), nullptr).get();
+					material_data.m_metallic_texture = *image_loader.LoadFromDisc(base_path + path.C_Str(), nullptr).get();
 				}
 			}
 		}
@@ -197,7 +212,7 @@ void AssimpModelLoader::LoadMaterials(ModelData* model, const aiScene* scene, st
 			}
 			else
 			{
-				material_data.m_metallic_texture = *image_loader->LoadFromDisc(base_path + path.C_Str()).get();
+				material_data.m_metallic_texture = *image_loader.LoadFromDisc(base_path + path.C_Str(), nullptr).get();
 			}
 		}
 
@@ -213,7 +228,7 @@ void AssimpModelLoader::LoadMaterials(ModelData* model, const aiScene* scene, st
 			}
 			else
 			{
-				material_data.m_roughness_texture = *image_loader->LoadFromDisc(base_path + path.C_Str()).get();
+				material_data.m_roughness_texture = *image_loader.LoadFromDisc(base_path + path.C_Str(), nullptr).get();
 			}
 		}
 
@@ -229,7 +244,7 @@ void AssimpModelLoader::LoadMaterials(ModelData* model, const aiScene* scene, st
 			}
 			else
 			{
-				material_data.m_ambient_occlusion_texture = *image_loader->LoadFromDisc(base_path + path.C_Str()).get();
+				material_data.m_ambient_occlusion_texture = *image_loader.LoadFromDisc(base_path + path.C_Str(), nullptr).get();
 			}
 		}
 
@@ -245,7 +260,7 @@ void AssimpModelLoader::LoadMaterials(ModelData* model, const aiScene* scene, st
 			}
 			else
 			{
-				material_data.m_normal_map_texture = *image_loader->LoadFromDisc(base_path + path.C_Str()).get();
+				material_data.m_normal_map_texture = *image_loader.LoadFromDisc(base_path + path.C_Str(), nullptr).get();
 			}
 		}
 
@@ -263,7 +278,7 @@ void AssimpModelLoader::LoadMaterials(ModelData* model, const aiScene* scene, st
 			}
 			else
 			{
-				material_data.m_emissive_texture = *image_loader->LoadFromDisc(base_path + path.C_Str()).get();
+				material_data.m_emissive_texture = *image_loader.LoadFromDisc(base_path + path.C_Str(), nullptr).get();
 				material_data.m_base_emissive = 1;
 			}
 		}
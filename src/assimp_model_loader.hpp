@@ -20,9 +20,12 @@ public:
 	AssimpModelLoader();
 	~AssimpModelLoader() final = default;
 
-	AnonResource LoadFromDisc(std::string const & path) final;
+	AnonResource LoadFromDisc(std::string const & path, util::ThreadPool* thread_pool) final;
 
 	void LoadEmbeddedTextures(ModelData* model, const aiScene* scene);
 	void LoadMaterials(ModelData* model, const aiScene* scene, std::string base_path);
-	void LoadMeshes(ModelData* model, const aiScene* scene, aiNode* node);
+	// Loads every mesh of the scene once, in object space.
+	void LoadMeshes(ModelData* model, const aiScene* scene);
+	// Adds a node for every mesh referenced by `node` and its children.
+	void LoadNodes(ModelData* model, aiNode* node, glm::mat4 const & parent_transform);
 };
\ No newline at end of file
@@ -0,0 +1,788 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "block_compression.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <glm.hpp>
+
+#include "util/simd.hpp"
+
+namespace internal
+{
+
+	// Pixels of a block as structure of arrays, so 4 pixels are processed at a time.
+	struct alignas(16) BlockPixels
+	{
+		float m_channels[4][16] = {};
+
+		glm::vec4 Get(std::uint32_t i) const
+		{
+			return glm::vec4(m_channels[0][i], m_channels[1][i], m_channels[2][i], m_channels[3][i]);
+		}
+	};
+
+	struct alignas(16) BlockPalette
+	{
+		float m_channels[4][16] = {};
+		std::uint32_t m_size = 0;
+
+		void Set(std::uint32_t i, glm::vec4 color)
+		{
+			for (auto c = 0; c < 4; c++)
+			{
+				m_channels[c][i] = color[c];
+			}
+		}
+	};
+
+	static const glm::vec4 rgb_mask = glm::vec4(1, 1, 1, 0);
+	static const glm::vec4 rgba_mask = glm::vec4(1, 1, 1, 1);
+	static const glm::vec4 r_mask = glm::vec4(1, 0, 0, 0);
+
+	// Maximum number of least squares fits to the indices selected for the previous endpoints.
+	static constexpr int num_refinements = 3;
+
+	// Interpolation factors of the indices.
+	static constexpr float bc1_factors[4] = { 0.f, 1.f, 1.f / 3.f, 2.f / 3.f };
+	static constexpr float bc4_factors[8] = { 0.f, 1.f, 1.f / 7.f, 2.f / 7.f, 3.f / 7.f, 4.f / 7.f, 5.f / 7.f, 6.f / 7.f };
+	static constexpr std::uint32_t bc7_weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	static constexpr float bc7_factors[16] = { 0 / 64.f, 4 / 64.f, 9 / 64.f, 13 / 64.f, 17 / 64.f, 21 / 64.f, 26 / 64.f, 30 / 64.f,
+		34 / 64.f, 38 / 64.f, 43 / 64.f, 47 / 64.f, 51 / 64.f, 55 / 64.f, 60 / 64.f, 64 / 64.f };
+
+	inline BlockPixels LoadBlockPixels(std::uint8_t const * rgba)
+	{
+		BlockPixels pixels;
+		for (auto i = 0; i < 16; i++)
+		{
+			for (auto c = 0; c < 4; c++)
+			{
+				pixels.m_channels[c][i] = rgba[i * 4 + c];
+			}
+		}
+
+		return pixels;
+	}
+
+	// Single channel in the first channel of the block.
+	inline BlockPixels LoadBlockChannel(std::uint8_t const * rgba, std::uint32_t channel)
+	{
+		BlockPixels pixels;
+		for (auto i = 0; i < 16; i++)
+		{
+			pixels.m_channels[0][i] = rgba[i * 4 + channel];
+		}
+
+		return pixels;
+	}
+
+	// Writes the index of the closest palette entry of every pixel. Returns the sum of the squared errors of the
+	// channels in `mask`.
+	inline float FindClosestScalar(BlockPixels const & pixels, BlockPalette const & palette, glm::vec4 mask, std::uint8_t* indices)
+	{
+		float error = 0;
+		for (auto i = 0; i < 16; i++)
+		{
+			float best = FLT_MAX;
+			std::uint8_t best_index = 0;
+			for (std::uint32_t e = 0; e < palette.m_size; e++)
+			{
+				float distance = 0;
+				for (auto c = 0; c < 4; c++)
+				{
+					if (mask[c] != 0)
+					{
+						float diff = pixels.m_channels[c][i] - palette.m_channels[c][e];
+						distance += diff * diff;
+					}
+				}
+
+				if (distance < best)
+				{
+					best = distance;
+					best_index = static_cast<std::uint8_t>(e);
+				}
+			}
+
+			indices[i] = best_index;
+			error += best;
+		}
+
+		return error;
+	}
+
+#ifdef SKYGGE_SIMD_X86
+	inline float FindClosestSSE2(BlockPixels const & pixels, BlockPalette const & palette, glm::vec4 mask, std::uint8_t* indices)
+	{
+		__m128 error = _mm_setzero_ps();
+		for (auto i = 0; i < 16; i += 4)
+		{
+			__m128 channels[4];
+			for (auto c = 0; c < 4; c++)
+			{
+				channels[c] = _mm_load_ps(&pixels.m_channels[c][i]);
+			}
+
+			__m128 best = _mm_set1_ps(FLT_MAX);
+			__m128 best_index = _mm_setzero_ps();
+			for (std::uint32_t e = 0; e < palette.m_size; e++)
+			{
+				__m128 distance = _mm_setzero_ps();
+				for (auto c = 0; c < 4; c++)
+				{
+					if (mask[c] != 0)
+					{
+						__m128 diff = _mm_sub_ps(channels[c], _mm_set1_ps(palette.m_channels[c][e]));
+						distance = _mm_add_ps(distance, _mm_mul_ps(diff, diff));
+					}
+				}
+
+				__m128 closer = _mm_cmplt_ps(distance, best);
+				best = _mm_min_ps(distance, best);
+				best_index = _mm_or_ps(_mm_and_ps(closer, _mm_set1_ps(static_cast<float>(e))), _mm_andnot_ps(closer, best_index));
+			}
+
+			alignas(16) std::int32_t lane_indices[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(lane_indices), _mm_cvttps_epi32(best_index));
+			for (auto lane = 0; lane < 4; lane++)
+			{
+				indices[i + lane] = static_cast<std::uint8_t>(lane_indices[lane]);
+			}
+
+			error = _mm_add_ps(error, best);
+		}
+
+		alignas(16) float lanes[4];
+		_mm_store_ps(lanes, error);
+		return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+	}
+#endif
+
+	inline float FindClosest(BlockPixels const & pixels, BlockPalette const & palette, glm::vec4 mask, std::uint8_t* indices)
+	{
+#ifdef SKYGGE_SIMD_X86
+		return FindClosestSSE2(pixels, palette, mask, indices);
+#else
+		return FindClosestScalar(pixels, palette, mask, indices);
+#endif
+	}
+
+	// Endpoints on the principal axis of the channels in `mask`, spanning the projections of all pixels.
+	inline void FitPrincipalAxis(BlockPixels const & pixels, glm::vec4 mask, glm::vec4& e0, glm::vec4& e1)
+	{
+		glm::vec4 mean(0);
+		glm::vec4 min(FLT_MAX);
+		glm::vec4 max(-FLT_MAX);
+		for (auto i = 0; i < 16; i++)
+		{
+			auto pixel = pixels.Get(i) * mask;
+			mean += pixel;
+			min = glm::min(min, pixel);
+			max = glm::max(max, pixel);
+		}
+		mean /= 16.f;
+
+		glm::mat4 covariance(0);
+		for (auto i = 0; i < 16; i++)
+		{
+			auto d = pixels.Get(i) * mask - mean;
+			covariance += glm::outerProduct(d, d);
+		}
+
+		// Power iteration, starting at the diagonal of the bounding box.
+		auto axis = max - min;
+		if (glm::dot(axis, axis) < 1e-6f)
+		{
+			e0 = e1 = mean;
+			return;
+		}
+
+		for (auto iteration = 0; iteration < 8; iteration++)
+		{
+			auto next = covariance * axis;
+			auto length = glm::length(next);
+			if (length < 1e-6f)
+			{
+				break;
+			}
+			axis = next / length;
+		}
+		axis = glm::normalize(axis);
+
+		float t_min = FLT_MAX;
+		float t_max = -FLT_MAX;
+		for (auto i = 0; i < 16; i++)
+		{
+			auto t = glm::dot(pixels.Get(i) * mask - mean, axis);
+			t_min = std::min(t_min, t);
+			t_max = std::max(t_max, t);
+		}
+
+		e0 = glm::clamp(mean + axis * t_min, 0.f, 255.f);
+		e1 = glm::clamp(mean + axis * t_max, 0.f, 255.f);
+	}
+
+	// Endpoints that minimize the squared error of the pixels when pixel `i` is interpolated with `factors[indices[i]]`.
+	// Returns false when all pixels use the same factor.
+	inline bool FitLeastSquares(BlockPixels const & pixels, std::uint8_t const * indices, float const * factors, glm::vec4& e0, glm::vec4& e1)
+	{
+		float aa = 0, ab = 0, bb = 0;
+		glm::vec4 ax(0), bx(0);
+		for (auto i = 0; i < 16; i++)
+		{
+			auto b = factors[indices[i]];
+			auto a = 1.f - b;
+			auto pixel = pixels.Get(i);
+
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			ax += a * pixel;
+			bx += b * pixel;
+		}
+
+		auto determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) < 1e-6f)
+		{
+			return false;
+		}
+
+		e0 = glm::clamp((bb * ax - ab * bx) / determinant, 0.f, 255.f);
+		e1 = glm::clamp((aa * bx - ab * ax) / determinant, 0.f, 255.f);
+		return true;
+	}
+
+	inline std::uint32_t Quantize(float value, std::uint32_t max)
+	{
+		return static_cast<std::uint32_t>(std::lround(std::clamp(value, 0.f, 255.f) * max / 255.f));
+	}
+
+	inline std::uint16_t PackRGB565(glm::vec4 color)
+	{
+		return static_cast<std::uint16_t>((Quantize(color.x, 31) << 11) | (Quantize(color.y, 63) << 5) | Quantize(color.z, 31));
+	}
+
+	inline glm::ivec4 UnpackRGB565(std::uint16_t color)
+	{
+		int r = (color >> 11) & 31;
+		int g = (color >> 5) & 63;
+		int b = color & 31;
+		return glm::ivec4((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 255);
+	}
+
+	// Returns the error of the block. `c0` is larger than `c1` (4 color mode) unless both are equal.
+	inline float EncodeBC1Endpoints(BlockPixels const & pixels, glm::vec4 e0, glm::vec4 e1, std::uint16_t& c0, std::uint16_t& c1, std::uint8_t* indices)
+	{
+		c0 = PackRGB565(e0);
+		c1 = PackRGB565(e1);
+		if (c0 < c1)
+		{
+			std::swap(c0, c1);
+		}
+
+		auto p0 = glm::vec4(UnpackRGB565(c0));
+		auto p1 = glm::vec4(UnpackRGB565(c1));
+
+		BlockPalette palette;
+		palette.m_size = c0 == c1 ? 1 : 4;
+		for (std::uint32_t i = 0; i < palette.m_size; i++)
+		{
+			palette.Set(i, glm::mix(p0, p1, bc1_factors[i]));
+		}
+
+		return FindClosest(pixels, palette, rgb_mask, indices);
+	}
+
+	// Returns the error of the block. `e0` is larger than `e1` (8 value mode) unless both are equal.
+	inline float EncodeBC4Endpoints(BlockPixels const & pixels, float v0, float v1, std::uint8_t& e0, std::uint8_t& e1, std::uint8_t* indices)
+	{
+		e0 = static_cast<std::uint8_t>(Quantize(std::max(v0, v1), 255));
+		e1 = static_cast<std::uint8_t>(Quantize(std::min(v0, v1), 255));
+
+		BlockPalette palette;
+		palette.m_size = e0 == e1 ? 1 : 8;
+		for (std::uint32_t i = 0; i < palette.m_size; i++)
+		{
+			palette.m_channels[0][i] = glm::mix(static_cast<float>(e0), static_cast<float>(e1), bc4_factors[i]);
+		}
+
+		return FindClosest(pixels, palette, r_mask, indices);
+	}
+
+	// 7 bits per channel plus a p-bit shared by the channels. Picks the p-bit with the smallest error.
+	inline void QuantizeBC7Endpoint(glm::vec4 endpoint, glm::uvec4& quantized, std::uint32_t& p_bit)
+	{
+		float best = FLT_MAX;
+		for (std::uint32_t p = 0; p < 2; p++)
+		{
+			glm::uvec4 candidate;
+			float error = 0;
+			for (auto c = 0; c < 4; c++)
+			{
+				auto value = std::clamp(std::lround((endpoint[c] - p) / 2.f), 0l, 127l);
+				candidate[c] = static_cast<std::uint32_t>(value);
+				auto diff = static_cast<float>(value * 2 + p) - endpoint[c];
+				error += diff * diff;
+			}
+
+			if (error < best)
+			{
+				best = error;
+				quantized = candidate;
+				p_bit = p;
+			}
+		}
+	}
+
+	struct BC7Endpoints
+	{
+		glm::uvec4 m_quantized[2];
+		std::uint32_t m_p_bits[2];
+	};
+
+	inline glm::uvec4 UnquantizeBC7Endpoint(glm::uvec4 quantized, std::uint32_t p_bit)
+	{
+		return quantized * 2u + glm::uvec4(p_bit);
+	}
+
+	inline std::uint32_t InterpolateBC7(std::uint32_t e0, std::uint32_t e1, std::uint32_t index)
+	{
+		return ((64 - bc7_weights[index]) * e0 + bc7_weights[index] * e1 + 32) >> 6;
+	}
+
+	inline float EncodeBC7Endpoints(BlockPixels const & pixels, glm::vec4 e0, glm::vec4 e1, BC7Endpoints& endpoints, std::uint8_t* indices)
+	{
+		QuantizeBC7Endpoint(e0, endpoints.m_quantized[0], endpoints.m_p_bits[0]);
+		QuantizeBC7Endpoint(e1, endpoints.m_quantized[1], endpoints.m_p_bits[1]);
+
+		auto p0 = UnquantizeBC7Endpoint(endpoints.m_quantized[0], endpoints.m_p_bits[0]);
+		auto p1 = UnquantizeBC7Endpoint(endpoints.m_quantized[1], endpoints.m_p_bits[1]);
+
+		BlockPalette palette;
+		palette.m_size = 16;
+		for (std::uint32_t i = 0; i < 16; i++)
+		{
+			for (auto c = 0; c < 4; c++)
+			{
+				palette.m_channels[c][i] = static_cast<float>(InterpolateBC7(p0[c], p1[c], i));
+			}
+		}
+
+		return FindClosest(pixels, palette, rgba_mask, indices);
+	}
+
+	// Bits are written from the least significant bit of the first byte up.
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::uint8_t* data) : m_data(data), m_position(0) {}
+
+		void Write(std::uint32_t value, std::uint32_t num_bits)
+		{
+			for (std::uint32_t i = 0; i < num_bits; i++, m_position++)
+			{
+				if ((value >> i) & 1)
+				{
+					m_data[m_position / 8] |= static_cast<std::uint8_t>(1 << (m_position % 8));
+				}
+			}
+		}
+
+	private:
+		std::uint8_t* m_data;
+		std::uint32_t m_position;
+	};
+
+	class BitReader
+	{
+	public:
+		explicit BitReader(std::uint8_t const * data) : m_data(data), m_position(0) {}
+
+		std::uint32_t Read(std::uint32_t num_bits)
+		{
+			std::uint32_t value = 0;
+			for (std::uint32_t i = 0; i < num_bits; i++, m_position++)
+			{
+				value |= ((m_data[m_position / 8] >> (m_position % 8)) & 1u) << i;
+			}
+
+			return value;
+		}
+
+	private:
+		std::uint8_t const * m_data;
+		std::uint32_t m_position;
+	};
+
+	// 3 bit indices of a BC4 block, pixel 0 first.
+	inline void WriteBC4Indices(std::uint8_t const * indices, std::uint8_t* block)
+	{
+		std::uint64_t bits = 0;
+		for (auto i = 0; i < 16; i++)
+		{
+			bits |= static_cast<std::uint64_t>(indices[i]) << (3 * i);
+		}
+
+		for (auto i = 0; i < 6; i++)
+		{
+			block[2 + i] = static_cast<std::uint8_t>(bits >> (8 * i));
+		}
+	}
+
+	// BC2 and BC3 color blocks always use 4 colors, BC1 uses 3 colors and black when c0 <= c1.
+	inline void DecodeColorBlock(std::uint8_t const * block, std::uint8_t* rgba, bool four_color)
+	{
+		std::uint16_t c0, c1;
+		std::uint32_t bits;
+		memcpy(&c0, block, sizeof(c0));
+		memcpy(&c1, block + 2, sizeof(c1));
+		memcpy(&bits, block + 4, sizeof(bits));
+
+		glm::ivec4 palette[4];
+		palette[0] = UnpackRGB565(c0);
+		palette[1] = UnpackRGB565(c1);
+		if (c0 > c1 || four_color)
+		{
+			palette[2] = (2 * palette[0] + palette[1]) / 3;
+			palette[3] = (palette[0] + 2 * palette[1]) / 3;
+		}
+		else
+		{
+			palette[2] = (palette[0] + palette[1]) / 2;
+			palette[3] = glm::ivec4(0);
+		}
+
+		for (auto i = 0; i < 16; i++)
+		{
+			auto color = palette[(bits >> (2 * i)) & 3];
+			for (auto c = 0; c < 4; c++)
+			{
+				rgba[i * 4 + c] = static_cast<std::uint8_t>(color[c]);
+			}
+		}
+	}
+
+} /* internal */
+
+std::uint32_t BlockCompression::GetBlockSize(TextureCompression compression)
+{
+	switch (compression)
+	{
+	case TextureCompression::BC1:
+	case TextureCompression::BC4:
+		return 8;
+	case TextureCompression::BC3:
+	case TextureCompression::BC5:
+	case TextureCompression::BC7:
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+void BlockCompression::EncodeBC1(std::uint8_t const * rgba, std::uint8_t* block)
+{
+	auto pixels = internal::LoadBlockPixels(rgba);
+
+	glm::vec4 e0, e1;
+	internal::FitPrincipalAxis(pixels, internal::rgb_mask, e0, e1);
+
+	std::uint16_t c0, c1;
+	std::uint8_t indices[16];
+	auto error = internal::EncodeBC1Endpoints(pixels, e0, e1, c0, c1, indices);
+
+	glm::vec4 refined_e0, refined_e1;
+	for (auto i = 0; i < internal::num_refinements && c0 != c1 && internal::FitLeastSquares(pixels, indices, internal::bc1_factors, refined_e0, refined_e1); i++)
+	{
+		std::uint16_t refined_c0, refined_c1;
+		std::uint8_t refined_indices[16];
+		auto refined_error = internal::EncodeBC1Endpoints(pixels, refined_e0, refined_e1, refined_c0, refined_c1, refined_indices);
+		if (refined_error >= error)
+		{
+			break;
+		}
+
+		error = refined_error;
+		c0 = refined_c0;
+		c1 = refined_c1;
+		memcpy(indices, refined_indices, sizeof(indices));
+	}
+
+	std::uint32_t bits = 0;
+	for (auto i = 0; i < 16; i++)
+	{
+		bits |= static_cast<std::uint32_t>(indices[i]) << (2 * i);
+	}
+
+	memcpy(block, &c0, sizeof(c0));
+	memcpy(block + 2, &c1, sizeof(c1));
+	memcpy(block + 4, &bits, sizeof(bits));
+}
+
+void BlockCompression::EncodeBC4(std::uint8_t const * rgba, std::uint8_t* block, std::uint32_t channel)
+{
+	auto pixels = internal::LoadBlockChannel(rgba, channel);
+
+	float min = 255;
+	float max = 0;
+	for (auto value : pixels.m_channels[0])
+	{
+		min = std::min(min, value);
+		max = std::max(max, value);
+	}
+
+	std::uint8_t e0, e1;
+	std::uint8_t indices[16];
+	auto error = internal::EncodeBC4Endpoints(pixels, max, min, e0, e1, indices);
+
+	glm::vec4 refined_e0, refined_e1;
+	for (auto i = 0; i < internal::num_refinements && e0 != e1 && internal::FitLeastSquares(pixels, indices, internal::bc4_factors, refined_e0, refined_e1); i++)
+	{
+		std::uint8_t refined_v0, refined_v1;
+		std::uint8_t refined_indices[16];
+		auto refined_error = internal::EncodeBC4Endpoints(pixels, refined_e0.x, refined_e1.x, refined_v0, refined_v1, refined_indices);
+		if (refined_error >= error)
+		{
+			break;
+		}
+
+		error = refined_error;
+		e0 = refined_v0;
+		e1 = refined_v1;
+		memcpy(indices, refined_indices, sizeof(indices));
+	}
+
+	block[0] = e0;
+	block[1] = e1;
+	internal::WriteBC4Indices(indices, block);
+}
+
+void BlockCompression::EncodeBC3(std::uint8_t const * rgba, std::uint8_t* block)
+{
+	EncodeBC4(rgba, block, 3);
+	EncodeBC1(rgba, block + 8);
+}
+
+void BlockCompression::EncodeBC5(std::uint8_t const * rgba, std::uint8_t* block)
+{
+	EncodeBC4(rgba, block, 0);
+	EncodeBC4(rgba, block + 8, 1);
+}
+
+void BlockCompression::EncodeBC7(std::uint8_t const * rgba, std::uint8_t* block)
+{
+	auto pixels = internal::LoadBlockPixels(rgba);
+
+	glm::vec4 e0, e1;
+	internal::FitPrincipalAxis(pixels, internal::rgba_mask, e0, e1);
+
+	internal::BC7Endpoints endpoints;
+	std::uint8_t indices[16];
+	auto error = internal::EncodeBC7Endpoints(pixels, e0, e1, endpoints, indices);
+
+	glm::vec4 refined_e0, refined_e1;
+	for (auto i = 0; i < internal::num_refinements && internal::FitLeastSquares(pixels, indices, internal::bc7_factors, refined_e0, refined_e1); i++)
+	{
+		internal::BC7Endpoints refined_endpoints;
+		std::uint8_t refined_indices[16];
+		auto refined_error = internal::EncodeBC7Endpoints(pixels, refined_e0, refined_e1, refined_endpoints, refined_indices);
+		if (refined_error >= error)
+		{
+			break;
+		}
+
+		error = refined_error;
+		endpoints = refined_endpoints;
+		memcpy(indices, refined_indices, sizeof(indices));
+	}
+
+	// The most significant bit of the first index is implicitly 0.
+	if (indices[0] >= 8)
+	{
+		std::swap(endpoints.m_quantized[0], endpoints.m_quantized[1]);
+		std::swap(endpoints.m_p_bits[0], endpoints.m_p_bits[1]);
+		for (auto& index : indices)
+		{
+			index = 15 - index;
+		}
+	}
+
+	memset(block, 0, 16);
+	internal::BitWriter writer(block);
+	writer.Write(1 << 6, 7); // Mode 6
+	for (auto c = 0; c < 4; c++)
+	{
+		writer.Write(endpoints.m_quantized[0][c], 7);
+		writer.Write(endpoints.m_quantized[1][c], 7);
+	}
+	writer.Write(endpoints.m_p_bits[0], 1);
+	writer.Write(endpoints.m_p_bits[1], 1);
+	writer.Write(indices[0], 3);
+	for (auto i = 1; i < 16; i++)
+	{
+		writer.Write(indices[i], 4);
+	}
+}
+
+void BlockCompression::DecodeBC1(std::uint8_t const * block, std::uint8_t* rgba)
+{
+	internal::DecodeColorBlock(block, rgba, false);
+}
+
+void BlockCompression::DecodeBC4(std::uint8_t const * block, std::uint8_t* rgba, std::uint32_t channel)
+{
+	int e0 = block[0];
+	int e1 = block[1];
+
+	int palette[8] = { e0, e1 };
+	if (e0 > e1)
+	{
+		for (auto i = 1; i < 7; i++)
+		{
+			palette[i + 1] = ((7 - i) * e0 + i * e1 + 3) / 7;
+		}
+	}
+	else
+	{
+		for (auto i = 1; i < 5; i++)
+		{
+			palette[i + 1] = ((5 - i) * e0 + i * e1 + 2) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	std::uint64_t bits = 0;
+	for (auto i = 0; i < 6; i++)
+	{
+		bits |= static_cast<std::uint64_t>(block[2 + i]) << (8 * i);
+	}
+
+	for (auto i = 0; i < 16; i++)
+	{
+		rgba[i * 4 + channel] = static_cast<std::uint8_t>(palette[(bits >> (3 * i)) & 7]);
+	}
+}
+
+void BlockCompression::DecodeBC3(std::uint8_t const * block, std::uint8_t* rgba)
+{
+	internal::DecodeColorBlock(block + 8, rgba, true);
+	DecodeBC4(block, rgba, 3);
+}
+
+void BlockCompression::DecodeBC5(std::uint8_t const * block, std::uint8_t* rgba)
+{
+	DecodeBC4(block, rgba, 0);
+	DecodeBC4(block + 8, rgba, 1);
+}
+
+bool BlockCompression::DecodeBC7(std::uint8_t const * block, std::uint8_t* rgba)
+{
+	internal::BitReader reader(block);
+	if (reader.Read(7) != (1 << 6))
+	{
+		return false;
+	}
+
+	glm::uvec4 quantized[2];
+	for (auto c = 0; c < 4; c++)
+	{
+		quantized[0][c] = reader.Read(7);
+		quantized[1][c] = reader.Read(7);
+	}
+	auto e0 = internal::UnquantizeBC7Endpoint(quantized[0], reader.Read(1));
+	auto e1 = internal::UnquantizeBC7Endpoint(quantized[1], reader.Read(1));
+
+	for (auto i = 0; i < 16; i++)
+	{
+		auto index = reader.Read(i == 0 ? 3 : 4);
+		for (auto c = 0; c < 4; c++)
+		{
+			rgba[i * 4 + c] = static_cast<std::uint8_t>(internal::InterpolateBC7(e0[c], e1[c], index));
+		}
+	}
+
+	return true;
+}
+
+void BlockCompression::Compress(TextureCompression compression, std::uint8_t const * rgba, std::uint32_t width, std::uint32_t height,
+	std::uint8_t* blocks, std::uint32_t first_block_row, std::uint32_t num_block_rows)
+{
+	const auto block_size = GetBlockSize(compression);
+	const auto num_blocks_x = (width + 3) / 4;
+	const auto last_block_row = std::min(first_block_row + num_block_rows, (height + 3) / 4);
+
+	std::uint8_t block_pixels[16 * 4];
+	for (auto block_y = first_block_row; block_y < last_block_row; block_y++)
+	{
+		for (std::uint32_t block_x = 0; block_x < num_blocks_x; block_x++)
+		{
+			for (std::uint32_t y = 0; y < 4; y++)
+			{
+				auto source_y = std::min(block_y * 4 + y, height - 1);
+				for (std::uint32_t x = 0; x < 4; x++)
+				{
+					auto source_x = std::min(block_x * 4 + x, width - 1);
+					memcpy(&block_pixels[(y * 4 + x) * 4], &rgba[(static_cast<std::size_t>(source_y) * width + source_x) * 4], 4);
+				}
+			}
+
+			auto block = blocks + (static_cast<std::size_t>(block_y) * num_blocks_x + block_x) * block_size;
+			switch (compression)
+			{
+			case TextureCompression::BC1: EncodeBC1(block_pixels, block); break;
+			case TextureCompression::BC3: EncodeBC3(block_pixels, block); break;
+			case TextureCompression::BC4: EncodeBC4(block_pixels, block); break;
+			case TextureCompression::BC5: EncodeBC5(block_pixels, block); break;
+			case TextureCompression::BC7: EncodeBC7(block_pixels, block); break;
+			default: break;
+			}
+		}
+	}
+}
+
+void BlockCompression::Decompress(TextureCompression compression, std::uint8_t const * blocks, std::uint32_t width, std::uint32_t height, std::uint8_t* rgba)
+{
+	const auto block_size = GetBlockSize(compression);
+	const auto num_blocks_x = (width + 3) / 4;
+	const auto num_blocks_y = (height + 3) / 4;
+
+	std::uint8_t block_pixels[16 * 4];
+	for (std::uint32_t block_y = 0; block_y < num_blocks_y; block_y++)
+	{
+		for (std::uint32_t block_x = 0; block_x < num_blocks_x; block_x++)
+		{
+			for (auto i = 0; i < 16; i++)
+			{
+				block_pixels[i * 4 + 0] = block_pixels[i * 4 + 1] = block_pixels[i * 4 + 2] = 0;
+				block_pixels[i * 4 + 3] = 255;
+			}
+
+			auto block = blocks + (static_cast<std::size_t>(block_y) * num_blocks_x + block_x) * block_size;
+			switch (compression)
+			{
+			case TextureCompression::BC1: DecodeBC1(block, block_pixels); break;
+			case TextureCompression::BC3: DecodeBC3(block, block_pixels); break;
+			case TextureCompression::BC4: DecodeBC4(block, block_pixels); break;
+			case TextureCompression::BC5: DecodeBC5(block, block_pixels); break;
+			case TextureCompression::BC7: DecodeBC7(block, block_pixels); break;
+			default: break;
+			}
+
+			for (std::uint32_t y = 0; y < 4 && block_y * 4 + y < height; y++)
+			{
+				for (std::uint32_t x = 0; x < 4 && block_x * 4 + x < width; x++)
+				{
+					auto target = (static_cast<std::size_t>(block_y * 4 + y) * width + block_x * 4 + x) * 4;
+					memcpy(&rgba[target], &block_pixels[(y * 4 + x) * 4], 4);
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,45 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "resource_structs.hpp"
+
+// Encoders and decoders of BC1, BC3, BC4, BC5 and BC7 4x4 blocks. Pixels are RGBA8, 16 pixels of a block in row major
+// order. Endpoints are fitted along the principal axis of the block and refined with a least squares fit to the
+// selected indices. Index selection runs 4 pixels at a time with SSE2 on x86-64.
+//
+// BC1 is always encoded in 4 color mode. BC7 is always encoded in mode 6 (single subset, RGBA endpoints with a
+// p-bit each, 4 bit indices), which handles color and alpha well on its own.
+struct BlockCompression
+{
+	// Bytes of a 4x4 block. 0 for `TextureCompression::NONE`.
+	static std::uint32_t GetBlockSize(TextureCompression compression);
+
+	static void EncodeBC1(std::uint8_t const * rgba, std::uint8_t* block);
+	// Encodes `channel` of the pixels.
+	static void EncodeBC4(std::uint8_t const * rgba, std::uint8_t* block, std::uint32_t channel = 0);
+	static void EncodeBC3(std::uint8_t const * rgba, std::uint8_t* block);
+	static void EncodeBC5(std::uint8_t const * rgba, std::uint8_t* block);
+	static void EncodeBC7(std::uint8_t const * rgba, std::uint8_t* block);
+
+	static void DecodeBC1(std::uint8_t const * block, std::uint8_t* rgba);
+	// Writes the decoded value to `channel` of the pixels and leaves the other channels as they are.
+	static void DecodeBC4(std::uint8_t const * block, std::uint8_t* rgba, std::uint32_t channel = 0);
+	static void DecodeBC3(std::uint8_t const * block, std::uint8_t* rgba);
+	static void DecodeBC5(std::uint8_t const * block, std::uint8_t* rgba);
+	// Only decodes mode 6 blocks, as written by `EncodeBC7`. Returns false for other modes.
+	static bool DecodeBC7(std::uint8_t const * block, std::uint8_t* rgba);
+
+	// Compresses block rows `first_block_row` up to `first_block_row + num_block_rows` of a RGBA8 image. `blocks`
+	// points to the first block of the image. Blocks on the right and bottom edge repeat the last column and row.
+	static void Compress(TextureCompression compression, std::uint8_t const * rgba, std::uint32_t width, std::uint32_t height,
+		std::uint8_t* blocks, std::uint32_t first_block_row, std::uint32_t num_block_rows);
+	// Decompresses a whole image into RGBA8. Channels a format doesn't store are 0, alpha is 255.
+	static void Decompress(TextureCompression compression, std::uint8_t const * blocks, std::uint32_t width, std::uint32_t height, std::uint8_t* rgba);
+};
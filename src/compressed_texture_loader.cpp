@@ -0,0 +1,363 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "compressed_texture_loader.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <optional>
+
+#include "util/log.hpp"
+#include "util/mapped_file.hpp"
+
+namespace internal
+{
+
+	struct KTX2Header
+	{
+		static inline const std::uint8_t identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+		std::uint8_t m_identifier[12];
+		std::uint32_t m_vk_format;
+		std::uint32_t m_type_size;
+		std::uint32_t m_pixel_width;
+		std::uint32_t m_pixel_height;
+		std::uint32_t m_pixel_depth;
+		std::uint32_t m_layer_count;
+		std::uint32_t m_face_count;
+		std::uint32_t m_level_count; // 0 asks the loader to generate mips.
+		std::uint32_t m_supercompression_scheme;
+		std::uint32_t m_dfd_byte_offset;
+		std::uint32_t m_dfd_byte_length;
+		std::uint32_t m_kvd_byte_offset;
+		std::uint32_t m_kvd_byte_length;
+		std::uint64_t m_sgd_byte_offset;
+		std::uint64_t m_sgd_byte_length;
+	};
+	static_assert(sizeof(KTX2Header) == 80);
+
+	struct KTX2Level
+	{
+		std::uint64_t m_byte_offset;
+		std::uint64_t m_byte_length;
+		std::uint64_t m_uncompressed_byte_length;
+	};
+
+	struct DDSPixelFormat
+	{
+		static inline const std::uint32_t alpha_pixels = 0x1;
+		static inline const std::uint32_t four_cc = 0x4;
+		static inline const std::uint32_t rgb = 0x40;
+
+		std::uint32_t m_size;
+		std::uint32_t m_flags;
+		std::uint32_t m_four_cc;
+		std::uint32_t m_rgb_bit_count;
+		std::uint32_t m_r_bit_mask;
+		std::uint32_t m_g_bit_mask;
+		std::uint32_t m_b_bit_mask;
+		std::uint32_t m_a_bit_mask;
+	};
+
+	struct DDSHeader
+	{
+		static inline const std::uint32_t magic = 0x20534444; // "DDS "
+		static inline const std::uint32_t flag_mip_map_count = 0x20000;
+		static inline const std::uint32_t flag_depth = 0x800000;
+		static inline const std::uint32_t caps2_cube_map = 0x200;
+		static inline const std::uint32_t caps2_volume = 0x200000;
+
+		std::uint32_t m_magic;
+		std::uint32_t m_size;
+		std::uint32_t m_flags;
+		std::uint32_t m_height;
+		std::uint32_t m_width;
+		std::uint32_t m_pitch_or_linear_size;
+		std::uint32_t m_depth;
+		std::uint32_t m_mip_map_count;
+		std::uint32_t m_reserved[11];
+		DDSPixelFormat m_pixel_format;
+		std::uint32_t m_caps;
+		std::uint32_t m_caps2;
+		std::uint32_t m_caps3;
+		std::uint32_t m_caps4;
+		std::uint32_t m_reserved2;
+	};
+	static_assert(sizeof(DDSHeader) == 128);
+
+	// Follows `DDSHeader` when the four CC is "DX10".
+	struct DDSHeaderDX10
+	{
+		static inline const std::uint32_t dimension_texture_2d = 3;
+		static inline const std::uint32_t misc_texture_cube = 0x4;
+
+		std::uint32_t m_dxgi_format;
+		std::uint32_t m_resource_dimension;
+		std::uint32_t m_misc_flag;
+		std::uint32_t m_array_size;
+		std::uint32_t m_misc_flags2;
+	};
+
+	constexpr std::uint32_t MakeFourCC(char a, char b, char c, char d)
+	{
+		return static_cast<std::uint32_t>(a) | (static_cast<std::uint32_t>(b) << 8) | (static_cast<std::uint32_t>(c) << 16) | (static_cast<std::uint32_t>(d) << 24);
+	}
+
+	// The layout of the pixels as `TextureData` describes it.
+	struct TextureFormat
+	{
+		TextureCompression m_compression = TextureCompression::NONE;
+		bool m_is_hdr = false;
+		std::uint32_t m_channels = 4;
+	};
+
+	inline std::optional<TextureFormat> GetFormat(VkFormat format)
+	{
+		switch (format)
+		{
+		case VK_FORMAT_R8G8B8A8_UNORM:
+		case VK_FORMAT_R8G8B8A8_SRGB: return TextureFormat{ TextureCompression::NONE, false, 4 };
+		case VK_FORMAT_R32G32B32A32_SFLOAT: return TextureFormat{ TextureCompression::NONE, true, 4 };
+		case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+		case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: return TextureFormat{ TextureCompression::BC1, false, 3 };
+		case VK_FORMAT_BC3_UNORM_BLOCK:
+		case VK_FORMAT_BC3_SRGB_BLOCK: return TextureFormat{ TextureCompression::BC3, false, 4 };
+		case VK_FORMAT_BC4_UNORM_BLOCK: return TextureFormat{ TextureCompression::BC4, false, 1 };
+		case VK_FORMAT_BC5_UNORM_BLOCK: return TextureFormat{ TextureCompression::BC5, false, 2 };
+		case VK_FORMAT_BC7_UNORM_BLOCK:
+		case VK_FORMAT_BC7_SRGB_BLOCK: return TextureFormat{ TextureCompression::BC7, false, 4 };
+		default: return std::nullopt;
+		}
+	}
+
+	inline std::optional<TextureFormat> GetDXGIFormat(std::uint32_t format)
+	{
+		switch (format)
+		{
+		case 2: return GetFormat(VK_FORMAT_R32G32B32A32_SFLOAT); // DXGI_FORMAT_R32G32B32A32_FLOAT
+		case 28: // DXGI_FORMAT_R8G8B8A8_UNORM
+		case 29: return GetFormat(VK_FORMAT_R8G8B8A8_UNORM); // DXGI_FORMAT_R8G8B8A8_UNORM_SRGB
+		case 71: // DXGI_FORMAT_BC1_UNORM
+		case 72: return GetFormat(VK_FORMAT_BC1_RGB_UNORM_BLOCK); // DXGI_FORMAT_BC1_UNORM_SRGB
+		case 77: // DXGI_FORMAT_BC3_UNORM
+		case 78: return GetFormat(VK_FORMAT_BC3_UNORM_BLOCK); // DXGI_FORMAT_BC3_UNORM_SRGB
+		case 80: return GetFormat(VK_FORMAT_BC4_UNORM_BLOCK); // DXGI_FORMAT_BC4_UNORM
+		case 83: return GetFormat(VK_FORMAT_BC5_UNORM_BLOCK); // DXGI_FORMAT_BC5_UNORM
+		case 98: // DXGI_FORMAT_BC7_UNORM
+		case 99: return GetFormat(VK_FORMAT_BC7_UNORM_BLOCK); // DXGI_FORMAT_BC7_UNORM_SRGB
+		default: return std::nullopt;
+		}
+	}
+
+	inline std::optional<TextureFormat> GetDDSFormat(DDSPixelFormat const & pixel_format)
+	{
+		if (pixel_format.m_flags & DDSPixelFormat::four_cc)
+		{
+			switch (pixel_format.m_four_cc)
+			{
+			case MakeFourCC('D', 'X', 'T', '1'): return GetFormat(VK_FORMAT_BC1_RGB_UNORM_BLOCK);
+			case MakeFourCC('D', 'X', 'T', '5'): return GetFormat(VK_FORMAT_BC3_UNORM_BLOCK);
+			case MakeFourCC('A', 'T', 'I', '1'):
+			case MakeFourCC('B', 'C', '4', 'U'): return GetFormat(VK_FORMAT_BC4_UNORM_BLOCK);
+			case MakeFourCC('A', 'T', 'I', '2'):
+			case MakeFourCC('B', 'C', '5', 'U'): return GetFormat(VK_FORMAT_BC5_UNORM_BLOCK);
+			case 116: return GetFormat(VK_FORMAT_R32G32B32A32_SFLOAT); // D3DFMT_A32B32G32R32F
+			default: return std::nullopt;
+			}
+		}
+
+		// Only RGBA8 in memory order is uploaded as is.
+		if ((pixel_format.m_flags & DDSPixelFormat::rgb) && (pixel_format.m_flags & DDSPixelFormat::alpha_pixels) && pixel_format.m_rgb_bit_count == 32
+			&& pixel_format.m_r_bit_mask == 0xFF && pixel_format.m_g_bit_mask == 0xFF00 && pixel_format.m_b_bit_mask == 0xFF0000 && pixel_format.m_a_bit_mask == 0xFF000000)
+		{
+			return GetFormat(VK_FORMAT_R8G8B8A8_UNORM);
+		}
+
+		return std::nullopt;
+	}
+
+	inline bool IsValidSize(std::uint32_t width, std::uint32_t height, std::uint32_t num_mips)
+	{
+		if (width == 0 || height == 0 || num_mips == 0 || num_mips > 16)
+		{
+			return false;
+		}
+
+		// Levels can't be smaller than 1x1.
+		return ((std::max(width, height) >> (num_mips - 1)) > 0);
+	}
+
+	// Creates a texture that points into `file` and keeps it mapped.
+	inline std::unique_ptr<TextureData> CreateMappedTexture(std::shared_ptr<util::MappedFile> const & file, TextureFormat const & format,
+		std::uint32_t width, std::uint32_t height, std::uint32_t num_mips, std::size_t offset)
+	{
+		auto texture = std::make_unique<TextureData>();
+		texture->m_width = width;
+		texture->m_height = height;
+		texture->m_channels = format.m_channels;
+		texture->m_is_hdr = format.m_is_hdr;
+		texture->m_compression = format.m_compression;
+		texture->m_num_mips = num_mips;
+		texture->m_pixels = const_cast<std::uint8_t*>(file->GetData() + offset);
+		texture->m_pixel_storage = std::shared_ptr<void>(file, texture->m_pixels);
+		return texture;
+	}
+
+} /* internal */
+
+KTX2Loader::KTX2Loader()
+	: ResourceLoader(std::vector<std::string>{ "ktx2" })
+{
+
+}
+
+KTX2Loader::AnonResource KTX2Loader::LoadFromDisc(std::string const & path, util::ThreadPool*)
+{
+	auto file = std::make_shared<util::MappedFile>(path);
+	if (!file->IsOpen() || file->GetSize() < sizeof(internal::KTX2Header))
+	{
+		LOGW("Failed to open KTX2 texture {}", path);
+		return nullptr;
+	}
+
+	internal::KTX2Header header;
+	memcpy(&header, file->GetData(), sizeof(header));
+	if (memcmp(header.m_identifier, internal::KTX2Header::identifier, sizeof(header.m_identifier)) != 0)
+	{
+		LOGW("{} isn't a KTX2 texture", path);
+		return nullptr;
+	}
+
+	if (header.m_pixel_depth > 1 || header.m_layer_count > 1 || header.m_face_count != 1 || header.m_supercompression_scheme != 0)
+	{
+		LOGW("KTX2 texture {} isn't a single 2D image without supercompression", path);
+		return nullptr;
+	}
+
+	auto format = internal::GetFormat(static_cast<VkFormat>(header.m_vk_format));
+	if (!format.has_value())
+	{
+		LOGW("KTX2 texture {} has unsupported format {}", path, header.m_vk_format);
+		return nullptr;
+	}
+
+	auto num_mips = std::max(header.m_level_count, 1u);
+	if (!internal::IsValidSize(header.m_pixel_width, header.m_pixel_height, num_mips)
+		|| file->GetSize() < sizeof(header) + num_mips * sizeof(internal::KTX2Level))
+	{
+		LOGW("KTX2 texture {} is corrupt", path);
+		return nullptr;
+	}
+
+	// The levels are usually stored smallest first. The texture points to the first level in the file.
+	std::vector<internal::KTX2Level> levels(num_mips);
+	memcpy(levels.data(), file->GetData() + sizeof(header), num_mips * sizeof(internal::KTX2Level));
+
+	auto first_level = std::min_element(levels.begin(), levels.end(), [](auto const & a, auto const & b) { return a.m_byte_offset < b.m_byte_offset; });
+	if (first_level->m_byte_offset > file->GetSize())
+	{
+		LOGW("KTX2 texture {} is corrupt", path);
+		return nullptr;
+	}
+
+	auto texture = internal::CreateMappedTexture(file, format.value(), header.m_pixel_width, header.m_pixel_height, num_mips, first_level->m_byte_offset);
+	for (std::uint32_t level = 0; level < num_mips; level++)
+	{
+		if (levels[level].m_byte_length != texture->GetMipSizeInBytes(level) || levels[level].m_byte_offset > file->GetSize()
+			|| levels[level].m_byte_length > file->GetSize() - levels[level].m_byte_offset)
+		{
+			LOGW("KTX2 texture {} is corrupt", path);
+			return nullptr;
+		}
+
+		texture->m_mip_offsets.push_back(levels[level].m_byte_offset - first_level->m_byte_offset);
+	}
+
+	return texture;
+}
+
+DDSLoader::DDSLoader()
+	: ResourceLoader(std::vector<std::string>{ "dds" })
+{
+
+}
+
+DDSLoader::AnonResource DDSLoader::LoadFromDisc(std::string const & path, util::ThreadPool*)
+{
+	auto file = std::make_shared<util::MappedFile>(path);
+	if (!file->IsOpen() || file->GetSize() < sizeof(internal::DDSHeader))
+	{
+		LOGW("Failed to open DDS texture {}", path);
+		return nullptr;
+	}
+
+	internal::DDSHeader header;
+	memcpy(&header, file->GetData(), sizeof(header));
+	if (header.m_magic != internal::DDSHeader::magic || header.m_size != sizeof(header) - sizeof(header.m_magic)
+		|| header.m_pixel_format.m_size != sizeof(internal::DDSPixelFormat))
+	{
+		LOGW("{} isn't a DDS texture", path);
+		return nullptr;
+	}
+
+	if ((header.m_flags & internal::DDSHeader::flag_depth) || (header.m_caps2 & (internal::DDSHeader::caps2_cube_map | internal::DDSHeader::caps2_volume)))
+	{
+		LOGW("DDS texture {} isn't a single 2D image", path);
+		return nullptr;
+	}
+
+	std::optional<internal::TextureFormat> format;
+	std::size_t offset = sizeof(header);
+	if ((header.m_pixel_format.m_flags & internal::DDSPixelFormat::four_cc) && header.m_pixel_format.m_four_cc == internal::MakeFourCC('D', 'X', '1', '0'))
+	{
+		internal::DDSHeaderDX10 header_dx10;
+		if (file->GetSize() < offset + sizeof(header_dx10))
+		{
+			LOGW("DDS texture {} is corrupt", path);
+			return nullptr;
+		}
+
+		memcpy(&header_dx10, file->GetData() + offset, sizeof(header_dx10));
+		offset += sizeof(header_dx10);
+		if (header_dx10.m_resource_dimension != internal::DDSHeaderDX10::dimension_texture_2d || header_dx10.m_array_size > 1
+			|| (header_dx10.m_misc_flag & internal::DDSHeaderDX10::misc_texture_cube))
+		{
+			LOGW("DDS texture {} isn't a single 2D image", path);
+			return nullptr;
+		}
+
+		format = internal::GetDXGIFormat(header_dx10.m_dxgi_format);
+	}
+	else
+	{
+		format = internal::GetDDSFormat(header.m_pixel_format);
+	}
+
+	if (!format.has_value())
+	{
+		LOGW("DDS texture {} has an unsupported format", path);
+		return nullptr;
+	}
+
+	// The levels are stored largest first and tightly packed, as `TextureData` expects them.
+	auto num_mips = (header.m_flags & internal::DDSHeader::flag_mip_map_count) ? std::max(header.m_mip_map_count, 1u) : 1u;
+	if (!internal::IsValidSize(header.m_width, header.m_height, num_mips))
+	{
+		LOGW("DDS texture {} is corrupt", path);
+		return nullptr;
+	}
+
+	auto texture = internal::CreateMappedTexture(file, format.value(), header.m_width, header.m_height, num_mips, offset);
+	if (texture->GetSizeInBytes() > file->GetSize() - offset)
+	{
+		LOGW("DDS texture {} is corrupt", path);
+		return nullptr;
+	}
+
+	return texture;
+}
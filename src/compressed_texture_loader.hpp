@@ -0,0 +1,35 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include "resource_loader.hpp"
+
+#include "resource_structs.hpp"
+
+// Loaders of container formats that store textures as they are uploaded. The files are memory mapped and the
+// textures point into the mapping, so the pixels are never decoded or copied before staging. Only single 2D images
+// are supported: no arrays, cube maps, volumes or supercompression.
+//
+// Supported formats are RGBA8, RGBA32F, BC1, BC3, BC4, BC5 and BC7. BC1 is loaded without punch-through alpha.
+
+class KTX2Loader : public ResourceLoader<TextureData>
+{
+public:
+	KTX2Loader();
+	~KTX2Loader() final = default;
+
+	AnonResource LoadFromDisc(std::string const & path, util::ThreadPool* thread_pool) final;
+};
+
+class DDSLoader : public ResourceLoader<TextureData>
+{
+public:
+	DDSLoader();
+	~DDSLoader() final = default;
+
+	AnonResource LoadFromDisc(std::string const & path, util::ThreadPool* thread_pool) final;
+};
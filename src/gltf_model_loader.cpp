@@ -0,0 +1,1150 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "gltf_model_loader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <nlohmann/json.hpp>
+#include <mat3x3.hpp>
+#include <mat4x4.hpp>
+#include <gtc/quaternion.hpp>
+#include <gtc/matrix_transform.hpp>
+
+#include "util/log.hpp"
+#include "util/mapped_file.hpp"
+#include "util/thread_pool.hpp"
+#include "meshopt_decoder.hpp"
+#include "stb_image_loader.hpp"
+#include "tangent_generator.hpp"
+
+namespace internal
+{
+
+	using json = nlohmann::json;
+
+	static constexpr std::uint32_t glb_magic = 0x46546C67; // "glTF"
+	static constexpr std::uint32_t glb_chunk_json = 0x4E4F534A; // "JSON"
+	static constexpr std::uint32_t glb_chunk_bin = 0x004E4942; // "BIN\0"
+
+	static constexpr std::uint32_t component_byte = 5120;
+	static constexpr std::uint32_t component_unsigned_byte = 5121;
+	static constexpr std::uint32_t component_short = 5122;
+	static constexpr std::uint32_t component_unsigned_short = 5123;
+	static constexpr std::uint32_t component_unsigned_int = 5125;
+	static constexpr std::uint32_t component_float = 5126;
+
+	static constexpr std::uint32_t mode_triangles = 4;
+
+	static constexpr char const * meshopt_extension = "EXT_meshopt_compression";
+	static constexpr char const * texture_transform_extension = "KHR_texture_transform";
+
+	// Quantized attributes and texture transforms only need the conversions every accessor goes through.
+	static const std::vector<std::string> supported_extensions = { meshopt_extension, "KHR_mesh_quantization", texture_transform_extension };
+
+	// Bytes of a buffer or buffer view. Points into a mapped file, the binary chunk of a GLB file or a decoded data URI.
+	struct BufferData
+	{
+		std::uint8_t const * m_data = nullptr;
+		std::size_t m_size = 0;
+	};
+
+	// Element `i` of an accessor starts at `m_data + i * m_stride`. Accessors without a buffer view have no data and
+	// are all zeros.
+	struct AccessorView
+	{
+		std::uint8_t const * m_data = nullptr;
+		std::size_t m_count = 0;
+		std::size_t m_stride = 0;
+		std::uint32_t m_component_type = 0;
+		std::uint32_t m_num_components = 0;
+		bool m_normalized = false;
+	};
+
+	// The parsed JSON and the memory of the buffers it references, which stay mapped while the model is converted.
+	struct Document
+	{
+		json m_json;
+		std::filesystem::path m_directory;
+		std::vector<std::unique_ptr<util::MappedFile>> m_files;
+		std::vector<std::vector<std::uint8_t>> m_decoded_uris;
+		std::vector<BufferData> m_buffers;
+		// Decoded EXT_meshopt_compression buffer views, indexed by buffer view. Used instead of the fallback buffer.
+		std::vector<std::optional<std::vector<std::uint8_t>>> m_decoded_views;
+	};
+
+	// Runs the tasks of a load on the thread pool of the caller, or right away when there is none. Waits for the
+	// queued tasks when it goes out of scope, so they never outlive the document and model, also when the load throws.
+	class TaskGroup
+	{
+	public:
+		explicit TaskGroup(util::ThreadPool* thread_pool) : m_thread_pool(thread_pool), m_num_pending(0) {}
+
+		~TaskGroup()
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_condition.wait(lock, [this]() { return m_num_pending == 0; });
+		}
+
+		template<typename F>
+		std::future<std::invoke_result_t<F>> Enqueue(F func)
+		{
+			if (!m_thread_pool)
+			{
+				std::packaged_task<std::invoke_result_t<F>()> task(std::move(func));
+				auto future = task.get_future();
+				task();
+				return future;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_num_pending++;
+			}
+
+			return m_thread_pool->Enqueue([this, func = std::move(func)]() mutable
+			{
+				// Finishes the task when the function returns or throws.
+				struct Finish
+				{
+					TaskGroup & m_group;
+					~Finish()
+					{
+						std::lock_guard<std::mutex> lock(m_group.m_mutex);
+						m_group.m_num_pending--;
+						m_group.m_condition.notify_all();
+					}
+				} finish{ *this };
+
+				return func();
+			});
+		}
+
+	private:
+		util::ThreadPool* m_thread_pool;
+		std::size_t m_num_pending;
+		std::mutex m_mutex;
+		std::condition_variable m_condition;
+	};
+
+	inline std::size_t GetComponentSize(std::uint32_t component_type)
+	{
+		switch (component_type)
+		{
+		case component_byte:
+		case component_unsigned_byte: return 1;
+		case component_short:
+		case component_unsigned_short: return 2;
+		case component_unsigned_int:
+		case component_float: return 4;
+		default: return 0;
+		}
+	}
+
+	inline std::uint32_t GetNumComponents(std::string const & type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4" || type == "MAT2") return 4;
+		if (type == "MAT3") return 9;
+		if (type == "MAT4") return 16;
+		return 0;
+	}
+
+	inline std::vector<std::uint8_t> DecodeBase64(std::string_view text)
+	{
+		std::vector<std::uint8_t> bytes;
+		bytes.reserve(text.size() / 4 * 3);
+
+		std::uint32_t bits = 0;
+		int num_bits = 0;
+		for (auto c : text)
+		{
+			std::uint32_t value;
+			if (c >= 'A' && c <= 'Z') value = c - 'A';
+			else if (c >= 'a' && c <= 'z') value = c - 'a' + 26;
+			else if (c >= '0' && c <= '9') value = c - '0' + 52;
+			else if (c == '+' || c == '-') value = 62;
+			else if (c == '/' || c == '_') value = 63;
+			else continue; // Padding
+
+			bits = (bits << 6) | value;
+			num_bits += 6;
+			if (num_bits >= 8)
+			{
+				num_bits -= 8;
+				bytes.push_back(static_cast<std::uint8_t>(bits >> num_bits));
+			}
+		}
+
+		return bytes;
+	}
+
+	// Relative URIs are percent encoded, like "my%20model.bin".
+	inline std::string DecodeURI(std::string const & uri)
+	{
+		std::string decoded;
+		decoded.reserve(uri.size());
+		for (std::size_t i = 0; i < uri.size(); i++)
+		{
+			if (uri[i] == '%' && i + 2 < uri.size() && std::isxdigit(static_cast<unsigned char>(uri[i + 1])) && std::isxdigit(static_cast<unsigned char>(uri[i + 2])))
+			{
+				decoded.push_back(static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16)));
+				i += 2;
+			}
+			else
+			{
+				decoded.push_back(uri[i]);
+			}
+		}
+
+		return decoded;
+	}
+
+	inline bool IsDataURI(std::string const & uri)
+	{
+		return uri.rfind("data:", 0) == 0;
+	}
+
+	// Decodes the base64 payload of a data URI. Returns nullopt for data URIs that aren't base64 encoded.
+	inline std::optional<std::vector<std::uint8_t>> DecodeDataURI(std::string const & uri)
+	{
+		auto comma = uri.find(',');
+		if (comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos)
+		{
+			return std::nullopt;
+		}
+
+		return DecodeBase64(std::string_view(uri).substr(comma + 1));
+	}
+
+	// Maps the JSON and binary chunk of a GLB file. False when the file isn't a valid GLB file.
+	inline bool ParseGLB(BufferData const & file, BufferData & json_chunk, BufferData & bin_chunk)
+	{
+		auto read_u32 = [&](std::size_t offset)
+		{
+			std::uint32_t value;
+			memcpy(&value, file.m_data + offset, sizeof(value));
+			return value;
+		};
+
+		if (file.m_size < 12 || read_u32(0) != glb_magic || read_u32(4) != 2)
+		{
+			return false;
+		}
+
+		auto length = std::min<std::size_t>(read_u32(8), file.m_size);
+		for (std::size_t offset = 12; offset + 8 <= length;)
+		{
+			auto chunk_length = static_cast<std::size_t>(read_u32(offset));
+			auto chunk_type = read_u32(offset + 4);
+			offset += 8;
+
+			if (chunk_length > length - offset)
+			{
+				return false;
+			}
+
+			if (chunk_type == glb_chunk_json && !json_chunk.m_data)
+			{
+				json_chunk = { file.m_data + offset, chunk_length };
+			}
+			else if (chunk_type == glb_chunk_bin && !bin_chunk.m_data)
+			{
+				bin_chunk = { file.m_data + offset, chunk_length };
+			}
+
+			// Chunks are 4 byte aligned.
+			offset += (chunk_length + 3) & ~std::size_t(3);
+		}
+
+		return json_chunk.m_data != nullptr;
+	}
+
+	// Parses a glTF or GLB file and maps the buffers it references. False when the file or one of its buffers can't
+	// be read.
+	inline bool OpenDocument(std::string const & path, Document & document)
+	{
+		auto const & file = document.m_files.emplace_back(std::make_unique<util::MappedFile>(path));
+		if (!file->IsOpen())
+		{
+			LOGW("Failed to open glTF file {}", path);
+			return false;
+		}
+
+		// A glTF file is all JSON.
+		BufferData json_chunk = { file->GetData(), file->GetSize() };
+		BufferData bin_chunk;
+
+		std::uint32_t magic = 0;
+		if (file->GetSize() >= sizeof(magic))
+		{
+			memcpy(&magic, file->GetData(), sizeof(magic));
+		}
+
+		if (magic == glb_magic)
+		{
+			json_chunk = {};
+			if (!ParseGLB({ file->GetData(), file->GetSize() }, json_chunk, bin_chunk))
+			{
+				LOGW("Invalid GLB file {}", path);
+				return false;
+			}
+		}
+
+		auto json_text = reinterpret_cast<char const *>(json_chunk.m_data);
+		document.m_json = json::parse(json_text, json_text + json_chunk.m_size, nullptr, false);
+		if (document.m_json.is_discarded() || !document.m_json.is_object())
+		{
+			LOGW("Failed to parse the JSON of glTF file {}", path);
+			return false;
+		}
+
+		auto version = document.m_json.value("asset", json::object()).value("version", std::string());
+		if (version.rfind("2.", 0) != 0)
+		{
+			LOGW("glTF file {} has version '{}'. Only glTF 2.0 is supported.", path, version);
+			return false;
+		}
+
+		for (auto const & extension : document.m_json.value("extensionsRequired", std::vector<std::string>()))
+		{
+			if (std::find(supported_extensions.begin(), supported_extensions.end(), extension) == supported_extensions.end())
+			{
+				LOGW("glTF file {} requires unsupported extension {}", path, extension);
+				return false;
+			}
+		}
+
+		document.m_directory = std::filesystem::path(path).parent_path();
+
+		for (auto const & buffer : document.m_json.value("buffers", json::array()))
+		{
+			auto byte_length = buffer.value("byteLength", std::size_t(0));
+			auto uri = buffer.find("uri");
+
+			// Fallback buffers only hold uncompressed copies of EXT_meshopt_compression buffer views, which are decoded
+			// instead, so they aren't read.
+			auto extensions = buffer.value("extensions", json::object());
+			if (extensions.contains(meshopt_extension) && extensions[meshopt_extension].value("fallback", false))
+			{
+				document.m_buffers.push_back({});
+				continue;
+			}
+
+			BufferData data;
+			if (uri == buffer.end())
+			{
+				// The first buffer of a GLB file without a URI is the binary chunk.
+				if (document.m_buffers.empty())
+				{
+					data = bin_chunk;
+				}
+			}
+			else if (IsDataURI(uri->get<std::string>()))
+			{
+				if (auto decoded = DecodeDataURI(uri->get<std::string>()))
+				{
+					auto const & bytes = document.m_decoded_uris.emplace_back(std::move(decoded.value()));
+					data = { bytes.data(), bytes.size() };
+				}
+			}
+			else
+			{
+				auto buffer_path = (document.m_directory / DecodeURI(uri->get<std::string>())).generic_string();
+				auto const & buffer_file = document.m_files.emplace_back(std::make_unique<util::MappedFile>(buffer_path));
+				if (buffer_file->IsOpen())
+				{
+					data = { buffer_file->GetData(), buffer_file->GetSize() };
+				}
+			}
+
+			if (!data.m_data || data.m_size < byte_length)
+			{
+				LOGW("Failed to read buffer {} of glTF file {}", document.m_buffers.size(), path);
+				return false;
+			}
+
+			document.m_buffers.push_back({ data.m_data, byte_length });
+		}
+
+		return true;
+	}
+
+	// Bounds checked bytes of a buffer view. Returns nullopt when the view is outside its buffer.
+	inline std::optional<BufferData> GetBufferView(Document const & document, std::size_t buffer_view_id, std::size_t* byte_stride = nullptr)
+	{
+		auto const & buffer_views = document.m_json.at("bufferViews");
+		if (buffer_view_id >= buffer_views.size())
+		{
+			return std::nullopt;
+		}
+
+		auto const & buffer_view = buffer_views[buffer_view_id];
+		if (byte_stride)
+		{
+			*byte_stride = buffer_view.value("byteStride", std::size_t(0));
+		}
+
+		if (buffer_view_id < document.m_decoded_views.size() && document.m_decoded_views[buffer_view_id])
+		{
+			auto const & decoded = document.m_decoded_views[buffer_view_id].value();
+			return BufferData{ decoded.data(), decoded.size() };
+		}
+
+		auto buffer_id = buffer_view.at("buffer").get<std::size_t>();
+		auto offset = buffer_view.value("byteOffset", std::size_t(0));
+		auto length = buffer_view.at("byteLength").get<std::size_t>();
+		if (buffer_id >= document.m_buffers.size() || offset > document.m_buffers[buffer_id].m_size
+			|| length > document.m_buffers[buffer_id].m_size - offset)
+		{
+			return std::nullopt;
+		}
+
+		return BufferData{ document.m_buffers[buffer_id].m_data + offset, length };
+	}
+
+	// Decodes every EXT_meshopt_compression buffer view, a buffer view per task. Views that fail to decode fall back
+	// to the data of their own buffer.
+	inline void DecodeBufferViews(Document & document, TaskGroup & tasks)
+	{
+		auto buffer_views = document.m_json.find("bufferViews");
+		if (buffer_views == document.m_json.end())
+		{
+			return;
+		}
+
+		document.m_decoded_views.resize(buffer_views->size());
+
+		std::vector<std::pair<std::size_t, std::future<bool>>> futures;
+		for (std::size_t i = 0; i < buffer_views->size(); i++)
+		{
+			auto const & buffer_view = (*buffer_views)[i];
+			auto extensions = buffer_view.find("extensions");
+			if (extensions == buffer_view.end() || !extensions->contains(meshopt_extension))
+			{
+				continue;
+			}
+
+			auto const & compression = (*extensions)[meshopt_extension];
+			auto buffer_id = compression.at("buffer").get<std::size_t>();
+			auto offset = compression.value("byteOffset", std::size_t(0));
+			auto length = compression.at("byteLength").get<std::size_t>();
+			auto stride = compression.at("byteStride").get<std::size_t>();
+			auto count = compression.at("count").get<std::size_t>();
+
+			MeshoptMode mode;
+			MeshoptFilter filter;
+			bool valid = MeshoptDecoder::ParseMode(compression.at("mode").get<std::string>(), mode)
+				&& MeshoptDecoder::ParseFilter(compression.value("filter", std::string("NONE")), filter);
+
+			valid &= buffer_id < document.m_buffers.size() && document.m_buffers[buffer_id].m_data
+				&& offset <= document.m_buffers[buffer_id].m_size && length <= document.m_buffers[buffer_id].m_size - offset;
+			valid &= stride > 0 && count <= buffer_view.at("byteLength").get<std::size_t>() / stride;
+			if (!valid)
+			{
+				LOGW("Invalid {} buffer view {}", meshopt_extension, i);
+				continue;
+			}
+
+			auto& decoded = document.m_decoded_views[i].emplace(count * stride);
+			BufferData source = { document.m_buffers[buffer_id].m_data + offset, length };
+			futures.emplace_back(i, tasks.Enqueue([&decoded, source, count, stride, mode, filter]()
+			{
+				return MeshoptDecoder::Decode(decoded.data(), count, stride, source.m_data, source.m_size, mode, filter);
+			}));
+		}
+
+		for (auto& future : futures)
+		{
+			if (!future.second.get())
+			{
+				LOGW("Failed to decode {} buffer view {}", meshopt_extension, future.first);
+				document.m_decoded_views[future.first].reset();
+			}
+		}
+	}
+
+	// Points `view` at its elements in a buffer view. Elements are tightly packed unless the buffer view has a stride
+	// and `use_stride` is set. False when the elements are outside the buffer view.
+	inline bool ResolveAccessorView(Document const & document, std::size_t buffer_view_id, std::size_t byte_offset, bool use_stride, AccessorView & view)
+	{
+		auto element_size = GetComponentSize(view.m_component_type) * view.m_num_components;
+		std::size_t byte_stride = 0;
+		auto buffer_view = GetBufferView(document, buffer_view_id, &byte_stride);
+		if (!buffer_view || element_size == 0)
+		{
+			return false;
+		}
+
+		view.m_stride = use_stride && byte_stride != 0 ? byte_stride : element_size;
+		if (view.m_stride < element_size || view.m_count > buffer_view->m_size || byte_offset > buffer_view->m_size)
+		{
+			return false;
+		}
+
+		if (view.m_count > 0 && (view.m_count - 1) * view.m_stride + element_size > buffer_view->m_size - byte_offset)
+		{
+			return false;
+		}
+
+		view.m_data = buffer_view->m_data + byte_offset;
+		return true;
+	}
+
+	// Accessors are only resolved when a primitive uses them. Returns nullopt for invalid accessors.
+	inline std::optional<AccessorView> GetAccessorView(Document const & document, std::size_t accessor_id)
+	{
+		auto const & accessors = document.m_json.at("accessors");
+		if (accessor_id >= accessors.size())
+		{
+			return std::nullopt;
+		}
+
+		auto const & accessor = accessors[accessor_id];
+
+		AccessorView view;
+		view.m_count = accessor.at("count").get<std::size_t>();
+		view.m_component_type = accessor.at("componentType").get<std::uint32_t>();
+		view.m_num_components = GetNumComponents(accessor.at("type").get<std::string>());
+		view.m_normalized = accessor.value("normalized", false);
+		if (GetComponentSize(view.m_component_type) == 0 || view.m_num_components == 0)
+		{
+			return std::nullopt;
+		}
+
+		auto buffer_view_id = accessor.find("bufferView");
+		if (buffer_view_id != accessor.end()
+			&& !ResolveAccessorView(document, buffer_view_id->get<std::size_t>(), accessor.value("byteOffset", std::size_t(0)), true, view))
+		{
+			return std::nullopt;
+		}
+
+		return view;
+	}
+
+	inline float ReadComponent(std::uint8_t const * data, std::uint32_t component_type, bool normalized)
+	{
+		switch (component_type)
+		{
+		case component_byte:
+		{
+			auto value = static_cast<std::int8_t>(*data);
+			return normalized ? std::max(value / 127.f, -1.f) : value;
+		}
+		case component_unsigned_byte:
+			return normalized ? *data / 255.f : *data;
+		case component_short:
+		{
+			std::int16_t value;
+			memcpy(&value, data, sizeof(value));
+			return normalized ? std::max(value / 32767.f, -1.f) : value;
+		}
+		case component_unsigned_short:
+		{
+			std::uint16_t value;
+			memcpy(&value, data, sizeof(value));
+			return normalized ? value / 65535.f : value;
+		}
+		case component_unsigned_int:
+		{
+			std::uint32_t value;
+			memcpy(&value, data, sizeof(value));
+			return static_cast<float>(value);
+		}
+		default:
+		{
+			float value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+		}
+	}
+
+	inline std::uint32_t ReadIndex(AccessorView const & view, std::size_t i)
+	{
+		auto data = view.m_data + i * view.m_stride;
+		switch (view.m_component_type)
+		{
+		case component_unsigned_byte: return *data;
+		case component_unsigned_short:
+		{
+			std::uint16_t value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+		default:
+		{
+			std::uint32_t value;
+			memcpy(&value, data, sizeof(value));
+			return value;
+		}
+		}
+	}
+
+	// Calls `store(i, value)` for every element of `view`, converted to floats. Only the first 4 components are
+	// read and the components the accessor doesn't have are 0.
+	template<typename F>
+	inline void ForEachElement(AccessorView const & view, F && store)
+	{
+		const auto num_components = std::min<std::uint32_t>(view.m_num_components, 4);
+		glm::vec4 value(0);
+
+		if (!view.m_data)
+		{
+			for (std::size_t i = 0; i < view.m_count; i++)
+			{
+				store(i, value);
+			}
+		}
+		else if (view.m_component_type == component_float)
+		{
+			for (std::size_t i = 0; i < view.m_count; i++)
+			{
+				memcpy(&value, view.m_data + i * view.m_stride, num_components * sizeof(float));
+				store(i, value);
+			}
+		}
+		else
+		{
+			const auto component_size = GetComponentSize(view.m_component_type);
+			for (std::size_t i = 0; i < view.m_count; i++)
+			{
+				auto element = view.m_data + i * view.m_stride;
+				for (std::uint32_t c = 0; c < num_components; c++)
+				{
+					value[c] = ReadComponent(element + c * component_size, view.m_component_type, view.m_normalized);
+				}
+				store(i, value);
+			}
+		}
+	}
+
+	// Calls `store(i, value)` for the elements a sparse accessor replaces. False when the sparse data is invalid.
+	template<typename F>
+	inline bool ForEachSparseElement(Document const & document, std::size_t accessor_id, AccessorView const & view, F && store)
+	{
+		auto const & accessor = document.m_json.at("accessors")[accessor_id];
+		auto sparse = accessor.find("sparse");
+		if (sparse == accessor.end())
+		{
+			return true;
+		}
+
+		auto const & sparse_indices = sparse->at("indices");
+		auto const & sparse_values = sparse->at("values");
+
+		AccessorView indices;
+		indices.m_count = sparse->at("count").get<std::size_t>();
+		indices.m_component_type = sparse_indices.at("componentType").get<std::uint32_t>();
+		indices.m_num_components = 1;
+
+		AccessorView values = view;
+		values.m_count = indices.m_count;
+
+		if (!ResolveAccessorView(document, sparse_indices.at("bufferView").get<std::size_t>(), sparse_indices.value("byteOffset", std::size_t(0)), false, indices)
+			|| !ResolveAccessorView(document, sparse_values.at("bufferView").get<std::size_t>(), sparse_values.value("byteOffset", std::size_t(0)), false, values))
+		{
+			return false;
+		}
+
+		bool valid = true;
+		ForEachElement(values, [&](std::size_t i, glm::vec4 const & value)
+		{
+			auto index = ReadIndex(indices, i);
+			if (index < view.m_count)
+			{
+				store(index, value);
+			}
+			else
+			{
+				valid = false;
+			}
+		});
+
+		return valid;
+	}
+
+	// Converts attribute `name` of a primitive to `out`, straight from the mapped buffer. True when the primitive
+	// doesn't have the attribute, which leaves `out` empty.
+	template<typename F>
+	inline bool ReadAttribute(Document const & document, json const & attributes, char const * name, std::size_t num_vertices, std::vector<glm::vec3> & out, F && convert)
+	{
+		auto attribute = attributes.find(name);
+		if (attribute == attributes.end())
+		{
+			return true;
+		}
+
+		auto accessor_id = attribute->get<std::size_t>();
+		auto view = GetAccessorView(document, accessor_id);
+		if (!view || view->m_count != num_vertices)
+		{
+			return false;
+		}
+
+		out.resize(num_vertices);
+		auto store = [&](std::size_t i, glm::vec4 const & value) { out[i] = convert(value); };
+		ForEachElement(*view, store);
+		return ForEachSparseElement(document, accessor_id, *view, store);
+	}
+
+	// The texture properties of a material, the object with the property and its name.
+	inline std::vector<std::pair<json const *, char const *>> GetTextureProperties(json const & material)
+	{
+		static const json empty = json::object();
+		auto pbr = material.find("pbrMetallicRoughness");
+		auto const & pbr_properties = pbr != material.end() ? *pbr : empty;
+
+		return {
+			{ &pbr_properties, "baseColorTexture" },
+			{ &pbr_properties, "metallicRoughnessTexture" },
+			{ &material, "normalTexture" },
+			{ &material, "occlusionTexture" },
+			{ &material, "emissiveTexture" },
+		};
+	}
+
+	// KHR_texture_transform of the first texture of the material that has one. A mesh has a single set of uvs, so the
+	// transform is applied to them instead of per texture. Quantized uvs are dequantized this way.
+	inline glm::mat3 GetTextureTransform(json const & gltf, json const & primitive)
+	{
+		auto materials = gltf.find("materials");
+		auto material_id = primitive.value("material", std::numeric_limits<std::size_t>::max());
+		if (materials == gltf.end() || material_id >= materials->size())
+		{
+			return glm::mat3(1);
+		}
+
+		for (auto const & property : GetTextureProperties((*materials)[material_id]))
+		{
+			auto texture_info = property.first->find(property.second);
+			if (texture_info == property.first->end() || !texture_info->contains("extensions")
+				|| !(*texture_info)["extensions"].contains(texture_transform_extension))
+			{
+				continue;
+			}
+
+			auto const & transform = (*texture_info)["extensions"][texture_transform_extension];
+			auto offset = transform.value("offset", std::vector<float>{ 0, 0 });
+			auto scale = transform.value("scale", std::vector<float>{ 1, 1 });
+			auto rotation = transform.value("rotation", 0.f);
+			if (offset.size() != 2 || scale.size() != 2)
+			{
+				break;
+			}
+
+			// Translation * rotation * scale.
+			glm::mat3 uv_transform(1);
+			uv_transform[0] = glm::vec3(std::cos(rotation) * scale[0], -std::sin(rotation) * scale[0], 0);
+			uv_transform[1] = glm::vec3(std::sin(rotation) * scale[1], std::cos(rotation) * scale[1], 0);
+			uv_transform[2] = glm::vec3(offset[0], offset[1], 1);
+			return uv_transform;
+		}
+
+		return glm::mat3(1);
+	}
+
+	// Converts a triangle list primitive to a mesh in object space. False when the primitive references invalid data.
+	inline bool LoadPrimitive(Document const & document, json const & primitive, MeshData & mesh_data)
+	{
+		auto const & attributes = primitive.at("attributes");
+
+		auto positions = GetAccessorView(document, attributes.at("POSITION").get<std::size_t>());
+		if (!positions)
+		{
+			return false;
+		}
+
+		const auto num_vertices = positions->m_count;
+		auto to_vec3 = [](glm::vec4 const & value) { return glm::vec3(value); };
+		auto uv_transform = GetTextureTransform(document.m_json, primitive);
+		auto to_uvw = [&uv_transform](glm::vec4 const & value)
+		{
+			auto uv = uv_transform * glm::vec3(value.x, value.y, 1);
+			return glm::vec3(uv.x, uv.y * -1, 0);
+		};
+
+		if (!ReadAttribute(document, attributes, "POSITION", num_vertices, mesh_data.m_positions, to_vec3)
+			|| !ReadAttribute(document, attributes, "NORMAL", num_vertices, mesh_data.m_normals, to_vec3)
+			|| !ReadAttribute(document, attributes, "TEXCOORD_0", num_vertices, mesh_data.m_uvw, to_uvw))
+		{
+			return false;
+		}
+
+		mesh_data.m_normals.resize(num_vertices);
+
+		auto indices_id = primitive.find("indices");
+		if (indices_id != primitive.end())
+		{
+			auto indices = GetAccessorView(document, indices_id->get<std::size_t>());
+			if (!indices || !indices->m_data || indices->m_num_components != 1 || indices->m_component_type == component_byte
+				|| indices->m_component_type == component_short || indices->m_component_type == component_float)
+			{
+				return false;
+			}
+
+			// Indices keep their stride, so 16 bit indices are copied as is.
+			const auto stride = GetComponentSize(indices->m_component_type);
+			mesh_data.m_indices_stride = stride;
+			mesh_data.m_num_indices = indices->m_count;
+			mesh_data.m_indices.resize(indices->m_count * stride);
+			if (indices->m_stride == stride)
+			{
+				memcpy(mesh_data.m_indices.data(), indices->m_data, mesh_data.m_indices.size());
+			}
+			else
+			{
+				for (std::size_t i = 0; i < indices->m_count; i++)
+				{
+					memcpy(mesh_data.m_indices.data() + i * stride, indices->m_data + i * indices->m_stride, stride);
+				}
+			}
+		}
+		else
+		{
+			// Primitives without indices draw their vertices in order.
+			mesh_data.m_indices_stride = sizeof(std::uint32_t);
+			mesh_data.m_num_indices = num_vertices;
+			mesh_data.m_indices.resize(num_vertices * sizeof(std::uint32_t));
+			for (std::size_t i = 0; i < num_vertices; i++)
+			{
+				mesh_data.SetIndex(i, static_cast<std::uint32_t>(i));
+			}
+		}
+
+		mesh_data.m_num_indices -= mesh_data.m_num_indices % 3;
+		mesh_data.m_indices.resize(mesh_data.m_num_indices * mesh_data.m_indices_stride);
+		for (std::size_t i = 0; i < mesh_data.m_num_indices; i++)
+		{
+			if (mesh_data.GetIndex(i) >= num_vertices)
+			{
+				return false;
+			}
+		}
+
+		// Called from a task of the thread pool, so the tangents of a primitive are generated on this thread.
+		TangentGenerator::Generate(mesh_data, TangentMode::ACCUMULATE, nullptr);
+		mesh_data.m_uvw.resize(num_vertices);
+		mesh_data.m_material_id = static_cast<std::uint32_t>(primitive.value("material", -1));
+
+		return true;
+	}
+
+	inline std::unique_ptr<TextureData> DecodeImage(Document const & document, std::size_t image_id)
+	{
+		auto const & image = document.m_json.at("images").at(image_id);
+		auto name = image.value("name", "image " + std::to_string(image_id));
+
+		auto uri = image.find("uri");
+		if (uri != image.end() && IsDataURI(uri->get<std::string>()))
+		{
+			auto bytes = DecodeDataURI(uri->get<std::string>());
+			return bytes ? STBImageLoader::Decode(bytes->data(), bytes->size(), name) : nullptr;
+		}
+		else if (uri != image.end())
+		{
+			return STBImageLoader::Decode((document.m_directory / DecodeURI(uri->get<std::string>())).generic_string());
+		}
+
+		auto buffer_view_id = image.find("bufferView");
+		auto bytes = buffer_view_id != image.end() ? GetBufferView(document, buffer_view_id->get<std::size_t>()) : std::nullopt;
+		if (!bytes)
+		{
+			LOGW("glTF {} has no valid data", name);
+			return nullptr;
+		}
+
+		return STBImageLoader::Decode(bytes->m_data, bytes->m_size, name);
+	}
+
+	// The image of a texture info of a material, like `baseColorTexture`. Returns nullopt when the material doesn't
+	// have the texture.
+	inline std::optional<std::size_t> GetImageId(json const & gltf, json const & material, char const * texture_name)
+	{
+		auto texture_info = material.find(texture_name);
+		if (texture_info == material.end())
+		{
+			return std::nullopt;
+		}
+
+		auto textures = gltf.find("textures");
+		auto texture_id = texture_info->value("index", std::size_t(0));
+		if (textures == gltf.end() || texture_id >= textures->size())
+		{
+			return std::nullopt;
+		}
+
+		auto image_id = (*textures)[texture_id].find("source");
+		if (image_id == (*textures)[texture_id].end())
+		{
+			return std::nullopt;
+		}
+
+		return image_id->get<std::size_t>();
+	}
+
+	// Same mapping as the TinyGLTF loader. The metallic roughness texture is used for both.
+	inline MaterialData LoadMaterial(json const & gltf, json const & material, std::vector<std::unique_ptr<TextureData>> const & images)
+	{
+		MaterialData mat_data;
+
+		auto properties = GetTextureProperties(material);
+		std::array<TextureData*, 5> targets = { &mat_data.m_albedo_texture, &mat_data.m_metallic_texture, &mat_data.m_normal_map_texture,
+			&mat_data.m_ambient_occlusion_texture, &mat_data.m_emissive_texture };
+
+		for (std::size_t i = 0; i < properties.size(); i++)
+		{
+			auto image_id = GetImageId(gltf, *properties[i].first, properties[i].second);
+			if (image_id && image_id.value() < images.size() && images[image_id.value()])
+			{
+				*targets[i] = *images[image_id.value()];
+			}
+		}
+		mat_data.m_roughness_texture = mat_data.m_metallic_texture;
+
+		auto emissive_factor = material.find("emissiveFactor");
+		if (emissive_factor != material.end() && emissive_factor->size() == 3)
+		{
+			mat_data.m_base_emissive = (*emissive_factor)[0].get<float>() + (*emissive_factor)[1].get<float>() + (*emissive_factor)[2].get<float>();
+		}
+
+		return mat_data;
+	}
+
+	// T * R * S, or the column major matrix of the node.
+	inline glm::mat4 GetNodeTransform(json const & node)
+	{
+		glm::mat4 transform(1);
+
+		auto matrix = node.find("matrix");
+		if (matrix != node.end() && matrix->size() == 16)
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				transform[i / 4][i % 4] = (*matrix)[i].get<float>();
+			}
+
+			return transform;
+		}
+
+		auto translation = node.find("translation");
+		if (translation != node.end() && translation->size() == 3)
+		{
+			transform = glm::translate(transform, glm::vec3((*translation)[0].get<float>(), (*translation)[1].get<float>(), (*translation)[2].get<float>()));
+		}
+
+		// The rotation is a quaternion stored as x, y, z, w.
+		auto rotation = node.find("rotation");
+		if (rotation != node.end() && rotation->size() == 4)
+		{
+			transform = transform * glm::mat4_cast(glm::quat((*rotation)[3].get<float>(), (*rotation)[0].get<float>(), (*rotation)[1].get<float>(), (*rotation)[2].get<float>()));
+		}
+
+		auto scale = node.find("scale");
+		if (scale != node.end() && scale->size() == 3)
+		{
+			transform = glm::scale(transform, glm::vec3((*scale)[0].get<float>(), (*scale)[1].get<float>(), (*scale)[2].get<float>()));
+		}
+
+		return transform;
+	}
+
+	// A primitive that is converted to mesh `m_mesh_id` of the model.
+	struct PrimitiveJob
+	{
+		json const * m_primitive;
+		std::uint32_t m_mesh_id;
+	};
+
+	inline std::unique_ptr<ModelData> LoadModel(std::string const & path, util::ThreadPool* thread_pool)
+	{
+		Document document;
+		if (!OpenDocument(path, document))
+		{
+			return nullptr;
+		}
+
+		auto const & gltf = document.m_json;
+		static const json empty = json::array();
+		auto const & materials = gltf.contains("materials") ? gltf["materials"] : empty;
+		auto const & meshes = gltf.contains("meshes") ? gltf["meshes"] : empty;
+		auto const & nodes = gltf.contains("nodes") ? gltf["nodes"] : empty;
+		auto const & scenes = gltf.contains("scenes") ? gltf["scenes"] : empty;
+
+		auto model = std::make_unique<ModelData>();
+
+		// Declared after the document and model, so queued tasks finish before they are destroyed.
+		TaskGroup tasks(thread_pool);
+
+		// Compressed buffer views are decoded before anything reads them.
+		DecodeBufferViews(document, tasks);
+
+		// Decode the images the materials use while the primitives are converted.
+		std::vector<std::optional<std::future<std::unique_ptr<TextureData>>>> image_futures(gltf.contains("images") ? gltf["images"].size() : 0);
+		for (auto const & material : materials)
+		{
+			for (auto const & property : GetTextureProperties(material))
+			{
+				auto image_id = GetImageId(gltf, *property.first, property.second);
+				if (image_id && image_id.value() < image_futures.size() && !image_futures[image_id.value()])
+				{
+					image_futures[image_id.value()] = tasks.Enqueue([&document, id = image_id.value()]() { return DecodeImage(document, id); });
+				}
+			}
+		}
+
+		// glTF meshes are loaded when a node references them for the first time. First mesh and number of meshes.
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> loaded_meshes(meshes.size(), { 0, 0 });
+		std::vector<bool> is_mesh_loaded(meshes.size(), false);
+		std::vector<PrimitiveJob> jobs;
+
+		std::function<void(std::size_t, glm::mat4 const &, std::size_t)> recursive_func = [&](std::size_t node_id, glm::mat4 const & parent_transform, std::size_t depth)
+		{
+			// Deeper than the number of nodes means the hierarchy has a cycle.
+			if (node_id >= nodes.size() || depth > nodes.size())
+			{
+				return;
+			}
+
+			auto const & node = nodes[node_id];
+			auto transform = parent_transform * GetNodeTransform(node);
+
+			auto mesh_id = node.value("mesh", meshes.size());
+			if (mesh_id < meshes.size())
+			{
+				auto& node_meshes = loaded_meshes[mesh_id];
+				if (!is_mesh_loaded[mesh_id])
+				{
+					node_meshes.first = static_cast<std::uint32_t>(model->m_meshes.size());
+					// The jobs point at the primitives, so they are iterated in place instead of copied.
+					auto const & mesh = meshes[mesh_id];
+					auto primitives = mesh.find("primitives");
+					for (auto const & primitive : primitives != mesh.end() ? *primitives : empty)
+					{
+						if (primitive.value("mode", mode_triangles) != mode_triangles || !primitive.at("attributes").contains("POSITION"))
+						{
+							LOGW("Skipping a primitive of glTF mesh {}, only triangle lists with positions are supported", mesh_id);
+							continue;
+						}
+
+						jobs.push_back({ &primitive, static_cast<std::uint32_t>(model->m_meshes.size()) });
+						model->m_meshes.emplace_back().m_material_id = static_cast<std::uint32_t>(primitive.value("material", -1));
+					}
+					node_meshes.second = static_cast<std::uint32_t>(model->m_meshes.size()) - node_meshes.first;
+					is_mesh_loaded[mesh_id] = true;
+				}
+
+				for (auto id = node_meshes.first; id < node_meshes.first + node_meshes.second; id++)
+				{
+					model->m_nodes.push_back({ id, model->m_meshes[id].m_material_id, transform });
+				}
+			}
+
+			for (auto const & child_id : node.value("children", json::array()))
+			{
+				recursive_func(child_id.get<std::size_t>(), transform, depth + 1);
+			}
+		};
+
+		auto scene_id = gltf.value("scene", std::size_t(0));
+		if (scene_id < scenes.size())
+		{
+			for (auto const & node_id : scenes[scene_id].value("nodes", json::array()))
+			{
+				recursive_func(node_id.get<std::size_t>(), glm::mat4(1), 0);
+			}
+		}
+
+		// The meshes don't move anymore, so every primitive converts straight into its mesh.
+		std::vector<std::future<bool>> job_futures;
+		job_futures.reserve(jobs.size());
+		for (auto const & job : jobs)
+		{
+			job_futures.push_back(tasks.Enqueue([&document, &model, job]()
+			{
+				return LoadPrimitive(document, *job.m_primitive, model->m_meshes[job.m_mesh_id]);
+			}));
+		}
+
+		std::vector<std::unique_ptr<TextureData>> images(image_futures.size());
+		for (std::size_t i = 0; i < image_futures.size(); i++)
+		{
+			if (image_futures[i])
+			{
+				images[i] = image_futures[i]->get();
+			}
+		}
+
+		for (auto const & material : materials)
+		{
+			model->m_materials.push_back(LoadMaterial(gltf, material, images));
+		}
+
+		// Meshes of invalid primitives are removed, with the nodes that place them.
+		std::vector<std::uint32_t> mesh_remap(model->m_meshes.size(), std::numeric_limits<std::uint32_t>::max());
+		std::vector<MeshData> loaded;
+		loaded.reserve(model->m_meshes.size());
+		for (std::size_t i = 0; i < job_futures.size(); i++)
+		{
+			if (job_futures[i].get())
+			{
+				mesh_remap[i] = static_cast<std::uint32_t>(loaded.size());
+				loaded.push_back(std::move(model->m_meshes[i]));
+			}
+			else
+			{
+				LOGW("Skipping a primitive of glTF file {} with invalid data", path);
+			}
+		}
+		model->m_meshes = std::move(loaded);
+
+		auto& model_nodes = model->m_nodes;
+		model_nodes.erase(std::remove_if(model_nodes.begin(), model_nodes.end(), [&](auto const & node)
+		{
+			return mesh_remap[node.m_mesh_id] == std::numeric_limits<std::uint32_t>::max();
+		}), model_nodes.end());
+		for (auto& node : model_nodes)
+		{
+			node.m_mesh_id = mesh_remap[node.m_mesh_id];
+		}
+
+		return model;
+	}
+
+} /* internal */
+
+GLTFModelLoader::GLTFModelLoader()
+	: ResourceLoader(std::vector<std::string>{ "gltf", "glb" })
+{
+
+}
+
+GLTFModelLoader::AnonResource GLTFModelLoader::LoadFromDisc(std::string const & path, util::ThreadPool* thread_pool)
+{
+	try
+	{
+		return internal::LoadModel(path, thread_pool);
+	}
+	catch (nlohmann::json::exception const & e)
+	{
+		LOGW("Invalid glTF file {}: {}", path, e.what());
+		return nullptr;
+	}
+}
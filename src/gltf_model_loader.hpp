@@ -0,0 +1,23 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include "resource_loader.hpp"
+
+#include "resource_structs.hpp"
+
+// Loads glTF 2.0 and GLB files. Buffers are memory mapped instead of read, and accessors are converted from the
+// mapped memory to the meshes directly, a primitive per task. EXT_meshopt_compression buffer views are decoded first,
+// a buffer view per task. The tasks run on the thread pool passed to `Load`, or on the calling thread without one.
+class GLTFModelLoader : public ResourceLoader<ModelData>
+{
+public:
+	GLTFModelLoader();
+	~GLTFModelLoader() final = default;
+
+	AnonResource LoadFromDisc(std::string const & path, util::ThreadPool* thread_pool) final;
+};
@@ -11,6 +11,7 @@
 #include "gpu_buffers.hpp"
 #include "../util/log.hpp"
 #include "gfx_defines.hpp"
+#include "gfx_enums.hpp"
 
 gfx::AccelerationStructure::AccelerationStructure(Context* context)
 	: m_context(context)
@@ -112,7 +113,7 @@ void gfx::AccelerationStructure::CreateBottomLevel(CommandList* cmd_list, std::v
 		geom.geometry.triangles.indexData = desc.m_ib->m_buffer;
 		geom.geometry.triangles.indexOffset = desc.m_indices_offset;
 		geom.geometry.triangles.indexCount = desc.m_num_indices;
-		geom.geometry.triangles.indexType = VK_INDEX_TYPE_UINT32;
+		geom.geometry.triangles.indexType = enums::IndexTypeFromStride(desc.m_index_stride);
 		geom.geometry.triangles.transformData = VK_NULL_HANDLE;
 		geom.geometry.triangles.transformOffset = 0;
 		geom.geometry.aabbs = {};
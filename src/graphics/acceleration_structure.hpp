@@ -31,6 +31,7 @@ namespace gfx
 		std::uint32_t m_vertices_offset = 0u;
 		std::uint32_t m_indices_offset = 0u;
 		std::uint32_t m_vertex_stride = 0u;
+		std::uint32_t m_index_stride = 4u; // 2 or 4 bytes.
 	};
 	
 	class AccelerationStructure;
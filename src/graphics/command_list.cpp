@@ -6,6 +6,7 @@
 
 #include "command_list.hpp"
 
+#include <algorithm>
 #include <array>
 
 #include "shader_table.hpp"
@@ -165,7 +166,7 @@ void gfx::CommandList::BindVertexBuffer(GPUBuffer* buffer, std::uint64_t offset)
 
 void gfx::CommandList::BindIndexBuffer(GPUBuffer* buffer, std::uint64_t stride, std::uint64_t offset)
 {
-	vkCmdBindIndexBuffer(m_cmd_buffers[m_frame_idx], buffer->m_buffer, offset, stride == 4 ? VkIndexType::VK_INDEX_TYPE_UINT32 : VkIndexType::VK_INDEX_TYPE_UINT16);
+	vkCmdBindIndexBuffer(m_cmd_buffers[m_frame_idx], buffer->m_buffer, offset, enums::IndexTypeFromStride(stride));
 }
 
 void gfx::CommandList::BindDescriptorHeap(RootSignature* root_signature, std::vector<std::pair<DescriptorHeap*, std::uint32_t>> sets)
@@ -217,30 +218,44 @@ void gfx::CommandList::StageBuffer(GPUBuffer* buffer, GPUBuffer* staging_buffer,
 
 void gfx::CommandList::StageTexture(StagingTexture* texture)
 {
-	VkBufferImageCopy region = {};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
-
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = 1;
-
-	region.imageOffset = {0, 0, 0};
-	region.imageExtent = {
-		texture->m_desc.m_width,
-		texture->m_desc.m_height,
-		1
-	};
+	auto const & desc = texture->m_desc;
+
+	// One region per mip level when the staged pixels contain the mips.
+	std::vector<VkBufferImageCopy> regions;
+	VkDeviceSize offset = 0;
+	for (std::uint32_t level = 0; level < (desc.m_upload_mips ? desc.m_mip_levels : 1); level++)
+	{
+		auto width = std::max(desc.m_width >> level, 1u);
+		auto height = std::max(desc.m_height >> level, 1u);
+
+		VkBufferImageCopy region = {};
+		region.bufferOffset = offset;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = level;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = 1;
+
+		region.imageOffset = {0, 0, 0};
+		region.imageExtent = {
+			width,
+			height,
+			1
+		};
+
+		regions.push_back(region);
+		offset += enums::MipSizeInBytes(desc.m_format, width, height);
+	}
 
 	vkCmdCopyBufferToImage(
 		m_cmd_buffers[m_frame_idx],
 		texture->m_buffer,
 		texture->m_texture,
 		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		1,
-		&region
+		static_cast<std::uint32_t>(regions.size()),
+		regions.data()
 	);
 }
 
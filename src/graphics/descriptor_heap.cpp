@@ -267,27 +267,13 @@ std::uint32_t gfx::DescriptorHeap::CreateSRVSetFromTexture(std::vector<StagingTe
 	}
 
 	std::vector<VkDescriptorImageInfo> image_infos;
+	std::vector<VkImageView> views;
 
 	for (auto& t : texture)
 	{
-		// image view
-		VkImageViewCreateInfo view_info = {};
-		view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-		view_info.image = t->m_texture;
-		view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-		view_info.format = t->m_desc.m_format;
-		view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-		view_info.subresourceRange.baseMipLevel = 0;
-		view_info.subresourceRange.levelCount = t->m_desc.m_mip_levels;
-		view_info.subresourceRange.baseArrayLayer = 0;
-		view_info.subresourceRange.layerCount = 1;
-
-		VkImageView new_view;
-		if (vkCreateImageView(logical_device, &view_info, nullptr, &new_view) != VK_SUCCESS)
-		{
-			LOGC("Failed to create texture image view!");
-		}
+		auto new_view = CreateTextureView(t);
 		m_image_views.push_back(new_view);
+		views.push_back(new_view);
 
 		VkDescriptorImageInfo image_info = {};
 		image_info.imageLayout = sampler_desc.has_value() ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;;
@@ -297,6 +283,7 @@ std::uint32_t gfx::DescriptorHeap::CreateSRVSetFromTexture(std::vector<StagingTe
 	}
 
 	auto descriptor_set_id = m_descriptor_sets[frame_idx].size() - 1;
+	m_texture_sets[descriptor_set] = { sampler_desc, new_sampler, views };
 
 	VkWriteDescriptorSet descriptor_write = {};
 	descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
@@ -314,6 +301,65 @@ std::uint32_t gfx::DescriptorHeap::CreateSRVSetFromTexture(std::vector<StagingTe
 	return descriptor_set_id;
 }
 
+void gfx::DescriptorHeap::UpdateSRVSetFromTexture(std::uint32_t descriptor_set_id, std::vector<StagingTexture*> texture, std::uint32_t handle, std::uint32_t frame_idx)
+{
+	auto logical_device = m_context->m_logical_device;
+	auto descriptor_set = m_descriptor_sets[frame_idx][descriptor_set_id];
+
+	auto it = m_texture_sets.find(descriptor_set);
+	if (it == m_texture_sets.end())
+	{
+		LOGE("Can't update a descriptor set that wasn't created from textures.");
+		return;
+	}
+	auto& texture_set = it->second;
+
+	// The views and the sampler depend on the number of mip levels, so they are recreated.
+	for (auto view : texture_set.m_views)
+	{
+		std::erase(m_image_views, view);
+		vkDestroyImageView(logical_device, view, nullptr);
+	}
+	texture_set.m_views.clear();
+
+	if (texture_set.m_sampler_desc.has_value())
+	{
+		std::erase(m_image_samplers, texture_set.m_sampler);
+		vkDestroySampler(logical_device, texture_set.m_sampler, nullptr);
+
+		texture_set.m_sampler = CreateSampler(texture_set.m_sampler_desc.value(), texture[0]->m_desc.m_mip_levels);
+		m_image_samplers.push_back(texture_set.m_sampler);
+	}
+
+	std::vector<VkDescriptorImageInfo> image_infos;
+
+	for (auto& t : texture)
+	{
+		auto new_view = CreateTextureView(t);
+		m_image_views.push_back(new_view);
+		texture_set.m_views.push_back(new_view);
+
+		VkDescriptorImageInfo image_info = {};
+		image_info.imageLayout = texture_set.m_sampler_desc.has_value() ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+		image_info.imageView = new_view;
+		image_info.sampler = texture_set.m_sampler;
+		image_infos.push_back(image_info);
+	}
+
+	VkWriteDescriptorSet descriptor_write = {};
+	descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	descriptor_write.dstSet = descriptor_set;
+	descriptor_write.dstBinding = handle;
+	descriptor_write.dstArrayElement = 0;
+	descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	descriptor_write.descriptorCount = image_infos.size();
+	descriptor_write.pBufferInfo = nullptr;
+	descriptor_write.pImageInfo = image_infos.data();
+	descriptor_write.pTexelBufferView = nullptr;
+
+	vkUpdateDescriptorSets(logical_device, 1u, &descriptor_write, 0, nullptr);
+}
+
 std::uint32_t gfx::DescriptorHeap::CreateUAVSetFromTexture(std::vector<Texture*> texture, RootSignature* root_signature, std::uint32_t handle, std::uint32_t frame_idx, std::optional<SamplerDesc> sampler_desc)
 {
 	auto logical_device = m_context->m_logical_device;
@@ -652,6 +698,28 @@ std::uint32_t gfx::DescriptorHeap::CreateUAVSetFromRT(RenderTarget* render_targe
 }
 
 
+VkImageView gfx::DescriptorHeap::CreateTextureView(StagingTexture* texture)
+{
+	VkImageViewCreateInfo view_info = {};
+	view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	view_info.image = texture->m_texture;
+	view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	view_info.format = texture->m_desc.m_format;
+	view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	view_info.subresourceRange.baseMipLevel = 0;
+	view_info.subresourceRange.levelCount = texture->m_desc.m_mip_levels;
+	view_info.subresourceRange.baseArrayLayer = 0;
+	view_info.subresourceRange.layerCount = 1;
+
+	VkImageView new_view;
+	if (vkCreateImageView(m_context->m_logical_device, &view_info, nullptr, &new_view) != VK_SUCCESS)
+	{
+		LOGC("Failed to create texture image view!");
+	}
+
+	return new_view;
+}
+
 VkSampler gfx::DescriptorHeap::CreateSampler(SamplerDesc sampler_desc, std::uint32_t num_mips)
 {
 	auto logical_device = m_context->m_logical_device;
@@ -10,6 +10,7 @@
 #include <vector>
 #include <cstdint>
 #include <optional>
+#include <unordered_map>
 
 #include "gfx_enums.hpp"
 
@@ -70,6 +71,9 @@ namespace gfx
 				std::uint32_t handle, std::uint32_t frame_idx, std::optional<SamplerDesc> sampler_desc = m_default_sampler_desc);
 		std::uint32_t CreateSRVSetFromTexture(std::vector<StagingTexture*> texture, VkDescriptorSetLayout layout, // TODO: Change this to texture instead of staging texture.
 				std::uint32_t handle, std::uint32_t frame_idx, std::optional<SamplerDesc> sampler_desc = m_default_sampler_desc);
+		// Points a set created by `CreateSRVSetFromTexture` at other textures, which may have a different number of mip
+		// levels. The set can't be in use by the GPU.
+		void UpdateSRVSetFromTexture(std::uint32_t descriptor_set_id, std::vector<StagingTexture*> texture, std::uint32_t handle, std::uint32_t frame_idx);
 		std::uint32_t CreateUAVSetFromTexture(std::vector<Texture*> texture, RootSignature* root_signature,
 				std::uint32_t handle, std::uint32_t frame_idx, std::optional<SamplerDesc> sampler_desc = m_default_sampler_desc);
 		std::uint32_t CreateSRVSetFromRT(RenderTarget* render_target, RootSignature* root_signature,
@@ -82,6 +86,14 @@ namespace gfx
 			std::uint32_t handle, std::uint32_t frame_idx, SamplerDesc sampler_desc = m_default_sampler_desc, std::optional<float> mip_level = std::nullopt);
 
 	private:
+		struct TextureSet
+		{
+			std::optional<SamplerDesc> m_sampler_desc;
+			VkSampler m_sampler;
+			std::vector<VkImageView> m_views;
+		};
+
+		VkImageView CreateTextureView(StagingTexture* texture);
 		VkSampler CreateSampler(SamplerDesc sampler, std::uint32_t num_mips = 1);
 
 		Context* m_context;
@@ -92,6 +104,7 @@ namespace gfx
 		std::vector<std::vector<VkDescriptorSet>> m_descriptor_sets; // first array is versions second array is sets
 		std::vector<VkImageView> m_image_views; // stores image views for textures.
 		std::vector<VkSampler> m_image_samplers; // store sampler for textures.
+		std::unordered_map<VkDescriptorSet, TextureSet> m_texture_sets; // Sets created from staging textures.
 	};
 
 } /* gfx */
\ No newline at end of file
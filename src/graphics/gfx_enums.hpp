@@ -104,6 +104,8 @@ namespace gfx::enums
 			case VK_FORMAT_B8G8R8A8_SRGB:
 			case VK_FORMAT_R8G8B8A8_SRGB:
 				return 32;
+			case VK_FORMAT_R8_UNORM:
+				return 8;
 
 			default:
 				LOGW("Unsupported format in bytes per pixel returning 4");
@@ -116,4 +118,43 @@ namespace gfx::enums
 		return BitsPerPixel(format) / 8;
 	}
 
+	// Bytes of a 4x4 block of a block compressed format. 0 for other formats.
+	inline std::size_t BytesPerBlock(VkFormat format)
+	{
+		switch(format)
+		{
+			case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+			case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+			case VK_FORMAT_BC4_UNORM_BLOCK:
+				return 8;
+			case VK_FORMAT_BC3_UNORM_BLOCK:
+			case VK_FORMAT_BC3_SRGB_BLOCK:
+			case VK_FORMAT_BC5_UNORM_BLOCK:
+			case VK_FORMAT_BC7_UNORM_BLOCK:
+			case VK_FORMAT_BC7_SRGB_BLOCK:
+				return 16;
+
+			default:
+				return 0;
+		}
+	}
+
+	inline std::size_t MipSizeInBytes(VkFormat format, std::uint32_t width, std::uint32_t height)
+	{
+		if (auto block_size = BytesPerBlock(format); block_size > 0)
+		{
+			return static_cast<std::size_t>((width + 3) / 4) * ((height + 3) / 4) * block_size;
+		}
+
+		return static_cast<std::size_t>(width) * height * BytesPerPixel(format);
+	}
+
+	// Index buffers are 16 or 32 bit. 8 bit indices need VK_EXT_index_type_uint8, so the model pool widens them on import.
+	inline VkIndexType IndexTypeFromStride(std::uint64_t stride)
+	{
+		return stride == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	}
+
 }
\ No newline at end of file
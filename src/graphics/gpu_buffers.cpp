@@ -6,6 +6,8 @@
 
 #include "gpu_buffers.hpp"
 
+#include <algorithm>
+
 #include "../util/log.hpp"
 #include "context.hpp"
 #include "gfx_defines.hpp"
@@ -16,6 +18,18 @@ constexpr inline T SizeAlignTwoPower(T size, A alignment)
 	return (size + (alignment - 1U)) & ~(alignment - 1U);
 }
 
+// Size of the pixels staged for a texture.
+inline std::size_t StagingSizeInBytes(gfx::Texture::Desc const & desc)
+{
+	std::size_t size = gfx::enums::MipSizeInBytes(desc.m_format, desc.m_width, desc.m_height);
+	for (std::uint32_t level = 1; desc.m_upload_mips && level < desc.m_mip_levels; level++)
+	{
+		size += gfx::enums::MipSizeInBytes(desc.m_format, std::max(desc.m_width >> level, 1u), std::max(desc.m_height >> level, 1u));
+	}
+
+	return size;
+}
+
 template<typename T, typename A>
 constexpr inline T SizeAlignAnyAlignment(T size, A alignment)
 {
@@ -238,6 +252,11 @@ bool gfx::Texture::HasMipMaps()
 	return m_desc.m_mip_levels > 1;
 }
 
+bool gfx::Texture::HasUploadedMipMaps()
+{
+	return m_desc.m_mip_levels > 1 && m_desc.m_upload_mips;
+}
+
 void gfx::Texture::CreateImageAndMemory(VkImageTiling tiling, VkImageUsageFlags usage, VmaMemoryUsage memory_usage,
 										VkImage& image, VmaAllocation& allocation)
 {
@@ -271,7 +290,7 @@ void gfx::Texture::CreateImageAndMemory(VkImageTiling tiling, VkImageUsageFlags
 }
 
 gfx::StagingTexture::StagingTexture(Context* context, std::optional<MemoryPool*> pool, Desc desc)
-		: GPUBuffer(context, pool, desc.m_width * desc.m_height * enums::BytesPerPixel(desc.m_format)), Texture(context, pool, desc)
+		: GPUBuffer(context, pool, StagingSizeInBytes(desc)), Texture(context, pool, desc)
 {
 	CreateBufferAndMemory(pool, m_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU,
 	                      m_buffer, m_buffer_allocation);
@@ -281,7 +300,7 @@ gfx::StagingTexture::StagingTexture(Context* context, std::optional<MemoryPool*>
 }
 
 gfx::StagingTexture::StagingTexture(Context* context, std::optional<MemoryPool*> pool, Desc desc, void* pixels)
-		: GPUBuffer(context, pool, desc.m_width * desc.m_height * enums::BytesPerPixel(desc.m_format)), Texture(context, pool, desc)
+		: GPUBuffer(context, pool, StagingSizeInBytes(desc)), Texture(context, pool, desc)
 {
 	CreateBufferAndMemory(pool, m_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU,
 	                      m_buffer, m_buffer_allocation);
@@ -105,12 +105,15 @@ namespace gfx
 			std::uint32_t m_array_size = 1u;
 			std::uint32_t m_mip_levels = 1u;
 			bool m_is_hdr = false;
+			// The pixels of a staging texture contain every mip level, largest first. Mips aren't generated on the GPU.
+			bool m_upload_mips = false;
 		};
 
 		Texture(Context* context, std::optional<MemoryPool*> pool, Desc desc);
 		virtual ~Texture();
 
 		bool HasMipMaps();
+		bool HasUploadedMipMaps();
 
 	protected:
 		void CreateImageAndMemory(VkImageTiling tiling, VkImageUsageFlags usage, VmaMemoryUsage memory_usage,
@@ -6,11 +6,15 @@
 
 #include "vk_material_pool.hpp"
 
+#include <algorithm>
+#include <utility>
+
 #include "../texture_pool.hpp"
 #include "gpu_buffers.hpp"
 #include "descriptor_heap.hpp"
 #include "../util/log.hpp"
 #include "context.hpp"
+#include "gfx_settings.hpp"
 #include "../buffer_definitions.hpp"
 
 gfx::VkMaterialPool::VkMaterialPool(gfx::Context* context)
@@ -21,9 +25,10 @@ gfx::VkMaterialPool::VkMaterialPool(gfx::Context* context)
 	auto logical_device = context->m_logical_device;
 
 	gfx::DescriptorHeap::Desc desc;
-	desc.m_versions = 1;
+	desc.m_versions = gfx::settings::num_back_buffers;
 	desc.m_num_descriptors = 300;
 	m_desc_heap = new gfx::DescriptorHeap(m_context, desc);
+	m_queued_texture_updates.resize(desc.m_versions);
 
 	// TODO: make this entire layout static and use it when creating root signatures.
 	std::vector<VkDescriptorSetLayoutBinding> parameters(1);
@@ -111,6 +116,46 @@ gfx::DescriptorHeap* gfx::VkMaterialPool::GetDescriptorHeap()
 	return m_desc_heap;
 }
 
+void gfx::VkMaterialPool::QueueTextureUpdates(std::vector<std::uint32_t> const & texture_ids)
+{
+	for (auto& queued : m_queued_texture_updates)
+	{
+		queued.insert(queued.end(), texture_ids.begin(), texture_ids.end());
+	}
+}
+
+void gfx::VkMaterialPool::UpdateTextures(std::uint32_t frame_idx, TexturePool* texture_pool)
+{
+	auto version = frame_idx % m_queued_texture_updates.size();
+	auto texture_ids = std::exchange(m_queued_texture_updates[version], {});
+	if (texture_ids.empty())
+	{
+		return;
+	}
+
+	for (auto const & [material_id, handle] : m_material_handles)
+	{
+		std::vector<std::uint32_t> texture_handles = {
+			handle.m_albedo_texture_handle,
+			handle.m_normal_texture_handle,
+			handle.m_roughness_texture_handle,
+			handle.m_thickness_texture_handle,
+			handle.m_displacement_texture_handle,
+			handle.m_emissive_texture_handle
+		};
+
+		bool uses_texture = std::any_of(texture_handles.begin(), texture_handles.end(), [&](auto texture_handle)
+		{
+			return std::find(texture_ids.begin(), texture_ids.end(), texture_handle) != texture_ids.end();
+		});
+
+		if (uses_texture)
+		{
+			m_desc_heap->UpdateSRVSetFromTexture(m_descriptor_sets[material_id], texture_pool->GetTextures(texture_handles), 2, version);
+		}
+	}
+}
+
 void gfx::VkMaterialPool::Update(MaterialHandle handle, MaterialData const & data)
 {
 	cb::BasicMaterial material_cb_data;
@@ -144,7 +189,12 @@ void gfx::VkMaterialPool::Load_Impl(MaterialHandle& handle, MaterialData const &
 
 	// TODO: memory pool
 	auto buffer = new gfx::GPUBuffer(m_context, std::nullopt, sizeof(cb::BasicMaterial), gfx::enums::BufferUsageFlag::CONSTANT_BUFFER);
-	auto descriptor_cb_set_id = m_desc_heap->CreateSRVFromCB(buffer, m_material_cb_set_layout, 3, 0);
+	// Every version gets the same sets in the same order, so the IDs are the same for every version.
+	std::uint32_t descriptor_cb_set_id = 0;
+	for (std::uint32_t version = 0; version < m_queued_texture_updates.size(); version++)
+	{
+		descriptor_cb_set_id = m_desc_heap->CreateSRVFromCB(buffer, m_material_cb_set_layout, 3, version);
+	}
 
 	cb::BasicMaterial material_cb_data;
 	material_cb_data.color = glm::vec3(data.m_base_color[0], data.m_base_color[1], data.m_base_color[2]);
@@ -173,10 +223,15 @@ void gfx::VkMaterialPool::Load_Impl(MaterialHandle& handle, MaterialData const &
 		handle.m_displacement_texture_handle,
 		handle.m_emissive_texture_handle
 	});
-	auto descriptor_set_id = m_desc_heap->CreateSRVSetFromTexture(textures, m_material_set_layout, 2, 0, sampler_desc);
+	std::uint32_t descriptor_set_id = 0;
+	for (std::uint32_t version = 0; version < m_queued_texture_updates.size(); version++)
+	{
+		descriptor_set_id = m_desc_heap->CreateSRVSetFromTexture(textures, m_material_set_layout, 2, version, sampler_desc);
+	}
 	handle.m_material_set_id = descriptor_set_id;
 	handle.m_material_cb_set_id = descriptor_cb_set_id;
 
 	m_descriptor_sets.insert({ handle.m_material_id, descriptor_set_id }); //TODO: Unhardcode this handle (1). We want this to be a global static. see line 25
 	m_descriptor_cb_sets.insert({ handle.m_material_id, descriptor_cb_set_id }); //TODO: Unhardcode this handle (1). We want this to be a global static. see line 25
+	m_material_handles.insert({ handle.m_material_id, handle });
 }
\ No newline at end of file
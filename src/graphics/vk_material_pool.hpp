@@ -30,6 +30,11 @@ namespace gfx
 		std::uint32_t GetCBDescriptorSetID(MaterialHandle handle);
 		gfx::GPUBuffer* GetCBBuffer(MaterialHandle handle);
 		gfx::DescriptorHeap* GetDescriptorHeap();
+		// Every material has a version of its descriptor sets per back buffer. Replaced textures are queued for every
+		// version, and `UpdateTextures` points the versions of `frame_idx` of the materials that use them at the current
+		// textures. Frame `frame_idx` can't be in flight.
+		void QueueTextureUpdates(std::vector<std::uint32_t> const & texture_ids);
+		void UpdateTextures(std::uint32_t frame_idx, TexturePool* texture_pool);
 
 	private:
 		void Load_Impl(MaterialHandle& handle, MaterialData const & data, TexturePool* texture_pool) final;
@@ -40,6 +45,8 @@ namespace gfx
 		std::unordered_map<std::uint32_t, std::uint32_t> m_descriptor_sets;
 		std::unordered_map<std::uint32_t, std::uint32_t> m_descriptor_cb_sets;
 		std::unordered_map<std::uint32_t, gfx::GPUBuffer*> m_constant_buffers;
+		std::unordered_map<std::uint32_t, MaterialHandle> m_material_handles;
+		std::vector<std::vector<std::uint32_t>> m_queued_texture_updates; // By version.
 
 		gfx::DescriptorHeap* m_desc_heap;
 	};
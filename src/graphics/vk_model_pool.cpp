@@ -11,6 +11,7 @@
 #include "gpu_buffers.hpp"
 #include "descriptor_heap.hpp"
 #include "../engine_registry.hpp"
+#include "../vertex.hpp"
 
 gfx::VkModelPool::VkModelPool(Context* context)
 		: ModelPool(), m_context(context)
@@ -90,6 +91,11 @@ ModelHandle::MeshOffsets gfx::VkModelPool::AllocateMesh(void* vertex_data, std::
 	return offsets;
 }
 
+bool gfx::VkModelPool::IsVertexStrideSupported(std::uint32_t vertex_stride) const
+{
+	return vertex_stride == sizeof(Vertex);
+}
+
 void gfx::VkModelPool::AllocateMeshShadingBuffers(std::vector<std::uint32_t> vertex_indices, std::vector<std::uint8_t> flat_indices)
 {
 	auto vi_buffer = new gfx::StagingBuffer(m_context, std::nullopt, std::nullopt, vertex_indices.data(), vertex_indices.size(), sizeof(std::uint32_t), gfx::enums::BufferUsageFlag::INDEX_BUFFER);
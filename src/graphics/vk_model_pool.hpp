@@ -34,6 +34,9 @@ namespace gfx
 		gfx::DescriptorHeap* GetDescriptorHeap();
 
 	protected:
+		// The mesh shading and ray tracing shaders read the vertex buffer as `Vertex`.
+		bool IsVertexStrideSupported(std::uint32_t vertex_stride) const final;
+
 		Context* m_context;
 
 	public:
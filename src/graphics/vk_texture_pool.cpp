@@ -6,9 +6,14 @@
 
 #include "vk_texture_pool.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
 #include "command_list.hpp"
 #include "gpu_buffers.hpp"
 #include "descriptor_heap.hpp"
+#include "gfx_settings.hpp"
 #include "../util/log.hpp"
 
 gfx::VkTexturePool::VkTexturePool(gfx::Context* context)
@@ -18,6 +23,21 @@ gfx::VkTexturePool::VkTexturePool(gfx::Context* context)
 
 gfx::VkTexturePool::~VkTexturePool()
 {
+	for (auto& job : m_streaming_jobs)
+	{
+		delete job.second.get();
+	}
+	m_streaming_jobs.clear();
+
+	for (auto& retired : m_retired_resources)
+	{
+		for (auto texture : retired.m_textures)
+		{
+			delete texture;
+		}
+	}
+	m_retired_resources.clear();
+
 	for (auto& texture : m_staged_textures)
 	{
 		delete texture.second;
@@ -31,32 +51,214 @@ gfx::VkTexturePool::~VkTexturePool()
 	m_queued_for_staging_textures.clear();
 }
 
-void gfx::VkTexturePool::Load_Impl(TextureData const & data, std::uint32_t id, bool mipmap, bool srgb)
+namespace internal
 {
-	auto desc = StagingTexture::Desc();
-	desc.m_width = data.m_width;
-	desc.m_height = data.m_height;
-	desc.m_channels = data.m_channels;
-	desc.m_mip_levels = mipmap ? static_cast<std::uint32_t>(std::floor(std::log2(std::max(desc.m_width, desc.m_height)))) + 1 : 1;
-	desc.m_mip_levels = std::clamp(desc.m_mip_levels, 1u, 16u);
 
-	if (data.m_is_hdr && srgb)
+	gfx::StagingTexture::Desc GetTextureDesc(TextureData const & data, bool mipmap, bool srgb)
 	{
-		LOGW("A texture is specified as HDR and SRGB. This is not supported. Using the HDR format instead.");
+		auto desc = gfx::StagingTexture::Desc();
+		desc.m_width = data.m_width;
+		desc.m_height = data.m_height;
+		desc.m_channels = data.m_channels;
+
+		// Textures processed on the CPU contain their mips. Otherwise the mips are generated on the GPU.
+		if (data.m_num_mips > 1 || data.m_compression != TextureCompression::NONE)
+		{
+			desc.m_mip_levels = data.m_num_mips;
+			desc.m_upload_mips = true;
+		}
+		else
+		{
+			desc.m_mip_levels = mipmap ? static_cast<std::uint32_t>(std::floor(std::log2(std::max(desc.m_width, desc.m_height)))) + 1 : 1;
+			desc.m_mip_levels = std::clamp(desc.m_mip_levels, 1u, 16u);
+		}
+
+		switch (data.m_compression)
+		{
+		case TextureCompression::BC1:
+			desc.m_format = srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+			break;
+		case TextureCompression::BC3:
+			desc.m_format = srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+			break;
+		case TextureCompression::BC4:
+			desc.m_format = VK_FORMAT_BC4_UNORM_BLOCK;
+			break;
+		case TextureCompression::BC5:
+			desc.m_format = VK_FORMAT_BC5_UNORM_BLOCK;
+			break;
+		case TextureCompression::BC7:
+			desc.m_format = srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+			break;
+		default:
+			if (data.m_is_hdr)
+			{
+				desc.m_format = VK_FORMAT_R32G32B32A32_SFLOAT;
+			}
+			else if (data.m_pixel_channels == 1)
+			{
+				// Grey textures hold linear data such as displacement.
+				desc.m_format = VK_FORMAT_R8_UNORM;
+			}
+			else
+			{
+				desc.m_format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+			}
+			break;
+		}
+
+		return desc;
+	}
+
+} /* internal */
+
+void gfx::VkTexturePool::EnableStreaming(TextureResidencySettings const & settings, std::uint32_t num_threads)
+{
+	std::lock_guard<std::mutex> lock(m_streaming_mutex);
+	m_residency_manager = std::make_unique<TextureResidencyManager>(settings);
+	m_streaming_thread_pool = std::make_unique<util::ThreadPool>(std::max(num_threads, 1u));
+	m_retired_resources.resize(gfx::settings::num_back_buffers);
+}
+
+bool gfx::VkTexturePool::IsStreaming()
+{
+	std::lock_guard<std::mutex> lock(m_streaming_mutex);
+	return m_residency_manager != nullptr;
+}
+
+void gfx::VkTexturePool::RequestScreenSize(std::uint32_t id, float screen_size)
+{
+	std::lock_guard<std::mutex> lock(m_streaming_mutex);
+	if (m_residency_manager)
+	{
+		m_residency_manager->RequestScreenSize(id, screen_size);
+	}
+}
+
+bool gfx::VkTexturePool::UpdateStreaming(std::uint32_t frame_idx)
+{
+	std::lock_guard<std::mutex> lock(m_streaming_mutex);
+	if (!m_residency_manager)
+	{
+		return false;
+	}
+
+	// The last frame that used these completed before this frame index was acquired again.
+	auto& retired = m_retired_resources[frame_idx];
+	for (auto texture : retired.m_staging_textures)
+	{
+		texture->FreeStagingResources();
+	}
+	for (auto texture : retired.m_textures)
+	{
+		delete texture;
+	}
+	retired = {};
+
+	for (auto const & change : m_residency_manager->Update())
+	{
+		// Nodes of unordered maps are stable, so the job can keep a reference.
+		auto const & streamed = m_streamed_textures[change.m_id];
+		auto first_mip = change.m_first_mip;
+		m_streaming_jobs.emplace_back(change.m_id, m_streaming_thread_pool->Enqueue([this, &streamed, first_mip]()
+		{
+			return CreateTexture(streamed.m_data, true, streamed.m_srgb, first_mip);
+		}));
 	}
 
-	if (data.m_is_hdr)
+	return std::any_of(m_streaming_jobs.begin(), m_streaming_jobs.end(), [this](auto const & job)
+	{
+		return IsStreamingJobReady(job);
+	});
+}
+
+std::vector<std::uint32_t> gfx::VkTexturePool::GetReplacedTextures()
+{
+	std::lock_guard<std::mutex> lock(m_streaming_mutex);
+	return std::exchange(m_replaced_textures, {});
+}
+
+std::optional<TextureResidencyStats> gfx::VkTexturePool::GetStreamingStats()
+{
+	std::lock_guard<std::mutex> lock(m_streaming_mutex);
+	if (!m_residency_manager)
 	{
-		desc.m_format = VK_FORMAT_R32G32B32A32_SFLOAT;
+		return std::nullopt;
 	}
-	else
+
+	return m_residency_manager->GetStats();
+}
+
+bool gfx::VkTexturePool::IsStreamingJobReady(StreamingJob const & job) const
+{
+	// A texture can be registered before it's staged for the first time.
+	return job.second.wait_for(std::chrono::seconds(0)) == std::future_status::ready && m_staged_textures.find(job.first) != m_staged_textures.end();
+}
+
+gfx::StagingTexture* gfx::VkTexturePool::CreateTexture(TextureData const & data, bool mipmap, bool srgb, std::uint32_t first_mip)
+{
+	auto desc = internal::GetTextureDesc(data, mipmap, srgb);
+	if (first_mip > 0)
 	{
-		desc.m_format = srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+		desc.m_width = data.GetMipWidth(first_mip);
+		desc.m_height = data.GetMipHeight(first_mip);
+		desc.m_mip_levels = data.m_num_mips - first_mip;
 	}
 
 	// TODO: memory pool
-	auto texture = new StagingTexture(m_context, std::nullopt, desc, data.m_pixels);
-	m_queued_for_staging_textures.insert(std::make_pair(id, texture));
+	if (data.m_mip_offsets.empty())
+	{
+		return new StagingTexture(m_context, std::nullopt, desc, static_cast<std::uint8_t*>(data.m_pixels) + data.GetMipOffset(first_mip));
+	}
+
+	// The staging buffer expects the levels tightly packed, largest first.
+	auto texture = new StagingTexture(m_context, std::nullopt, desc);
+	texture->Map();
+	std::size_t offset = 0;
+	for (std::uint32_t level = first_mip; level < data.m_num_mips; level++)
+	{
+		auto size = data.GetMipSizeInBytes(level);
+		texture->Update(static_cast<std::uint8_t*>(data.m_pixels) + data.GetMipOffset(level), size, offset);
+		offset += size;
+	}
+	texture->Unmap();
+
+	return texture;
+}
+
+void gfx::VkTexturePool::Load_Impl(TextureData const & data, std::uint32_t id, bool mipmap, bool srgb)
+{
+	if (data.m_is_hdr && srgb)
+	{
+		LOGW("A texture is specified as HDR and SRGB. This is not supported. Using the HDR format instead.");
+	}
+
+	std::uint32_t first_mip = 0;
+	{
+		std::lock_guard<std::mutex> lock(m_streaming_mutex);
+
+		// Only textures with their mips on the CPU can be streamed.
+		if (m_residency_manager && data.m_num_mips > 1)
+		{
+			std::vector<std::size_t> mip_sizes(data.m_num_mips);
+			for (std::uint32_t level = 0; level < data.m_num_mips; level++)
+			{
+				mip_sizes[level] = data.GetMipSizeInBytes(level);
+			}
+			first_mip = m_residency_manager->Register(id, data.m_width, data.m_height, mip_sizes);
+
+			// The levels are uploaded again whenever the residency changes, so the pixels are kept. Textures mapped
+			// from the processor cache cost address space only.
+			StreamedTexture streamed = { data, srgb };
+			if (!data.m_pixel_storage)
+			{
+				std::memcpy(streamed.m_data.AllocatePixels(data.GetSizeInBytes()), data.m_pixels, data.GetSizeInBytes());
+			}
+			m_streamed_textures.insert({ id, std::move(streamed) });
+		}
+	}
+
+	m_queued_for_staging_textures.insert(std::make_pair(id, CreateTexture(data, mipmap, srgb, first_mip)));
 }
 
 void gfx::VkTexturePool::Stage(gfx::CommandList* command_list)
@@ -67,7 +269,7 @@ void gfx::VkTexturePool::Stage(gfx::CommandList* command_list)
 		command_list->StageTexture(texture.second);
 
 		// Generate mipmaps or transition it to shader read only.
-		if (texture.second->HasMipMaps())
+		if (texture.second->HasMipMaps() && !texture.second->HasUploadedMipMaps())
 		{
 			command_list->GenerateMipMap(texture.second);
 		}
@@ -83,6 +285,34 @@ void gfx::VkTexturePool::Stage(gfx::CommandList* command_list)
 	m_queued_for_staging_textures.clear();
 }
 
+void gfx::VkTexturePool::StageStreaming(gfx::CommandList* command_list, std::uint32_t frame_idx)
+{
+	std::lock_guard<std::mutex> lock(m_streaming_mutex);
+	auto& retired = m_retired_resources[frame_idx];
+	for (auto it = m_streaming_jobs.begin(); it != m_streaming_jobs.end();)
+	{
+		if (!IsStreamingJobReady(*it))
+		{
+			it++;
+			continue;
+		}
+
+		auto id = it->first;
+		auto texture = it->second.get();
+		command_list->TransitionTexture(texture, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		command_list->StageTexture(texture);
+		command_list->TransitionTexture(texture, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		retired.m_textures.push_back(m_staged_textures[id]);
+		retired.m_staging_textures.push_back(texture);
+		m_staged_textures[id] = texture;
+		m_replaced_textures.push_back(id);
+		m_residency_manager->Complete(id);
+
+		it = m_streaming_jobs.erase(it);
+	}
+}
+
 void gfx::VkTexturePool::PostStage()
 {
 	for (auto idx : m_queued_for_release_staging_resources_textures)
@@ -123,6 +353,11 @@ std::vector<gfx::StagingTexture*> gfx::VkTexturePool::GetTextures(std::vector<st
 
 std::vector<gfx::StagingTexture*> gfx::VkTexturePool::GetAllTexturesPadded(std::uint32_t num)
 {
+	if (IsStreaming())
+	{
+		LOGW("Streamed textures are replaced when their residency changes, which invalidates sets of all textures.");
+	}
+
 	std::vector<gfx::StagingTexture*> all_textures;
 	for (auto& texture : m_staged_textures)
 	{
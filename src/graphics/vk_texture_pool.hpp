@@ -7,7 +7,13 @@
 #pragma once
 
 #include "../texture_pool.hpp"
+#include "../texture_residency_manager.hpp"
+#include "../util/thread_pool.hpp"
 
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <unordered_map>
 
 namespace gfx
@@ -17,6 +23,11 @@ namespace gfx
 	class StagingTexture;
 	class DescriptorHeap;
 
+	// Streaming: textures with mips on the CPU start with only their base levels resident. Higher levels are
+	// requested every frame with `RequestScreenSize` and applied by `UpdateStreaming`, which creates the new textures
+	// on a thread pool. `StageStreaming` records the copies of the textures that are ready into the frame and
+	// `GetReplacedTextures` tells which descriptor sets to update. Replaced textures stay alive until the frame index
+	// comes around again, so streaming never waits for the GPU. Other textures are fully resident.
 	class VkTexturePool : public TexturePool
 	{
 	public:
@@ -28,14 +39,56 @@ namespace gfx
 		std::vector<gfx::StagingTexture*> GetTextures(std::vector<std::uint32_t> texture_handles) final;
 		std::vector<gfx::StagingTexture*> GetAllTexturesPadded(std::uint32_t num);
 
+		// Textures loaded afterwards are streamed. Call before loading textures.
+		void EnableStreaming(TextureResidencySettings const & settings, std::uint32_t num_threads = 1);
+		bool IsStreaming();
+		// Requests the levels a texture needs to cover `screen_size` pixels this frame.
+		void RequestScreenSize(std::uint32_t id, float screen_size);
+		// Ends the streaming frame and starts creating textures for the residency changes. Frees what was retired the
+		// last time `frame_idx` was rendered, so that frame can't be in flight. Returns true when textures are ready to
+		// be staged, which requires their first version to be staged.
+		bool UpdateStreaming(std::uint32_t frame_idx);
+		// Records the copies of the textures that are ready into `command_list`, which is executed with frame
+		// `frame_idx`. The textures they replace are retired until `frame_idx` is rendered again.
+		void StageStreaming(gfx::CommandList* command_list, std::uint32_t frame_idx);
+		// Textures replaced by `StageStreaming` since the last call.
+		std::vector<std::uint32_t> GetReplacedTextures();
+		std::optional<TextureResidencyStats> GetStreamingStats();
+
 	private:
+		struct StreamedTexture
+		{
+			TextureData m_data;
+			bool m_srgb;
+		};
+
+		struct RetiredResources
+		{
+			std::vector<StagingTexture*> m_textures; // Replaced textures, deleted.
+			std::vector<StagingTexture*> m_staging_textures; // Staged textures, their staging resources are freed.
+		};
+
+		using StreamingJob = std::pair<std::uint32_t, std::future<StagingTexture*>>;
+
 		void Load_Impl(TextureData const & data, std::uint32_t id, bool mipmap, bool srgb) final;
+		// Expects `m_streaming_mutex` to be locked.
+		bool IsStreamingJobReady(StreamingJob const & job) const;
+		// Texture with the levels of `data` from `first_mip` up.
+		StagingTexture* CreateTexture(TextureData const & data, bool mipmap, bool srgb, std::uint32_t first_mip = 0);
 
 		Context* m_context;
 
 		std::unordered_map<std::uint32_t, StagingTexture*> m_queued_for_staging_textures;
 		std::vector<std::uint32_t> m_queued_for_release_staging_resources_textures;
 		std::unordered_map<std::uint32_t, StagingTexture*> m_staged_textures;
+
+		std::unique_ptr<TextureResidencyManager> m_residency_manager;
+		std::unique_ptr<util::ThreadPool> m_streaming_thread_pool;
+		std::unordered_map<std::uint32_t, StreamedTexture> m_streamed_textures;
+		std::vector<StreamingJob> m_streaming_jobs;
+		std::vector<RetiredResources> m_retired_resources; // By frame index.
+		std::vector<std::uint32_t> m_replaced_textures;
+		std::mutex m_streaming_mutex;
 	};
 
 } /* gfx */
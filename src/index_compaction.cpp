@@ -0,0 +1,172 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "index_compaction.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "meshlet_builder.hpp"
+
+namespace internal
+{
+
+	inline void WriteIndex(unsigned char* ptr, std::uint32_t stride, std::uint32_t value)
+	{
+		switch (stride)
+		{
+		case 1: *ptr = static_cast<std::uint8_t>(value); break;
+		case 2: { auto index = static_cast<std::uint16_t>(value); memcpy(ptr, &index, sizeof(index)); break; }
+		default: memcpy(ptr, &value, sizeof(value)); break;
+		}
+	}
+
+	// Triangles `[m_first_triangle, m_last_triangle)` of a mesh that become a separate mesh.
+	struct MeshPart
+	{
+		std::size_t m_first_triangle;
+		std::size_t m_last_triangle;
+		std::size_t m_num_vertices;
+	};
+
+	template<typename T>
+	inline void CopyVertexAttribute(std::vector<T> const & source, std::vector<std::uint32_t> const & vertices, std::size_t num_vertices, std::vector<T> & out)
+	{
+		if (source.size() < num_vertices)
+		{
+			return;
+		}
+
+		out.reserve(vertices.size());
+		for (auto vertex : vertices)
+		{
+			out.push_back(source[vertex]);
+		}
+	}
+
+} /* internal */
+
+std::uint32_t IndexCompaction::GetIndexStride(std::size_t num_vertices)
+{
+	return num_vertices <= max_16bit_vertices ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+}
+
+void IndexCompaction::SetIndexStride(MeshData & mesh_data, std::uint32_t stride)
+{
+	if (mesh_data.m_indices_stride == stride)
+	{
+		return;
+	}
+
+	std::vector<unsigned char> indices(mesh_data.m_num_indices * stride);
+	for (std::size_t i = 0; i < mesh_data.m_num_indices; i++)
+	{
+		internal::WriteIndex(indices.data() + i * stride, stride, mesh_data.GetIndex(i));
+	}
+
+	mesh_data.m_indices = std::move(indices);
+	mesh_data.m_indices_stride = stride;
+}
+
+std::vector<MeshData> IndexCompaction::Split(MeshData const & mesh_data, std::size_t vertex_size, std::size_t max_vertices)
+{
+	const auto num_vertices = mesh_data.m_positions.size();
+	const auto num_triangles = mesh_data.m_num_indices / 3;
+	if (num_vertices <= max_vertices || num_triangles == 0 || mesh_data.m_indices_stride <= sizeof(std::uint16_t))
+	{
+		return {};
+	}
+
+	// Adds the sequential meshlets to the current part until it runs out of vertices.
+	std::vector<internal::MeshPart> parts;
+	std::vector<std::uint32_t> stamps(num_vertices, 0);
+	std::vector<std::uint8_t> referenced(num_vertices, 0);
+	std::vector<std::uint32_t> meshlet_vertices;
+	std::size_t num_referenced = 0;
+	std::size_t num_part_vertices = 0;
+	std::uint32_t stamp = 1;
+
+	internal::MeshPart part = { 0, 0, 0 };
+	for (std::size_t first = 0; first < num_triangles; first += max_primitive_count_limit)
+	{
+		auto last = std::min<std::size_t>(first + max_primitive_count_limit, num_triangles);
+
+		meshlet_vertices.clear();
+		for (auto i = first * 3; i < last * 3; i++)
+		{
+			auto index = mesh_data.GetIndex(i);
+			if (std::find(meshlet_vertices.begin(), meshlet_vertices.end(), index) == meshlet_vertices.end())
+			{
+				meshlet_vertices.push_back(index);
+			}
+		}
+
+		auto num_new = static_cast<std::size_t>(std::count_if(meshlet_vertices.begin(), meshlet_vertices.end(), [&](auto vertex) { return stamps[vertex] != stamp; }));
+		if (part.m_num_vertices + num_new > max_vertices && part.m_last_triangle > part.m_first_triangle)
+		{
+			parts.push_back(part);
+			num_part_vertices += part.m_num_vertices;
+			part = { first, first, 0 };
+			stamp++;
+			num_new = meshlet_vertices.size();
+		}
+
+		for (auto vertex : meshlet_vertices)
+		{
+			stamps[vertex] = stamp;
+			num_referenced += referenced[vertex] ? 0 : 1;
+			referenced[vertex] = 1;
+		}
+		part.m_last_triangle = last;
+		part.m_num_vertices += num_new;
+	}
+	parts.push_back(part);
+	num_part_vertices += part.m_num_vertices;
+
+	// Only split when it saves memory.
+	auto duplicated_bytes = (num_part_vertices - num_referenced) * vertex_size;
+	auto saved_bytes = mesh_data.m_num_indices * (mesh_data.m_indices_stride - sizeof(std::uint16_t));
+	if (duplicated_bytes >= saved_bytes)
+	{
+		return {};
+	}
+
+	std::vector<MeshData> meshes(parts.size());
+	std::vector<std::uint32_t> remap(num_vertices);
+	std::vector<std::uint32_t> vertices;
+	for (std::size_t p = 0; p < parts.size(); p++)
+	{
+		auto const & info = parts[p];
+		auto& mesh = meshes[p];
+		stamp++;
+
+		mesh.m_material_id = mesh_data.m_material_id;
+		mesh.m_indices_stride = GetIndexStride(info.m_num_vertices);
+		mesh.m_num_indices = (info.m_last_triangle - info.m_first_triangle) * 3;
+		mesh.m_indices.resize(mesh.m_num_indices * mesh.m_indices_stride);
+
+		vertices.clear();
+		for (std::size_t i = 0; i < mesh.m_num_indices; i++)
+		{
+			auto index = mesh_data.GetIndex(info.m_first_triangle * 3 + i);
+			if (stamps[index] != stamp)
+			{
+				stamps[index] = stamp;
+				remap[index] = static_cast<std::uint32_t>(vertices.size());
+				vertices.push_back(index);
+			}
+			mesh.SetIndex(i, remap[index]);
+		}
+
+		internal::CopyVertexAttribute(mesh_data.m_positions, vertices, num_vertices, mesh.m_positions);
+		internal::CopyVertexAttribute(mesh_data.m_normals, vertices, num_vertices, mesh.m_normals);
+		internal::CopyVertexAttribute(mesh_data.m_uvw, vertices, num_vertices, mesh.m_uvw);
+		internal::CopyVertexAttribute(mesh_data.m_tangents, vertices, num_vertices, mesh.m_tangents);
+		internal::CopyVertexAttribute(mesh_data.m_bitangents, vertices, num_vertices, mesh.m_bitangents);
+	}
+
+	return meshes;
+}
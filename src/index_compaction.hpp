@@ -0,0 +1,33 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "resource_structs.hpp"
+
+// Number of vertices a 16 bit index buffer can address.
+static inline const std::size_t max_16bit_vertices = 65536;
+
+// Picks the smallest index size the GPU can bind for a mesh and splits meshes that are too large for 16 bit indices.
+struct IndexCompaction
+{
+	// 2 bytes for meshes with up to `max_16bit_vertices` vertices, 4 otherwise. 8 bit indices aren't returned since
+	// Vulkan can't bind them without an extension.
+	static std::uint32_t GetIndexStride(std::size_t num_vertices);
+
+	// Rewrites the indices of `mesh_data` with `stride` bytes per index. The indices have to fit.
+	static void SetIndexStride(MeshData & mesh_data, std::uint32_t stride);
+
+	// Splits `mesh_data` into meshes of at most `max_vertices` vertices that can use 16 bit indices. Parts end on
+	// multiples of `max_primitive_count_limit` triangles, the boundaries of sequential meshlets, and vertices shared
+	// by parts are duplicated. The parts keep the triangle order, so meshes should be ordered for locality first.
+	// Returns nothing when the mesh already fits or when the duplicated vertices, `vertex_size` bytes each, take more
+	// memory than halving the index buffer saves.
+	static std::vector<MeshData> Split(MeshData const & mesh_data, std::size_t vertex_size, std::size_t max_vertices = max_16bit_vertices);
+};
@@ -23,7 +23,7 @@ MaterialHandle MaterialPool::Load(MaterialData const & data, TexturePool* textur
 	{
 		m_loaded_defaults = true;
 		m_default_albedo_texture = texture_pool->Load("white.png", false);
-		m_default_normal_texture = texture_pool->Load("flat_normal.png", false);
+		m_default_normal_texture = texture_pool->Load("flat_normal.png", false, false, TextureRole::NORMAL);
 		m_default_roughness_metallic_texture = texture_pool->Load("rough1metal0ao1.png", false);
 		m_default_thickness_texture = texture_pool->Load("white.png", false);
 		m_default_emissive_texture = m_default_displacement_texture = texture_pool->Load("black.png", false);
@@ -31,17 +31,27 @@ MaterialHandle MaterialPool::Load(MaterialData const & data, TexturePool* textur
 
 	MaterialHandle handle;
 	handle.m_material_id = new_id;
-	handle.m_albedo_texture_handle = data.m_albedo_texture.m_pixels ? texture_pool->Load(data.m_albedo_texture, true, true) : m_default_albedo_texture;
-	handle.m_normal_texture_handle = data.m_normal_map_texture.m_pixels ? texture_pool->Load(data.m_normal_map_texture, true) : m_default_normal_texture;
-	handle.m_roughness_texture_handle = data.m_roughness_texture.m_pixels ? texture_pool->Load(data.m_roughness_texture, true) : m_default_roughness_metallic_texture;
-	handle.m_thickness_texture_handle = data.m_thickness_texture.m_pixels ? texture_pool->Load(data.m_thickness_texture, true) : m_default_thickness_texture;
-	handle.m_displacement_texture_handle = data.m_displacement_texture.m_pixels ? texture_pool->Load(data.m_displacement_texture, true) : m_default_displacement_texture;
-	handle.m_emissive_texture_handle = data.m_emissive_texture.m_pixels ? texture_pool->Load(data.m_emissive_texture, true) : m_default_emissive_texture;
-
-	m_raw_data[new_id] = data;
+	handle.m_albedo_texture_handle = data.m_albedo_texture.HasContents() ? texture_pool->Load(data.m_albedo_texture, true, true) : m_default_albedo_texture;
+	handle.m_normal_texture_handle = data.m_normal_map_texture.HasContents() ? texture_pool->Load(data.m_normal_map_texture, true, false, TextureRole::NORMAL) : m_default_normal_texture;
+	handle.m_roughness_texture_handle = data.m_roughness_texture.HasContents() ? texture_pool->Load(data.m_roughness_texture, true) : m_default_roughness_metallic_texture;
+	handle.m_thickness_texture_handle = data.m_thickness_texture.HasContents() ? texture_pool->Load(data.m_thickness_texture, true, false, TextureRole::SINGLE_CHANNEL) : m_default_thickness_texture;
+	handle.m_displacement_texture_handle = data.m_displacement_texture.HasContents() ? texture_pool->Load(data.m_displacement_texture, true, false, TextureRole::SINGLE_CHANNEL) : m_default_displacement_texture;
+	handle.m_emissive_texture_handle = data.m_emissive_texture.HasContents() ? texture_pool->Load(data.m_emissive_texture, true, false, TextureRole::COLOR_OPAQUE) : m_default_emissive_texture;
 
 	Load_Impl(handle, data, texture_pool);
 
+	// The textures were uploaded by the texture pool, so only the parameters are kept. This releases the pixels
+	// owned by `data`.
+	auto& raw_data = m_raw_data[new_id];
+	raw_data = data;
+	for (auto texture : { &raw_data.m_albedo_texture, &raw_data.m_metallic_texture, &raw_data.m_roughness_texture, &raw_data.m_ambient_occlusion_texture,
+		&raw_data.m_normal_map_texture, &raw_data.m_emissive_texture, &raw_data.m_thickness_texture, &raw_data.m_displacement_texture })
+	{
+		texture->m_pixels = nullptr;
+		texture->m_pixel_storage.reset();
+		texture->m_source_hash = 0;
+	}
+
 	m_next_id++;
 
 	return handle;
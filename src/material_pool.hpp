@@ -42,7 +42,7 @@ public:
 	MaterialHandle Load(MaterialData const & data, TexturePool* texture_pool);
 	virtual void Update(MaterialHandle handle, MaterialData const & material_data) = 0;
 
-	MaterialData GetRawData(MaterialHandle handle); // This is temporary.
+	MaterialData GetRawData(MaterialHandle handle); // This is temporary. The textures have no pixels.
 
 private:
 	virtual void Load_Impl(MaterialHandle& handle, MaterialData const & data, TexturePool* texture_pool) = 0;
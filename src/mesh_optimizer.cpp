@@ -0,0 +1,408 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <glm.hpp>
+
+namespace internal
+{
+
+	inline std::vector<std::uint32_t> ReadIndices(MeshData const & mesh_data)
+	{
+		std::vector<std::uint32_t> indices(mesh_data.m_num_indices);
+		for (std::size_t i = 0; i < indices.size(); i++)
+		{
+			indices[i] = mesh_data.GetIndex(i);
+		}
+		return indices;
+	}
+
+	// Returns the triangles in tipsified order.
+	// `hard_boundaries` receives the triangle offsets at which the algorithm had to restart from a dead end.
+	// These are the points where the cache is effectively cold, so clusters split there can be reordered freely.
+	inline std::vector<std::uint32_t> Tipsify(std::vector<std::uint32_t> const & indices, std::size_t num_vertices, std::uint32_t cache_size,
+		std::vector<std::uint32_t> & hard_boundaries)
+	{
+		const auto num_triangles = indices.size() / 3;
+
+		// vertex -> triangle adjacency (compressed rows)
+		std::vector<std::uint32_t> live_triangles(num_vertices, 0);
+		for (std::size_t i = 0; i < num_triangles * 3; i++)
+		{
+			live_triangles[indices[i]]++;
+		}
+
+		std::vector<std::uint32_t> adjacency_offsets(num_vertices + 1, 0);
+		for (std::size_t v = 0; v < num_vertices; v++)
+		{
+			adjacency_offsets[v + 1] = adjacency_offsets[v] + live_triangles[v];
+		}
+
+		std::vector<std::uint32_t> adjacency(num_triangles * 3);
+		{
+			std::vector<std::uint32_t> cursor(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+			for (std::size_t i = 0; i < num_triangles * 3; i++)
+			{
+				adjacency[cursor[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+			}
+		}
+
+		std::vector<std::uint32_t> cache_timestamps(num_vertices, 0);
+		std::vector<std::uint8_t> emitted(num_triangles, 0);
+		std::vector<std::uint32_t> dead_end_stack;
+		std::vector<std::uint32_t> candidates;
+		dead_end_stack.reserve(num_triangles * 3);
+
+		std::vector<std::uint32_t> output;
+		output.reserve(num_triangles);
+
+		std::uint32_t timestamp = cache_size + 1;
+		std::size_t cursor = 0;
+
+		auto skip_dead_end = [&]() -> std::int64_t
+		{
+			// Recently referenced vertices that still have triangles left.
+			while (!dead_end_stack.empty())
+			{
+				auto vertex = dead_end_stack.back();
+				dead_end_stack.pop_back();
+				if (live_triangles[vertex] > 0)
+				{
+					return vertex;
+				}
+			}
+
+			// Otherwise the next vertex in input order with triangles left.
+			for (; cursor < num_vertices; cursor++)
+			{
+				if (live_triangles[cursor] > 0)
+				{
+					return static_cast<std::int64_t>(cursor);
+				}
+			}
+
+			return -1;
+		};
+
+		std::int64_t fanning_vertex = num_triangles > 0 ? skip_dead_end() : -1;
+
+		while (fanning_vertex >= 0)
+		{
+			candidates.clear();
+
+			for (auto a = adjacency_offsets[fanning_vertex]; a < adjacency_offsets[fanning_vertex + 1]; a++)
+			{
+				auto triangle = adjacency[a];
+				if (emitted[triangle])
+				{
+					continue;
+				}
+
+				for (std::size_t k = 0; k < 3; k++)
+				{
+					auto vertex = indices[triangle * 3 + k];
+					dead_end_stack.push_back(vertex);
+					candidates.push_back(vertex);
+					live_triangles[vertex]--;
+
+					// not in cache
+					if (timestamp - cache_timestamps[vertex] > cache_size)
+					{
+						cache_timestamps[vertex] = timestamp;
+						timestamp++;
+					}
+				}
+
+				emitted[triangle] = 1;
+				output.push_back(triangle);
+			}
+
+			// Pick the candidate that is still in cache after fanning its remaining triangles, preferring the oldest.
+			std::int64_t next_vertex = -1;
+			std::int64_t best_priority = -1;
+			for (auto vertex : candidates)
+			{
+				if (live_triangles[vertex] == 0)
+				{
+					continue;
+				}
+
+				std::int64_t priority = 0;
+				if (timestamp - cache_timestamps[vertex] + 2 * live_triangles[vertex] <= cache_size)
+				{
+					priority = timestamp - cache_timestamps[vertex];
+				}
+
+				if (priority > best_priority)
+				{
+					best_priority = priority;
+					next_vertex = vertex;
+				}
+			}
+
+			if (next_vertex == -1)
+			{
+				next_vertex = skip_dead_end();
+				if (next_vertex >= 0)
+				{
+					hard_boundaries.push_back(static_cast<std::uint32_t>(output.size()));
+				}
+			}
+
+			fanning_vertex = next_vertex;
+		}
+
+		return output;
+	}
+
+	// Simulates a FIFO cache and returns whether each vertex was a miss.
+	class FIFOCache
+	{
+	public:
+		FIFOCache(std::size_t num_vertices, std::uint32_t cache_size)
+			: m_timestamps(num_vertices, 0), m_timestamp(cache_size + 1), m_cache_size(cache_size)
+		{
+		}
+
+		bool Access(std::uint32_t vertex)
+		{
+			if (m_timestamp - m_timestamps[vertex] > m_cache_size)
+			{
+				m_timestamps[vertex] = m_timestamp++;
+				return true;
+			}
+			return false;
+		}
+
+		// Evicts every vertex.
+		void Flush()
+		{
+			m_timestamp += m_cache_size + 1;
+		}
+
+	private:
+		std::vector<std::uint32_t> m_timestamps;
+		std::uint32_t m_timestamp;
+		std::uint32_t m_cache_size;
+	};
+
+} /* internal */
+
+void MeshOptimizer::OptimizeVertexCache(MeshData & mesh_data, std::uint32_t cache_size)
+{
+	auto indices = internal::ReadIndices(mesh_data);
+
+	std::vector<std::uint32_t> hard_boundaries;
+	auto triangles = internal::Tipsify(indices, mesh_data.m_positions.size(), cache_size, hard_boundaries);
+
+	for (std::size_t t = 0; t < triangles.size(); t++)
+	{
+		for (std::size_t k = 0; k < 3; k++)
+		{
+			mesh_data.SetIndex(t * 3 + k, indices[triangles[t] * 3 + k]);
+		}
+	}
+}
+
+// Linear-speed vertex cache optimisation and overdraw reduction (Sander et al. 2007).
+void MeshOptimizer::OptimizeOverdraw(MeshData & mesh_data, float threshold, std::uint32_t cache_size)
+{
+	auto indices = internal::ReadIndices(mesh_data);
+	const auto num_triangles = indices.size() / 3;
+	const auto num_vertices = mesh_data.m_positions.size();
+
+	if (num_triangles == 0)
+	{
+		return;
+	}
+
+	std::vector<std::uint32_t> hard_boundaries;
+	auto triangles = internal::Tipsify(indices, num_vertices, cache_size, hard_boundaries);
+
+	// ACMR of the tipsified order. Clusters are only split where their own ACMR stays below `threshold` times this.
+	std::uint32_t total_misses = 0;
+	{
+		internal::FIFOCache cache(num_vertices, cache_size);
+		for (auto triangle : triangles)
+		{
+			for (std::size_t k = 0; k < 3; k++)
+			{
+				total_misses += cache.Access(indices[triangle * 3 + k]) ? 1 : 0;
+			}
+		}
+	}
+	const float max_acmr = threshold * float(total_misses) / float(num_triangles);
+
+	// Split clusters at soft boundaries. Each cluster starts with a cold cache.
+	std::vector<std::uint32_t> cluster_offsets = { 0 };
+	{
+		std::size_t next_hard_boundary = 0;
+		std::uint32_t cluster_misses = 0;
+		std::uint32_t cluster_triangles = 0;
+		internal::FIFOCache cache(num_vertices, cache_size);
+
+		for (std::size_t t = 0; t < num_triangles; t++)
+		{
+			bool hard_boundary = next_hard_boundary < hard_boundaries.size() && hard_boundaries[next_hard_boundary] == t;
+			if (hard_boundary)
+			{
+				next_hard_boundary++;
+			}
+
+			bool soft_boundary = cluster_triangles > 0 && float(cluster_misses) / float(cluster_triangles) <= max_acmr;
+			if (t > 0 && (hard_boundary || soft_boundary))
+			{
+				cluster_offsets.push_back(static_cast<std::uint32_t>(t));
+				cluster_misses = 0;
+				cluster_triangles = 0;
+				cache.Flush();
+			}
+
+			for (std::size_t k = 0; k < 3; k++)
+			{
+				cluster_misses += cache.Access(indices[triangles[t] * 3 + k]) ? 1 : 0;
+			}
+			cluster_triangles++;
+		}
+
+		cluster_offsets.push_back(static_cast<std::uint32_t>(num_triangles));
+	}
+
+	// Sort clusters by how much they face away from the center of the mesh.
+	glm::vec3 mesh_centroid = glm::vec3(0);
+	for (std::size_t i = 0; i < num_triangles * 3; i++)
+	{
+		mesh_centroid += mesh_data.m_positions[indices[i]];
+	}
+	mesh_centroid /= float(num_triangles * 3);
+
+	const auto num_clusters = cluster_offsets.size() - 1;
+	std::vector<float> cluster_sort_keys(num_clusters);
+	for (std::size_t c = 0; c < num_clusters; c++)
+	{
+		glm::vec3 centroid = glm::vec3(0);
+		glm::vec3 normal = glm::vec3(0);
+		float area = 0;
+
+		for (auto t = cluster_offsets[c]; t < cluster_offsets[c + 1]; t++)
+		{
+			auto const & v0 = mesh_data.m_positions[indices[triangles[t] * 3 + 0]];
+			auto const & v1 = mesh_data.m_positions[indices[triangles[t] * 3 + 1]];
+			auto const & v2 = mesh_data.m_positions[indices[triangles[t] * 3 + 2]];
+
+			glm::vec3 cross = glm::cross(v1 - v0, v2 - v0);
+			float triangle_area = glm::length(cross);
+
+			centroid += (v0 + v1 + v2) * (triangle_area / 3.0f);
+			normal += cross;
+			area += triangle_area;
+		}
+
+		centroid = area > 0 ? centroid / area : centroid;
+		float normal_length = glm::length(normal);
+		normal = normal_length > 0 ? normal / normal_length : normal;
+
+		cluster_sort_keys[c] = glm::dot(centroid - mesh_centroid, normal);
+	}
+
+	std::vector<std::uint32_t> cluster_order(num_clusters);
+	std::iota(cluster_order.begin(), cluster_order.end(), 0);
+	std::stable_sort(cluster_order.begin(), cluster_order.end(), [&](auto a, auto b)
+	{
+		return cluster_sort_keys[a] > cluster_sort_keys[b];
+	});
+
+	std::size_t i = 0;
+	for (auto cluster : cluster_order)
+	{
+		for (auto t = cluster_offsets[cluster]; t < cluster_offsets[cluster + 1]; t++)
+		{
+			for (std::size_t k = 0; k < 3; k++)
+			{
+				mesh_data.SetIndex(i++, indices[triangles[t] * 3 + k]);
+			}
+		}
+	}
+}
+
+void MeshOptimizer::OptimizeVertexFetch(MeshData & mesh_data)
+{
+	constexpr std::uint32_t unused = std::numeric_limits<std::uint32_t>::max();
+
+	const auto num_vertices = mesh_data.m_positions.size();
+	std::vector<std::uint32_t> remap(num_vertices, unused);
+	std::uint32_t next_vertex = 0;
+
+	for (std::size_t i = 0; i < mesh_data.m_num_indices; i++)
+	{
+		auto index = mesh_data.GetIndex(i);
+		if (remap[index] == unused)
+		{
+			remap[index] = next_vertex++;
+		}
+		mesh_data.SetIndex(i, remap[index]);
+	}
+
+	auto reorder = [&](auto & attributes)
+	{
+		if (attributes.size() != num_vertices)
+		{
+			return;
+		}
+
+		std::remove_reference_t<decltype(attributes)> reordered(next_vertex);
+		for (std::size_t v = 0; v < num_vertices; v++)
+		{
+			if (remap[v] != unused)
+			{
+				reordered[remap[v]] = attributes[v];
+			}
+		}
+		attributes = std::move(reordered);
+	};
+
+	reorder(mesh_data.m_positions);
+	reorder(mesh_data.m_normals);
+	reorder(mesh_data.m_uvw);
+	reorder(mesh_data.m_tangents);
+	reorder(mesh_data.m_bitangents);
+}
+
+void MeshOptimizer::Optimize(MeshData & mesh_data)
+{
+	OptimizeOverdraw(mesh_data);
+	OptimizeVertexFetch(mesh_data);
+}
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(MeshData const & mesh_data, std::uint32_t cache_size)
+{
+	VertexCacheStats stats = {};
+
+	const auto num_vertices = mesh_data.m_positions.size();
+	const auto num_triangles = mesh_data.m_num_indices / 3;
+
+	internal::FIFOCache cache(num_vertices, cache_size);
+	std::vector<std::uint8_t> referenced(num_vertices, 0);
+	std::uint32_t misses = 0;
+	std::uint32_t num_referenced = 0;
+
+	for (std::size_t i = 0; i < num_triangles * 3; i++)
+	{
+		auto index = mesh_data.GetIndex(i);
+		misses += cache.Access(index) ? 1 : 0;
+		num_referenced += referenced[index] ? 0 : 1;
+		referenced[index] = 1;
+	}
+
+	stats.m_acmr = num_triangles > 0 ? float(misses) / float(num_triangles) : 0;
+	stats.m_atvr = num_referenced > 0 ? float(misses) / float(num_referenced) : 0;
+
+	return stats;
+}
@@ -0,0 +1,43 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "resource_structs.hpp"
+
+// Size of the simulated FIFO post transform vertex cache.
+static inline const std::uint32_t vertex_cache_size = 16;
+
+struct VertexCacheStats
+{
+	float m_acmr = 0; // Average cache miss ratio. Vertex shader invocations per triangle. (0.5 - 3)
+	float m_atvr = 0; // Average transformed vertex ratio. Vertex shader invocations per referenced vertex. (1 is optimal)
+};
+
+// Index and vertex reordering passes that run on `MeshData` before meshlets are built.
+// None of the passes change the rendered result. They only change the order of triangles and vertices.
+struct MeshOptimizer
+{
+	// Tipsify (Sander et al. 2007). Reorders triangles for the post transform vertex cache.
+	static void OptimizeVertexCache(MeshData & mesh_data, std::uint32_t cache_size = vertex_cache_size);
+
+	// Reorders triangles for the vertex cache first and then reorders clusters of triangles from the outside in, so
+	// triangles that are likely to occlude others are rendered first.
+	// `threshold` is the maximum ACMR increase relative to `OptimizeVertexCache` allowed when splitting clusters. (1.05 = 5%)
+	static void OptimizeOverdraw(MeshData & mesh_data, float threshold = 1.05f, std::uint32_t cache_size = vertex_cache_size);
+
+	// Reorders the vertices in the order they are first referenced by the index buffer and removes unreferenced vertices.
+	// Should run after the triangle order is final.
+	static void OptimizeVertexFetch(MeshData & mesh_data);
+
+	// Runs `OptimizeOverdraw` followed by `OptimizeVertexFetch`.
+	static void Optimize(MeshData & mesh_data);
+
+	static VertexCacheStats AnalyzeVertexCache(MeshData const & mesh_data, std::uint32_t cache_size = vertex_cache_size);
+};
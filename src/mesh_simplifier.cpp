@@ -0,0 +1,446 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "mesh_simplifier.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <glm.hpp>
+
+namespace internal
+{
+
+	// Quadric over an N dimensional vector: `v^T A v + 2 b^T v + c`. A is symmetric and stored as its upper triangle.
+	template<std::size_t N>
+	struct Quadric
+	{
+		float m_a[N * (N + 1) / 2] = {};
+		float m_b[N] = {};
+		float m_c = 0;
+
+		void Add(Quadric const & other)
+		{
+			for (std::size_t i = 0; i < N * (N + 1) / 2; i++) m_a[i] += other.m_a[i];
+			for (std::size_t i = 0; i < N; i++) m_b[i] += other.m_b[i];
+			m_c += other.m_c;
+		}
+
+		float Evaluate(float const * v) const
+		{
+			float result = m_c;
+			std::size_t k = 0;
+			for (std::size_t i = 0; i < N; i++)
+			{
+				result += m_a[k++] * v[i] * v[i];
+				for (std::size_t j = i + 1; j < N; j++)
+				{
+					result += 2.0f * m_a[k++] * v[i] * v[j];
+				}
+				result += 2.0f * m_b[i] * v[i];
+			}
+			return std::max(0.0f, result);
+		}
+
+		// Squared distance to the plane spanned by the triangle. With N > 3 the extra dimensions are the attributes
+		// of the triangle, interpolated linearly over the triangle.
+		static Quadric FromTriangle(float const * p0, float const * p1, float const * p2, float weight)
+		{
+			Quadric q;
+
+			float e1[N], e2[N];
+			float e1_length = 0;
+			for (std::size_t i = 0; i < N; i++)
+			{
+				e1[i] = p1[i] - p0[i];
+				e1_length += e1[i] * e1[i];
+			}
+			e1_length = std::sqrt(e1_length);
+			if (e1_length < FLT_EPSILON)
+			{
+				return q;
+			}
+
+			float e1_dot_t = 0;
+			for (std::size_t i = 0; i < N; i++)
+			{
+				e1[i] /= e1_length;
+				e1_dot_t += e1[i] * (p2[i] - p0[i]);
+			}
+
+			float e2_length = 0;
+			for (std::size_t i = 0; i < N; i++)
+			{
+				e2[i] = (p2[i] - p0[i]) - e1_dot_t * e1[i];
+				e2_length += e2[i] * e2[i];
+			}
+			e2_length = std::sqrt(e2_length);
+			if (e2_length < FLT_EPSILON)
+			{
+				return q;
+			}
+
+			float p0_dot_e1 = 0, p0_dot_e2 = 0, p0_dot_p0 = 0;
+			for (std::size_t i = 0; i < N; i++)
+			{
+				e2[i] /= e2_length;
+				p0_dot_e1 += p0[i] * e1[i];
+				p0_dot_e2 += p0[i] * e2[i];
+				p0_dot_p0 += p0[i] * p0[i];
+			}
+
+			std::size_t k = 0;
+			for (std::size_t i = 0; i < N; i++)
+			{
+				for (std::size_t j = i; j < N; j++)
+				{
+					q.m_a[k++] = weight * ((i == j ? 1.0f : 0.0f) - e1[i] * e1[j] - e2[i] * e2[j]);
+				}
+				q.m_b[i] = weight * (p0_dot_e1 * e1[i] + p0_dot_e2 * e2[i] - p0[i]);
+			}
+			q.m_c = weight * (p0_dot_p0 - p0_dot_e1 * p0_dot_e1 - p0_dot_e2 * p0_dot_e2);
+
+			return q;
+		}
+	};
+
+	// normalized position (3), weighted normal (3), weighted uv (2)
+	static constexpr std::size_t attribute_quadric_size = 8;
+	using AttributeQuadric = Quadric<attribute_quadric_size>;
+	using PositionQuadric = Quadric<3>;
+
+	struct Collapse
+	{
+		std::uint32_t m_src;
+		std::uint32_t m_dst;
+		float m_cost;
+		float m_error; // squared object space distance
+	};
+
+	struct PositionHash
+	{
+		std::size_t operator()(glm::vec3 const & p) const
+		{
+			std::uint32_t bits[3];
+			memcpy(bits, &p, sizeof(bits));
+			return (bits[0] * 73856093) ^ (bits[1] * 19349663) ^ (bits[2] * 83492791);
+		}
+	};
+
+	struct PositionEqual
+	{
+		bool operator()(glm::vec3 const & a, glm::vec3 const & b) const
+		{
+			return memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+		}
+	};
+
+	// Locks vertices that can't be collapsed without changing the topology or outline of the mesh.
+	inline std::vector<std::uint8_t> FindLockedVertices(MeshData const & mesh_data, std::vector<std::uint32_t> const & indices, bool lock_border)
+	{
+		const auto num_vertices = mesh_data.m_positions.size();
+		std::vector<std::uint8_t> locked(num_vertices, 0);
+
+		// Weld vertices by position. Vertices sharing a position are on an attribute seam.
+		std::vector<std::uint32_t> welded(num_vertices);
+		{
+			std::unordered_map<glm::vec3, std::uint32_t, PositionHash, PositionEqual> first_vertex;
+			first_vertex.reserve(num_vertices);
+			for (std::uint32_t v = 0; v < num_vertices; v++)
+			{
+				auto [it, inserted] = first_vertex.insert({ mesh_data.m_positions[v], v });
+				welded[v] = it->second;
+				if (!inserted)
+				{
+					locked[v] = 1;
+					locked[it->second] = 1;
+				}
+			}
+		}
+
+		// Directed edge counts in welded space. An edge without its opposite is a border, an edge used more than once
+		// in the same direction is non-manifold.
+		std::unordered_map<std::uint64_t, std::uint32_t> edges;
+		edges.reserve(indices.size());
+		auto edge_key = [](std::uint32_t a, std::uint32_t b) { return (std::uint64_t(a) << 32) | b; };
+
+		for (std::size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (std::size_t k = 0; k < 3; k++)
+			{
+				auto a = welded[indices[i + k]];
+				auto b = welded[indices[i + (k + 1) % 3]];
+				edges[edge_key(a, b)]++;
+			}
+		}
+
+		std::vector<std::uint8_t> welded_locked(num_vertices, 0);
+		for (auto const & [key, count] : edges)
+		{
+			auto a = static_cast<std::uint32_t>(key >> 32);
+			auto b = static_cast<std::uint32_t>(key & 0xFFFFFFFF);
+			auto opposite = edges.find(edge_key(b, a));
+
+			bool border = opposite == edges.end();
+			bool non_manifold = count > 1 || (!border && opposite->second > 1);
+			if ((border && lock_border) || non_manifold)
+			{
+				welded_locked[a] = 1;
+				welded_locked[b] = 1;
+			}
+		}
+
+		for (std::size_t v = 0; v < num_vertices; v++)
+		{
+			locked[v] |= welded_locked[welded[v]];
+		}
+
+		return locked;
+	}
+
+} /* internal */
+
+std::vector<std::uint32_t> MeshSimplifier::Simplify(MeshData const & mesh_data, std::vector<std::uint32_t> const & indices,
+	std::size_t target_index_count, float max_error, SimplifySettings const & settings, float* out_error)
+{
+	using namespace internal;
+
+	const auto num_vertices = mesh_data.m_positions.size();
+	const bool has_normals = mesh_data.m_normals.size() == num_vertices;
+	const bool has_uvs = mesh_data.m_uvw.size() == num_vertices;
+
+	std::vector<std::uint32_t> result = indices;
+	float result_error = 0;
+
+	if (result.size() <= target_index_count || num_vertices == 0)
+	{
+		if (out_error) *out_error = 0;
+		return result;
+	}
+
+	// Attribute vectors. Positions are normalized so the attribute weights are independent of the scale of the mesh.
+	glm::vec3 bbox_min = mesh_data.m_positions[0];
+	glm::vec3 bbox_max = mesh_data.m_positions[0];
+	for (auto const & p : mesh_data.m_positions)
+	{
+		bbox_min = glm::min(bbox_min, p);
+		bbox_max = glm::max(bbox_max, p);
+	}
+	glm::vec3 extent = bbox_max - bbox_min;
+	float scale = std::max(extent.x, std::max(extent.y, extent.z));
+	float inv_scale = scale > 0 ? 1.0f / scale : 1.0f;
+
+	std::vector<float> attributes(num_vertices * attribute_quadric_size, 0.0f);
+	for (std::size_t v = 0; v < num_vertices; v++)
+	{
+		auto a = attributes.data() + v * attribute_quadric_size;
+		glm::vec3 p = (mesh_data.m_positions[v] - bbox_min) * inv_scale;
+		a[0] = p.x; a[1] = p.y; a[2] = p.z;
+		if (has_normals)
+		{
+			a[3] = mesh_data.m_normals[v].x * settings.m_normal_weight;
+			a[4] = mesh_data.m_normals[v].y * settings.m_normal_weight;
+			a[5] = mesh_data.m_normals[v].z * settings.m_normal_weight;
+		}
+		if (has_uvs)
+		{
+			a[6] = mesh_data.m_uvw[v].x * settings.m_uv_weight;
+			a[7] = mesh_data.m_uvw[v].y * settings.m_uv_weight;
+		}
+	}
+
+	// Quadrics. The attribute quadric drives the collapse order, the position quadric (unweighted, object space)
+	// measures the geometric error.
+	std::vector<AttributeQuadric> attribute_quadrics(num_vertices);
+	std::vector<PositionQuadric> position_quadrics(num_vertices);
+	for (std::size_t i = 0; i + 2 < result.size(); i += 3)
+	{
+		auto i0 = result[i + 0], i1 = result[i + 1], i2 = result[i + 2];
+
+		auto a0 = attributes.data() + i0 * attribute_quadric_size;
+		auto a1 = attributes.data() + i1 * attribute_quadric_size;
+		auto a2 = attributes.data() + i2 * attribute_quadric_size;
+		glm::vec3 p0(a0[0], a0[1], a0[2]), p1(a1[0], a1[1], a1[2]), p2(a2[0], a2[1], a2[2]);
+		float area = glm::length(glm::cross(p1 - p0, p2 - p0)) * 0.5f;
+
+		auto attribute_quadric = AttributeQuadric::FromTriangle(a0, a1, a2, area);
+		auto position_quadric = PositionQuadric::FromTriangle(&mesh_data.m_positions[i0].x, &mesh_data.m_positions[i1].x, &mesh_data.m_positions[i2].x, 1.0f);
+
+		for (auto v : { i0, i1, i2 })
+		{
+			attribute_quadrics[v].Add(attribute_quadric);
+			position_quadrics[v].Add(position_quadric);
+		}
+	}
+
+	const auto locked = FindLockedVertices(mesh_data, result, settings.m_lock_border);
+	const float max_error_sq = max_error * max_error;
+
+	std::vector<std::uint32_t> remap(num_vertices);
+	std::vector<std::uint8_t> touched(num_vertices);
+	std::vector<std::uint32_t> adjacency_offsets(num_vertices + 1);
+	std::vector<std::uint32_t> adjacency;
+	std::vector<Collapse> collapses;
+
+	auto index_count = result.size();
+
+	// Every pass collapses a set of independent edges in order of increasing cost.
+	while (index_count > target_index_count)
+	{
+		// vertex -> triangle adjacency (compressed rows)
+		std::fill(adjacency_offsets.begin(), adjacency_offsets.end(), 0);
+		for (auto index : result)
+		{
+			adjacency_offsets[index + 1]++;
+		}
+		for (std::size_t v = 0; v < num_vertices; v++)
+		{
+			adjacency_offsets[v + 1] += adjacency_offsets[v];
+		}
+		adjacency.resize(result.size());
+		{
+			std::vector<std::uint32_t> cursor(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+			for (std::size_t i = 0; i < result.size(); i++)
+			{
+				adjacency[cursor[result[i]]++] = static_cast<std::uint32_t>(i / 3);
+			}
+		}
+
+		// candidates
+		collapses.clear();
+		for (std::size_t i = 0; i < result.size(); i += 3)
+		{
+			for (std::size_t k = 0; k < 3; k++)
+			{
+				auto a = result[i + k];
+				auto b = result[i + (k + 1) % 3];
+
+				for (auto [src, dst] : { std::pair(a, b), std::pair(b, a) })
+				{
+					if (locked[src])
+					{
+						continue;
+					}
+
+					auto attribute_quadric = attribute_quadrics[src];
+					attribute_quadric.Add(attribute_quadrics[dst]);
+					auto position_quadric = position_quadrics[src];
+					position_quadric.Add(position_quadrics[dst]);
+
+					float error = position_quadric.Evaluate(&mesh_data.m_positions[dst].x);
+					if (error > max_error_sq)
+					{
+						continue;
+					}
+
+					collapses.push_back({ src, dst, attribute_quadric.Evaluate(attributes.data() + dst * attribute_quadric_size), error });
+				}
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](Collapse const & a, Collapse const & b)
+		{
+			return a.m_cost < b.m_cost;
+		});
+
+		for (std::size_t v = 0; v < num_vertices; v++)
+		{
+			remap[v] = static_cast<std::uint32_t>(v);
+		}
+		std::fill(touched.begin(), touched.end(), 0);
+
+		std::size_t num_collapses = 0;
+		for (auto const & collapse : collapses)
+		{
+			if (index_count <= target_index_count)
+			{
+				break;
+			}
+
+			auto src = collapse.m_src;
+			auto dst = collapse.m_dst;
+			if (touched[src] || touched[dst])
+			{
+				continue;
+			}
+
+			// Reject collapses that flip or nearly degenerate a triangle.
+			bool flips = false;
+			std::size_t removed_triangles = 0;
+			for (auto a = adjacency_offsets[src]; a < adjacency_offsets[src + 1] && !flips; a++)
+			{
+				auto t = adjacency[a] * 3;
+				if (result[t + 0] == dst || result[t + 1] == dst || result[t + 2] == dst)
+				{
+					removed_triangles++;
+					continue;
+				}
+
+				glm::vec3 before[3], after[3];
+				for (std::size_t k = 0; k < 3; k++)
+				{
+					before[k] = mesh_data.m_positions[result[t + k]];
+					after[k] = result[t + k] == src ? mesh_data.m_positions[dst] : before[k];
+				}
+
+				glm::vec3 normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+				glm::vec3 normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+				flips = glm::dot(normal_before, normal_after) <= 0.25f * glm::length(normal_before) * glm::length(normal_after);
+			}
+
+			if (flips)
+			{
+				continue;
+			}
+
+			remap[src] = dst;
+			attribute_quadrics[dst].Add(attribute_quadrics[src]);
+			position_quadrics[dst].Add(position_quadrics[src]);
+			result_error = std::max(result_error, collapse.m_error);
+			index_count -= removed_triangles * 3;
+			num_collapses++;
+
+			// The neighbourhood of `src` changed, so the flip test of collapses around it would be stale.
+			for (auto a = adjacency_offsets[src]; a < adjacency_offsets[src + 1]; a++)
+			{
+				auto t = adjacency[a] * 3;
+				touched[result[t + 0]] = 1;
+				touched[result[t + 1]] = 1;
+				touched[result[t + 2]] = 1;
+			}
+		}
+
+		if (num_collapses == 0)
+		{
+			break;
+		}
+
+		// apply collapses and remove degenerate triangles
+		std::size_t write = 0;
+		for (std::size_t i = 0; i < result.size(); i += 3)
+		{
+			auto i0 = remap[result[i + 0]], i1 = remap[result[i + 1]], i2 = remap[result[i + 2]];
+			if (i0 != i1 && i1 != i2 && i0 != i2)
+			{
+				result[write++] = i0;
+				result[write++] = i1;
+				result[write++] = i2;
+			}
+		}
+		result.resize(write);
+		index_count = write;
+	}
+
+	if (out_error)
+	{
+		*out_error = std::sqrt(result_error);
+	}
+
+	return result;
+}
@@ -0,0 +1,33 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "resource_structs.hpp"
+
+struct SimplifySettings
+{
+	// Attribute weights relative to the position error. Positions are normalized to the mesh extent.
+	float m_normal_weight = 0.5f;
+	float m_uv_weight = 0.5f;
+	// Vertices on open borders are never collapsed, so the outline of the mesh is preserved.
+	bool m_lock_border = true;
+};
+
+// Edge collapse simplifier using quadric error metrics (Garland & Heckbert 1998) extended with normals and texture coordinates.
+// Edges are collapsed onto one of their existing vertices, so the simplified indices reference the original vertex buffer.
+// Vertices that share their position with another vertex (attribute seams) are locked to avoid cracks.
+struct MeshSimplifier
+{
+	// Simplifies the triangles in `indices`, which index into the vertices of `mesh_data`.
+	// Stops when the index count reaches `target_index_count` or when no collapse with a geometric error below `max_error` is left.
+	// `max_error` and `out_error` are object space distances.
+	static std::vector<std::uint32_t> Simplify(MeshData const & mesh_data, std::vector<std::uint32_t> const & indices,
+		std::size_t target_index_count, float max_error, SimplifySettings const & settings = {}, float* out_error = nullptr);
+};
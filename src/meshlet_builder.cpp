@@ -0,0 +1,1148 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "meshlet_builder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+#include "mesh_simplifier.hpp"
+
+namespace internal
+{
+
+	struct MeshletCone
+	{
+		std::int8_t m_x = 0;
+		std::int8_t m_y = 0;
+		std::int8_t m_angle = 127; // positive value for cluster not being backface cullable
+	};
+
+	inline glm::vec3 TriangleNormal(glm::vec3 const & v0, glm::vec3 const & v1, glm::vec3 const & v2)
+	{
+		return glm::cross(v1 - v0, v2 - v0);
+	}
+
+	// Ritter's bounding sphere. Not minimal, but close and linear in the number of points.
+	inline std::pair<glm::vec3, float> CalculateBoundingSphere(std::vector<glm::vec3> const & points)
+	{
+		if (points.empty())
+		{
+			return { glm::vec3(0), 0.f };
+		}
+
+		auto furthest = [&points](glm::vec3 const & from)
+		{
+			std::size_t furthest_idx = 0;
+			float furthest_distance = -1.f;
+			for (std::size_t i = 0; i < points.size(); i++)
+			{
+				float distance = glm::dot(points[i] - from, points[i] - from);
+				if (distance > furthest_distance)
+				{
+					furthest_distance = distance;
+					furthest_idx = i;
+				}
+			}
+			return points[furthest_idx];
+		};
+
+		glm::vec3 a = furthest(points[0]);
+		glm::vec3 b = furthest(a);
+		glm::vec3 center = (a + b) * 0.5f;
+		float radius = glm::length(b - a) * 0.5f;
+
+		// grow the sphere to include every point
+		for (auto const & p : points)
+		{
+			float distance = glm::length(p - center);
+			if (distance > radius)
+			{
+				float new_radius = (radius + distance) * 0.5f;
+				center += (p - center) * ((new_radius - radius) / distance);
+				radius = new_radius;
+			}
+		}
+
+		return { center, radius };
+	}
+
+	// Calculates the bounding sphere and normal cone of a meshlet from its own triangles.
+	// The cone axis is the direction to the center of the bounding sphere of the triangle normals, which approximates
+	// the minimal enclosing cone. The apex is moved back along the axis until it lies behind every triangle plane.
+	// `quantized_cone` receives the 8 bit cone for `MeshletDesc`, recalculated against the quantized axis.
+	inline MeshletBounds CalculateMeshletBounds(MeshData const & mesh_data, std::uint32_t const * triangles, std::size_t num_triangles,
+		std::vector<std::uint32_t> const & vertex_indices, std::vector<glm::vec3> & scratch, MeshletCone & quantized_cone)
+	{
+		MeshletBounds bounds = {};
+		quantized_cone = {};
+
+		auto triangle_position = [&](std::size_t t, std::size_t k) -> glm::vec3 const &
+		{
+			return mesh_data.m_positions[mesh_data.GetIndex(triangles[t] * 3 + k)];
+		};
+
+		// bounding sphere
+		scratch.clear();
+		for (auto index : vertex_indices)
+		{
+			scratch.push_back(mesh_data.m_positions[index]);
+		}
+		std::tie(bounds.m_sphere_center, bounds.m_sphere_radius) = CalculateBoundingSphere(scratch);
+		bounds.m_cone_apex = bounds.m_sphere_center;
+
+		// triangle normals, degenerate triangles don't constrain the cone
+		scratch.clear();
+		for (std::size_t t = 0; t < num_triangles; t++)
+		{
+			auto normal = TriangleNormal(triangle_position(t, 0), triangle_position(t, 1), triangle_position(t, 2));
+			float length = glm::length(normal);
+			if (length > FLT_EPSILON)
+			{
+				scratch.push_back(normal / length);
+			}
+		}
+
+		if (scratch.empty())
+		{
+			return bounds;
+		}
+
+		auto normal_sphere = CalculateBoundingSphere(scratch);
+		float axis_length = glm::length(normal_sphere.first);
+		if (axis_length <= FLT_EPSILON)
+		{
+			return bounds;
+		}
+		glm::vec3 axis = normal_sphere.first / axis_length;
+
+		float mindot = 1.0f;
+		for (auto const & n : scratch)
+		{
+			mindot = std::min(mindot, glm::dot(n, axis));
+		}
+
+		// normals spread over more than a hemisphere
+		if (mindot <= 0)
+		{
+			return bounds;
+		}
+
+		float max_t = 0;
+		for (std::size_t t = 0; t < num_triangles; t++)
+		{
+			auto const & v0 = triangle_position(t, 0);
+			auto normal = TriangleNormal(v0, triangle_position(t, 1), triangle_position(t, 2));
+			float length = glm::length(normal);
+			if (length <= FLT_EPSILON)
+			{
+				continue;
+			}
+			normal /= length;
+
+			// distance along the axis from the sphere center to the triangle plane
+			max_t = std::max(max_t, glm::dot(bounds.m_sphere_center - v0, normal) / glm::dot(axis, normal));
+		}
+
+		bounds.m_cone_apex = bounds.m_sphere_center - axis * max_t;
+		bounds.m_cone_axis = axis;
+		bounds.m_cone_cutoff = sqrtf(1.0f - mindot * mindot);
+
+		// quantized cone
+		glm::vec3 packed = FVec3ToOctnPrecise(axis, 16);
+		quantized_cone.m_x = std::min(127, std::max(-127, std::int32_t(packed.x * 127.0f)));
+		quantized_cone.m_y = std::min(127, std::max(-127, std::int32_t(packed.y * 127.0f)));
+
+		// post quantization normal
+		glm::vec3 quantized_axis = OctToFVec3(glm::vec3(float(quantized_cone.m_x) / 127.0f, float(quantized_cone.m_y) / 127.0f, 0.0f));
+
+		float quantized_mindot = 1.0f;
+		for (auto const & n : scratch)
+		{
+			quantized_mindot = std::min(quantized_mindot, glm::dot(n, quantized_axis));
+		}
+
+		// apply safety delta due to quantization
+		quantized_mindot -= 1.0f / 127.0f;
+
+		if (quantized_mindot > 0)
+		{
+			// store -sin(cone angle)
+			// we test against dot product (cosine) so this is equivalent to cos(cone angle + 90 degrees)
+			// Rounded down so the stored angle is never tighter than the real one.
+			float angle = -sinf(acosf(quantized_mindot));
+			quantized_cone.m_angle = std::max(-127, std::min(127, int32_t(floorf(angle * 127.0f))));
+		}
+
+		return bounds;
+	}
+
+	// Slices the index buffer into runs of `max_primitive_count_limit` triangles in index buffer order.
+	inline void ClusterSequential(std::size_t num_triangles, std::vector<std::uint32_t> & triangles, std::vector<std::uint32_t> & cluster_offsets)
+	{
+		triangles.resize(num_triangles);
+		for (std::size_t t = 0; t < num_triangles; t++)
+		{
+			triangles[t] = static_cast<std::uint32_t>(t);
+		}
+
+		for (std::size_t t = 0; t < num_triangles; t += max_primitive_count_limit)
+		{
+			cluster_offsets.push_back(static_cast<std::uint32_t>(t));
+		}
+		cluster_offsets.push_back(static_cast<std::uint32_t>(num_triangles));
+	}
+
+	// Grows clusters greedily over triangle adjacency.
+	// Candidates are triangles that share a vertex with the cluster. They are scored by the number of vertices they
+	// would add plus their distance to the cluster centroid relative to the cluster radius, lowest score wins.
+	// The cluster radius is approximated by half the diagonal of the bounding box of the cluster vertices.
+	// When the cluster has no adjacent candidates left, a small window of unclustered triangles following the seed in
+	// index buffer order is considered so disconnected pieces (foliage cards, split UV seams) still fill meshlets.
+	inline void ClusterSpatial(MeshData const & mesh_data, std::vector<std::uint32_t> & triangles, std::vector<std::uint32_t> & cluster_offsets)
+	{
+		constexpr std::uint32_t invalid = std::numeric_limits<std::uint32_t>::max();
+		constexpr std::uint32_t fallback_window = 64;
+		constexpr float compactness_weight = 1.0f;
+
+		const auto num_vertices = mesh_data.m_positions.size();
+		const auto num_triangles = mesh_data.m_num_indices / 3;
+
+		// vertex -> triangle adjacency (compressed rows)
+		std::vector<std::uint32_t> adjacency_offsets(num_vertices + 1, 0);
+		std::vector<std::uint32_t> adjacency(num_triangles * 3);
+		for (std::size_t i = 0; i < num_triangles * 3; i++)
+		{
+			adjacency_offsets[mesh_data.GetIndex(i) + 1]++;
+		}
+		for (std::size_t v = 0; v < num_vertices; v++)
+		{
+			adjacency_offsets[v + 1] += adjacency_offsets[v];
+		}
+		{
+			std::vector<std::uint32_t> cursor(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+			for (std::size_t i = 0; i < num_triangles * 3; i++)
+			{
+				adjacency[cursor[mesh_data.GetIndex(i)]++] = static_cast<std::uint32_t>(i / 3);
+			}
+		}
+
+		std::vector<glm::vec3> centroids(num_triangles);
+		for (std::size_t t = 0; t < num_triangles; t++)
+		{
+			centroids[t] = (mesh_data.m_positions[mesh_data.GetIndex(t * 3 + 0)]
+				+ mesh_data.m_positions[mesh_data.GetIndex(t * 3 + 1)]
+				+ mesh_data.m_positions[mesh_data.GetIndex(t * 3 + 2)]) * (1.0f / 3.0f);
+		}
+
+		std::vector<std::uint8_t> clustered(num_triangles, 0);
+		std::vector<std::uint32_t> stamps(num_vertices, 0);
+		std::vector<std::uint32_t> cluster_vertices;
+		std::vector<std::uint32_t> candidate_stamps(num_triangles, 0);
+		std::vector<std::uint32_t> candidates; // Triangles adjacent to the cluster.
+		cluster_vertices.reserve(max_vertex_count_limit);
+		std::uint32_t generation = 0;
+
+		triangles.reserve(num_triangles);
+		cluster_offsets.push_back(0);
+
+		glm::vec3 centroid_sum;
+		glm::vec3 centroid;
+		glm::vec3 bbox_min;
+		glm::vec3 bbox_max;
+		float radius;
+		std::uint32_t num_cluster_triangles;
+
+		auto count_new_vertices = [&](std::uint32_t t)
+		{
+			std::uint32_t count = 0;
+			for (std::size_t k = 0; k < 3; k++)
+			{
+				count += stamps[mesh_data.GetIndex(t * 3 + k)] != generation ? 1 : 0;
+			}
+			return count;
+		};
+
+		auto score = [&](std::uint32_t t, std::uint32_t new_vertices)
+		{
+			float distance = glm::length(centroids[t] - centroid);
+			return float(new_vertices) + compactness_weight * distance / std::max(radius, FLT_EPSILON);
+		};
+
+		auto add_triangle = [&](std::uint32_t t)
+		{
+			clustered[t] = 1;
+			triangles.push_back(t);
+			num_cluster_triangles++;
+
+			for (std::size_t k = 0; k < 3; k++)
+			{
+				auto index = mesh_data.GetIndex(t * 3 + k);
+				if (stamps[index] != generation)
+				{
+					stamps[index] = generation;
+					cluster_vertices.push_back(index);
+					bbox_min = glm::min(bbox_min, mesh_data.m_positions[index]);
+					bbox_max = glm::max(bbox_max, mesh_data.m_positions[index]);
+					for (auto a = adjacency_offsets[index]; a < adjacency_offsets[index + 1]; a++)
+					{
+						auto adjacent = adjacency[a];
+						if (!clustered[adjacent] && candidate_stamps[adjacent] != generation)
+						{
+							candidate_stamps[adjacent] = generation;
+							candidates.push_back(adjacent);
+						}
+					}
+				}
+			}
+
+			centroid_sum += centroids[t];
+			centroid = centroid_sum / float(num_cluster_triangles);
+
+			radius = glm::length(bbox_max - bbox_min) * 0.5f;
+		};
+
+		std::size_t seed = 0;
+		while (true)
+		{
+			while (seed < num_triangles && clustered[seed])
+			{
+				seed++;
+			}
+			if (seed == num_triangles)
+			{
+				break;
+			}
+
+			generation++;
+			cluster_vertices.clear();
+			candidates.clear();
+			centroid_sum = glm::vec3(0);
+			bbox_min = glm::vec3(std::numeric_limits<float>::max());
+			bbox_max = glm::vec3(-std::numeric_limits<float>::max());
+			num_cluster_triangles = 0;
+
+			add_triangle(static_cast<std::uint32_t>(seed));
+
+			while (num_cluster_triangles < static_cast<std::uint32_t>(max_primitive_count_limit))
+			{
+				std::uint32_t best = invalid;
+				float best_score = std::numeric_limits<float>::max();
+
+				auto consider = [&](std::uint32_t t)
+				{
+					if (clustered[t]) return;
+
+					auto new_vertices = count_new_vertices(t);
+					if (cluster_vertices.size() + new_vertices > static_cast<std::size_t>(max_vertex_count_limit)) return;
+
+					auto s = score(t, new_vertices);
+					if (s < best_score)
+					{
+						best_score = s;
+						best = t;
+					}
+				};
+
+				candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&](auto t) { return clustered[t] != 0; }), candidates.end());
+				for (auto t : candidates)
+				{
+					consider(t);
+				}
+
+				if (best == invalid)
+				{
+					auto window_end = std::min(num_triangles, seed + 1 + fallback_window);
+					for (auto t = seed + 1; t < window_end; t++)
+					{
+						consider(static_cast<std::uint32_t>(t));
+					}
+				}
+
+				if (best == invalid)
+				{
+					break;
+				}
+
+				add_triangle(best);
+			}
+
+			cluster_offsets.push_back(static_cast<std::uint32_t>(triangles.size()));
+		}
+	}
+
+	// Smallest sphere found by growing the first sphere until it contains all others. Not minimal.
+	inline std::pair<glm::vec3, float> MergeBoundingSpheres(std::vector<std::pair<glm::vec3, float>> const & spheres)
+	{
+		if (spheres.empty())
+		{
+			return { glm::vec3(0), 0.f };
+		}
+
+		auto [center, radius] = spheres[0];
+		for (auto const & [other_center, other_radius] : spheres)
+		{
+			float distance = glm::length(other_center - center);
+			if (distance + other_radius <= radius)
+			{
+				continue;
+			}
+
+			if (distance + radius <= other_radius)
+			{
+				center = other_center;
+				radius = other_radius;
+				continue;
+			}
+
+			float new_radius = (radius + distance + other_radius) * 0.5f;
+			center += (other_center - center) * ((new_radius - radius) / distance);
+			radius = new_radius;
+		}
+
+		return { center, radius };
+	}
+
+	// Appends the triangles of a meshlet as indices into the vertex buffer of the mesh.
+	inline void AppendMeshletTriangles(MeshletData const & meshlet_data, std::uint32_t meshlet, std::vector<std::uint32_t> & out)
+	{
+		auto const & desc = meshlet_data.m_meshlets[meshlet];
+		auto vertex_begin = desc.GetVertexBegin();
+		auto prim_begin = desc.GetPrimBegin();
+		auto num_prims = desc.GetNumPrims();
+
+		for (std::uint32_t i = 0; i < num_prims * 3; i++)
+		{
+			out.push_back(meshlet_data.m_vertex_indices[vertex_begin + meshlet_data.m_index_indices[prim_begin * 3 + i]]);
+		}
+	}
+
+	// Greedily groups `meshlets` into groups of up to `meshlet_group_size` meshlets. Meshlets are added to a group in
+	// order of the number of vertices they share with it.
+	inline std::vector<std::vector<std::uint32_t>> GroupMeshlets(MeshletData const & meshlet_data, std::vector<std::uint32_t> const & meshlets,
+		std::size_t num_vertices)
+	{
+		const auto num_meshlets = meshlets.size();
+
+		// vertex -> meshlet adjacency (compressed rows). Vertices are unique within a meshlet.
+		std::vector<std::uint32_t> adjacency_offsets(num_vertices + 1, 0);
+		for (auto meshlet : meshlets)
+		{
+			auto const & desc = meshlet_data.m_meshlets[meshlet];
+			for (std::uint32_t i = 0; i < desc.GetNumVertices(); i++)
+			{
+				adjacency_offsets[meshlet_data.m_vertex_indices[desc.GetVertexBegin() + i] + 1]++;
+			}
+		}
+		for (std::size_t v = 0; v < num_vertices; v++)
+		{
+			adjacency_offsets[v + 1] += adjacency_offsets[v];
+		}
+		std::vector<std::uint32_t> adjacency(adjacency_offsets.back());
+		{
+			std::vector<std::uint32_t> cursor(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+			for (std::uint32_t m = 0; m < num_meshlets; m++)
+			{
+				auto const & desc = meshlet_data.m_meshlets[meshlets[m]];
+				for (std::uint32_t i = 0; i < desc.GetNumVertices(); i++)
+				{
+					adjacency[cursor[meshlet_data.m_vertex_indices[desc.GetVertexBegin() + i]]++] = m;
+				}
+			}
+		}
+
+		std::vector<std::vector<std::uint32_t>> groups;
+		std::vector<std::uint8_t> grouped(num_meshlets, 0);
+		std::vector<std::uint32_t> shared_vertices(num_meshlets, 0);
+		std::vector<std::uint32_t> candidates;
+
+		for (std::uint32_t seed = 0; seed < num_meshlets; seed++)
+		{
+			if (grouped[seed])
+			{
+				continue;
+			}
+
+			std::vector<std::uint32_t> group;
+			candidates.clear();
+
+			auto add = [&](std::uint32_t m)
+			{
+				grouped[m] = 1;
+				group.push_back(meshlets[m]);
+
+				auto const & desc = meshlet_data.m_meshlets[meshlets[m]];
+				for (std::uint32_t i = 0; i < desc.GetNumVertices(); i++)
+				{
+					auto v = meshlet_data.m_vertex_indices[desc.GetVertexBegin() + i];
+					for (auto a = adjacency_offsets[v]; a < adjacency_offsets[v + 1]; a++)
+					{
+						auto neighbour = adjacency[a];
+						if (grouped[neighbour])
+						{
+							continue;
+						}
+						if (shared_vertices[neighbour]++ == 0)
+						{
+							candidates.push_back(neighbour);
+						}
+					}
+				}
+			};
+
+			add(seed);
+			while (group.size() < meshlet_group_size)
+			{
+				std::uint32_t best = 0;
+				std::uint32_t best_shared = 0;
+				for (auto candidate : candidates)
+				{
+					if (!grouped[candidate] && shared_vertices[candidate] > best_shared)
+					{
+						best = candidate;
+						best_shared = shared_vertices[candidate];
+					}
+				}
+
+				if (best_shared == 0)
+				{
+					break;
+				}
+
+				add(best);
+			}
+
+			for (auto candidate : candidates)
+			{
+				shared_vertices[candidate] = 0;
+			}
+
+			groups.push_back(std::move(group));
+		}
+
+		return groups;
+	}
+
+	template<typename T>
+	inline void WriteArray(std::vector<std::uint8_t> & out, std::vector<T> const & array)
+	{
+		auto offset = out.size();
+		auto size = array.size() * sizeof(T);
+		out.resize(offset + SizeAlignTwoPower(size, 4u), 0);
+		if (size > 0)
+		{
+			memcpy(out.data() + offset, array.data(), size);
+		}
+	}
+
+	template<typename T>
+	inline bool ReadArray(std::uint8_t const * data, std::size_t size, std::size_t & offset, std::size_t count, std::vector<T> & array)
+	{
+		auto array_size = count * sizeof(T);
+		if (offset + array_size > size)
+		{
+			return false;
+		}
+
+		array.resize(count);
+		if (array_size > 0)
+		{
+			memcpy(array.data(), data + offset, array_size);
+		}
+		offset += SizeAlignTwoPower(array_size, 4u);
+		return true;
+	}
+
+	// Kernels of `CalculateBoundingBox`. They process triangles `[first, last)` and accumulate into `bbox`, with the
+	// sum of the face normals in `m_average_normal`. The SIMD kernels hand their remainder to the scalar kernel.
+	template<typename I>
+	void BoundingBoxScalar(glm::vec3 const * positions, I const * indices, std::size_t first, std::size_t last, MeshBoundingBox & bbox)
+	{
+		for (std::size_t t = first; t < last; t++)
+		{
+			auto const & v0 = positions[indices[t * 3 + 0]];
+			auto const & v1 = positions[indices[t * 3 + 1]];
+			auto const & v2 = positions[indices[t * 3 + 2]];
+
+			bbox.m_min = glm::min(bbox.m_min, glm::min(v0, glm::min(v1, v2)));
+			bbox.m_max = glm::max(bbox.m_max, glm::max(v0, glm::max(v1, v2)));
+
+			glm::vec3 cross = TriangleNormal(v0, v1, v2);
+			float length = glm::length(cross);
+			bbox.m_average_normal += length > FLT_EPSILON ? cross * (1.0f / length) : cross;
+		}
+	}
+
+#ifdef SKYGGE_SIMD_X86
+	// 4 triangles at a time in structure of arrays form.
+	template<typename I>
+	void BoundingBoxSSE2(glm::vec3 const * positions, I const * indices, std::size_t num_triangles, MeshBoundingBox & bbox)
+	{
+		__m128 min_x = _mm_set1_ps(FLT_MAX), min_y = min_x, min_z = min_x;
+		__m128 max_x = _mm_set1_ps(-FLT_MAX), max_y = max_x, max_z = max_x;
+		__m128 sum_x = _mm_setzero_ps(), sum_y = sum_x, sum_z = sum_x;
+		const __m128 epsilon = _mm_set1_ps(FLT_EPSILON);
+		const __m128 one = _mm_set1_ps(1.f);
+
+		const std::size_t num_simd_triangles = num_triangles & ~std::size_t(3);
+		for (std::size_t t = 0; t < num_simd_triangles; t += 4)
+		{
+			I const * tri = indices + t * 3;
+			__m128 x[3], y[3], z[3];
+			for (int c = 0; c < 3; c++)
+			{
+				auto const & p0 = positions[tri[c]];
+				auto const & p1 = positions[tri[c + 3]];
+				auto const & p2 = positions[tri[c + 6]];
+				auto const & p3 = positions[tri[c + 9]];
+				x[c] = _mm_setr_ps(p0.x, p1.x, p2.x, p3.x);
+				y[c] = _mm_setr_ps(p0.y, p1.y, p2.y, p3.y);
+				z[c] = _mm_setr_ps(p0.z, p1.z, p2.z, p3.z);
+			}
+
+			min_x = _mm_min_ps(min_x, _mm_min_ps(x[0], _mm_min_ps(x[1], x[2])));
+			min_y = _mm_min_ps(min_y, _mm_min_ps(y[0], _mm_min_ps(y[1], y[2])));
+			min_z = _mm_min_ps(min_z, _mm_min_ps(z[0], _mm_min_ps(z[1], z[2])));
+			max_x = _mm_max_ps(max_x, _mm_max_ps(x[0], _mm_max_ps(x[1], x[2])));
+			max_y = _mm_max_ps(max_y, _mm_max_ps(y[0], _mm_max_ps(y[1], y[2])));
+			max_z = _mm_max_ps(max_z, _mm_max_ps(z[0], _mm_max_ps(z[1], z[2])));
+
+			__m128 e1_x = _mm_sub_ps(x[1], x[0]), e1_y = _mm_sub_ps(y[1], y[0]), e1_z = _mm_sub_ps(z[1], z[0]);
+			__m128 e2_x = _mm_sub_ps(x[2], x[0]), e2_y = _mm_sub_ps(y[2], y[0]), e2_z = _mm_sub_ps(z[2], z[0]);
+			__m128 n_x = _mm_sub_ps(_mm_mul_ps(e1_y, e2_z), _mm_mul_ps(e1_z, e2_y));
+			__m128 n_y = _mm_sub_ps(_mm_mul_ps(e1_z, e2_x), _mm_mul_ps(e1_x, e2_z));
+			__m128 n_z = _mm_sub_ps(_mm_mul_ps(e1_x, e2_y), _mm_mul_ps(e1_y, e2_x));
+
+			// Degenerate triangles add their unnormalized normal, like the scalar kernel.
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(n_x, n_x), _mm_add_ps(_mm_mul_ps(n_y, n_y), _mm_mul_ps(n_z, n_z))));
+			__m128 valid = _mm_cmpgt_ps(length, epsilon);
+			__m128 scale = _mm_or_ps(_mm_and_ps(valid, _mm_div_ps(one, length)), _mm_andnot_ps(valid, one));
+
+			sum_x = _mm_add_ps(sum_x, _mm_mul_ps(n_x, scale));
+			sum_y = _mm_add_ps(sum_y, _mm_mul_ps(n_y, scale));
+			sum_z = _mm_add_ps(sum_z, _mm_mul_ps(n_z, scale));
+		}
+
+		alignas(16) float lanes[9][4];
+		_mm_store_ps(lanes[0], min_x); _mm_store_ps(lanes[1], min_y); _mm_store_ps(lanes[2], min_z);
+		_mm_store_ps(lanes[3], max_x); _mm_store_ps(lanes[4], max_y); _mm_store_ps(lanes[5], max_z);
+		_mm_store_ps(lanes[6], sum_x); _mm_store_ps(lanes[7], sum_y); _mm_store_ps(lanes[8], sum_z);
+		for (int i = 0; i < 4; i++)
+		{
+			bbox.m_min = glm::min(bbox.m_min, glm::vec3(lanes[0][i], lanes[1][i], lanes[2][i]));
+			bbox.m_max = glm::max(bbox.m_max, glm::vec3(lanes[3][i], lanes[4][i], lanes[5][i]));
+			bbox.m_average_normal += glm::vec3(lanes[6][i], lanes[7][i], lanes[8][i]);
+		}
+
+		BoundingBoxScalar(positions, indices, num_simd_triangles, num_triangles, bbox);
+	}
+
+	// 8 triangles at a time. Positions are gathered, which limits the vertex count to 2^31 / 3.
+	template<typename I>
+	SKYGGE_TARGET_AVX2 void BoundingBoxAVX2(glm::vec3 const * positions, I const * indices, std::size_t num_triangles, MeshBoundingBox & bbox)
+	{
+		__m256 min_x = _mm256_set1_ps(FLT_MAX), min_y = min_x, min_z = min_x;
+		__m256 max_x = _mm256_set1_ps(-FLT_MAX), max_y = max_x, max_z = max_x;
+		__m256 sum_x = _mm256_setzero_ps(), sum_y = sum_x, sum_z = sum_x;
+		const __m256 epsilon = _mm256_set1_ps(FLT_EPSILON);
+		const __m256 one = _mm256_set1_ps(1.f);
+		const __m256i three = _mm256_set1_epi32(3);
+		const float* base = &positions[0].x;
+
+		const std::size_t num_simd_triangles = num_triangles & ~std::size_t(7);
+		for (std::size_t t = 0; t < num_simd_triangles; t += 8)
+		{
+			I const * tri = indices + t * 3;
+			__m256 x[3], y[3], z[3];
+			for (int c = 0; c < 3; c++)
+			{
+				__m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(tri[c], tri[c + 3], tri[c + 6], tri[c + 9],
+					tri[c + 12], tri[c + 15], tri[c + 18], tri[c + 21]), three);
+				x[c] = _mm256_i32gather_ps(base + 0, offsets, 4);
+				y[c] = _mm256_i32gather_ps(base + 1, offsets, 4);
+				z[c] = _mm256_i32gather_ps(base + 2, offsets, 4);
+			}
+
+			min_x = _mm256_min_ps(min_x, _mm256_min_ps(x[0], _mm256_min_ps(x[1], x[2])));
+			min_y = _mm256_min_ps(min_y, _mm256_min_ps(y[0], _mm256_min_ps(y[1], y[2])));
+			min_z = _mm256_min_ps(min_z, _mm256_min_ps(z[0], _mm256_min_ps(z[1], z[2])));
+			max_x = _mm256_max_ps(max_x, _mm256_max_ps(x[0], _mm256_max_ps(x[1], x[2])));
+			max_y = _mm256_max_ps(max_y, _mm256_max_ps(y[0], _mm256_max_ps(y[1], y[2])));
+			max_z = _mm256_max_ps(max_z, _mm256_max_ps(z[0], _mm256_max_ps(z[1], z[2])));
+
+			__m256 e1_x = _mm256_sub_ps(x[1], x[0]), e1_y = _mm256_sub_ps(y[1], y[0]), e1_z = _mm256_sub_ps(z[1], z[0]);
+			__m256 e2_x = _mm256_sub_ps(x[2], x[0]), e2_y = _mm256_sub_ps(y[2], y[0]), e2_z = _mm256_sub_ps(z[2], z[0]);
+			__m256 n_x = _mm256_fmsub_ps(e1_y, e2_z, _mm256_mul_ps(e1_z, e2_y));
+			__m256 n_y = _mm256_fmsub_ps(e1_z, e2_x, _mm256_mul_ps(e1_x, e2_z));
+			__m256 n_z = _mm256_fmsub_ps(e1_x, e2_y, _mm256_mul_ps(e1_y, e2_x));
+
+			__m256 length = _mm256_sqrt_ps(_mm256_fmadd_ps(n_x, n_x, _mm256_fmadd_ps(n_y, n_y, _mm256_mul_ps(n_z, n_z))));
+			__m256 scale = _mm256_blendv_ps(one, _mm256_div_ps(one, length), _mm256_cmp_ps(length, epsilon, _CMP_GT_OQ));
+
+			sum_x = _mm256_fmadd_ps(n_x, scale, sum_x);
+			sum_y = _mm256_fmadd_ps(n_y, scale, sum_y);
+			sum_z = _mm256_fmadd_ps(n_z, scale, sum_z);
+		}
+
+		alignas(32) float lanes[9][8];
+		_mm256_store_ps(lanes[0], min_x); _mm256_store_ps(lanes[1], min_y); _mm256_store_ps(lanes[2], min_z);
+		_mm256_store_ps(lanes[3], max_x); _mm256_store_ps(lanes[4], max_y); _mm256_store_ps(lanes[5], max_z);
+		_mm256_store_ps(lanes[6], sum_x); _mm256_store_ps(lanes[7], sum_y); _mm256_store_ps(lanes[8], sum_z);
+		for (int i = 0; i < 8; i++)
+		{
+			bbox.m_min = glm::min(bbox.m_min, glm::vec3(lanes[0][i], lanes[1][i], lanes[2][i]));
+			bbox.m_max = glm::max(bbox.m_max, glm::vec3(lanes[3][i], lanes[4][i], lanes[5][i]));
+			bbox.m_average_normal += glm::vec3(lanes[6][i], lanes[7][i], lanes[8][i]);
+		}
+
+		BoundingBoxScalar(positions, indices, num_simd_triangles, num_triangles, bbox);
+	}
+#endif
+
+	template<typename I>
+	void BoundingBox(glm::vec3 const * positions, I const * indices, std::size_t num_triangles, util::SIMDLevel level, MeshBoundingBox & bbox)
+	{
+#ifdef SKYGGE_SIMD_X86
+		if (level == util::SIMDLevel::AVX2)
+		{
+			BoundingBoxAVX2(positions, indices, num_triangles, bbox);
+			return;
+		}
+		if (level == util::SIMDLevel::SSE2)
+		{
+			BoundingBoxSSE2(positions, indices, num_triangles, bbox);
+			return;
+		}
+#endif
+		BoundingBoxScalar(positions, indices, 0, num_triangles, bbox);
+	}
+
+
+} /* internal */
+
+MeshBoundingBox MeshletBuilder::CalculateBoundingBox(MeshData const & mesh_data, util::SIMDLevel level)
+{
+	MeshBoundingBox bbox = {};
+
+	level = std::min(level, util::GetSIMDLevel());
+	const auto num_triangles = mesh_data.m_num_indices / 3;
+	switch (mesh_data.m_indices_stride)
+	{
+	case 1: internal::BoundingBox(mesh_data.m_positions.data(), mesh_data.m_indices.data(), num_triangles, level, bbox); break;
+	case 2: internal::BoundingBox(mesh_data.m_positions.data(), reinterpret_cast<std::uint16_t const *>(mesh_data.m_indices.data()), num_triangles, level, bbox); break;
+	default: internal::BoundingBox(mesh_data.m_positions.data(), reinterpret_cast<std::uint32_t const *>(mesh_data.m_indices.data()), num_triangles, level, bbox); break;
+	}
+
+	// potential improvement, instead of average maybe use
+	// http://www.cs.technion.ac.il/~cggc/files/gallery-pdfs/Barequet-1.pdf
+	float len = glm::length(bbox.m_average_normal);
+	if (len > FLT_EPSILON)
+	{
+		bbox.m_average_normal = bbox.m_average_normal / len;
+	}
+	else
+	{
+		bbox.m_average_normal = glm::vec3(0.0f);
+	}
+
+	return bbox;
+}
+
+void MeshletBuilder::Build(MeshData const & mesh_data, MeshBoundingBox const & mesh_bbox, MeshletData & out, MeshletClusteringMode mode)
+{
+	const auto num_vertices = mesh_data.m_positions.size();
+	const auto num_triangles = mesh_data.m_num_indices / 3;
+	const auto max_indices_per_meshlet = static_cast<std::size_t>(max_primitive_count_limit * 3);
+
+	// Partition the triangles into clusters. `cluster_triangles[cluster_offsets[i]..cluster_offsets[i + 1]]` are the
+	// triangles of meshlet `i`.
+	std::vector<std::uint32_t> cluster_triangles;
+	std::vector<std::uint32_t> cluster_offsets;
+	switch (mode)
+	{
+	case MeshletClusteringMode::SPATIAL:
+		internal::ClusterSpatial(mesh_data, cluster_triangles, cluster_offsets);
+		break;
+	case MeshletClusteringMode::SEQUENTIAL:
+	default:
+		internal::ClusterSequential(num_triangles, cluster_triangles, cluster_offsets);
+		break;
+	}
+	const auto num_clusters = cluster_offsets.size() - 1;
+
+	// Scratch memory is allocated once per mesh and reused by every meshlet.
+	// A vertex belongs to the current meshlet when its stamp equals the current generation,
+	// which avoids clearing the remap table between meshlets.
+	std::vector<std::uint32_t> stamps(num_vertices, 0);
+	std::vector<std::uint8_t> remap(num_vertices, 0);
+	std::vector<std::uint32_t> meshlet_vertex_indices;
+	std::vector<std::uint8_t> flat_meshlet_indices;
+	meshlet_vertex_indices.reserve(max_vertex_count_limit);
+	flat_meshlet_indices.reserve(max_indices_per_meshlet + primitive_packing_alignment * 3);
+	std::uint32_t generation = 0;
+
+	out.m_meshlets.reserve(out.m_meshlets.size() + num_clusters);
+	out.m_bounds.reserve(out.m_bounds.size() + num_clusters);
+	out.m_vertex_indices.reserve(out.m_vertex_indices.size() + num_triangles * 3);
+	out.m_index_indices.reserve(out.m_index_indices.size() + num_triangles * 3);
+
+	auto vertices_start = static_cast<std::uint32_t>(out.m_vertex_indices.size());
+	auto prim_begin = static_cast<std::uint32_t>(out.m_index_indices.size() / 3);
+
+	std::vector<glm::vec3> bounds_scratch;
+	bounds_scratch.reserve(max_vertex_count_limit);
+
+	for (std::size_t cluster = 0; cluster < num_clusters; cluster++)
+	{
+		MeshletDesc meshlet = {};
+
+		glm::vec3 bbox_min = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 bbox_max = glm::vec3(-std::numeric_limits<float>::max());
+
+		const auto first_triangle = cluster_offsets[cluster];
+		const auto num_triangles_in_meshlet = cluster_offsets[cluster + 1] - first_triangle;
+		const auto num_indices_in_meshlet = static_cast<std::size_t>(num_triangles_in_meshlet) * 3;
+
+		meshlet_vertex_indices.clear();
+		flat_meshlet_indices.resize(num_indices_in_meshlet);
+		generation++;
+
+		for (std::size_t i = 0; i < num_indices_in_meshlet; i++)
+		{
+			auto index = mesh_data.GetIndex(cluster_triangles[first_triangle + i / 3] * 3 + i % 3);
+			auto const & pos = mesh_data.m_positions[index];
+
+			// bounding box
+			bbox_min = glm::min(bbox_min, pos);
+			bbox_max = glm::max(bbox_max, pos);
+
+			if (stamps[index] != generation)
+			{
+				stamps[index] = generation;
+				remap[index] = static_cast<std::uint8_t>(meshlet_vertex_indices.size());
+				meshlet_vertex_indices.push_back(index);
+			}
+
+			flat_meshlet_indices[i] = remap[index];
+		}
+
+		// alignment
+		auto alligned_vertices_start = SizeAlignTwoPower(vertices_start, vertex_packing_alignment);
+		auto alligned_prim_start = SizeAlignTwoPower(prim_begin, primitive_packing_alignment);
+
+		// pad array to allignment
+		out.m_vertex_indices.resize(out.m_vertex_indices.size() + (alligned_vertices_start - vertices_start), 0);
+		flat_meshlet_indices.resize(flat_meshlet_indices.size() + (alligned_prim_start - prim_begin) * 3, 0);
+
+		// Get new size with padding.
+		auto num_unique_vertices = static_cast<std::uint32_t>(meshlet_vertex_indices.size());
+		auto num_unique_indices = static_cast<std::uint32_t>(flat_meshlet_indices.size());
+
+		vertices_start = alligned_vertices_start;
+		prim_begin = alligned_prim_start;
+
+		meshlet.SetNumVertices(num_unique_vertices);
+		meshlet.SetVertexBegin(vertices_start);
+		meshlet.SetNumPrims(static_cast<std::uint32_t>(num_indices_in_meshlet / 3));
+		meshlet.SetPrimBegin(prim_begin);
+
+		vertices_start += num_unique_vertices;
+		prim_begin += (num_unique_indices / 3);
+
+		out.m_vertex_indices.insert(out.m_vertex_indices.end(), meshlet_vertex_indices.begin(), meshlet_vertex_indices.end());
+		out.m_index_indices.insert(out.m_index_indices.end(), flat_meshlet_indices.begin(), flat_meshlet_indices.end());
+
+		TruncateBBoxToMeshBBox(bbox_min, bbox_max, mesh_bbox);
+
+		// Snap to grid
+		const int grid_bits = 8;
+		const int grid_last = (1 << grid_bits) - 1;
+		uint8_t   grid_min[3];
+		uint8_t   grid_max[3];
+
+		grid_min[0] = std::max(0, std::min(int(truncf(bbox_min.x * float(grid_last))), grid_last - 1));
+		grid_min[1] = std::max(0, std::min(int(truncf(bbox_min.y * float(grid_last))), grid_last - 1));
+		grid_min[2] = std::max(0, std::min(int(truncf(bbox_min.z * float(grid_last))), grid_last - 1));
+		grid_max[0] = std::max(0, std::min(int(ceilf(bbox_max.x * float(grid_last))), grid_last));
+		grid_max[1] = std::max(0, std::min(int(ceilf(bbox_max.y * float(grid_last))), grid_last));
+		grid_max[2] = std::max(0, std::min(int(ceilf(bbox_max.z * float(grid_last))), grid_last));
+
+		meshlet.SetBBox(grid_min, grid_max);
+
+		internal::MeshletCone cone;
+		auto bounds = internal::CalculateMeshletBounds(mesh_data, cluster_triangles.data() + first_triangle, num_triangles_in_meshlet,
+			meshlet_vertex_indices, bounds_scratch, cone);
+
+		meshlet.SetCone(cone.m_x, cone.m_y, cone.m_angle);
+
+		out.m_meshlets.push_back(meshlet);
+		out.m_bounds.push_back(bounds);
+	}
+}
+
+MeshletStats MeshletBuilder::CalculateStats(MeshData const & mesh_data, MeshletData const & meshlet_data)
+{
+	MeshletStats stats = {};
+	stats.m_num_meshlets = meshlet_data.m_meshlets.size();
+
+	if (stats.m_num_meshlets == 0)
+	{
+		return stats;
+	}
+
+	double total_vertices = 0;
+	double total_prims = 0;
+	double total_volume = 0;
+	std::size_t num_cullable = 0;
+
+	for (auto const & meshlet : meshlet_data.m_meshlets)
+	{
+		glm::vec3 bbox_min = glm::vec3(std::numeric_limits<float>::max());
+		glm::vec3 bbox_max = glm::vec3(-std::numeric_limits<float>::max());
+
+		auto vertex_begin = meshlet.GetVertexBegin();
+		auto num_vertices = meshlet.GetNumVertices();
+		for (std::uint32_t i = 0; i < num_vertices; i++)
+		{
+			auto const & pos = mesh_data.m_positions[meshlet_data.m_vertex_indices[vertex_begin + i]];
+			bbox_min = glm::min(bbox_min, pos);
+			bbox_max = glm::max(bbox_max, pos);
+		}
+
+		glm::vec3 extent = bbox_max - bbox_min;
+
+		total_vertices += num_vertices;
+		total_prims += meshlet.GetNumPrims();
+		total_volume += double(extent.x) * double(extent.y) * double(extent.z);
+
+		std::int8_t cone_x, cone_y, cone_angle;
+		meshlet.GetCone(cone_x, cone_y, cone_angle);
+		num_cullable += cone_angle < 0 ? 1 : 0;
+	}
+
+	auto num_meshlets = static_cast<double>(stats.m_num_meshlets);
+	stats.m_average_vertices = static_cast<float>(total_vertices / num_meshlets);
+	stats.m_average_fill = static_cast<float>(total_prims / (num_meshlets * max_primitive_count_limit));
+	stats.m_average_bbox_volume = static_cast<float>(total_volume / num_meshlets);
+	stats.m_cone_cullable = static_cast<float>(num_cullable / num_meshlets);
+
+	return stats;
+}
+
+void MeshletBuilder::BuildHierarchy(MeshData const & mesh_data, MeshBoundingBox const & mesh_bbox, MeshletHierarchy & out)
+{
+	const auto num_vertices = mesh_data.m_positions.size();
+	const bool has_normals = mesh_data.m_normals.size() == num_vertices;
+	const bool has_uvs = mesh_data.m_uvw.size() == num_vertices;
+
+	out = {};
+	auto& meshlet_data = out.m_meshlet_data;
+
+	// Level 0
+	Build(mesh_data, mesh_bbox, meshlet_data, MeshletClusteringMode::SPATIAL);
+
+	std::vector<std::uint32_t> pending(meshlet_data.m_meshlets.size());
+	out.m_nodes.resize(meshlet_data.m_meshlets.size());
+	for (std::uint32_t i = 0; i < pending.size(); i++)
+	{
+		pending[i] = i;
+		out.m_nodes[i].m_center = meshlet_data.m_bounds[i].m_sphere_center;
+		out.m_nodes[i].m_radius = meshlet_data.m_bounds[i].m_sphere_radius;
+	}
+
+	// Groups are simplified and split as separate meshes with only the vertices they reference, so the cost of a group
+	// doesn't depend on the size of the mesh.
+	constexpr std::uint32_t invalid = std::numeric_limits<std::uint32_t>::max();
+	std::vector<std::uint32_t> local_vertex(num_vertices, invalid);
+	std::vector<std::uint32_t> global_vertex;
+	std::vector<std::uint32_t> group_indices;
+	std::vector<std::pair<glm::vec3, float>> group_spheres;
+	MeshData group_mesh = {};
+
+	SimplifySettings simplify_settings;
+	simplify_settings.m_lock_border = true; // Group borders are shared with other groups and must not move.
+
+	std::uint32_t level = 0;
+	while (pending.size() > 1)
+	{
+		std::vector<std::uint32_t> next_pending;
+		bool simplified_any = false;
+
+		for (auto const & group : internal::GroupMeshlets(meshlet_data, pending, num_vertices))
+		{
+			// A single meshlet has nothing to merge with and its border is locked.
+			if (group.size() < 2)
+			{
+				next_pending.push_back(group[0]);
+				continue;
+			}
+
+			group_indices.clear();
+			for (auto meshlet : group)
+			{
+				internal::AppendMeshletTriangles(meshlet_data, meshlet, group_indices);
+			}
+
+			// compact the vertices
+			global_vertex.clear();
+			for (auto & index : group_indices)
+			{
+				if (local_vertex[index] == invalid)
+				{
+					local_vertex[index] = static_cast<std::uint32_t>(global_vertex.size());
+					global_vertex.push_back(index);
+				}
+				index = local_vertex[index];
+			}
+
+			group_mesh.m_positions.resize(global_vertex.size());
+			group_mesh.m_normals.resize(has_normals ? global_vertex.size() : 0);
+			group_mesh.m_uvw.resize(has_uvs ? global_vertex.size() : 0);
+			for (std::size_t v = 0; v < global_vertex.size(); v++)
+			{
+				group_mesh.m_positions[v] = mesh_data.m_positions[global_vertex[v]];
+				if (has_normals) group_mesh.m_normals[v] = mesh_data.m_normals[global_vertex[v]];
+				if (has_uvs) group_mesh.m_uvw[v] = mesh_data.m_uvw[global_vertex[v]];
+				local_vertex[global_vertex[v]] = invalid;
+			}
+
+			float simplify_error = 0;
+			auto simplified = MeshSimplifier::Simplify(group_mesh, group_indices, group_indices.size() / 6 * 3, FLT_MAX, simplify_settings, &simplify_error);
+
+			// The group is mostly border. Retry on the next level, where it can be grouped with other meshlets.
+			if (simplified.size() > group_indices.size() * 85 / 100)
+			{
+				next_pending.insert(next_pending.end(), group.begin(), group.end());
+				continue;
+			}
+
+			simplified_any = true;
+
+			// The group bounds contain the bounds of its meshlets and the error is never smaller than theirs.
+			group_spheres.clear();
+			float group_error = simplify_error;
+			for (auto meshlet : group)
+			{
+				auto const & node = out.m_nodes[meshlet];
+				group_spheres.push_back({ node.m_center, node.m_radius });
+				group_error = std::max(group_error, node.m_error);
+			}
+			auto [group_center, group_radius] = internal::MergeBoundingSpheres(group_spheres);
+
+			for (auto meshlet : group)
+			{
+				auto& node = out.m_nodes[meshlet];
+				node.m_parent_center = group_center;
+				node.m_parent_radius = group_radius;
+				node.m_parent_error = group_error;
+			}
+
+			// split into new meshlets
+			group_mesh.m_indices_stride = sizeof(std::uint32_t);
+			group_mesh.m_num_indices = simplified.size();
+			group_mesh.m_indices.resize(simplified.size() * sizeof(std::uint32_t));
+			memcpy(group_mesh.m_indices.data(), simplified.data(), group_mesh.m_indices.size());
+
+			auto first_meshlet = static_cast<std::uint32_t>(meshlet_data.m_meshlets.size());
+			auto first_vertex_index = meshlet_data.m_vertex_indices.size();
+			Build(group_mesh, mesh_bbox, meshlet_data, MeshletClusteringMode::SPATIAL);
+
+			for (auto i = first_vertex_index; i < meshlet_data.m_vertex_indices.size(); i++)
+			{
+				meshlet_data.m_vertex_indices[i] = global_vertex[meshlet_data.m_vertex_indices[i]];
+			}
+
+			for (auto meshlet = first_meshlet; meshlet < meshlet_data.m_meshlets.size(); meshlet++)
+			{
+				MeshletHierarchyNode node = {};
+				node.m_center = group_center;
+				node.m_radius = group_radius;
+				node.m_error = group_error;
+				node.m_level = level + 1;
+				out.m_nodes.push_back(node);
+				next_pending.push_back(meshlet);
+			}
+		}
+
+		if (!simplified_any)
+		{
+			break;
+		}
+
+		pending = std::move(next_pending);
+		level++;
+	}
+
+	out.m_num_levels = level + 1;
+}
+
+std::vector<std::uint32_t> MeshletBuilder::SelectCut(MeshletHierarchy const & hierarchy, glm::vec3 const & view_pos, float threshold)
+{
+	std::vector<std::uint32_t> selected;
+
+	for (std::uint32_t i = 0; i < hierarchy.m_nodes.size(); i++)
+	{
+		auto const & node = hierarchy.m_nodes[i];
+		bool fine_enough = ProjectError(node.m_center, node.m_radius, node.m_error, view_pos) <= threshold;
+		bool parent_fine_enough = node.m_parent_error != FLT_MAX && ProjectError(node.m_parent_center, node.m_parent_radius, node.m_parent_error, view_pos) <= threshold;
+
+		if (fine_enough && !parent_fine_enough)
+		{
+			selected.push_back(i);
+		}
+	}
+
+	return selected;
+}
+
+std::vector<std::uint8_t> MeshletBuilder::SerializeHierarchy(MeshletHierarchy const & hierarchy)
+{
+	auto const & meshlet_data = hierarchy.m_meshlet_data;
+
+	MeshletHierarchyHeader header;
+	header.m_num_levels = hierarchy.m_num_levels;
+	header.m_num_meshlets = static_cast<std::uint32_t>(meshlet_data.m_meshlets.size());
+	header.m_num_vertex_indices = static_cast<std::uint32_t>(meshlet_data.m_vertex_indices.size());
+	header.m_num_index_indices = static_cast<std::uint32_t>(meshlet_data.m_index_indices.size());
+
+	std::vector<std::uint8_t> out(sizeof(MeshletHierarchyHeader));
+	memcpy(out.data(), &header, sizeof(MeshletHierarchyHeader));
+
+	internal::WriteArray(out, meshlet_data.m_meshlets);
+	internal::WriteArray(out, meshlet_data.m_bounds);
+	internal::WriteArray(out, hierarchy.m_nodes);
+	internal::WriteArray(out, meshlet_data.m_vertex_indices);
+	internal::WriteArray(out, meshlet_data.m_index_indices);
+
+	return out;
+}
+
+bool MeshletBuilder::DeserializeHierarchy(std::uint8_t const * data, std::size_t size, MeshletHierarchy & out)
+{
+	MeshletHierarchyHeader header;
+	if (size < sizeof(MeshletHierarchyHeader))
+	{
+		return false;
+	}
+
+	memcpy(&header, data, sizeof(MeshletHierarchyHeader));
+	if (header.m_magic != MeshletHierarchyHeader::magic || header.m_version != MeshletHierarchyHeader::version)
+	{
+		return false;
+	}
+
+	out = {};
+	out.m_num_levels = header.m_num_levels;
+	auto& meshlet_data = out.m_meshlet_data;
+
+	std::size_t offset = sizeof(MeshletHierarchyHeader);
+	return internal::ReadArray(data, size, offset, header.m_num_meshlets, meshlet_data.m_meshlets)
+		&& internal::ReadArray(data, size, offset, header.m_num_meshlets, meshlet_data.m_bounds)
+		&& internal::ReadArray(data, size, offset, header.m_num_meshlets, out.m_nodes)
+		&& internal::ReadArray(data, size, offset, header.m_num_vertex_indices, meshlet_data.m_vertex_indices)
+		&& internal::ReadArray(data, size, offset, header.m_num_index_indices, meshlet_data.m_index_indices);
+}
@@ -9,9 +9,15 @@
 #include <cstdint>
 #include <cassert>
 #include <cstring>
+#include <cfloat>
+#include <limits>
+#include <vector>
+#include <glm.hpp>
 
 #include "vertex.hpp"
+#include "resource_structs.hpp"
 #include "util/bitfield.hpp"
+#include "util/simd.hpp"
 
 static inline const int max_vertex_count_limit = 256;
 static inline const int primitive_packing_alignment = 1;
@@ -25,6 +31,65 @@ constexpr inline T SizeAlignTwoPower(T size, A alignment)
 	return (size + (alignment - 1U)) & ~(alignment - 1U);
 }
 
+// all oct functions derived from "A Survey of Efficient Representations for Independent Unit Vectors"
+// http://jcgt.org/published/0003/02/01/paper.pdf
+inline glm::vec3 OctSignNotZero(glm::vec3 v)
+{
+	// leaves z as is
+	return glm::vec3((v.x >= 0.0f) ? +1.0f : -1.0f, (v.y >= 0.0f) ? +1.0f : -1.0f, 1.0f);
+}
+
+inline glm::vec3 OctToFVec3(glm::vec3 e)
+{
+	auto v = glm::vec3(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
+	if (v.z < 0.0f)
+	{
+		v = glm::vec3(1.0f - fabs(v.y), 1.0f - fabs(v.x), v.z) * OctSignNotZero(v);
+	}
+	return glm::normalize(v);
+}
+
+inline glm::vec3 FVec3ToOct(glm::vec3 v)
+{
+	// Project the sphere onto the octahedron, and then onto the xy plane
+	glm::vec3 p = glm::vec3(v.x, v.y, 0) * (1.0f / (fabsf(v.x) + fabsf(v.y) + fabsf(v.z)));
+	// Reflect the folds of the lower hemisphere over the diagonals
+	return (v.z <= 0.0f) ? glm::vec3(1.0f - fabsf(p.y), 1.0f - fabsf(p.x), 0.0f) * OctSignNotZero(p) : p;
+}
+
+inline glm::vec3 FVec3ToOctnPrecise(glm::vec3 v, const int n)
+{
+	glm::vec3 s = FVec3ToOct(v);  // Remap to the square
+								  // Each snorm's max value interpreted as an integer,
+								  // e.g., 127.0 for snorm8
+	float M = float(1 << ((n / 2) - 1)) - 1.0;
+	// Remap components to snorm(n/2) precision...with floor instead
+	// of round (see equation 1)
+	s = glm::floor(glm::clamp(s, glm::vec3(-1.0f), glm::vec3(1.0f)) * M) * glm::vec3(1.0 / M);
+	glm::vec3 bestRepresentation = s;	
+	float highestCosine = glm::dot(OctToFVec3(s), v);
+	// Test all combinations of floor and ceil and keep the best.
+	// Note that at +/- 1, this will exit the square... but that
+	// will be a worse encoding and never win.
+	for (int i = 0; i <= 1; ++i)
+		for (int j = 0; j <= 1; ++j)
+			// This branch will be evaluated at compile time
+			if ((i != 0) || (j != 0))
+			{
+				// Offset the bit pattern (which is stored in floating
+				// point!) to effectively change the rounding mode
+				// (when i or j is 0: floor, when it is one: ceiling)
+				glm::vec3 candidate = glm::vec3(i, j, 0) * (1 / M) + s;
+				float cosine = glm::dot(OctToFVec3(candidate), v);
+				if (cosine > highestCosine)
+				{
+					bestRepresentation = candidate;
+					highestCosine = cosine;
+				}
+			}
+	return bestRepresentation;
+}
+
 struct MeshletDesc
 {
 	MeshletDesc() : m_x(0), m_y(0), m_z(0), m_w(0)
@@ -142,73 +207,151 @@ struct MeshletDesc
 struct MeshBoundingBox
 {
 	glm::vec3 m_average_normal = glm::vec3(0);
-	std::vector<glm::vec3> m_tri_normals;
 	glm::vec3 m_min = glm::vec3(std::numeric_limits<float>::max());
 	glm::vec3 m_max = glm::vec3(-std::numeric_limits<float>::max());
 };
 
-struct MeshletBuilder
+// Extended meshlet descriptor with full precision culling data. Stored alongside the quantized `MeshletDesc`.
+// The layout is 3 x vec4 so it can be uploaded as is with std430 packing. Not uploaded yet, the task shader only culls
+// with the quantized cone and bounding box of `MeshletDesc`.
+//
+// A meshlet is backfacing for a viewer at `view_pos` when
+// `dot(normalize(m_cone_apex - view_pos), m_cone_axis) >= m_cone_cutoff`.
+// `m_cone_cutoff` is 1 when the meshlet can't be backface culled.
+struct MeshletBounds
 {
-	template<typename VT>
-	static MeshBoundingBox CalculateBoundingBox(MeshData const & mesh_data)
-	{
-		MeshBoundingBox bbox = {};
+	glm::vec3 m_sphere_center = glm::vec3(0);
+	float m_sphere_radius = 0;
 
-		for (auto i = 0; i < mesh_data.m_num_indices; i += 3)
-		{
-			glm::ivec3 triangle;
-			memcpy(&triangle, &mesh_data.m_indices[i * mesh_data.m_indices_stride], mesh_data.m_indices_stride * 3);
+	glm::vec3 m_cone_apex = glm::vec3(0);
+	float m_cone_cutoff = 1; // sin(cone angle)
 
-			auto v0 = mesh_data.m_positions[triangle[0]];
-			auto v1 = mesh_data.m_positions[triangle[1]];
-			auto v2 = mesh_data.m_positions[triangle[2]];
+	glm::vec3 m_cone_axis = glm::vec3(0);
+	float m_padding = 0;
+};
 
-			// bounding box
-			{
-				bbox.m_min = glm::min(bbox.m_min, v0);
-				bbox.m_min = glm::min(bbox.m_min, v1);
-				bbox.m_min = glm::min(bbox.m_min, v2);
+enum class MeshletClusteringMode
+{
+	SEQUENTIAL, // Consecutive runs of `max_primitive_count_limit` triangles in index buffer order.
+	SPATIAL, // Greedy growth over triangle adjacency, favouring shared vertices and compact clusters.
+};
 
-				bbox.m_max = glm::max(bbox.m_max, v0);
-				bbox.m_max = glm::max(bbox.m_max, v1);
-				bbox.m_max = glm::max(bbox.m_max, v2);
-			}
+struct MeshletData
+{
+	std::vector<MeshletDesc> m_meshlets;
+	std::vector<MeshletBounds> m_bounds; // One per meshlet. (CPU only for now)
+	std::vector<std::uint32_t> m_vertex_indices; // used to index the vertex buffer from mesh shading (Uploaded to the GPU)
+	std::vector<std::uint8_t> m_index_indices; // used to index the vertex indices buffer  (Uploaded to the GPU)
+};
 
-			// cone
-			{
-				glm::vec3 cross = glm::cross(v1 - v0, v2 - v0);
-				float length = glm::length(cross);
+// Quality metrics of a set of meshlets, used to compare clustering modes.
+struct MeshletStats
+{
+	std::size_t m_num_meshlets = 0;
+	float m_average_vertices = 0; // Unique vertices per meshlet.
+	float m_average_fill = 0; // Primitives per meshlet relative to `max_primitive_count_limit`. (0..1)
+	float m_average_bbox_volume = 0; // Object space bounding box volume per meshlet.
+	float m_cone_cullable = 0; // Fraction of meshlets with a backface cullable normal cone.
+};
 
-				glm::vec3 normal;
-				if (length > FLT_EPSILON)
-				{
-					normal = cross * (1.0f / length);
-				}
-				else
-				{
-					normal = cross;
-				}
+// Number of neighbouring meshlets that are merged and simplified together when building a meshlet hierarchy.
+static inline const std::uint32_t meshlet_group_size = 8;
+
+// Level of detail information of a meshlet in a `MeshletHierarchy`. The layout is 3 x vec4 so it can be uploaded as is
+// with std430 packing.
+//
+// Every meshlet is created by simplifying a group of meshlets of the level below and is later merged into a group
+// that gets simplified for the level above. All meshlets created from the same group share `m_center`, `m_radius` and
+// `m_error`, all meshlets merged into the same group share the parent values. The parent sphere contains the sphere of
+// the meshlet and the parent error is never smaller, so the projected error is monotonic from the leaves to the roots.
+struct MeshletHierarchyNode
+{
+	// Bounds and object space error of the group this meshlet was created from. The error is 0 for level 0.
+	glm::vec3 m_center = glm::vec3(0);
+	float m_radius = 0;
+
+	// Bounds and object space error of the group this meshlet was merged into. The error is FLT_MAX for roots.
+	glm::vec3 m_parent_center = glm::vec3(0);
+	float m_parent_radius = 0;
+
+	float m_error = 0;
+	float m_parent_error = FLT_MAX;
+	std::uint32_t m_level = 0;
+	std::uint32_t m_padding = 0;
+};
 
-				bbox.m_average_normal += normal;
-				bbox.m_tri_normals.push_back(normal);
-			}
-		}
+// Meshlets of every level of a mesh. The meshlets of all levels index the vertex buffer of the source mesh.
+//
+// Serialized layout (little endian, every array starts 4 byte aligned):
+//   MeshletHierarchyHeader
+//   MeshletDesc[m_num_meshlets]
+//   MeshletBounds[m_num_meshlets]
+//   MeshletHierarchyNode[m_num_meshlets]
+//   std::uint32_t[m_num_vertex_indices]
+//   std::uint8_t[m_num_index_indices], padded to 4 bytes
+struct MeshletHierarchy
+{
+	MeshletData m_meshlet_data; // Level 0 first.
+	std::vector<MeshletHierarchyNode> m_nodes; // One per meshlet.
+	std::uint32_t m_num_levels = 0;
+};
 
-		// potential improvement, instead of average maybe use
-		// http://www.cs.technion.ac.il/~cggc/files/gallery-pdfs/Barequet-1.pdf
-		float len = glm::length(bbox.m_average_normal);
-		if (len > FLT_EPSILON)
-		{
-			bbox.m_average_normal = bbox.m_average_normal / len;
-		}
-		else
+struct MeshletHierarchyHeader
+{
+	static inline const std::uint32_t magic = 0x484D4B53; // "SKMH"
+	static inline const std::uint32_t version = 3;
+
+	std::uint32_t m_magic = magic;
+	std::uint32_t m_version = version;
+	std::uint32_t m_num_levels = 0;
+	std::uint32_t m_num_meshlets = 0;
+	std::uint32_t m_num_vertex_indices = 0;
+	std::uint32_t m_num_index_indices = 0;
+};
+
+struct MeshletBuilder
+{
+	// Bounding box of the referenced vertices and average face normal in a single pass over the index buffer.
+	// Face normals are accumulated in registers, nothing is stored per triangle. `level` selects the kernel and is
+	// clamped to what the CPU supports. 8, 16 and 32 bit indices are supported.
+	static MeshBoundingBox CalculateBoundingBox(MeshData const & mesh_data, util::SIMDLevel level = util::GetSIMDLevel());
+
+	// Splits the index buffer of `mesh_data` into meshlets of at most `max_primitive_count_limit` triangles and
+	// `max_vertex_count_limit` vertices and appends the meshlet descriptors, vertex indices and primitive indices to `out`.
+	// Vertex de-duplication uses a generation stamped remap table so the cost is linear in the number of indices.
+	// The normal cone and bounding sphere of every meshlet are calculated from the meshlet's own triangles.
+	static void Build(MeshData const & mesh_data, MeshBoundingBox const & mesh_bbox, MeshletData & out,
+		MeshletClusteringMode mode = MeshletClusteringMode::SEQUENTIAL);
+
+	// Expects `meshlet_data` to only contain the meshlets of `mesh_data`.
+	static MeshletStats CalculateStats(MeshData const & mesh_data, MeshletData const & meshlet_data);
+
+	// Builds a continuous level of detail hierarchy. Level 0 are the spatially clustered meshlets of `mesh_data`.
+	// Every following level merges groups of up to `meshlet_group_size` neighbouring meshlets, simplifies them to half
+	// their triangle count with the group border locked and splits the result into new meshlets.
+	// Stops when no group can be simplified anymore.
+	static void BuildHierarchy(MeshData const & mesh_data, MeshBoundingBox const & mesh_bbox, MeshletHierarchy & out);
+
+	// Error of a group as seen from `view_pos`. Object space error divided by the distance to the group's bounds.
+	static float ProjectError(glm::vec3 const & center, float radius, float error, glm::vec3 const & view_pos)
+	{
+		if (error == 0.f || error == FLT_MAX)
 		{
-			bbox.m_average_normal = glm::vec3(0.0f);
+			return error;
 		}
 
-		return bbox;
+		float distance = glm::length(center - view_pos) - radius;
+		return distance > 0.f ? error / distance : FLT_MAX;
 	}
 
+	// CPU reference of the cut selection. Returns the meshlets whose own projected error is within `threshold` while
+	// the projected error of their parent isn't. Every part of the surface is covered by exactly one selected meshlet.
+	static std::vector<std::uint32_t> SelectCut(MeshletHierarchy const & hierarchy, glm::vec3 const & view_pos, float threshold);
+
+	static std::vector<std::uint8_t> SerializeHierarchy(MeshletHierarchy const & hierarchy);
+	// Returns false when `data` isn't a serialized hierarchy of the current version.
+	static bool DeserializeHierarchy(std::uint8_t const * data, std::size_t size, MeshletHierarchy & out);
+
 	static void TruncateBBoxToMeshBBox(glm::vec3& bbox_min, glm::vec3& bbox_max, MeshBoundingBox const& mesh_bbox)
 	{
 		glm::vec3 object_bbox_extent = mesh_bbox.m_max - mesh_bbox.m_min;
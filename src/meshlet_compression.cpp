@@ -0,0 +1,332 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "meshlet_compression.hpp"
+
+#include <algorithm>
+#include <future>
+
+namespace internal
+{
+
+	static constexpr std::uint32_t codec_fifo_size = 16;
+	static constexpr std::uint32_t codec_max_edge = 15; // Edge FIFO entries addressable by a code byte.
+	static constexpr std::uint32_t codec_max_vertex = 14; // Vertex FIFO entries addressable by a code byte.
+	static constexpr std::uint8_t codec_explicit_vertex = 15;
+	static constexpr std::uint8_t codec_no_edge = 0xF0;
+
+	inline void WriteVarint(std::vector<std::uint8_t> & out, std::uint32_t value)
+	{
+		while (value >= 0x80)
+		{
+			out.push_back(static_cast<std::uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<std::uint8_t>(value));
+	}
+
+	inline std::uint32_t ReadVarint(std::uint8_t const *& data)
+	{
+		std::uint32_t value = 0;
+		for (std::uint32_t shift = 0; ; shift += 7)
+		{
+			auto byte = *data++;
+			value |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+			if (byte < 0x80)
+			{
+				return value;
+			}
+		}
+	}
+
+	inline std::uint32_t ZigZag(std::uint32_t delta)
+	{
+		return (delta << 1) ^ static_cast<std::uint32_t>(static_cast<std::int32_t>(delta) >> 31);
+	}
+
+	inline std::uint32_t UnZigZag(std::uint32_t value)
+	{
+		return (value >> 1) ^ (0u - (value & 1));
+	}
+
+	// Edge and vertex FIFOs shared by the triangle encoder and decoder. Entry 0 is the most recent.
+	struct TriangleCodecState
+	{
+		std::uint8_t m_edges[codec_fifo_size][2] = {};
+		std::uint8_t m_vertices[codec_fifo_size] = {};
+		std::uint32_t m_num_edges = 0;
+		std::uint32_t m_num_vertices = 0;
+		std::uint32_t m_next_vertex = 0;
+
+		std::uint8_t const * GetEdge(std::uint32_t i) const
+		{
+			return m_edges[(m_num_edges - 1 - i) & (codec_fifo_size - 1)];
+		}
+
+		std::uint8_t GetVertex(std::uint32_t i) const
+		{
+			return m_vertices[(m_num_vertices - 1 - i) & (codec_fifo_size - 1)];
+		}
+
+		std::uint32_t NumEdges() const { return std::min(m_num_edges, codec_max_edge); }
+		std::uint32_t NumVertices() const { return std::min(m_num_vertices, codec_max_vertex); }
+
+		// Edges are stored in the direction a neighbouring triangle would use them.
+		void PushEdge(std::uint8_t a, std::uint8_t b)
+		{
+			auto& edge = m_edges[m_num_edges++ & (codec_fifo_size - 1)];
+			edge[0] = b;
+			edge[1] = a;
+		}
+
+		void PushVertex(std::uint8_t v)
+		{
+			m_vertices[m_num_vertices++ & (codec_fifo_size - 1)] = v;
+		}
+	};
+
+	inline void EncodeTriangles(std::uint8_t const * indices, std::uint32_t num_triangles, std::vector<std::uint8_t> & out)
+	{
+		TriangleCodecState state;
+
+		for (std::uint32_t t = 0; t < num_triangles; t++)
+		{
+			std::uint8_t const * triangle = indices + t * 3;
+
+			// Find a rotation of the triangle that starts with a FIFO edge. Prefer a cheap third vertex.
+			std::uint32_t best_edge = codec_max_edge;
+			std::uint32_t best_rotation = 0;
+			std::uint8_t best_code = codec_explicit_vertex;
+			for (std::uint32_t rotation = 0; rotation < 3 && best_code == codec_explicit_vertex; rotation++)
+			{
+				auto a = triangle[rotation], b = triangle[(rotation + 1) % 3], c = triangle[(rotation + 2) % 3];
+
+				for (std::uint32_t e = 0; e < state.NumEdges(); e++)
+				{
+					auto edge = state.GetEdge(e);
+					if (edge[0] != a || edge[1] != b)
+					{
+						continue;
+					}
+
+					std::uint8_t code = codec_explicit_vertex;
+					if (c == state.m_next_vertex)
+					{
+						code = 0;
+					}
+					else
+					{
+						for (std::uint32_t v = 0; v < state.NumVertices(); v++)
+						{
+							if (state.GetVertex(v) == c)
+							{
+								code = static_cast<std::uint8_t>(v + 1);
+								break;
+							}
+						}
+					}
+
+					if (best_edge == codec_max_edge || code != codec_explicit_vertex)
+					{
+						best_edge = e;
+						best_rotation = rotation;
+						best_code = code;
+					}
+					break;
+				}
+			}
+
+			if (best_edge != codec_max_edge)
+			{
+				auto a = triangle[best_rotation], b = triangle[(best_rotation + 1) % 3], c = triangle[(best_rotation + 2) % 3];
+
+				out.push_back(static_cast<std::uint8_t>((best_edge << 4) | best_code));
+				if (best_code == codec_explicit_vertex)
+				{
+					out.push_back(c);
+				}
+				if (best_code == 0)
+				{
+					state.m_next_vertex++;
+				}
+				if (best_code == 0 || best_code == codec_explicit_vertex)
+				{
+					state.PushVertex(c);
+				}
+
+				state.PushEdge(b, c);
+				state.PushEdge(c, a);
+				continue;
+			}
+
+			// No shared edge, encode all vertices.
+			auto code_position = out.size();
+			std::uint8_t code = codec_no_edge;
+			out.push_back(code);
+			for (std::uint32_t k = 0; k < 3; k++)
+			{
+				if (triangle[k] == state.m_next_vertex)
+				{
+					code |= static_cast<std::uint8_t>(1 << k);
+					state.m_next_vertex++;
+				}
+				else
+				{
+					out.push_back(triangle[k]);
+				}
+				state.PushVertex(triangle[k]);
+			}
+			out[code_position] = code;
+
+			state.PushEdge(triangle[0], triangle[1]);
+			state.PushEdge(triangle[1], triangle[2]);
+			state.PushEdge(triangle[2], triangle[0]);
+		}
+	}
+
+	inline void DecodeTriangles(std::uint8_t const *& data, std::uint32_t num_triangles, std::uint8_t* out)
+	{
+		TriangleCodecState state;
+
+		for (std::uint32_t t = 0; t < num_triangles; t++)
+		{
+			std::uint8_t* triangle = out + t * 3;
+			auto code = *data++;
+
+			if (code < codec_no_edge)
+			{
+				auto edge = state.GetEdge(code >> 4);
+				auto a = edge[0], b = edge[1];
+				std::uint8_t c;
+
+				auto vertex_code = static_cast<std::uint8_t>(code & 15);
+				if (vertex_code == 0)
+				{
+					c = static_cast<std::uint8_t>(state.m_next_vertex++);
+					state.PushVertex(c);
+				}
+				else if (vertex_code == codec_explicit_vertex)
+				{
+					c = *data++;
+					state.PushVertex(c);
+				}
+				else
+				{
+					c = state.GetVertex(vertex_code - 1);
+				}
+
+				triangle[0] = a;
+				triangle[1] = b;
+				triangle[2] = c;
+
+				state.PushEdge(b, c);
+				state.PushEdge(c, a);
+				continue;
+			}
+
+			for (std::uint32_t k = 0; k < 3; k++)
+			{
+				triangle[k] = (code & (1 << k)) ? static_cast<std::uint8_t>(state.m_next_vertex++) : *data++;
+				state.PushVertex(triangle[k]);
+			}
+
+			state.PushEdge(triangle[0], triangle[1]);
+			state.PushEdge(triangle[1], triangle[2]);
+			state.PushEdge(triangle[2], triangle[0]);
+		}
+	}
+
+	inline void DecodeMeshlets(CompressedMeshletView const & compressed, MeshletData & out, std::size_t first, std::size_t last)
+	{
+		for (std::size_t m = first; m < last; m++)
+		{
+			auto const & desc = compressed.m_meshlets[m];
+			std::uint8_t const * data = compressed.m_data + compressed.m_offsets[m];
+
+			auto vertex_indices = out.m_vertex_indices.data() + desc.GetVertexBegin();
+			std::uint32_t previous = 0;
+			for (std::uint32_t i = 0; i < desc.GetNumVertices(); i++)
+			{
+				auto value = ReadVarint(data);
+				previous = i == 0 ? value : previous + UnZigZag(value);
+				vertex_indices[i] = previous;
+			}
+
+			DecodeTriangles(data, desc.GetNumPrims(), out.m_index_indices.data() + desc.GetPrimBegin() * 3);
+		}
+	}
+
+} /* internal */
+
+CompressedMeshletData MeshletCompression::Encode(MeshletData const & meshlet_data)
+{
+	CompressedMeshletData compressed;
+	compressed.m_meshlets = meshlet_data.m_meshlets;
+	compressed.m_bounds = meshlet_data.m_bounds;
+	compressed.m_num_vertex_indices = static_cast<std::uint32_t>(meshlet_data.m_vertex_indices.size());
+	compressed.m_num_index_indices = static_cast<std::uint32_t>(meshlet_data.m_index_indices.size());
+	compressed.m_offsets.reserve(meshlet_data.m_meshlets.size() + 1);
+
+	for (auto const & desc : meshlet_data.m_meshlets)
+	{
+		compressed.m_offsets.push_back(static_cast<std::uint32_t>(compressed.m_data.size()));
+
+		auto vertex_indices = meshlet_data.m_vertex_indices.data() + desc.GetVertexBegin();
+		for (std::uint32_t i = 0; i < desc.GetNumVertices(); i++)
+		{
+			internal::WriteVarint(compressed.m_data, i == 0 ? vertex_indices[0] : internal::ZigZag(vertex_indices[i] - vertex_indices[i - 1]));
+		}
+
+		internal::EncodeTriangles(meshlet_data.m_index_indices.data() + desc.GetPrimBegin() * 3, desc.GetNumPrims(), compressed.m_data);
+	}
+
+	compressed.m_offsets.push_back(static_cast<std::uint32_t>(compressed.m_data.size()));
+
+	return compressed;
+}
+
+void MeshletCompression::Decode(CompressedMeshletData const & compressed, MeshletData & out, util::ThreadPool* thread_pool)
+{
+	CompressedMeshletView view;
+	view.m_meshlets = compressed.m_meshlets.data();
+	view.m_num_meshlets = compressed.m_meshlets.size();
+	view.m_data = compressed.m_data.data();
+	view.m_offsets = compressed.m_offsets.data();
+	view.m_num_vertex_indices = compressed.m_num_vertex_indices;
+	view.m_num_index_indices = compressed.m_num_index_indices;
+
+	Decode(view, out, thread_pool);
+	out.m_bounds = compressed.m_bounds;
+}
+
+void MeshletCompression::Decode(CompressedMeshletView const & compressed, MeshletData & out, util::ThreadPool* thread_pool)
+{
+	out.m_meshlets.assign(compressed.m_meshlets, compressed.m_meshlets + compressed.m_num_meshlets);
+	out.m_vertex_indices.assign(compressed.m_num_vertex_indices, 0);
+	out.m_index_indices.assign(compressed.m_num_index_indices, 0);
+
+	const auto num_meshlets = compressed.m_num_meshlets;
+	if (!thread_pool || num_meshlets <= meshlet_decode_batch_size)
+	{
+		internal::DecodeMeshlets(compressed, out, 0, num_meshlets);
+		return;
+	}
+
+	std::vector<std::future<void>> futures;
+	for (std::size_t first = 0; first < num_meshlets; first += meshlet_decode_batch_size)
+	{
+		auto last = std::min(first + meshlet_decode_batch_size, num_meshlets);
+		futures.emplace_back(thread_pool->Enqueue([&compressed, &out, first, last]()
+		{
+			internal::DecodeMeshlets(compressed, out, first, last);
+		}));
+	}
+
+	for (auto & future : futures)
+	{
+		future.get();
+	}
+}
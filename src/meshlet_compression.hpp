@@ -0,0 +1,66 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "meshlet_builder.hpp"
+#include "util/thread_pool.hpp"
+
+// Number of meshlets decoded by a single thread pool task.
+static inline const std::uint32_t meshlet_decode_batch_size = 1024;
+
+// `MeshletData` with the vertex and primitive indices of every meshlet entropy reduced into a byte stream.
+// Meshlets are encoded independently so they can be decoded in parallel.
+//
+// Stream of a meshlet:
+//   vertex indices   `GetNumVertices()` varints. The first is absolute, the others are zigzag encoded deltas to the
+//                    previous index.
+//   triangles        One code byte per triangle, optionally followed by explicit local vertex indices.
+//                    `0xEV` reuses edge `E` (0..14) of the edge FIFO with third vertex `V`:
+//                      0     the next unused local vertex (meshlet vertices are numbered in order of first use)
+//                      1..14 entry `V - 1` of the vertex FIFO
+//                      15    explicit, the local index follows
+//                    `0xF0 | N` encodes all three vertices. Bit `i` of `N` set means vertex `i` is the next unused
+//                    vertex, otherwise its local index follows.
+//
+// Triangles may be rotated to line up with a FIFO edge. The winding is preserved.
+struct CompressedMeshletData
+{
+	std::vector<MeshletDesc> m_meshlets;
+	std::vector<MeshletBounds> m_bounds;
+	std::vector<std::uint8_t> m_data;
+	std::vector<std::uint32_t> m_offsets; // Start of every meshlet in `m_data` plus the end of the last meshlet.
+
+	// Size of the decoded index buffers.
+	std::uint32_t m_num_vertex_indices = 0;
+	std::uint32_t m_num_index_indices = 0;
+};
+
+// Compressed meshlets in memory owned by someone else, like a memory mapped cooked model.
+struct CompressedMeshletView
+{
+	MeshletDesc const * m_meshlets = nullptr;
+	std::size_t m_num_meshlets = 0;
+	std::uint8_t const * m_data = nullptr;
+	std::uint32_t const * m_offsets = nullptr; // `m_num_meshlets + 1` entries.
+
+	std::uint32_t m_num_vertex_indices = 0;
+	std::uint32_t m_num_index_indices = 0;
+};
+
+struct MeshletCompression
+{
+	static CompressedMeshletData Encode(MeshletData const & meshlet_data);
+
+	// Decodes into `out`, replacing its contents. Meshlets are decoded in batches of `meshlet_decode_batch_size` on
+	// `thread_pool` when given.
+	static void Decode(CompressedMeshletData const & compressed, MeshletData & out, util::ThreadPool* thread_pool = nullptr);
+	// Same as above, except that `out.m_bounds` is left untouched since the view doesn't contain bounds.
+	static void Decode(CompressedMeshletView const & compressed, MeshletData & out, util::ThreadPool* thread_pool = nullptr);
+};
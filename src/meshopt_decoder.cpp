@@ -0,0 +1,509 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "meshopt_decoder.hpp"
+
+#include <cmath>
+#include <cstring>
+
+namespace internal
+{
+
+	static constexpr std::uint8_t vertex_header = 0xA0;
+	static constexpr std::uint8_t index_header = 0xE0;
+	static constexpr std::uint8_t sequence_header = 0xD0;
+
+	// Vertex bytes are delta encoded in groups of 16, a block has at most 8 KiB or 256 vertices.
+	static constexpr std::size_t byte_group_size = 16;
+	static constexpr std::size_t max_group_size = 24;
+	static constexpr std::size_t vertex_block_bytes = 8192;
+	static constexpr std::size_t max_vertex_block_size = 256;
+	static constexpr std::size_t min_tail_size = 32;
+
+	inline std::size_t GetVertexBlockSize(std::size_t stride)
+	{
+		auto block_size = (vertex_block_bytes / stride) & ~(byte_group_size - 1);
+		return block_size < max_vertex_block_size ? block_size : max_vertex_block_size;
+	}
+
+	inline std::uint8_t Unzigzag8(std::uint8_t v)
+	{
+		return static_cast<std::uint8_t>(-(v & 1) ^ (v >> 1));
+	}
+
+	// A group of 16 bytes is stored as 0, 2, 4 or 8 bits per byte. Packed values are stored most significant bits
+	// first, the largest value means the byte follows the packed values.
+	inline std::uint8_t const * DecodeBytesGroup(std::uint8_t const * data, std::uint8_t* buffer, int bits_log2)
+	{
+		if (bits_log2 == 0)
+		{
+			memset(buffer, 0, byte_group_size);
+			return data;
+		}
+		else if (bits_log2 == 3)
+		{
+			memcpy(buffer, data, byte_group_size);
+			return data + byte_group_size;
+		}
+
+		const int bits = bits_log2 == 1 ? 2 : 4;
+		const std::uint8_t sentinel = static_cast<std::uint8_t>((1 << bits) - 1);
+		auto packed = data;
+		auto explicit_bytes = data + byte_group_size * bits / 8;
+
+		for (std::size_t i = 0; i < byte_group_size; i++)
+		{
+			auto shift = 8 - bits - static_cast<int>((i * bits) % 8);
+			auto value = static_cast<std::uint8_t>((packed[(i * bits) / 8] >> shift) & sentinel);
+			buffer[i] = value == sentinel ? *explicit_bytes++ : value;
+		}
+
+		return explicit_bytes;
+	}
+
+	// Decodes `size` bytes, a multiple of 16, preceded by 2 bits per group that select the encoding of the group.
+	inline std::uint8_t const * DecodeBytes(std::uint8_t const * data, std::uint8_t const * data_end, std::uint8_t* buffer, std::size_t size)
+	{
+		auto header = data;
+		auto header_size = (size / byte_group_size + 3) / 4;
+		if (static_cast<std::size_t>(data_end - data) < header_size)
+		{
+			return nullptr;
+		}
+		data += header_size;
+
+		for (std::size_t i = 0; i < size; i += byte_group_size)
+		{
+			// Valid streams end with a tail of at least 32 bytes, so a group never reads past the end.
+			if (static_cast<std::size_t>(data_end - data) < max_group_size)
+			{
+				return nullptr;
+			}
+
+			auto group = i / byte_group_size;
+			int bits_log2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+			data = DecodeBytesGroup(data, buffer + i, bits_log2);
+		}
+
+		return data;
+	}
+
+	// Every byte of the vertex is a stream of deltas to the same byte of the previous vertex.
+	inline std::uint8_t const * DecodeVertexBlock(std::uint8_t const * data, std::uint8_t const * data_end, std::uint8_t* destination,
+		std::size_t count, std::size_t stride, std::uint8_t* last_vertex)
+	{
+		std::uint8_t buffer[max_vertex_block_size];
+		const auto aligned_count = (count + byte_group_size - 1) & ~(byte_group_size - 1);
+
+		for (std::size_t k = 0; k < stride; k++)
+		{
+			data = DecodeBytes(data, data_end, buffer, aligned_count);
+			if (!data)
+			{
+				return nullptr;
+			}
+
+			auto previous = last_vertex[k];
+			for (std::size_t i = 0; i < count; i++)
+			{
+				previous = static_cast<std::uint8_t>(Unzigzag8(buffer[i]) + previous);
+				destination[i * stride + k] = previous;
+			}
+			last_vertex[k] = previous;
+		}
+
+		return data;
+	}
+
+	inline std::uint32_t DecodeVarint(std::uint8_t const *& data)
+	{
+		std::uint8_t lead = *data++;
+		if (lead < 128)
+		{
+			return lead;
+		}
+
+		// At most 4 more bytes, so malformed data can't read further.
+		std::uint32_t result = lead & 127;
+		std::uint32_t shift = 7;
+		for (int i = 0; i < 4; i++)
+		{
+			std::uint8_t group = *data++;
+			result |= static_cast<std::uint32_t>(group & 127) << shift;
+			shift += 7;
+			if (group < 128)
+			{
+				break;
+			}
+		}
+
+		return result;
+	}
+
+	// Zigzag encoded delta to `last`.
+	inline std::uint32_t DecodeIndex(std::uint8_t const *& data, std::uint32_t last)
+	{
+		auto v = DecodeVarint(data);
+		return last + ((v >> 1) ^ (0u - (v & 1)));
+	}
+
+	inline void WriteIndex(std::uint8_t* destination, std::size_t i, std::size_t stride, std::uint32_t index)
+	{
+		if (stride == 2)
+		{
+			auto value = static_cast<std::uint16_t>(index);
+			memcpy(destination + i * 2, &value, sizeof(value));
+		}
+		else
+		{
+			memcpy(destination + i * 4, &index, sizeof(index));
+		}
+	}
+
+	struct IndexFifos
+	{
+		std::uint32_t m_edges[16][2];
+		std::uint32_t m_vertices[16];
+		std::size_t m_edge_offset = 0;
+		std::size_t m_vertex_offset = 0;
+
+		IndexFifos()
+		{
+			memset(m_edges, -1, sizeof(m_edges));
+			memset(m_vertices, -1, sizeof(m_vertices));
+		}
+
+		// The FIFOs have to advance exactly like they did while encoding.
+		void PushVertex(std::uint32_t v, bool advance = true)
+		{
+			m_vertices[m_vertex_offset] = v;
+			m_vertex_offset = (m_vertex_offset + (advance ? 1 : 0)) & 15;
+		}
+
+		void PushEdge(std::uint32_t a, std::uint32_t b)
+		{
+			m_edges[m_edge_offset][0] = a;
+			m_edges[m_edge_offset][1] = b;
+			m_edge_offset = (m_edge_offset + 1) & 15;
+		}
+	};
+
+	template<typename T>
+	inline void DecodeOctahedral(std::uint8_t* data, std::size_t count)
+	{
+		const float max = static_cast<float>((1 << (sizeof(T) * 8 - 1)) - 1);
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			T v[4];
+			memcpy(v, data + i * sizeof(v), sizeof(v));
+
+			// The third component stores 1.0 in the same fixed point scale.
+			float x = static_cast<float>(v[0]);
+			float y = static_cast<float>(v[1]);
+			float z = static_cast<float>(v[2]) - std::fabs(x) - std::fabs(y);
+
+			// Unfold the lower hemisphere.
+			float t = z < 0.f ? z : 0.f;
+			x += x >= 0.f ? t : -t;
+			y += y >= 0.f ? t : -t;
+
+			float length = std::sqrt(x * x + y * y + z * z);
+			float s = length > 0.f ? max / length : 0.f;
+
+			v[0] = static_cast<T>(static_cast<int>(x * s + (x >= 0.f ? 0.5f : -0.5f)));
+			v[1] = static_cast<T>(static_cast<int>(y * s + (y >= 0.f ? 0.5f : -0.5f)));
+			v[2] = static_cast<T>(static_cast<int>(z * s + (z >= 0.f ? 0.5f : -0.5f)));
+			memcpy(data + i * sizeof(v), v, sizeof(v));
+		}
+	}
+
+	inline void DecodeQuaternion(std::uint8_t* data, std::size_t count)
+	{
+		const float scale = 1.f / std::sqrt(2.f);
+
+		for (std::size_t i = 0; i < count; i++)
+		{
+			std::int16_t v[4];
+			memcpy(v, data + i * sizeof(v), sizeof(v));
+
+			// The low 2 bits of the fourth component are the index of the dropped component, the rest is the scale.
+			int component_scale = v[3] | 3;
+			float ss = scale / static_cast<float>(component_scale);
+
+			float x = v[0] * ss;
+			float y = v[1] * ss;
+			float z = v[2] * ss;
+			float ww = 1.f - x * x - y * y - z * z;
+			float w = std::sqrt(ww >= 0.f ? ww : 0.f);
+
+			auto to_int16 = [](float f) { return static_cast<std::int16_t>(static_cast<int>(f * 32767.f + (f >= 0.f ? 0.5f : -0.5f))); };
+
+			int dropped = v[3] & 3;
+			std::int16_t out[4];
+			out[(dropped + 1) & 3] = to_int16(x);
+			out[(dropped + 2) & 3] = to_int16(y);
+			out[(dropped + 3) & 3] = to_int16(z);
+			out[dropped] = to_int16(w);
+			memcpy(data + i * sizeof(out), out, sizeof(out));
+		}
+	}
+
+	inline void DecodeExponential(std::uint8_t* data, std::size_t count)
+	{
+		for (std::size_t i = 0; i < count; i++)
+		{
+			std::uint32_t v;
+			memcpy(&v, data + i * sizeof(v), sizeof(v));
+
+			// Signed 24 bit mantissa and signed 8 bit exponent.
+			auto mantissa = static_cast<std::int32_t>(v << 8) >> 8;
+			auto exponent = static_cast<std::int32_t>(v) >> 24;
+			auto f = std::ldexp(static_cast<float>(mantissa), exponent);
+
+			memcpy(data + i * sizeof(f), &f, sizeof(f));
+		}
+	}
+
+} /* internal */
+
+bool MeshoptDecoder::ParseMode(std::string const & name, MeshoptMode & mode)
+{
+	if (name == "ATTRIBUTES") mode = MeshoptMode::ATTRIBUTES;
+	else if (name == "TRIANGLES") mode = MeshoptMode::TRIANGLES;
+	else if (name == "INDICES") mode = MeshoptMode::INDICES;
+	else return false;
+
+	return true;
+}
+
+bool MeshoptDecoder::ParseFilter(std::string const & name, MeshoptFilter & filter)
+{
+	if (name == "NONE") filter = MeshoptFilter::NONE;
+	else if (name == "OCTAHEDRAL") filter = MeshoptFilter::OCTAHEDRAL;
+	else if (name == "QUATERNION") filter = MeshoptFilter::QUATERNION;
+	else if (name == "EXPONENTIAL") filter = MeshoptFilter::EXPONENTIAL;
+	else return false;
+
+	return true;
+}
+
+bool MeshoptDecoder::Decode(std::uint8_t* destination, std::size_t count, std::size_t stride, std::uint8_t const * data, std::size_t size,
+	MeshoptMode mode, MeshoptFilter filter)
+{
+	switch (mode)
+	{
+	case MeshoptMode::ATTRIBUTES:
+		return DecodeVertexBuffer(destination, count, stride, data, size) && ApplyFilter(destination, count, stride, filter);
+	case MeshoptMode::TRIANGLES:
+		return filter == MeshoptFilter::NONE && DecodeIndexBuffer(destination, count, stride, data, size);
+	case MeshoptMode::INDICES:
+		return filter == MeshoptFilter::NONE && DecodeIndexSequence(destination, count, stride, data, size);
+	default:
+		return false;
+	}
+}
+
+bool MeshoptDecoder::DecodeVertexBuffer(std::uint8_t* destination, std::size_t count, std::size_t stride, std::uint8_t const * data, std::size_t size)
+{
+	if (stride == 0 || stride > internal::max_vertex_block_size || stride % 4 != 0 || size < 1 + stride)
+	{
+		return false;
+	}
+
+	auto data_end = data + size;
+	if ((*data++ & 0xF0) != internal::vertex_header || (data[-1] & 0x0F) != 0)
+	{
+		return false;
+	}
+
+	// The tail stores the vertex the deltas of the first vertex are relative to.
+	std::uint8_t last_vertex[internal::max_vertex_block_size];
+	memcpy(last_vertex, data_end - stride, stride);
+
+	const auto block_size = internal::GetVertexBlockSize(stride);
+	for (std::size_t offset = 0; offset < count; offset += block_size)
+	{
+		auto num_vertices = offset + block_size < count ? block_size : count - offset;
+		data = internal::DecodeVertexBlock(data, data_end, destination + offset * stride, num_vertices, stride, last_vertex);
+		if (!data)
+		{
+			return false;
+		}
+	}
+
+	auto tail_size = stride < internal::min_tail_size ? internal::min_tail_size : stride;
+	return static_cast<std::size_t>(data_end - data) == tail_size;
+}
+
+bool MeshoptDecoder::DecodeIndexBuffer(std::uint8_t* destination, std::size_t count, std::size_t stride, std::uint8_t const * data, std::size_t size)
+{
+	// A code byte per triangle and a table of 16 code bytes at the end.
+	if (count % 3 != 0 || (stride != 2 && stride != 4) || size < 1 + count / 3 + 16)
+	{
+		return false;
+	}
+
+	if ((data[0] & 0xF0) != internal::index_header || (data[0] & 0x0F) > 1)
+	{
+		return false;
+	}
+
+	// Version 1 uses codes 13 and 14 for the last free index -1 and +1.
+	const std::uint32_t max_fifo_code = (data[0] & 0x0F) >= 1 ? 13 : 15;
+
+	internal::IndexFifos fifos;
+	std::uint32_t next = 0;
+	std::uint32_t last = 0;
+
+	auto code = data + 1;
+	auto extra = code + count / 3;
+	// A triangle reads at most 16 bytes, which the code table at the end covers.
+	auto safe_end = data + size - 16;
+	auto code_table = safe_end;
+
+	for (std::size_t i = 0; i < count; i += 3)
+	{
+		if (extra > safe_end)
+		{
+			return false;
+		}
+
+		std::uint8_t code_triangle = *code++;
+		std::uint32_t a, b, c;
+
+		if (code_triangle < 0xF0)
+		{
+			// Edge `code >> 4` of the FIFO and a third vertex.
+			auto const & edge = fifos.m_edges[(fifos.m_edge_offset - 1 - (code_triangle >> 4)) & 15];
+			a = edge[0];
+			b = edge[1];
+
+			std::uint32_t fec = code_triangle & 15;
+			if (fec < max_fifo_code)
+			{
+				c = fec == 0 ? next++ : fifos.m_vertices[(fifos.m_vertex_offset - 1 - fec) & 15];
+				fifos.PushVertex(c, fec == 0);
+			}
+			else
+			{
+				last = c = fec != 15 ? last + (fec - (fec ^ 3)) : internal::DecodeIndex(extra, last);
+				fifos.PushVertex(c);
+			}
+
+			fifos.PushEdge(c, b);
+			fifos.PushEdge(a, c);
+		}
+		else
+		{
+			// Three vertices, each new, from the vertex FIFO or a free index. The codes of the vertices are in the table
+			// or in a byte that follows.
+			std::uint32_t feb, fec;
+			bool explicit_a = false;
+			if (code_triangle < 0xFE)
+			{
+				auto code_aux = code_table[code_triangle & 15];
+				feb = code_aux >> 4;
+				fec = code_aux & 15;
+			}
+			else
+			{
+				auto code_aux = *extra++;
+				explicit_a = code_triangle != 0xFE;
+				feb = code_aux >> 4;
+				fec = code_aux & 15;
+
+				// Restart
+				if (code_aux == 0)
+				{
+					next = 0;
+				}
+			}
+
+			a = explicit_a ? 0 : next++;
+			b = feb == 0 ? next++ : fifos.m_vertices[(fifos.m_vertex_offset - feb) & 15];
+			c = fec == 0 ? next++ : fifos.m_vertices[(fifos.m_vertex_offset - fec) & 15];
+
+			if (explicit_a) last = a = internal::DecodeIndex(extra, last);
+			if (feb == 15) last = b = internal::DecodeIndex(extra, last);
+			if (fec == 15) last = c = internal::DecodeIndex(extra, last);
+
+			fifos.PushVertex(a);
+			fifos.PushVertex(b, feb == 0 || feb == 15);
+			fifos.PushVertex(c, fec == 0 || fec == 15);
+			fifos.PushEdge(b, a);
+			fifos.PushEdge(c, b);
+			fifos.PushEdge(a, c);
+		}
+
+		internal::WriteIndex(destination, i + 0, stride, a);
+		internal::WriteIndex(destination, i + 1, stride, b);
+		internal::WriteIndex(destination, i + 2, stride, c);
+	}
+
+	return extra == safe_end;
+}
+
+bool MeshoptDecoder::DecodeIndexSequence(std::uint8_t* destination, std::size_t count, std::size_t stride, std::uint8_t const * data, std::size_t size)
+{
+	// A byte per index and a 4 byte tail.
+	if ((stride != 2 && stride != 4) || size < 1 + count + 4)
+	{
+		return false;
+	}
+
+	if ((data[0] & 0xF0) != internal::sequence_header || (data[0] & 0x0F) > 1)
+	{
+		return false;
+	}
+
+	auto extra = data + 1;
+	// An index reads at most 5 bytes, which the tail covers.
+	auto safe_end = data + size - 4;
+
+	// Every index is a delta to one of the last two indices.
+	std::uint32_t last[2] = { 0, 0 };
+	for (std::size_t i = 0; i < count; i++)
+	{
+		if (extra >= safe_end)
+		{
+			return false;
+		}
+
+		auto v = internal::DecodeVarint(extra);
+		auto& baseline = last[v & 1];
+		v >>= 1;
+		baseline += (v >> 1) ^ (0u - (v & 1));
+
+		internal::WriteIndex(destination, i, stride, baseline);
+	}
+
+	return extra == safe_end;
+}
+
+bool MeshoptDecoder::ApplyFilter(std::uint8_t* data, std::size_t count, std::size_t stride, MeshoptFilter filter)
+{
+	switch (filter)
+	{
+	case MeshoptFilter::NONE:
+		return true;
+	case MeshoptFilter::OCTAHEDRAL:
+		if (stride == 4) internal::DecodeOctahedral<std::int8_t>(data, count);
+		else if (stride == 8) internal::DecodeOctahedral<std::int16_t>(data, count);
+		else return false;
+		return true;
+	case MeshoptFilter::QUATERNION:
+		if (stride != 8) return false;
+		internal::DecodeQuaternion(data, count);
+		return true;
+	case MeshoptFilter::EXPONENTIAL:
+		if (stride % 4 != 0) return false;
+		internal::DecodeExponential(data, count * stride / 4);
+		return true;
+	default:
+		return false;
+	}
+}
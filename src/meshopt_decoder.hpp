@@ -0,0 +1,52 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Streams of the glTF EXT_meshopt_compression extension.
+//   ATTRIBUTES  vertex codec, byte deltas of every vertex byte in blocks of up to 256 vertices.
+//   TRIANGLES   index codec, triangles encoded against an edge and a vertex FIFO.
+//   INDICES     index sequence codec, zigzag varint deltas to one of two previous indices.
+enum class MeshoptMode
+{
+	ATTRIBUTES,
+	TRIANGLES,
+	INDICES,
+};
+
+// Filters applied to decoded attribute streams.
+//   OCTAHEDRAL   signed 8 or 16 bit octahedral encoded unit vectors, decoded to the same component size.
+//   QUATERNION   16 bit quaternions with the largest component dropped.
+//   EXPONENTIAL  32 bit floats with a shared 8 bit exponent and a 24 bit mantissa.
+enum class MeshoptFilter
+{
+	NONE,
+	OCTAHEDRAL,
+	QUATERNION,
+	EXPONENTIAL,
+};
+
+struct MeshoptDecoder
+{
+	// Parse the names used by the extension. False for unknown names.
+	static bool ParseMode(std::string const & name, MeshoptMode & mode);
+	static bool ParseFilter(std::string const & name, MeshoptFilter & filter);
+
+	// Decodes `count` elements of `stride` bytes from `size` bytes at `data` to `destination` and applies `filter`.
+	// Index streams have a stride of 2 or 4. False when the stream or the combination of parameters is invalid, in
+	// which case the contents of `destination` are undefined.
+	static bool Decode(std::uint8_t* destination, std::size_t count, std::size_t stride, std::uint8_t const * data, std::size_t size,
+		MeshoptMode mode, MeshoptFilter filter = MeshoptFilter::NONE);
+
+	static bool DecodeVertexBuffer(std::uint8_t* destination, std::size_t count, std::size_t stride, std::uint8_t const * data, std::size_t size);
+	static bool DecodeIndexBuffer(std::uint8_t* destination, std::size_t count, std::size_t stride, std::uint8_t const * data, std::size_t size);
+	static bool DecodeIndexSequence(std::uint8_t* destination, std::size_t count, std::size_t stride, std::uint8_t const * data, std::size_t size);
+	static bool ApplyFilter(std::uint8_t* data, std::size_t count, std::size_t stride, MeshoptFilter filter);
+};
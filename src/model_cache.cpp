@@ -0,0 +1,663 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "model_cache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include "util/hash.hpp"
+#include "util/log.hpp"
+
+namespace internal
+{
+
+	static constexpr std::uint64_t cooked_alignment = 16;
+
+	struct CookedDependencyInfo
+	{
+		std::string m_path;
+		std::uint64_t m_size;
+		std::int64_t m_write_time;
+	};
+
+	inline std::uint64_t AlignCooked(std::uint64_t value)
+	{
+		return (value + cooked_alignment - 1) & ~(cooked_alignment - 1);
+	}
+
+	inline std::string CanonicalPath(std::filesystem::path const & path)
+	{
+		std::error_code error;
+		auto canonical = std::filesystem::weakly_canonical(path, error);
+		return (error ? path : canonical).generic_string();
+	}
+
+	inline bool IsInDirectory(std::string const & path, std::string const & directory)
+	{
+		return !directory.empty() && path.size() > directory.size() && path.compare(0, directory.size(), directory) == 0 && path[directory.size()] == '/';
+	}
+
+	inline std::optional<CookedDependencyInfo> GetDependencyInfo(std::filesystem::path const & path)
+	{
+		std::error_code error;
+		auto size = std::filesystem::file_size(path, error);
+		if (error) return std::nullopt;
+		auto write_time = std::filesystem::last_write_time(path, error);
+		if (error) return std::nullopt;
+
+		return CookedDependencyInfo{ CanonicalPath(path), size, static_cast<std::int64_t>(write_time.time_since_epoch().count()) };
+	}
+
+	// Every file in the directory of the source model and its subdirectories, except the files in the cache directory.
+	// Only the source model itself when it isn't in a directory. Sorted by path.
+	inline std::vector<CookedDependencyInfo> GatherDependencies(std::string const & source_path, std::string const & cache_directory)
+	{
+		namespace fs = std::filesystem;
+
+		std::vector<CookedDependencyInfo> dependencies;
+		std::error_code error;
+
+		auto add_file = [&](fs::path const & path)
+		{
+			if (auto info = GetDependencyInfo(path))
+			{
+				dependencies.push_back(std::move(info.value()));
+			}
+		};
+
+		auto directory = fs::path(source_path).parent_path();
+		if (directory.empty())
+		{
+			add_file(source_path);
+			return dependencies;
+		}
+
+		auto cache = cache_directory.empty() ? std::string() : CanonicalPath(cache_directory);
+		for (fs::recursive_directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+		{
+			if (it->is_regular_file(error) && !IsInDirectory(CanonicalPath(it->path()), cache))
+			{
+				add_file(it->path());
+			}
+		}
+
+		std::sort(dependencies.begin(), dependencies.end(), [](auto const & a, auto const & b) { return a.m_path < b.m_path; });
+
+		return dependencies;
+	}
+
+	inline std::uint64_t HashFile(std::string const & path)
+	{
+		util::MappedFile file(path);
+		return file.GetData() ? util::Hash64(file.GetData(), file.GetSize()) : 0;
+	}
+
+	inline TextureData ToTextureData(CookedTexture const & cooked_texture)
+	{
+		TextureData texture;
+		texture.m_width = cooked_texture.m_width;
+		texture.m_height = cooked_texture.m_height;
+		texture.m_channels = cooked_texture.m_channels;
+		texture.m_pixel_channels = cooked_texture.m_pixel_channels;
+		texture.m_is_hdr = cooked_texture.m_is_hdr != 0;
+		texture.m_compression = cooked_texture.m_compression;
+		texture.m_num_mips = cooked_texture.m_num_mips;
+		return texture;
+	}
+
+	// The pixels of `texture` with tightly packed mip levels and their size. Points into the texture when the levels
+	// already are packed, otherwise they are copied into `storage`.
+	inline std::pair<void const *, std::size_t> GetPackedPixels(TextureData const & texture, std::vector<std::uint8_t> & storage)
+	{
+		if (texture.m_mip_offsets.empty())
+		{
+			return { texture.m_pixels, texture.GetSizeInBytes() };
+		}
+
+		storage.clear();
+		for (std::uint32_t level = 0; level < texture.m_num_mips; level++)
+		{
+			auto level_pixels = static_cast<std::uint8_t const *>(texture.m_pixels) + texture.GetMipOffset(level);
+			storage.insert(storage.end(), level_pixels, level_pixels + texture.GetMipSizeInBytes(level));
+		}
+		return { storage.data(), storage.size() };
+	}
+
+	inline TextureData const & GetTexture(MaterialData const & material, CookedTextureSlot slot)
+	{
+		switch (slot)
+		{
+		case CookedTextureSlot::ALBEDO: return material.m_albedo_texture;
+		case CookedTextureSlot::METALLIC: return material.m_metallic_texture;
+		case CookedTextureSlot::ROUGHNESS: return material.m_roughness_texture;
+		case CookedTextureSlot::AMBIENT_OCCLUSION: return material.m_ambient_occlusion_texture;
+		case CookedTextureSlot::NORMAL_MAP: return material.m_normal_map_texture;
+		case CookedTextureSlot::EMISSIVE: return material.m_emissive_texture;
+		case CookedTextureSlot::THICKNESS: return material.m_thickness_texture;
+		default: return material.m_displacement_texture;
+		}
+	}
+
+	inline TextureData& GetTexture(MaterialData& material, CookedTextureSlot slot)
+	{
+		return const_cast<TextureData&>(GetTexture(static_cast<MaterialData const &>(material), slot));
+	}
+
+} /* internal */
+
+CookedModel::CookedModel(std::unique_ptr<util::MappedFile> file)
+	: m_file(std::move(file)),
+	m_header(reinterpret_cast<CookedModelHeader const *>(m_file->GetData())),
+	m_dependencies(nullptr),
+	m_meshes(nullptr),
+	m_materials(nullptr),
+	m_textures(nullptr),
+	m_nodes(nullptr),
+	m_payload(nullptr)
+{
+
+}
+
+std::unique_ptr<CookedModel> CookedModel::Open(std::string const & cache_path, std::string const & source_path,
+	std::string const & cache_directory, std::uint64_t key, std::uint32_t vertex_stride, std::optional<std::uint64_t> texture_cache_key)
+{
+	auto file = std::make_unique<util::MappedFile>(cache_path);
+	if (!file->IsOpen() || file->GetSize() < sizeof(CookedModelHeader))
+	{
+		return nullptr;
+	}
+
+	std::unique_ptr<CookedModel> model(new CookedModel(std::move(file)));
+	if (!model->Validate())
+	{
+		LOGW("Ignoring corrupt cooked model {}", cache_path);
+		return nullptr;
+	}
+
+	auto const & header = model->GetHeader();
+	if (header.m_key != key || header.m_vertex_stride != vertex_stride)
+	{
+		return nullptr;
+	}
+
+	if (texture_cache_key && header.m_texture_cache_key != texture_cache_key.value())
+	{
+		return nullptr;
+	}
+
+	auto source = internal::CanonicalPath(source_path);
+	if (header.m_source_path.m_size != source.size() || memcmp(model->GetArray<char>(header.m_source_path), source.data(), source.size()) != 0)
+	{
+		return nullptr;
+	}
+
+	auto is_unchanged = [&model](CookedDependency const & cooked, internal::CookedDependencyInfo const & current)
+	{
+		if (cooked.m_path.m_size != current.m_path.size() || memcmp(model->GetArray<char>(cooked.m_path), current.m_path.data(), current.m_path.size()) != 0
+			|| cooked.m_size != current.m_size)
+		{
+			return false;
+		}
+
+		// Only hash files that were touched.
+		return cooked.m_write_time == current.m_write_time || cooked.m_hash == internal::HashFile(current.m_path);
+	};
+
+	auto dependencies = internal::GatherDependencies(source_path, cache_directory);
+	if (dependencies.size() != header.m_num_dependencies)
+	{
+		return nullptr;
+	}
+
+	for (std::size_t i = 0; i < dependencies.size(); i++)
+	{
+		if (!is_unchanged(model->m_dependencies[i], dependencies[i]))
+		{
+			return nullptr;
+		}
+	}
+
+	// Without its processed textures the referenced textures can't be loaded.
+	for (std::uint32_t i = 0; i < header.m_num_texture_dependencies; i++)
+	{
+		auto const & cooked = model->m_texture_dependencies[i];
+		auto current = internal::GetDependencyInfo(std::string(model->GetArray<char>(cooked.m_path), cooked.m_path.m_size));
+		if (!current || !is_unchanged(cooked, current.value()))
+		{
+			return nullptr;
+		}
+	}
+
+	return model;
+}
+
+bool CookedModel::IsValidRange(CookedRange const & range) const
+{
+	return range.m_offset % internal::cooked_alignment == 0 && range.m_offset <= m_header->m_payload_size && range.m_size <= m_header->m_payload_size - range.m_offset;
+}
+
+bool CookedModel::Validate()
+{
+	auto const & header = *m_header;
+	if (header.m_magic != CookedModelHeader::magic || header.m_version != CookedModelHeader::version)
+	{
+		return false;
+	}
+
+	auto data = m_file->GetData();
+	std::uint64_t offset = sizeof(CookedModelHeader);
+	m_dependencies = reinterpret_cast<CookedDependency const *>(data + offset);
+	offset += header.m_num_dependencies * sizeof(CookedDependency);
+	m_texture_dependencies = reinterpret_cast<CookedDependency const *>(data + offset);
+	offset += header.m_num_texture_dependencies * sizeof(CookedDependency);
+	m_meshes = reinterpret_cast<CookedMesh const *>(data + offset);
+	offset += header.m_num_meshes * sizeof(CookedMesh);
+	m_materials = reinterpret_cast<CookedMaterial const *>(data + offset);
+	offset += header.m_num_materials * sizeof(CookedMaterial);
+	m_textures = reinterpret_cast<CookedTexture const *>(data + offset);
+	offset += header.m_num_textures * sizeof(CookedTexture);
+	m_nodes = reinterpret_cast<CookedNode const *>(data + offset);
+	offset += header.m_num_nodes * sizeof(CookedNode);
+
+	if (offset > header.m_payload_offset || header.m_payload_offset % internal::cooked_alignment != 0
+		|| header.m_payload_offset > m_file->GetSize() || header.m_payload_size > m_file->GetSize() - header.m_payload_offset)
+	{
+		return false;
+	}
+	m_payload = data + header.m_payload_offset;
+
+	if (!IsValidRange(header.m_source_path))
+	{
+		return false;
+	}
+
+	for (std::uint32_t i = 0; i < header.m_num_dependencies; i++)
+	{
+		if (!IsValidRange(m_dependencies[i].m_path))
+		{
+			return false;
+		}
+	}
+
+	for (std::uint32_t i = 0; i < header.m_num_texture_dependencies; i++)
+	{
+		if (!IsValidRange(m_texture_dependencies[i].m_path))
+		{
+			return false;
+		}
+	}
+
+	for (std::uint32_t i = 0; i < header.m_num_meshes; i++)
+	{
+		auto const & mesh = m_meshes[i];
+		bool valid_stride = mesh.m_index_stride == 1 || mesh.m_index_stride == 2 || mesh.m_index_stride == 4;
+		if (!valid_stride || !IsValidRange(mesh.m_vertices) || !IsValidRange(mesh.m_indices) || !IsValidRange(mesh.m_lods)
+			|| !IsValidRange(mesh.m_meshlets) || !IsValidRange(mesh.m_bounds) || !IsValidRange(mesh.m_meshlet_stream) || !IsValidRange(mesh.m_meshlet_offsets)
+			|| mesh.m_vertices.m_size != static_cast<std::uint64_t>(mesh.m_num_vertices) * header.m_vertex_stride
+			|| mesh.m_indices.m_size % mesh.m_index_stride != 0 || mesh.m_lods.m_size == 0 || mesh.m_lods.m_size % sizeof(CookedLOD) != 0
+			|| mesh.m_meshlets.m_size % sizeof(MeshletDesc) != 0 || mesh.m_bounds.m_size % sizeof(MeshletBounds) != 0
+			|| mesh.m_meshlet_offsets.m_size != (GetCount<MeshletDesc>(mesh.m_meshlets) + 1) * sizeof(std::uint32_t)
+			|| mesh.m_num_index_indices % 3 != 0)
+		{
+			return false;
+		}
+
+		// The decoder writes every meshlet to the ranges its descriptor points at and reads its part of the stream.
+		auto meshlets = GetMeshlets(mesh);
+		for (std::size_t m = 0; m < meshlets.m_num_meshlets; m++)
+		{
+			auto const & desc = meshlets.m_meshlets[m];
+			if (meshlets.m_offsets[m] > meshlets.m_offsets[m + 1] || meshlets.m_offsets[m + 1] > mesh.m_meshlet_stream.m_size
+				|| static_cast<std::uint64_t>(desc.GetVertexBegin()) + desc.GetNumVertices() > mesh.m_num_vertex_indices
+				|| (static_cast<std::uint64_t>(desc.GetPrimBegin()) + desc.GetNumPrims()) * 3 > mesh.m_num_index_indices)
+			{
+				return false;
+			}
+		}
+	}
+
+	for (std::uint32_t i = 0; i < header.m_num_materials; i++)
+	{
+		for (auto texture : m_materials[i].m_textures)
+		{
+			if (texture < -1 || texture >= static_cast<std::int32_t>(header.m_num_textures))
+			{
+				return false;
+			}
+		}
+	}
+
+	for (std::uint32_t i = 0; i < header.m_num_textures; i++)
+	{
+		auto const & texture = m_textures[i];
+		bool valid_format = (texture.m_pixel_channels == 1 || texture.m_pixel_channels == 4) && texture.m_compression <= TextureCompression::BC3
+			&& texture.m_num_mips >= 1 && texture.m_num_mips <= 32;
+		if (!valid_format || !IsValidRange(texture.m_pixels))
+		{
+			return false;
+		}
+
+		if (texture.m_source_hash != 0)
+		{
+			if (texture.m_pixels.m_size != 0)
+			{
+				return false;
+			}
+			continue;
+		}
+
+		auto texture_data = internal::ToTextureData(texture);
+		texture_data.m_pixels = const_cast<std::uint8_t*>(GetArray<std::uint8_t>(texture.m_pixels));
+		if (texture.m_pixels.m_size != texture_data.GetSizeInBytes())
+		{
+			return false;
+		}
+	}
+
+	for (std::uint32_t i = 0; i < header.m_num_nodes; i++)
+	{
+		if (m_nodes[i].m_mesh_id >= header.m_num_meshes)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+CompressedMeshletView CookedModel::GetMeshlets(CookedMesh const & mesh) const
+{
+	CompressedMeshletView view;
+	view.m_meshlets = GetArray<MeshletDesc>(mesh.m_meshlets);
+	view.m_num_meshlets = GetCount<MeshletDesc>(mesh.m_meshlets);
+	view.m_data = GetArray<std::uint8_t>(mesh.m_meshlet_stream);
+	view.m_offsets = GetArray<std::uint32_t>(mesh.m_meshlet_offsets);
+	view.m_num_vertex_indices = mesh.m_num_vertex_indices;
+	view.m_num_index_indices = mesh.m_num_index_indices;
+	return view;
+}
+
+std::vector<MaterialData> CookedModel::GetMaterials() const
+{
+	std::vector<MaterialData> materials(m_header->m_num_materials);
+	for (std::size_t i = 0; i < materials.size(); i++)
+	{
+		auto const & cooked = m_materials[i];
+		auto& material = materials[i];
+
+		for (int slot = 0; slot < static_cast<int>(CookedTextureSlot::COUNT); slot++)
+		{
+			if (cooked.m_textures[slot] < 0)
+			{
+				continue;
+			}
+
+			auto const & cooked_texture = m_textures[cooked.m_textures[slot]];
+			auto& texture = internal::GetTexture(material, static_cast<CookedTextureSlot>(slot));
+			texture = internal::ToTextureData(cooked_texture);
+			if (cooked_texture.m_source_hash != 0)
+			{
+				texture.m_source_hash = cooked_texture.m_source_hash;
+				continue;
+			}
+			texture.m_pixels = const_cast<std::uint8_t*>(GetArray<std::uint8_t>(cooked_texture.m_pixels));
+		}
+
+		material.m_base_color = cooked.m_base_color;
+		material.m_base_metallic = cooked.m_base_metallic;
+		material.m_base_roughness = cooked.m_base_roughness;
+		material.m_base_reflectivity = cooked.m_base_reflectivity;
+		material.m_base_transparency = cooked.m_base_transparency;
+		material.m_base_emissive = cooked.m_base_emissive;
+		material.m_base_normal_strength = cooked.m_base_normal_strength;
+		material.m_base_anisotropy = cooked.m_base_anisotropy;
+		material.m_base_anisotropy_dir = cooked.m_base_anisotropy_dir;
+		material.m_base_clear_coat = cooked.m_base_clear_coat;
+		material.m_base_clear_coat_roughness = cooked.m_base_clear_coat_roughness;
+		material.m_base_uv_scale = cooked.m_base_uv_scale;
+		material.m_two_sided = cooked.m_two_sided != 0;
+	}
+
+	return materials;
+}
+
+CookedRange CookedModelWriter::Append(void const * data, std::size_t size)
+{
+	CookedRange range = { internal::AlignCooked(m_payload.size()), size };
+	m_payload.resize(range.m_offset + size);
+	if (size > 0)
+	{
+		memcpy(m_payload.data() + range.m_offset, data, size);
+	}
+	return range;
+}
+
+void CookedModelWriter::AddMesh(void const * vertices, std::uint32_t num_vertices, std::uint32_t vertex_stride,
+	std::vector<unsigned char> const & indices, std::uint32_t index_stride, std::vector<CookedLOD> const & lods,
+	MeshletData const & meshlet_data, MeshBoundingBox const & bbox, std::uint32_t material_id)
+{
+	m_vertex_stride = vertex_stride;
+
+	CookedMesh mesh;
+	mesh.m_vertices = Append(vertices, static_cast<std::size_t>(num_vertices) * vertex_stride);
+	mesh.m_indices = Append(indices.data(), indices.size());
+	mesh.m_lods = Append(lods.data(), lods.size() * sizeof(CookedLOD));
+	mesh.m_meshlets = Append(meshlet_data.m_meshlets.data(), meshlet_data.m_meshlets.size() * sizeof(MeshletDesc));
+	mesh.m_bounds = Append(meshlet_data.m_bounds.data(), meshlet_data.m_bounds.size() * sizeof(MeshletBounds));
+	auto compressed = MeshletCompression::Encode(meshlet_data);
+	mesh.m_meshlet_stream = Append(compressed.m_data.data(), compressed.m_data.size());
+	mesh.m_meshlet_offsets = Append(compressed.m_offsets.data(), compressed.m_offsets.size() * sizeof(std::uint32_t));
+	mesh.m_num_vertex_indices = compressed.m_num_vertex_indices;
+	mesh.m_num_index_indices = compressed.m_num_index_indices;
+	mesh.m_num_vertices = num_vertices;
+	mesh.m_index_stride = index_stride;
+	mesh.m_material_id = material_id;
+	mesh.m_bbox_min = bbox.m_min;
+	mesh.m_bbox_max = bbox.m_max;
+	mesh.m_average_normal = bbox.m_average_normal;
+
+	m_meshes.push_back(mesh);
+}
+
+void CookedModelWriter::AddMaterials(std::vector<MaterialData> const & materials, std::uint64_t texture_cache_key,
+	std::function<std::optional<ProcessedTextureFiles>(TextureData const &)> const & get_processed_files)
+{
+	m_texture_cache_key = texture_cache_key;
+
+	std::unordered_multimap<std::uint64_t, std::int32_t> textures_by_hash;
+	std::vector<std::uint8_t> packed_storage;
+
+	for (auto const & material : materials)
+	{
+		CookedMaterial cooked = {};
+
+		for (int slot = 0; slot < static_cast<int>(CookedTextureSlot::COUNT); slot++)
+		{
+			auto const & texture = internal::GetTexture(material, static_cast<CookedTextureSlot>(slot));
+			cooked.m_textures[slot] = -1;
+			if (!texture.m_pixels)
+			{
+				continue;
+			}
+
+			auto [pixels, size] = internal::GetPackedPixels(texture, packed_storage);
+			auto format = util::HashValue(glm::uvec4(texture.m_pixel_channels, texture.m_is_hdr, static_cast<std::uint32_t>(texture.m_compression), texture.m_num_mips),
+				util::HashValue(glm::uvec2(texture.m_width, texture.m_height)));
+			auto hash = util::Hash64(pixels, size, format);
+			auto reference = get_processed_files ? get_processed_files(texture) : std::nullopt;
+			auto source_hash = reference ? reference->m_source_hash : 0;
+
+			// References only have the hash of their pixels to compare.
+			auto range = textures_by_hash.equal_range(hash);
+			for (auto it = range.first; it != range.second; it++)
+			{
+				auto const & existing = m_textures[it->second];
+				if (existing.m_width == texture.m_width && existing.m_height == texture.m_height && existing.m_pixel_channels == texture.m_pixel_channels
+					&& existing.m_is_hdr == static_cast<std::uint32_t>(texture.m_is_hdr) && existing.m_compression == texture.m_compression
+					&& existing.m_num_mips == texture.m_num_mips && existing.m_source_hash == source_hash
+					&& (source_hash != 0 || (existing.m_pixels.m_size == size && memcmp(m_payload.data() + existing.m_pixels.m_offset, pixels, size) == 0)))
+				{
+					cooked.m_textures[slot] = it->second;
+					break;
+				}
+			}
+
+			if (cooked.m_textures[slot] < 0)
+			{
+				CookedTexture cooked_texture;
+				if (reference)
+				{
+					cooked_texture.m_source_hash = source_hash;
+					for (auto const & path : reference->m_paths)
+					{
+						if (std::find(m_texture_dependencies.begin(), m_texture_dependencies.end(), path) == m_texture_dependencies.end())
+						{
+							m_texture_dependencies.push_back(path);
+						}
+					}
+				}
+				else
+				{
+					cooked_texture.m_pixels = Append(pixels, size);
+				}
+				cooked_texture.m_width = texture.m_width;
+				cooked_texture.m_height = texture.m_height;
+				cooked_texture.m_channels = texture.m_channels;
+				cooked_texture.m_pixel_channels = texture.m_pixel_channels;
+				cooked_texture.m_is_hdr = texture.m_is_hdr;
+				cooked_texture.m_compression = texture.m_compression;
+				cooked_texture.m_num_mips = texture.m_num_mips;
+
+				cooked.m_textures[slot] = static_cast<std::int32_t>(m_textures.size());
+				textures_by_hash.insert({ hash, cooked.m_textures[slot] });
+				m_textures.push_back(cooked_texture);
+			}
+		}
+
+		cooked.m_base_color = material.m_base_color;
+		cooked.m_base_metallic = material.m_base_metallic;
+		cooked.m_base_roughness = material.m_base_roughness;
+		cooked.m_base_reflectivity = material.m_base_reflectivity;
+		cooked.m_base_transparency = material.m_base_transparency;
+		cooked.m_base_emissive = material.m_base_emissive;
+		cooked.m_base_normal_strength = material.m_base_normal_strength;
+		cooked.m_base_anisotropy = material.m_base_anisotropy;
+		cooked.m_base_anisotropy_dir = material.m_base_anisotropy_dir;
+		cooked.m_base_clear_coat = material.m_base_clear_coat;
+		cooked.m_base_clear_coat_roughness = material.m_base_clear_coat_roughness;
+		cooked.m_base_uv_scale = material.m_base_uv_scale;
+		cooked.m_two_sided = material.m_two_sided;
+
+		m_materials.push_back(cooked);
+	}
+}
+
+void CookedModelWriter::AddNodes(std::vector<MeshNodeData> const & nodes)
+{
+	for (auto const & node : nodes)
+	{
+		m_nodes.push_back({ node.m_mesh_id, node.m_material_id, node.m_transform });
+	}
+}
+
+bool CookedModelWriter::Write(std::string const & cache_path, std::string const & source_path, std::string const & cache_directory, std::uint64_t key)
+{
+	namespace fs = std::filesystem;
+
+	CookedModelHeader header;
+	header.m_key = key;
+	header.m_texture_cache_key = m_texture_cache_key;
+	header.m_vertex_stride = m_vertex_stride;
+	header.m_num_meshes = static_cast<std::uint32_t>(m_meshes.size());
+	header.m_num_materials = static_cast<std::uint32_t>(m_materials.size());
+	header.m_num_textures = static_cast<std::uint32_t>(m_textures.size());
+	header.m_num_nodes = static_cast<std::uint32_t>(m_nodes.size());
+
+	auto source = internal::CanonicalPath(source_path);
+	header.m_source_path = Append(source.data(), source.size());
+
+	std::vector<CookedDependency> dependencies;
+	for (auto const & dependency : internal::GatherDependencies(source_path, cache_directory))
+	{
+		dependencies.push_back({ Append(dependency.m_path.data(), dependency.m_path.size()), dependency.m_size, dependency.m_write_time, internal::HashFile(dependency.m_path) });
+	}
+	header.m_num_dependencies = static_cast<std::uint32_t>(dependencies.size());
+
+	std::vector<CookedDependency> texture_dependencies;
+	for (auto const & path : m_texture_dependencies)
+	{
+		auto dependency = internal::GetDependencyInfo(path);
+		if (!dependency)
+		{
+			LOGW("Failed to write cooked model {}: processed texture {} is missing", cache_path, path);
+			return false;
+		}
+		texture_dependencies.push_back({ Append(dependency->m_path.data(), dependency->m_path.size()), dependency->m_size, dependency->m_write_time,
+			internal::HashFile(dependency->m_path) });
+	}
+	header.m_num_texture_dependencies = static_cast<std::uint32_t>(texture_dependencies.size());
+
+	auto tables_size = sizeof(CookedModelHeader) + (dependencies.size() + texture_dependencies.size()) * sizeof(CookedDependency) + m_meshes.size() * sizeof(CookedMesh)
+		+ m_materials.size() * sizeof(CookedMaterial) + m_textures.size() * sizeof(CookedTexture) + m_nodes.size() * sizeof(CookedNode);
+	header.m_payload_offset = internal::AlignCooked(tables_size);
+	header.m_payload_size = m_payload.size();
+
+	std::error_code error;
+	fs::create_directories(fs::path(cache_path).parent_path(), error);
+
+	// Unique per thread, since a model can be cooked by concurrent loads.
+	auto temp_path = cache_path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			LOGW("Failed to create cooked model {}", cache_path);
+			return false;
+		}
+
+		const char padding[internal::cooked_alignment] = {};
+		file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+		file.write(reinterpret_cast<char const *>(dependencies.data()), dependencies.size() * sizeof(CookedDependency));
+		file.write(reinterpret_cast<char const *>(texture_dependencies.data()), texture_dependencies.size() * sizeof(CookedDependency));
+		file.write(reinterpret_cast<char const *>(m_meshes.data()), m_meshes.size() * sizeof(CookedMesh));
+		file.write(reinterpret_cast<char const *>(m_materials.data()), m_materials.size() * sizeof(CookedMaterial));
+		file.write(reinterpret_cast<char const *>(m_textures.data()), m_textures.size() * sizeof(CookedTexture));
+		file.write(reinterpret_cast<char const *>(m_nodes.data()), m_nodes.size() * sizeof(CookedNode));
+		file.write(padding, header.m_payload_offset - tables_size);
+		file.write(reinterpret_cast<char const *>(m_payload.data()), m_payload.size());
+
+		if (!file)
+		{
+			LOGW("Failed to write cooked model {}", cache_path);
+			file.close();
+			fs::remove(temp_path, error);
+			return false;
+		}
+	}
+
+	fs::rename(temp_path, cache_path, error);
+	if (error)
+	{
+		LOGW("Failed to write cooked model {}: {}", cache_path, error.message());
+		fs::remove(temp_path, error);
+		return false;
+	}
+
+	return true;
+}
+
+std::string ModelCache::GetCachePath(std::string const & source_path, std::string const & cache_directory, std::uint64_t key)
+{
+	auto source = internal::CanonicalPath(source_path);
+	auto name = fmt::format("{}_{:016x}.skmc", std::filesystem::path(source_path).stem().string(), util::Hash64(source, key));
+	return (std::filesystem::path(cache_directory) / name).generic_string();
+}
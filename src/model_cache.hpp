@@ -0,0 +1,251 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include <glm.hpp>
+
+#include "resource_structs.hpp"
+#include "meshlet_builder.hpp"
+#include "meshlet_compression.hpp"
+#include "util/mapped_file.hpp"
+
+// Cooked models contain the result of importing a model: final vertex streams, index buffers of all levels of detail,
+// meshlets, bounding boxes and materials with decoded textures. A cooked model is memory mapped and its arrays are
+// handed to the pools as is, so loading one doesn't parse anything. Only the meshlet vertex and primitive indices are
+// stored compressed and decoded at load. Textures that were processed into the texture processor cache aren't stored
+// again: the cooked model references them by the hash of their source pixels.
+//
+// Layout (little endian):
+//   CookedModelHeader
+//   CookedDependency[m_num_dependencies]
+//   CookedDependency[m_num_texture_dependencies]
+//   CookedMesh[m_num_meshes]
+//   CookedMaterial[m_num_materials]
+//   CookedTexture[m_num_textures]
+//   CookedNode[m_num_nodes]
+//   payload at `m_payload_offset`. `CookedRange`s are relative to the payload and 16 byte aligned.
+//
+// A cooked model is valid for a key (importer settings and vertex layout) and the exact set of files it was cooked
+// from: every file in the directory of the source model and its subdirectories (buffers, material libraries and
+// textures), and the processed textures it references. A file is unchanged when its size and write time match, or when
+// its size and contents hash match.
+
+struct CookedRange
+{
+	std::uint64_t m_offset = 0;
+	std::uint64_t m_size = 0; // In bytes.
+};
+
+struct CookedModelHeader
+{
+	static inline const std::uint32_t magic = 0x434D4B53; // "SKMC"
+	static inline const std::uint32_t version = 7;
+
+	std::uint32_t m_magic = magic;
+	std::uint32_t m_version = version;
+	std::uint64_t m_key = 0;
+	std::uint64_t m_texture_cache_key = 0; // `TexturePool::GetProcessorCacheKey` of the pool that wrote it.
+	std::uint32_t m_vertex_stride = 0;
+	std::uint32_t m_num_dependencies = 0;
+	std::uint32_t m_num_meshes = 0;
+	std::uint32_t m_num_materials = 0;
+	std::uint32_t m_num_textures = 0;
+	std::uint32_t m_num_nodes = 0;
+	std::uint32_t m_num_texture_dependencies = 0; // Processed textures referenced by `CookedTexture::m_source_hash`.
+	std::uint32_t m_padding = 0;
+	CookedRange m_source_path; // Canonical path of the source model.
+	std::uint64_t m_payload_offset = 0;
+	std::uint64_t m_payload_size = 0;
+};
+
+struct CookedDependency
+{
+	CookedRange m_path; // Canonical path.
+	std::uint64_t m_size = 0;
+	std::int64_t m_write_time = 0;
+	std::uint64_t m_hash = 0;
+};
+
+// Mirrors `ModelHandle::MeshHandle::LOD`.
+struct CookedLOD
+{
+	std::uint32_t m_first_index = 0;
+	std::uint32_t m_num_indices = 0;
+	std::uint32_t m_first_meshlet = 0;
+	std::uint32_t m_num_meshlets = 0;
+	float m_error = 0;
+};
+
+struct CookedMesh
+{
+	CookedRange m_vertices;
+	CookedRange m_indices; // All levels of detail.
+	CookedRange m_lods; // CookedLOD[]
+	CookedRange m_meshlets; // MeshletDesc[]
+	CookedRange m_bounds; // MeshletBounds[]
+	CookedRange m_meshlet_stream; // Vertex and primitive indices of the meshlets, see `CompressedMeshletData`.
+	CookedRange m_meshlet_offsets; // std::uint32_t[], start of every meshlet in the stream plus the end of the last.
+	std::uint32_t m_num_vertex_indices = 0; // Decoded sizes.
+	std::uint32_t m_num_index_indices = 0;
+	std::uint32_t m_num_vertices = 0;
+	std::uint32_t m_index_stride = 0;
+	std::uint32_t m_material_id = 0;
+	glm::vec3 m_bbox_min = glm::vec3(0);
+	glm::vec3 m_bbox_max = glm::vec3(0);
+	glm::vec3 m_average_normal = glm::vec3(0);
+};
+
+enum class CookedTextureSlot
+{
+	ALBEDO,
+	METALLIC,
+	ROUGHNESS,
+	AMBIENT_OCCLUSION,
+	NORMAL_MAP,
+	EMISSIVE,
+	THICKNESS,
+	DISPLACEMENT,
+	COUNT,
+};
+
+// `MaterialData` with its textures replaced by indices into the texture table. -1 when the material has no texture.
+struct CookedMaterial
+{
+	std::int32_t m_textures[static_cast<int>(CookedTextureSlot::COUNT)];
+
+	glm::vec3 m_base_color;
+	float m_base_metallic;
+	float m_base_roughness;
+	float m_base_reflectivity;
+	float m_base_transparency;
+	float m_base_emissive;
+	float m_base_normal_strength;
+	float m_base_anisotropy;
+	glm::vec2 m_base_anisotropy_dir;
+	float m_base_clear_coat;
+	float m_base_clear_coat_roughness;
+	glm::vec2 m_base_uv_scale;
+	std::uint32_t m_two_sided;
+	std::uint32_t m_padding; // Keeps the texture table 8 byte aligned.
+};
+
+// Textures are stored once per unique pixel contents.
+// Mirrors `TextureData`. The mip levels are tightly packed.
+struct CookedTexture
+{
+	CookedRange m_pixels; // Empty for references.
+	std::uint32_t m_width = 0;
+	std::uint32_t m_height = 0;
+	std::uint32_t m_channels = 0;
+	std::uint32_t m_pixel_channels = 4;
+	std::uint32_t m_is_hdr = 0;
+	TextureCompression m_compression = TextureCompression::NONE;
+	std::uint32_t m_num_mips = 1;
+	std::uint32_t m_padding = 0;
+	// Set when the texture references its processed versions instead of storing pixels, see `TextureData::m_source_hash`.
+	std::uint64_t m_source_hash = 0;
+};
+
+// Mirrors `MeshNodeData`.
+struct CookedNode
+{
+	std::uint32_t m_mesh_id = 0;
+	std::uint32_t m_material_id = 0;
+	glm::mat4 m_transform = glm::mat4(1);
+};
+
+// Read only view of a memory mapped cooked model.
+class CookedModel
+{
+public:
+	// Returns nullptr when there is no cooked model at `cache_path` or when it is stale or corrupt. Cooked models are
+	// only valid for texture pools with the `texture_cache_key` they were written with, since they reference processed
+	// textures when it isn't 0. std::nullopt accepts any for loads that don't load textures.
+	static std::unique_ptr<CookedModel> Open(std::string const & cache_path, std::string const & source_path,
+		std::string const & cache_directory, std::uint64_t key, std::uint32_t vertex_stride, std::optional<std::uint64_t> texture_cache_key = std::nullopt);
+
+	CookedModelHeader const & GetHeader() const { return *m_header; }
+	CookedMesh const & GetMesh(std::size_t i) const { return m_meshes[i]; }
+	CookedNode const & GetNode(std::size_t i) const { return m_nodes[i]; }
+	// Decode with `MeshletCompression::Decode`.
+	CompressedMeshletView GetMeshlets(CookedMesh const & mesh) const;
+
+	template<typename T>
+	T const * GetArray(CookedRange const & range) const
+	{
+		return reinterpret_cast<T const *>(m_payload + range.m_offset);
+	}
+
+	template<typename T>
+	std::size_t GetCount(CookedRange const & range) const
+	{
+		return static_cast<std::size_t>(range.m_size / sizeof(T));
+	}
+
+	// The pixels of the textures point into the mapping and stay valid for the lifetime of this object. Referenced
+	// textures have no pixels.
+	std::vector<MaterialData> GetMaterials() const;
+
+private:
+	explicit CookedModel(std::unique_ptr<util::MappedFile> file);
+
+	bool IsValidRange(CookedRange const & range) const;
+	// Resolves the tables. False when the header, tables or ranges are out of bounds.
+	bool Validate();
+
+	std::unique_ptr<util::MappedFile> m_file;
+	CookedModelHeader const * m_header;
+	CookedDependency const * m_dependencies;
+	CookedDependency const * m_texture_dependencies;
+	CookedMesh const * m_meshes;
+	CookedMaterial const * m_materials;
+	CookedTexture const * m_textures;
+	CookedNode const * m_nodes;
+	std::uint8_t const * m_payload;
+};
+
+// Collects the imported meshes and materials of a model and writes them as a cooked model.
+class CookedModelWriter
+{
+public:
+	void AddMesh(void const * vertices, std::uint32_t num_vertices, std::uint32_t vertex_stride,
+		std::vector<unsigned char> const & indices, std::uint32_t index_stride, std::vector<CookedLOD> const & lods,
+		MeshletData const & meshlet_data, MeshBoundingBox const & bbox, std::uint32_t material_id);
+	// Copies the parameters and texture pixels. Identical textures are stored once. Textures for which
+	// `get_processed_files` returns their processed versions in the cache identified by `texture_cache_key` are stored
+	// as references to them, without pixels.
+	void AddMaterials(std::vector<MaterialData> const & materials, std::uint64_t texture_cache_key = 0,
+		std::function<std::optional<ProcessedTextureFiles>(TextureData const &)> const & get_processed_files = {});
+	void AddNodes(std::vector<MeshNodeData> const & nodes);
+
+	// Writes to a temporary file that is renamed to `cache_path`, so readers never see partially written models.
+	bool Write(std::string const & cache_path, std::string const & source_path, std::string const & cache_directory, std::uint64_t key);
+
+private:
+	CookedRange Append(void const * data, std::size_t size);
+
+	std::uint32_t m_vertex_stride = 0;
+	std::uint64_t m_texture_cache_key = 0;
+	std::vector<CookedMesh> m_meshes;
+	std::vector<CookedMaterial> m_materials;
+	std::vector<CookedTexture> m_textures;
+	std::vector<CookedNode> m_nodes;
+	std::vector<std::string> m_texture_dependencies;
+	std::vector<std::uint8_t> m_payload;
+};
+
+struct ModelCache
+{
+	// Location of the cooked model of `source_path` in `cache_directory` for `key`.
+	static std::string GetCachePath(std::string const & source_path, std::string const & cache_directory, std::uint64_t key);
+};
@@ -0,0 +1,85 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "model_instancing.hpp"
+
+#include <mat3x3.hpp>
+#include <glm.hpp>
+
+namespace internal
+{
+
+	inline void TransformDirections(std::vector<glm::vec3> & directions, glm::mat3 const & transform)
+	{
+		for (auto& direction : directions)
+		{
+			auto transformed = transform * direction;
+			auto length = glm::length(transformed);
+			direction = length > 0.f ? transformed / length : transformed;
+		}
+	}
+
+} /* internal */
+
+void ModelInstancing::Transform(MeshData & mesh_data, glm::mat4 const & transform)
+{
+	for (auto& position : mesh_data.m_positions)
+	{
+		position = glm::vec3(transform * glm::vec4(position, 1));
+	}
+
+	// Normals use the inverse transpose so they stay perpendicular to the surface under non uniform scales.
+	auto linear = glm::mat3(transform);
+	internal::TransformDirections(mesh_data.m_normals, glm::transpose(glm::inverse(linear)));
+	internal::TransformDirections(mesh_data.m_tangents, linear);
+	internal::TransformDirections(mesh_data.m_bitangents, linear);
+}
+
+void ModelInstancing::Flatten(ModelData & model_data)
+{
+	if (model_data.m_nodes.empty())
+	{
+		return;
+	}
+
+	// The last node of a mesh takes the original instead of a copy.
+	std::vector<std::size_t> last_node(model_data.m_meshes.size(), model_data.m_nodes.size());
+	for (std::size_t i = 0; i < model_data.m_nodes.size(); i++)
+	{
+		last_node[model_data.m_nodes[i].m_mesh_id] = i;
+	}
+
+	std::vector<MeshData> meshes;
+	meshes.reserve(model_data.m_nodes.size());
+	for (std::size_t i = 0; i < model_data.m_nodes.size(); i++)
+	{
+		auto const & node = model_data.m_nodes[i];
+		auto& source = model_data.m_meshes[node.m_mesh_id];
+		auto& mesh = last_node[node.m_mesh_id] == i ? meshes.emplace_back(std::move(source)) : meshes.emplace_back(source);
+
+		Transform(mesh, node.m_transform);
+		mesh.m_material_id = node.m_material_id;
+	}
+
+	model_data.m_meshes = std::move(meshes);
+	model_data.m_nodes.clear();
+}
+
+void ModelInstancing::RemapNodes(std::vector<MeshNodeData> & nodes, std::vector<std::pair<std::uint32_t, std::uint32_t>> const & mesh_parts)
+{
+	std::vector<MeshNodeData> remapped;
+	remapped.reserve(nodes.size());
+	for (auto const & node : nodes)
+	{
+		auto const & parts = mesh_parts[node.m_mesh_id];
+		for (std::uint32_t part = 0; part < parts.second; part++)
+		{
+			remapped.push_back({ parts.first + part, node.m_material_id, node.m_transform });
+		}
+	}
+
+	nodes = std::move(remapped);
+}
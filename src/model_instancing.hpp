@@ -0,0 +1,28 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "resource_structs.hpp"
+
+// Converts between models that instance their meshes with nodes and models with a copy of every mesh per node.
+struct ModelInstancing
+{
+	// Transforms the vertices of `mesh_data` by `transform`. Normals, tangents and bitangents are renormalized.
+	static void Transform(MeshData & mesh_data, glm::mat4 const & transform);
+
+	// Replaces the meshes of `model_data` by a copy of the mesh of every node, transformed to model space and using
+	// the material of the node, and clears the nodes. Models without nodes are unchanged.
+	static void Flatten(ModelData & model_data);
+
+	// Points the nodes at the meshes that replaced the mesh they referenced. Mesh `i` was replaced by the
+	// `mesh_parts[i].second` meshes starting at `mesh_parts[i].first`, so a node can become multiple nodes.
+	static void RemapNodes(std::vector<MeshNodeData> & nodes, std::vector<std::pair<std::uint32_t, std::uint32_t>> const & mesh_parts);
+};
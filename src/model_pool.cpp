@@ -7,18 +7,205 @@
 #include "model_pool.hpp"
 
 ModelPool::ModelPool()
-	: m_next_id(0)
+	: m_next_id(0),
+	m_import_thread_pool(nullptr),
+	m_import_thread_pool_size(0),
+	m_async_thread_pool(nullptr)
 {
 
 }
 
+ModelPool::~ModelPool()
+{
+	// Finishes the loads in flight, which release their references to the import thread pools.
+	m_async_thread_pool.reset();
+	m_import_thread_pool.reset();
+}
+
 ModelData* ModelPool::GetRawData(ModelHandle handle)
 {
 	if (auto it = m_loaded_data.find(handle); it != m_loaded_data.end())
 	{
-		return it->second;
+		return it->second.get();
 	}
 
 	LOGE("Failed to find raw data from handle");
 	return nullptr;
-}
\ No newline at end of file
+}
+
+void ModelPool::SetImportSettings(ModelImportSettings const & settings)
+{
+	m_import_settings = settings;
+}
+
+ModelImportSettings const & ModelPool::GetImportSettings() const
+{
+	return m_import_settings;
+}
+
+std::shared_ptr<util::ThreadPool> ModelPool::GetImportThreadPool()
+{
+	auto num_threads = m_import_settings.m_num_threads;
+	if (num_threads == 0)
+	{
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	if (num_threads == 1)
+	{
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(m_thread_pool_mutex);
+
+	// Replace the pool when the requested number of threads changed. Loads in flight keep their reference to the old
+	// pool, which is destroyed when the last of them finishes.
+	if (m_import_thread_pool_size != num_threads)
+	{
+		m_import_thread_pool = std::make_shared<util::ThreadPool>(num_threads);
+		m_import_thread_pool_size = num_threads;
+	}
+
+	return m_import_thread_pool;
+}
+
+std::size_t ModelPool::GetLoaderRetainedBytes()
+{
+	std::size_t size = 0;
+	for (auto& loader : m_registered_loaders)
+	{
+		size += loader->GetRetainedBytes();
+	}
+
+	return size;
+}
+
+void ModelPool::SetLoaderCacheBudget(std::size_t num_bytes)
+{
+	for (auto& loader : m_registered_loaders)
+	{
+		loader->SetCacheBudget(num_bytes);
+	}
+}
+
+util::ThreadPool* ModelPool::GetAsyncThreadPool()
+{
+	std::lock_guard<std::mutex> lock(m_thread_pool_mutex);
+
+	if (!m_async_thread_pool)
+	{
+		m_async_thread_pool = std::make_unique<util::ThreadPool>(std::max(1u, std::thread::hardware_concurrency()));
+	}
+
+	return m_async_thread_pool.get();
+}
+
+std::pair<VertexCacheStats, VertexCacheStats> ModelPool::OptimizeMesh(MeshData & mesh, ModelImportSettings const & settings)
+{
+	std::pair<VertexCacheStats, VertexCacheStats> vertex_cache_stats = {};
+
+	if (settings.m_log_vertex_cache_stats)
+	{
+		vertex_cache_stats.first = MeshOptimizer::AnalyzeVertexCache(mesh);
+		vertex_cache_stats.second = vertex_cache_stats.first;
+	}
+
+	if (settings.m_optimize_meshes)
+	{
+		MeshOptimizer::Optimize(mesh);
+
+		if (settings.m_log_vertex_cache_stats)
+		{
+			vertex_cache_stats.second = MeshOptimizer::AnalyzeVertexCache(mesh);
+		}
+	}
+
+	return vertex_cache_stats;
+}
+
+void ModelPool::CompactIndices(MeshData & mesh, ModelImportSettings const & settings)
+{
+	// After the optimization, which can remove unreferenced vertices.
+	auto index_stride = settings.m_compact_indices ? IndexCompaction::GetIndexStride(mesh.m_positions.size())
+		: std::max<std::uint32_t>(static_cast<std::uint32_t>(mesh.m_indices_stride), sizeof(std::uint16_t));
+	IndexCompaction::SetIndexStride(mesh, index_stride);
+}
+
+std::shared_ptr<ModelData> ModelPool::LoadFromDisc(std::string const & path, util::ThreadPool* thread_pool)
+{
+	auto extension = path.substr(path.find_last_of('.') + 1);
+
+	for (auto& loader : m_registered_loaders)
+	{
+		if (loader->IsSupportedExtension(extension))
+		{
+			auto model_data = loader->Load(path, thread_pool);
+			if (!model_data)
+			{
+				LOGE("Failed to load model {}", path);
+			}
+
+			return model_data;
+		}
+	}
+
+	LOGE("Could not find a appropriate model loader.");
+
+	return nullptr;
+}
+
+void ModelPool::ApplyExtraMaterialData(std::vector<MaterialData> & materials, std::optional<ExtraMaterialData> const & extra)
+{
+	if (!extra.has_value())
+	{
+		return;
+	}
+
+	STBImageLoader image_loader;
+
+	const auto& thickness_paths = extra.value().m_thickness_texture_paths;
+	for (std::size_t i = 0; i < std::min(materials.size(), thickness_paths.size()); i++)
+	{
+		materials[i].m_thickness_texture = *image_loader.LoadFromDisc(thickness_paths[i], nullptr).get();
+	}
+
+	const auto& displacement_paths = extra.value().m_displacement_texture_paths;
+	for (std::size_t i = 0; i < std::min(materials.size(), displacement_paths.size()); i++)
+	{
+		materials[i].m_displacement_texture = *image_loader.LoadFromDisc(displacement_paths[i], nullptr).get();
+	}
+}
+
+std::vector<std::optional<MaterialHandle>> ModelPool::LoadMaterials(std::vector<MaterialData> const & materials, std::vector<std::uint32_t> const & material_ids,
+	MaterialPool* material_pool, TexturePool* texture_pool)
+{
+	std::unordered_map<std::uint32_t, MaterialHandle> loaded_materials;
+	std::vector<std::optional<MaterialHandle>> material_handles(material_ids.size(), std::nullopt);
+
+	if (!material_pool || !texture_pool)
+	{
+		return material_handles;
+	}
+
+	for (std::size_t i = 0; i < material_ids.size(); i++)
+	{
+		auto material_id = material_ids[i];
+		if (material_id >= materials.size())
+		{
+			continue;
+		}
+
+		// If we already loaded that material use that one
+		if (auto it = loaded_materials.find(material_id); it != loaded_materials.end())
+		{
+			material_handles[i] = it->second;
+		}
+		else // if we haven't loaded the material load it.
+		{
+			material_handles[i] = material_pool->Load(materials[material_id], texture_pool);
+			loaded_materials.insert({ material_id, material_handles[i].value() });
+		}
+	}
+
+	return material_handles;
+}
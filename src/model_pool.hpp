@@ -7,17 +7,35 @@
 #pragma once
 
 #include <algorithm>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <typeinfo>
 #include <unordered_map>
+#include <utility>
 
 #include "resource_loader.hpp"
 #include "resource_structs.hpp"
 #include "material_pool.hpp"
 #include "texture_pool.hpp"
 #include "meshlet_builder.hpp"
+#include "meshlet_compression.hpp"
+#include "index_compaction.hpp"
+#include "model_instancing.hpp"
+#include "model_cache.hpp"
+#include "mesh_optimizer.hpp"
+#include "mesh_simplifier.hpp"
+#include "vertex_compression.hpp"
 #include "stb_image_loader.hpp"
 #include <glm.hpp>
 
+#include "util/hash.hpp"
 #include "util/log.hpp"
+#include "util/progress.hpp"
+#include "util/thread_pool.hpp"
 
 struct ModelHandle
 {
@@ -29,6 +47,16 @@ struct ModelHandle
 
 	struct MeshHandle
 	{
+		// Range of a level of detail in the index buffer and meshlets of the mesh.
+		struct LOD
+		{
+			std::uint32_t m_first_index;
+			std::uint32_t m_num_indices;
+			std::uint32_t m_first_meshlet;
+			std::uint32_t m_num_meshlets;
+			float m_error; // Object space distance to the full resolution mesh. 0 for LOD 0.
+		};
+
 		std::uint32_t m_id;
 		MeshOffsets m_offsets;
 		std::uint32_t m_num_indices;
@@ -40,6 +68,8 @@ struct ModelHandle
 		glm::vec3 m_bbox_min;
 		glm::vec3 m_bbox_max;
 
+		std::vector<LOD> m_lods; // LOD 0 is the full resolution mesh and matches `m_num_indices`.
+
 		bool operator==(MeshHandle const & other) const
 		{
 			return m_id == other.m_id &&
@@ -49,7 +79,16 @@ struct ModelHandle
 		}
 	};
 
+	// Placement of a mesh in the node hierarchy of a model imported with `m_preserve_instancing`.
+	struct Node
+	{
+		std::uint32_t m_mesh; // Index into `m_mesh_handles`.
+		std::optional<MaterialHandle> m_material_handle;
+		glm::mat4 m_transform;
+	};
+
 	std::vector<MeshHandle> m_mesh_handles;
+	std::vector<Node> m_nodes; // Empty when every mesh is drawn once as is.
 
 	bool operator==(ModelHandle const & other) const
 	{
@@ -83,11 +122,38 @@ namespace gfx
 	class CommandList;
 }
 
+struct ModelImportSettings
+{
+	MeshletClusteringMode m_meshlet_clustering = MeshletClusteringMode::SEQUENTIAL;
+	bool m_log_meshlet_stats = false;
+	// Reorders triangles for the vertex cache and overdraw and vertices for fetch locality before building meshlets.
+	bool m_optimize_meshes = false;
+	bool m_log_vertex_cache_stats = false;
+	// Uses 16 bit indices for meshes with up to 65536 vertices and splits larger meshes when the smaller index buffer
+	// saves more memory than the vertices shared by the parts cost. 8 bit indices are always widened to 16 bit.
+	bool m_compact_indices = true;
+	// Imports meshes referenced by multiple nodes once and returns the nodes in `ModelHandle::m_nodes`, see
+	// `sg::helper::CreateModelNodes`. Otherwise every node gets its own copy of the mesh in model space.
+	bool m_preserve_instancing = false;
+	// Number of threads used to process the meshes of a model. Meshes are processed serially when 1, 0 uses all hardware threads.
+	std::uint32_t m_num_threads = 1;
+	// Number of simplified levels of detail generated in addition to the full resolution mesh.
+	std::uint32_t m_num_lods = 0;
+	// Target triangle count of a level relative to the previous level.
+	float m_lod_triangle_ratio = 0.5f;
+	// Maximum geometric error of a level relative to the diagonal of the mesh bounding box.
+	float m_lod_max_error = 0.05f;
+	SimplifySettings m_lod_simplify_settings;
+	// Models loaded from disc are cooked into this directory and loaded from it while the source files and the settings
+	// above are unchanged. Empty disables the cache. Not used when the raw model data is stored.
+	std::string m_cache_directory;
+};
+
 class ModelPool
 {
 public:
 	ModelPool();
-	virtual ~ModelPool() = default;
+	virtual ~ModelPool();
 
 	template<typename V_T>
 	ModelHandle Load(std::string const & path,
@@ -98,29 +164,133 @@ public:
 		TexturePool* texture_pool,
 		bool store_data = false,
 		std::optional<ExtraMaterialData> extra = std::nullopt);
+	// `data` isn't modified, the import works on a copy. So the same data can be loaded again.
 	template<typename V_T>
-	ModelHandle Load(ModelData* data);
+	ModelHandle Load(ModelData const * data);
 	template<typename V_T>
-	ModelHandle LoadWithMaterials(ModelData* data,
+	ModelHandle LoadWithMaterials(ModelData const * data,
 		MaterialPool* material_pool,
 		TexturePool* texture_pool,
 		std::optional<ExtraMaterialData> extra = std::nullopt);
+	// Parses and imports the model on worker threads. Only committing the meshes to the pool is serialised, so
+	// multiple models load concurrently. Materials are loaded in the commit step, so the material and texture pools
+	// must not be used until the future is ready. Don't stage the pools while loads are in flight.
+	// Increments `progress` `num_async_load_steps` times.
+	template<typename V_T>
+	std::future<ModelHandle> LoadAsync(std::string const & path,
+		std::optional<std::reference_wrapper<util::Progress>> progress = std::nullopt);
+	template<typename V_T>
+	std::future<ModelHandle> LoadWithMaterialsAsync(std::string const & path,
+		MaterialPool* material_pool,
+		TexturePool* texture_pool,
+		std::optional<ExtraMaterialData> extra = std::nullopt,
+		std::optional<std::reference_wrapper<util::Progress>> progress = std::nullopt);
 	ModelData* GetRawData(ModelHandle handle);
 
+	static inline const unsigned int num_async_load_steps = 2;
+
+	void SetImportSettings(ModelImportSettings const & settings);
+	ModelImportSettings const & GetImportSettings() const;
+
 	virtual void Stage(gfx::CommandList* command_list) = 0;
 	virtual void PostStage() = 0;
 
 	template<typename T>
 	static void RegisterLoader();
+	// Bytes of models kept alive by the caches of the registered loaders.
+	static std::size_t GetLoaderRetainedBytes();
+	// Per loader. 0 (the default) releases models as soon as they are imported.
+	static void SetLoaderCacheBudget(std::size_t num_bytes);
 
-	std::unordered_map<ModelHandle, ModelData*> m_loaded_data; // TODO: Make private
+	std::unordered_map<ModelHandle, std::shared_ptr<ModelData>> m_loaded_data; // TODO: Make private
 protected:
 	virtual ModelHandle::MeshOffsets AllocateMesh(void* vertex_data, std::uint32_t num_vertices, std::uint32_t vertex_stride,
 			void* index_data, std::uint32_t num_indices, std::uint32_t index_stride, void* meshlet_data, std::uint32_t num_meshlets) = 0;
 
 	virtual void AllocateMeshShadingBuffers(std::vector<std::uint32_t> vertex_indices, std::vector<std::uint8_t> flat_indices) = 0;
+	// Loads with other vertex layouts fail before anything is imported or allocated. Every layout by default.
+	virtual bool IsVertexStrideSupported(std::uint32_t) const { return true; }
+
+	// CPU side results of importing a mesh. Independent of the pool so meshes can be processed in parallel.
+	template<typename V_T>
+	struct ImportedMesh
+	{
+		std::vector<V_T> m_vertices;
+		MeshBoundingBox m_bbox;
+		MeshletData m_meshlet_data; // Meshlets of all levels of detail, LOD 0 first.
+		std::vector<unsigned char> m_indices; // Indices of all levels of detail, LOD 0 first. Same stride as the source mesh.
+		std::vector<ModelHandle::MeshHandle::LOD> m_lods;
+		VertexCacheStats m_vertex_cache_stats_before; // Only set when `m_log_vertex_cache_stats` is set.
+		VertexCacheStats m_vertex_cache_stats_after;
+	};
+
+	// Loads a model from disc or its cooked model. Parsing and importing share `thread_pool`. Safe to call from multiple
+	// threads.
+	template<typename V_T>
+	ModelHandle LoadFromPath(std::string const & path,
+		MaterialPool* material_pool,
+		TexturePool* texture_pool,
+		bool store_data,
+		std::optional<ExtraMaterialData> extra,
+		ModelImportSettings const & settings,
+		util::ThreadPool* thread_pool,
+		util::Progress* progress);
+	// Imports `data` and adds the results to `cooked_model_writer` when given. Meshes are processed on `thread_pool`
+	// when given.
+	template<typename V_T>
+	ModelHandle LoadModelData(ModelData data,
+		MaterialPool* material_pool,
+		TexturePool* texture_pool,
+		std::optional<ExtraMaterialData> extra,
+		CookedModelWriter* cooked_model_writer,
+		ModelImportSettings const & settings,
+		util::ThreadPool* thread_pool);
+	// Hands the arrays of a cooked model to the pools without processing them, except for the compressed meshlets which
+	// are decoded on `thread_pool` when given. The pools copy what they need, so the cooked model is unmapped afterwards.
+	template<typename V_T>
+	ModelHandle LoadCookedModel(std::unique_ptr<CookedModel> cooked_model,
+		MaterialPool* material_pool,
+		TexturePool* texture_pool,
+		std::optional<ExtraMaterialData> extra,
+		util::ThreadPool* thread_pool);
+	// Optimizes `mesh` when mesh optimization is enabled. Returns the vertex cache stats before and after, which are
+	// only calculated when `m_log_vertex_cache_stats` is set.
+	static std::pair<VertexCacheStats, VertexCacheStats> OptimizeMesh(MeshData & mesh, ModelImportSettings const & settings);
+	// Rewrites the indices of `mesh` with the stride it is imported with.
+	static void CompactIndices(MeshData & mesh, ModelImportSettings const & settings);
+	// Expects the indices of `mesh` to be compacted with `CompactIndices`.
+	template<typename V_T>
+	static ImportedMesh<V_T> ImportMesh(MeshData const & mesh, ModelImportSettings const & settings);
+	// Allocates the mesh in the pool. Called in mesh order so mesh ids are deterministic.
+	template<typename V_T>
+	ModelHandle::MeshHandle CommitMesh(MeshData const & mesh, ImportedMesh<V_T> & imported_mesh, std::optional<MaterialHandle> material_handle,
+		CookedModelWriter* cooked_model_writer, ModelImportSettings const & settings);
+	// Identifies the import settings and vertex layout a cooked model was created with.
+	template<typename V_T>
+	static std::uint64_t GetCookedModelKey(ModelImportSettings const & settings);
+	// Parses `path` with the first registered loader that supports its extension. Returns nullptr when it fails. Loaders
+	// that split the load into tasks run them on `thread_pool`, or serially when it is nullptr.
+	static std::shared_ptr<ModelData> LoadFromDisc(std::string const & path, util::ThreadPool* thread_pool);
+	static void ApplyExtraMaterialData(std::vector<MaterialData> & materials, std::optional<ExtraMaterialData> const & extra);
+	// Loads the material of every mesh once. `material_ids` are the material of every mesh.
+	static std::vector<std::optional<MaterialHandle>> LoadMaterials(std::vector<MaterialData> const & materials, std::vector<std::uint32_t> const & material_ids,
+		MaterialPool* material_pool, TexturePool* texture_pool);
+	// Returns nullptr when meshes should be processed serially. Loads keep the returned reference until they finish,
+	// since the pool is replaced when `m_num_threads` changes.
+	std::shared_ptr<util::ThreadPool> GetImportThreadPool();
+	// Created once and never replaced.
+	util::ThreadPool* GetAsyncThreadPool();
 
 	std::uint32_t m_next_id;
+	ModelImportSettings m_import_settings;
+	std::shared_ptr<util::ThreadPool> m_import_thread_pool;
+	std::uint32_t m_import_thread_pool_size;
+	std::unique_ptr<util::ThreadPool> m_async_thread_pool; // Runs one task per asynchronous load.
+	// Guards creating and replacing the thread pools.
+	std::mutex m_thread_pool_mutex;
+	// Serialises the commit step: loading materials and allocating meshes. Also guards everything the commit step
+	// writes to (`m_next_id` and `m_loaded_data`).
+	std::mutex m_commit_mutex;
 
 	inline static std::vector<ResourceLoader<ModelData>*> m_registered_loaders = {};
 };
@@ -148,65 +318,6 @@ inline glm::vec4 GetBoxCorner(glm::vec3 bboxMin, glm::vec3 bboxMax, int n)
 	}
 }
 
-// all oct functions derived from "A Survey of Efficient Representations for Independent Unit Vectors"
-// http://jcgt.org/published/0003/02/01/paper.pdf
-inline glm::vec3 OctSignNotZero(glm::vec3 v)
-{
-	// leaves z as is
-	return glm::vec3((v.x >= 0.0f) ? +1.0f : -1.0f, (v.y >= 0.0f) ? +1.0f : -1.0f, 1.0f);
-}
-
-inline glm::vec3 OctToFVec3(glm::vec3 e)
-{
-	auto v = glm::vec3(e.x, e.y, 1.0f - fabsf(e.x) - fabsf(e.y));
-	if (v.z < 0.0f)
-	{
-		v = glm::vec3(1.0f - fabs(v.y), 1.0f - fabs(v.x), v.z) * OctSignNotZero(v);
-	}
-	return glm::normalize(v);
-}
-
-inline glm::vec3 FVec3ToOct(glm::vec3 v)
-{
-	// Project the sphere onto the octahedron, and then onto the xy plane
-	glm::vec3 p = glm::vec3(v.x, v.y, 0) * (1.0f / (fabsf(v.x) + fabsf(v.y) + fabsf(v.z)));
-	// Reflect the folds of the lower hemisphere over the diagonals
-	return (v.z <= 0.0f) ? glm::vec3(1.0f - fabsf(p.y), 1.0f - fabsf(p.x), 0.0f) * OctSignNotZero(p) : p;
-}
-
-inline glm::vec3 FVec3ToOctnPrecise(glm::vec3 v, const int n)
-{
-	glm::vec3 s = FVec3ToOct(v);  // Remap to the square
-								  // Each snorm's max value interpreted as an integer,
-								  // e.g., 127.0 for snorm8
-	float M = float(1 << ((n / 2) - 1)) - 1.0;
-	// Remap components to snorm(n/2) precision...with floor instead
-	// of round (see equation 1)
-	s = glm::floor(glm::clamp(s, glm::vec3(-1.0f), glm::vec3(1.0f)) * M) * glm::vec3(1.0 / M);
-	glm::vec3 bestRepresentation = s;	
-	float highestCosine = glm::dot(OctToFVec3(s), v);
-	// Test all combinations of floor and ceil and keep the best.
-	// Note that at +/- 1, this will exit the square... but that
-	// will be a worse encoding and never win.
-	for (int i = 0; i <= 1; ++i)
-		for (int j = 0; j <= 1; ++j)
-			// This branch will be evaluated at compile time
-			if ((i != 0) || (j != 0))
-			{
-				// Offset the bit pattern (which is stored in floating
-				// point!) to effectively change the rounding mode
-				// (when i or j is 0: floor, when it is one: ceiling)
-				glm::vec3 candidate = glm::vec3(i, j, 0) * (1 / M) + s;
-				float cosine = glm::dot(OctToFVec3(candidate), v);
-				if (cosine > highestCosine)
-				{
-					bestRepresentation = candidate;
-					highestCosine = cosine;
-				}
-			}
-	return bestRepresentation;
-}
-
 template<typename T>
 void ModelPool::RegisterLoader()
 {
@@ -226,6 +337,10 @@ DEFINE_HAS_STRUCT(UV, m_uv)
 DEFINE_HAS_STRUCT(Normal, m_normal)
 DEFINE_HAS_STRUCT(Tangent, m_tangent)
 DEFINE_HAS_STRUCT(Bitangent, m_bitangent)
+DEFINE_HAS_STRUCT(QuantizedPos, m_quantized_pos)
+DEFINE_HAS_STRUCT(HalfUV, m_half_uv)
+DEFINE_HAS_STRUCT(OctNormal, m_oct_normal)
+DEFINE_HAS_STRUCT(OctTangent, m_oct_tangent)
 
 template<typename V_T>
 ModelHandle ModelPool::Load(std::string const & path,
@@ -241,286 +356,576 @@ ModelHandle ModelPool::LoadWithMaterials(std::string const & path,
 	bool store_data,
 	std::optional<ExtraMaterialData> extra)
 {
-	auto extension = path.substr(path.find_last_of('.') + 1);
+	return LoadFromPath<V_T>(path, material_pool, texture_pool, store_data, extra, m_import_settings, GetImportThreadPool().get(), nullptr);
+}
+
+template<typename V_T>
+std::future<ModelHandle> ModelPool::LoadAsync(std::string const & path,
+	std::optional<std::reference_wrapper<util::Progress>> progress)
+{
+	return LoadWithMaterialsAsync<V_T>(path, nullptr, nullptr, std::nullopt, progress);
+}
+
+template<typename V_T>
+std::future<ModelHandle> ModelPool::LoadWithMaterialsAsync(std::string const & path,
+	MaterialPool* material_pool,
+	TexturePool* texture_pool,
+	std::optional<ExtraMaterialData> extra,
+	std::optional<std::reference_wrapper<util::Progress>> progress)
+{
+	// The settings and import thread pool are captured here, so changing them doesn't affect loads in flight. The load
+	// owns a reference to the pool, so it stays alive when the pool is replaced.
+	auto thread_pool = GetImportThreadPool();
+	auto progress_ptr = progress ? &(*progress).get() : nullptr;
 
-	for (auto& loader : m_registered_loaders)
+	return GetAsyncThreadPool()->Enqueue([=, this, settings = m_import_settings]()
 	{
-		if (loader->IsSupportedExtension(extension))
-		{
-			auto model_data = loader->Load(path);
+		return LoadFromPath<V_T>(path, material_pool, texture_pool, false, extra, settings, thread_pool.get(), progress_ptr);
+	});
+}
 
-			auto handle = LoadWithMaterials<V_T>(model_data, material_pool, texture_pool, extra);
+template<typename V_T>
+ModelHandle ModelPool::LoadFromPath(std::string const & path,
+	MaterialPool* material_pool,
+	TexturePool* texture_pool,
+	bool store_data,
+	std::optional<ExtraMaterialData> extra,
+	ModelImportSettings const & settings,
+	util::ThreadPool* thread_pool,
+	util::Progress* progress)
+{
+	if (progress) PROGRESS((*progress), "Loading `" + path + "`")
 
-			if (store_data)
-			{
-				m_loaded_data.insert({ handle, model_data });
-			}
-			else
-			{
-				delete model_data;
-			}
+	if (!IsVertexStrideSupported(sizeof(V_T)))
+	{
+		LOGE("Can't load `{}`, the model pool doesn't support vertices of {} bytes", path, sizeof(V_T));
+		if (progress) PROGRESS((*progress), "Failed to load `" + path + "`")
+		return ModelHandle{};
+	}
 
+	const bool use_cache = !settings.m_cache_directory.empty() && !store_data;
+	const auto cache_key = GetCookedModelKey<V_T>(settings);
+	// Referenced textures only matter when the materials are loaded.
+	const auto texture_cache_key = material_pool && texture_pool ? std::optional(texture_pool->GetProcessorCacheKey()) : std::nullopt;
+	std::string cache_path;
+	if (use_cache)
+	{
+		cache_path = ModelCache::GetCachePath(path, settings.m_cache_directory, cache_key);
+		if (auto cooked_model = CookedModel::Open(cache_path, path, settings.m_cache_directory, cache_key, sizeof(V_T), texture_cache_key))
+		{
+			auto handle = LoadCookedModel<V_T>(std::move(cooked_model), material_pool, texture_pool, extra, thread_pool);
+			if (progress) PROGRESS((*progress), "Loaded `" + path + "`")
 			return handle;
 		}
 	}
 
-	LOGE("Could not find a appropriate model loader.");
+	auto model_data = LoadFromDisc(path, thread_pool);
+	if (!model_data)
+	{
+		if (progress) PROGRESS((*progress), "Failed to load `" + path + "`")
+		return ModelHandle{};
+	}
+
+	// Importing modifies the model. Models that are shared with the cache of the loader or stored are copied, others
+	// are moved into the import.
+	CookedModelWriter cooked_model_writer;
+	auto handle = LoadModelData<V_T>(model_data.use_count() > 1 || store_data ? *model_data : std::move(*model_data),
+		material_pool, texture_pool, extra, use_cache ? &cooked_model_writer : nullptr, settings, thread_pool);
+
+	if (use_cache)
+	{
+		cooked_model_writer.Write(cache_path, path, settings.m_cache_directory, cache_key);
+	}
+
+	// Otherwise the model is released here.
+	if (store_data)
+	{
+		std::lock_guard<std::mutex> lock(m_commit_mutex);
+		m_loaded_data.insert({ handle, model_data });
+	}
 
-	return ModelHandle{};
+	if (progress) PROGRESS((*progress), "Loaded `" + path + "`")
+
+	return handle;
 }
 
 template<typename V_T>
-ModelHandle ModelPool::Load(ModelData* data)
+ModelHandle ModelPool::Load(ModelData const * data)
 {
 	return LoadWithMaterials<V_T>(data, nullptr, nullptr);
 }
 
 template<typename V_T>
-ModelHandle ModelPool::LoadWithMaterials(ModelData* data,
+ModelHandle ModelPool::LoadWithMaterials(ModelData const * data,
 	MaterialPool* material_pool,
 	TexturePool* texture_pool,
 	std::optional<ExtraMaterialData> extra)
+{
+	if (!IsVertexStrideSupported(sizeof(V_T)))
+	{
+		LOGE("Can't load the model, the model pool doesn't support vertices of {} bytes", sizeof(V_T));
+		return ModelHandle{};
+	}
+
+	return LoadModelData<V_T>(*data, material_pool, texture_pool, extra, nullptr, m_import_settings, GetImportThreadPool().get());
+}
+
+template<typename V_T>
+ModelHandle ModelPool::LoadModelData(ModelData data,
+	MaterialPool* material_pool,
+	TexturePool* texture_pool,
+	std::optional<ExtraMaterialData> extra,
+	CookedModelWriter* cooked_model_writer,
+	ModelImportSettings const & settings,
+	util::ThreadPool* thread_pool)
 {
 	ModelHandle model_handle;
 
-	bool mat_and_texture_pool_available = material_pool && texture_pool;
+	// Extra material data isn't cooked, it is applied again when loading the cooked model. The textures share their
+	// pixels with the copy.
+	std::vector<MaterialData> cooked_materials;
+	if (cooked_model_writer)
+	{
+		cooked_materials = data.m_materials;
+	}
+
+	ApplyExtraMaterialData(data.m_materials, extra);
 
-	// Apply extra material data
-	if (extra.has_value())
+	if (!settings.m_preserve_instancing)
 	{
-		auto image_loader = new STBImageLoader(); // TODO: Memory leak
+		ModelInstancing::Flatten(data);
+	}
 
-		const auto& thickness_paths = extra.value().m_thickness_texture_paths;
-		for (std::size_t i = 0; i < std::min(data->m_materials.size(), thickness_paths.size()); i++)
+	// Meshes are optimized before large meshes are split, so the parts keep the optimized triangle order.
+	std::vector<std::pair<VertexCacheStats, VertexCacheStats>> vertex_cache_stats(data.m_meshes.size());
+	if (thread_pool && data.m_meshes.size() > 1)
+	{
+		std::vector<std::future<void>> futures;
+		futures.reserve(data.m_meshes.size());
+
+		for (std::size_t i = 0; i < data.m_meshes.size(); i++)
 		{
-			data->m_materials[i].m_thickness_texture = *image_loader->LoadFromDisc(thickness_paths[i]).get();
+			futures.emplace_back(thread_pool->Enqueue([&data, &vertex_cache_stats, &settings, i]()
+			{
+				vertex_cache_stats[i] = OptimizeMesh(data.m_meshes[i], settings);
+			}));
 		}
 
-		const auto& displacement_paths = extra.value().m_displacement_texture_paths;
-		for (std::size_t i = 0; i < std::min(data->m_materials.size(), displacement_paths.size()); i++)
+		for (auto & future : futures)
 		{
-			data->m_materials[i].m_displacement_texture = *image_loader->LoadFromDisc(displacement_paths[i]).get();
+			future.get();
 		}
 	}
-
-	std::unordered_map<std::uint32_t, MaterialHandle> loaded_materials;
-
-	for (auto const & mesh : data->m_meshes)
+	else
 	{
-		std::optional<MaterialHandle> material_handle = std::nullopt;
+		for (std::size_t i = 0; i < data.m_meshes.size(); i++)
+		{
+			vertex_cache_stats[i] = OptimizeMesh(data.m_meshes[i], settings);
+		}
+	}
 
-		if (mat_and_texture_pool_available)
+	// Large meshes are split before the import, so every part is imported like a separate mesh. The parts share the
+	// vertex cache stats of their mesh.
+	if (settings.m_compact_indices)
+	{
+		std::vector<MeshData> meshes;
+		std::vector<std::pair<VertexCacheStats, VertexCacheStats>> part_vertex_cache_stats;
+		std::vector<std::pair<std::uint32_t, std::uint32_t>> mesh_parts;
+		for (std::size_t i = 0; i < data.m_meshes.size(); i++)
 		{
-			// If we already loaded that material use that one
-			if (auto it = loaded_materials.find(mesh.m_material_id); it != loaded_materials.end())
+			auto& mesh = data.m_meshes[i];
+			auto parts = IndexCompaction::Split(mesh, sizeof(V_T));
+			mesh_parts.push_back({ static_cast<std::uint32_t>(meshes.size()), static_cast<std::uint32_t>(std::max<std::size_t>(parts.size(), 1)) });
+			part_vertex_cache_stats.insert(part_vertex_cache_stats.end(), std::max<std::size_t>(parts.size(), 1), vertex_cache_stats[i]);
+			if (parts.empty())
 			{
-				material_handle = it->second;
+				meshes.push_back(std::move(mesh));
 			}
-			else // if we haven't loaded the material load it.
+			else
 			{
-				material_handle = material_pool->Load(data->m_materials[mesh.m_material_id], texture_pool);
-				loaded_materials.insert({ mesh.m_material_id, material_handle.value() });
+				std::move(parts.begin(), parts.end(), std::back_inserter(meshes));
 			}
 		}
+		data.m_meshes = std::move(meshes);
+		vertex_cache_stats = std::move(part_vertex_cache_stats);
+		ModelInstancing::RemapNodes(data.m_nodes, mesh_parts);
+	}
 
-		auto num_vertices = mesh.m_positions.size();
-		auto num_indices = mesh.m_num_indices;
-		auto index_stide = mesh.m_indices_stride;
+	// The materials of the nodes follow the materials of the meshes.
+	std::vector<std::uint32_t> material_ids;
+	for (auto const & mesh : data.m_meshes)
+	{
+		material_ids.push_back(mesh.m_material_id);
+	}
+	for (auto const & node : data.m_nodes)
+	{
+		material_ids.push_back(node.m_material_id);
+	}
 
-		std::vector<V_T> vertices(num_vertices);
-		auto indices = mesh.m_indices;
+	// Materials are loaded up front since the material and texture pools aren't thread safe.
+	std::vector<std::optional<MaterialHandle>> material_handles;
+	{
+		std::lock_guard<std::mutex> lock(m_commit_mutex);
+		material_handles = LoadMaterials(data.m_materials, material_ids, material_pool, texture_pool);
+	}
 
-		for (std::size_t i = 0; i < num_vertices; i++)
+	// Textures that were just processed into the cache of the texture pool are cooked as references to it.
+	if (cooked_model_writer)
+	{
+		auto texture_cache_key = material_pool && texture_pool ? texture_pool->GetProcessorCacheKey() : 0;
+		if (texture_cache_key != 0)
 		{
-			using namespace internal;
-			if constexpr (HasPos<V_T>::value) { vertices[i].m_pos = mesh.m_positions[i]; }
-			if constexpr (HasUV<V_T>::value) { vertices[i].m_uv = {mesh.m_uvw[i].x, mesh.m_uvw[i].y }; }
-			if constexpr (HasNormal<V_T>::value) { vertices[i].m_normal = mesh.m_normals[i]; }
-			if constexpr (HasTangent<V_T>::value) { vertices[i].m_tangent = mesh.m_tangents[i]; }
-			if constexpr (HasBitangent<V_T>::value) { vertices[i].m_bitangent = mesh.m_bitangents[i]; }
+			cooked_model_writer->AddMaterials(cooked_materials, texture_cache_key,
+				[texture_pool](TextureData const & texture) { return texture_pool->GetProcessedFiles(texture); });
 		}
+		else
+		{
+			cooked_model_writer->AddMaterials(cooked_materials);
+		}
+	}
 
-		auto mesh_bbox = MeshletBuilder::CalculateBoundingBox<V_T>(mesh);
+	for (std::size_t i = 0; i < data.m_nodes.size(); i++)
+	{
+		auto const & node = data.m_nodes[i];
+		model_handle.m_nodes.push_back({ node.m_mesh_id, material_handles[data.m_meshes.size() + i], node.m_transform });
+	}
 
-		// Generate meshlets
-		std::vector<MeshletDesc> meshlet_data;
-		std::vector<std::uint32_t> vertex_indices; // used to index the vertex buffer from mesh shading (Uploaded to the GPU)
-		std::vector<std::uint8_t> index_indices; // used to index the vertex indices buffer  (Uploaded to the GPU)
+	if (cooked_model_writer)
+	{
+		cooked_model_writer->AddNodes(data.m_nodes);
+	}
 
-		int vertices_start = 0;
-		int prim_begin = 0;
+	if (thread_pool && data.m_meshes.size() > 1)
+	{
+		std::vector<std::future<ImportedMesh<V_T>>> futures;
+		futures.reserve(data.m_meshes.size());
 
-		for (auto indices_start = 0; indices_start < mesh.m_num_indices; indices_start += max_primitive_count_limit * 3)
+		for (auto & mesh : data.m_meshes)
 		{
-			MeshletDesc meshlet = {};
+			futures.emplace_back(thread_pool->Enqueue([&mesh, &settings]()
+			{
+				CompactIndices(mesh, settings);
+				return ImportMesh<V_T>(mesh, settings);
+			}));
+		}
 
-			glm::vec3 bbox_min = glm::vec3(std::numeric_limits<float>::max());
-			glm::vec3 bbox_max = glm::vec3(-std::numeric_limits<float>::max());
+		// Commit in mesh order while the remaining meshes are still being processed.
+		for (std::size_t i = 0; i < data.m_meshes.size(); i++)
+		{
+			auto imported_mesh = futures[i].get();
+			std::tie(imported_mesh.m_vertex_cache_stats_before, imported_mesh.m_vertex_cache_stats_after) = vertex_cache_stats[i];
 
-			auto num_indices_in_meshlet = std::min((int)mesh.m_num_indices - indices_start, max_primitive_count_limit * 3);
-			std::vector<std::uint32_t> meshlet_vertex_indices;
-			std::vector<std::uint32_t> meshlet_indices;
+			std::lock_guard<std::mutex> lock(m_commit_mutex);
+			model_handle.m_mesh_handles.emplace_back(CommitMesh<V_T>(data.m_meshes[i], imported_mesh, material_handles[i], cooked_model_writer, settings));
+		}
+	}
+	else
+	{
+		for (std::size_t i = 0; i < data.m_meshes.size(); i++)
+		{
+			CompactIndices(data.m_meshes[i], settings);
+			auto imported_mesh = ImportMesh<V_T>(data.m_meshes[i], settings);
+			std::tie(imported_mesh.m_vertex_cache_stats_before, imported_mesh.m_vertex_cache_stats_after) = vertex_cache_stats[i];
 
-			// obtain all indices required for this meshlet.
-			for (auto i = indices_start; i < indices_start + num_indices_in_meshlet; i += 3)
-			{
-				glm::ivec3 triangle;
-				memcpy(&triangle, &mesh.m_indices[i * mesh.m_indices_stride], mesh.m_indices_stride * 3);
-
-				// bounding box
-				{
-					bbox_min = glm::min(bbox_min, vertices[triangle[0]].m_pos);
-					bbox_min = glm::min(bbox_min, vertices[triangle[1]].m_pos);
-					bbox_min = glm::min(bbox_min, vertices[triangle[2]].m_pos);
-
-					bbox_max = glm::max(bbox_max, vertices[triangle[0]].m_pos);
-					bbox_max = glm::max(bbox_max, vertices[triangle[1]].m_pos);
-					bbox_max = glm::max(bbox_max, vertices[triangle[2]].m_pos);
-				}
-
-				for (auto k = 0; k < 3; k++)
-				{
-					meshlet_indices.push_back(triangle[k]);
-				}
-			}
+			std::lock_guard<std::mutex> lock(m_commit_mutex);
+			model_handle.m_mesh_handles.emplace_back(CommitMesh<V_T>(data.m_meshes[i], imported_mesh, material_handles[i], cooked_model_writer, settings));
+		}
+	}
 
-			// Create the vertex indices vector based on the flat indices vector.
-			std::vector<std::uint8_t> flat_meshlet_indices(meshlet_indices.size());
-			std::vector<std::pair<std::uint32_t, std::uint8_t>> flat_helper; // first = original, second = flat
+	return model_handle;
+}
 
-			for (auto i = 0; i < meshlet_indices.size(); i++)
-			{
-				auto index = meshlet_indices[i];
-
-				if (std::find(meshlet_vertex_indices.begin(), meshlet_vertex_indices.end(), index) == meshlet_vertex_indices.end())
-				{
-					meshlet_vertex_indices.push_back(index);
-					auto new_flat_idx = meshlet_vertex_indices.size() - 1;
-					flat_meshlet_indices[i] = new_flat_idx;
-					flat_helper.push_back({ index, new_flat_idx });
-				}
-				else
-				{
-					bool found_match = false;
-					for (auto const & pair : flat_helper)
-					{
-						if (pair.first == index)
-						{
-							flat_meshlet_indices[i] = pair.second;
-							found_match = true;
-							break;
-						}
-					}
-
-					if (!found_match)
-					{
-						LOGW("The flattening code appears to be broken");
-					}
-				}
-			}
+template<typename V_T>
+ModelHandle ModelPool::LoadCookedModel(std::unique_ptr<CookedModel> cooked_model,
+	MaterialPool* material_pool,
+	TexturePool* texture_pool,
+	std::optional<ExtraMaterialData> extra,
+	util::ThreadPool* thread_pool)
+{
+	ModelHandle model_handle;
+	auto const & header = cooked_model->GetHeader();
 
-			// alignment
-			auto alligned_vertices_start = SizeAlignTwoPower(vertices_start, vertex_packing_alignment);
-			auto alligned_prim_start = SizeAlignTwoPower(prim_begin, primitive_packing_alignment);
+	// Decoded before taking the commit lock, like meshes are imported before they are committed.
+	std::vector<MeshletData> meshlet_data(header.m_num_meshes);
+	if (thread_pool && header.m_num_meshes > 1)
+	{
+		std::vector<std::future<void>> futures;
+		futures.reserve(header.m_num_meshes);
 
-			// pad array to allignment
-			for (auto i = 0; i < alligned_vertices_start - vertices_start; i++)
-			{
-				vertex_indices.push_back(0);
-			}
-			for (auto i = 0; i < alligned_prim_start - prim_begin; i++)
+		for (std::uint32_t i = 0; i < header.m_num_meshes; i++)
+		{
+			futures.emplace_back(thread_pool->Enqueue([&cooked_model, &meshlet_data, i]()
 			{
-				flat_meshlet_indices.push_back(0);
-				flat_meshlet_indices.push_back(0);
-				flat_meshlet_indices.push_back(0);
-			}
+				MeshletCompression::Decode(cooked_model->GetMeshlets(cooked_model->GetMesh(i)), meshlet_data[i]);
+			}));
+		}
+
+		for (auto & future : futures)
+		{
+			future.get();
+		}
+	}
+	else
+	{
+		// A single mesh is decoded in batches of meshlets instead.
+		for (std::uint32_t i = 0; i < header.m_num_meshes; i++)
+		{
+			MeshletCompression::Decode(cooked_model->GetMeshlets(cooked_model->GetMesh(i)), meshlet_data[i], thread_pool);
+		}
+	}
+
+	auto materials = cooked_model->GetMaterials();
+	ApplyExtraMaterialData(materials, extra);
+
+	std::vector<std::uint32_t> material_ids;
+	for (std::uint32_t i = 0; i < header.m_num_meshes; i++)
+	{
+		material_ids.push_back(cooked_model->GetMesh(i).m_material_id);
+	}
+	for (std::uint32_t i = 0; i < header.m_num_nodes; i++)
+	{
+		material_ids.push_back(cooked_model->GetNode(i).m_material_id);
+	}
+
+	std::lock_guard<std::mutex> lock(m_commit_mutex);
+
+	auto material_handles = LoadMaterials(materials, material_ids, material_pool, texture_pool);
+
+	for (std::uint32_t i = 0; i < header.m_num_nodes; i++)
+	{
+		auto const & node = cooked_model->GetNode(i);
+		model_handle.m_nodes.push_back({ node.m_mesh_id, material_handles[header.m_num_meshes + i], node.m_transform });
+	}
+
+	for (std::uint32_t i = 0; i < header.m_num_meshes; i++)
+	{
+		auto const & mesh = cooked_model->GetMesh(i);
+
+		AllocateMeshShadingBuffers(std::move(meshlet_data[i].m_vertex_indices), std::move(meshlet_data[i].m_index_indices));
+
+		auto offsets = AllocateMesh(const_cast<std::uint8_t*>(cooked_model->GetArray<std::uint8_t>(mesh.m_vertices)), mesh.m_num_vertices, sizeof(V_T),
+			const_cast<std::uint8_t*>(cooked_model->GetArray<std::uint8_t>(mesh.m_indices)), static_cast<std::uint32_t>(mesh.m_indices.m_size / mesh.m_index_stride), mesh.m_index_stride,
+			const_cast<MeshletDesc*>(cooked_model->GetArray<MeshletDesc>(mesh.m_meshlets)), static_cast<std::uint32_t>(cooked_model->GetCount<MeshletDesc>(mesh.m_meshlets)));
+
+		auto cooked_lods = cooked_model->GetArray<CookedLOD>(mesh.m_lods);
+		std::vector<ModelHandle::MeshHandle::LOD> lods;
+		for (std::size_t lod = 0; lod < cooked_model->GetCount<CookedLOD>(mesh.m_lods); lod++)
+		{
+			auto const & cooked_lod = cooked_lods[lod];
+			lods.push_back({ cooked_lod.m_first_index, cooked_lod.m_num_indices, cooked_lod.m_first_meshlet, cooked_lod.m_num_meshlets, cooked_lod.m_error });
+		}
 
-			// Get new size with padding.
-			int num_unique_vertices = meshlet_vertex_indices.size();
-			int num_unique_indices = flat_meshlet_indices.size();
+		model_handle.m_mesh_handles.push_back({
+			.m_id = m_next_id,
+			.m_offsets = offsets,
+			.m_num_indices = lods[0].m_num_indices,
+			.m_num_vertices = mesh.m_num_vertices,
+			.m_vertex_stride = sizeof(V_T),
+			.m_index_stride = mesh.m_index_stride,
+			.m_material_handle = material_handles[i],
+			.m_bbox_min = mesh.m_bbox_min,
+			.m_bbox_max = mesh.m_bbox_max,
+			.m_lods = std::move(lods)
+		});
+		m_next_id++;
+	}
 
-			vertices_start = alligned_vertices_start;
-			prim_begin = alligned_prim_start;
+	return model_handle;
+}
 
-			meshlet.SetNumVertices(num_unique_vertices);
-			meshlet.SetVertexBegin(vertices_start);
-			meshlet.SetNumPrims((num_indices_in_meshlet / 3));
-			meshlet.SetPrimBegin(prim_begin);
+template<typename V_T>
+std::uint64_t ModelPool::GetCookedModelKey(ModelImportSettings const & settings)
+{
+	// Bump when the import of a model changes in a way the settings don't capture.
+	const std::uint32_t import_version = 4;
+
+	std::uint64_t key = util::Hash64(typeid(V_T).name(), import_version);
+	key = util::HashValue(static_cast<std::uint32_t>(sizeof(V_T)), key);
+	key = util::HashValue(settings.m_meshlet_clustering, key);
+	key = util::HashValue(settings.m_optimize_meshes, key);
+	key = util::HashValue(settings.m_compact_indices, key);
+	key = util::HashValue(settings.m_preserve_instancing, key);
+	key = util::HashValue(settings.m_num_lods, key);
+	key = util::HashValue(settings.m_lod_triangle_ratio, key);
+	key = util::HashValue(settings.m_lod_max_error, key);
+	key = util::HashValue(settings.m_lod_simplify_settings.m_normal_weight, key);
+	key = util::HashValue(settings.m_lod_simplify_settings.m_uv_weight, key);
+	key = util::HashValue(settings.m_lod_simplify_settings.m_lock_border, key);
+	return key;
+}
 
-			vertices_start += num_unique_vertices;
-			prim_begin += (num_unique_indices / 3);
+template<typename V_T>
+ModelPool::ImportedMesh<V_T> ModelPool::ImportMesh(MeshData const & mesh, ModelImportSettings const & settings)
+{
+	ImportedMesh<V_T> imported_mesh;
 
-			vertex_indices.insert(vertex_indices.end(), meshlet_vertex_indices.begin(), meshlet_vertex_indices.end());
-			index_indices.insert(index_indices.end(), flat_meshlet_indices.begin(), flat_meshlet_indices.end());
+	// Quantized positions are relative to the bounding box.
+	imported_mesh.m_bbox = MeshletBuilder::CalculateBoundingBox(mesh);
+	auto const & bbox = imported_mesh.m_bbox;
 
-			MeshletBuilder::TruncateBBoxToMeshBBox(bbox_min, bbox_max, mesh_bbox);
+	auto num_vertices = mesh.m_positions.size();
+	auto& vertices = imported_mesh.m_vertices;
+	vertices.resize(num_vertices);
 
-			// Snap to grid
-			const int grid_bits = 8;
-			const int grid_last = (1 << grid_bits) - 1;
-			uint8_t   grid_min[3];
-			uint8_t   grid_max[3];
+	for (std::size_t i = 0; i < num_vertices; i++)
+	{
+		using namespace internal;
+		if constexpr (HasPos<V_T>::value) { vertices[i].m_pos = mesh.m_positions[i]; }
+		if constexpr (HasUV<V_T>::value) { vertices[i].m_uv = {mesh.m_uvw[i].x, mesh.m_uvw[i].y }; }
+		if constexpr (HasNormal<V_T>::value) { vertices[i].m_normal = mesh.m_normals[i]; }
+		if constexpr (HasTangent<V_T>::value) { vertices[i].m_tangent = mesh.m_tangents[i]; }
+		if constexpr (HasBitangent<V_T>::value) { vertices[i].m_bitangent = mesh.m_bitangents[i]; }
+		if constexpr (HasQuantizedPos<V_T>::value) { QuantizePosition(mesh.m_positions[i], bbox.m_min, bbox.m_max, vertices[i].m_quantized_pos); }
+		if constexpr (HasHalfUV<V_T>::value) { EncodeHalf2({ mesh.m_uvw[i].x, mesh.m_uvw[i].y }, vertices[i].m_half_uv); }
+		if constexpr (HasOctNormal<V_T>::value) { EncodeOctUnitVector(mesh.m_normals[i], vertices[i].m_oct_normal); }
+		if constexpr (HasOctTangent<V_T>::value)
+		{
+			EncodeOctUnitVector(mesh.m_tangents[i], vertices[i].m_oct_tangent);
+
+			// The bitangent sign is stored in the w component of the position.
+			if constexpr (HasQuantizedPos<V_T>::value)
+			{
+				bool positive = BitangentSign(mesh.m_normals[i], mesh.m_tangents[i], mesh.m_bitangents[i]) > 0.f;
+				vertices[i].m_quantized_pos[3] = positive ? 65535 : 0;
+			}
+		}
+	}
 
-			grid_min[0] = std::max(0, std::min(int(truncf(bbox_min.x * float(grid_last))), grid_last - 1));
-			grid_min[1] = std::max(0, std::min(int(truncf(bbox_min.y * float(grid_last))), grid_last - 1));
-			grid_min[2] = std::max(0, std::min(int(truncf(bbox_min.z * float(grid_last))), grid_last - 1));
-			grid_max[0] = std::max(0, std::min(int(ceilf(bbox_max.x * float(grid_last))), grid_last));
-			grid_max[1] = std::max(0, std::min(int(ceilf(bbox_max.y * float(grid_last))), grid_last));
-			grid_max[2] = std::max(0, std::min(int(ceilf(bbox_max.z * float(grid_last))), grid_last));
+	// Generate meshlets
+	auto& meshlet_data = imported_mesh.m_meshlet_data;
+	MeshletBuilder::Build(mesh, imported_mesh.m_bbox, meshlet_data, settings.m_meshlet_clustering);
 
-			meshlet.SetBBox(grid_min, grid_max);
+	imported_mesh.m_indices = mesh.m_indices;
+	imported_mesh.m_lods.push_back({ 0, static_cast<std::uint32_t>(mesh.m_num_indices), 0, static_cast<std::uint32_t>(meshlet_data.m_meshlets.size()), 0.f });
 
-			glm::vec3 packed = FVec3ToOctnPrecise(mesh_bbox.m_average_normal, 16);
-			std::int8_t cone_x = std::min(127, std::max(-127, std::int32_t(packed.x * 127.0f)));
-			std::int8_t cone_y = std::min(127, std::max(-127, std::int32_t(packed.y * 127.0f)));
+	if (settings.m_num_lods > 0 && mesh.m_num_indices > 0)
+	{
+		std::vector<std::uint32_t> lod0_indices(mesh.m_num_indices);
+		for (std::size_t i = 0; i < lod0_indices.size(); i++)
+		{
+			lod0_indices[i] = mesh.GetIndex(i);
+		}
+
+		const auto max_error = settings.m_lod_max_error * glm::length(imported_mesh.m_bbox.m_max - imported_mesh.m_bbox.m_min);
+
+		// Only the positions and indices are used to build the meshlets of a level.
+		MeshData lod_mesh;
+		lod_mesh.m_positions = mesh.m_positions;
+		lod_mesh.m_indices_stride = mesh.m_indices_stride;
+
+		float target_ratio = 1.f;
+		for (std::uint32_t lod = 1; lod <= settings.m_num_lods; lod++)
+		{
+			// Every level is simplified from LOD 0 so errors don't accumulate.
+			target_ratio *= settings.m_lod_triangle_ratio;
+			auto target_index_count = static_cast<std::size_t>(mesh.m_num_indices * target_ratio) / 3 * 3;
 
-			// post quantization normal
-			mesh_bbox.m_average_normal = OctToFVec3(glm::vec3(float(cone_x) / 127.0f, float(cone_y) / 127.0f, 0.0f));
+			float error = 0;
+			auto lod_indices = MeshSimplifier::Simplify(mesh, lod0_indices, target_index_count, max_error, settings.m_lod_simplify_settings, &error);
 
-			float mindot = 1.0f;
-			for (auto const & n : mesh_bbox.m_tri_normals)
+			// Stop when the simplifier can't make meaningful progress within the error bound.
+			auto const & previous = imported_mesh.m_lods.back();
+			if (lod_indices.empty() || lod_indices.size() > previous.m_num_indices * 9 / 10)
 			{
-				mindot = std::min(mindot, glm::dot(n, mesh_bbox.m_average_normal));
+				break;
 			}
 
-			// apply safety delta due to quantization
-			mindot -= 1.0f / 127.0f;
-			mindot = std::max(-1.0f, mindot);
+			// `MeshletDesc` can't address more primitives.
+			if (meshlet_data.m_index_indices.size() / 3 + lod_indices.size() / 3 >= (1 << 20) - 1)
+			{
+				break;
+			}
 
-			// positive value for cluster not being backface cullable (normals > 90)
-			std::int8_t cone_angle = 127;
-			if (mindot > 0)
+			lod_mesh.m_num_indices = lod_indices.size();
+			lod_mesh.m_indices.resize(lod_indices.size() * lod_mesh.m_indices_stride);
+			for (std::size_t i = 0; i < lod_indices.size(); i++)
 			{
-				// otherwise store -sin(cone angle)
-				// we test against dot product (cosine) so this is equivalent to cos(cone angle + 90)
-				float angle = -sinf(acosf(mindot));
-				cone_angle = std::max(-127, std::min(127, int32_t(angle * 127.0f)));
+				lod_mesh.SetIndex(i, lod_indices[i]);
 			}
 
-			meshlet.SetCone(cone_x, cone_y, cone_angle);
+			if (settings.m_optimize_meshes)
+			{
+				MeshOptimizer::OptimizeVertexCache(lod_mesh);
+			}
 
-			meshlet_data.push_back(meshlet);
+			auto first_meshlet = meshlet_data.m_meshlets.size();
+			MeshletBuilder::Build(lod_mesh, imported_mesh.m_bbox, meshlet_data, settings.m_meshlet_clustering);
+
+			imported_mesh.m_lods.push_back({
+				static_cast<std::uint32_t>(imported_mesh.m_indices.size() / mesh.m_indices_stride),
+				static_cast<std::uint32_t>(lod_indices.size()),
+				static_cast<std::uint32_t>(first_meshlet),
+				static_cast<std::uint32_t>(meshlet_data.m_meshlets.size() - first_meshlet),
+				error
+			});
+			imported_mesh.m_indices.insert(imported_mesh.m_indices.end(), lod_mesh.m_indices.begin(), lod_mesh.m_indices.end());
 		}
+	}
 
-		AllocateMeshShadingBuffers(vertex_indices, index_indices);
+	return imported_mesh;
+}
 
-		auto offsets = AllocateMesh(vertices.data(), num_vertices, sizeof(V_T), indices.data(), num_indices, index_stide, meshlet_data.data(), meshlet_data.size());
+template<typename V_T>
+ModelHandle::MeshHandle ModelPool::CommitMesh(MeshData const & mesh, ImportedMesh<V_T> & imported_mesh, std::optional<MaterialHandle> material_handle,
+	CookedModelWriter* cooked_model_writer, ModelImportSettings const & settings)
+{
+	auto num_vertices = imported_mesh.m_vertices.size();
+	auto index_stide = mesh.m_indices_stride;
+	auto& indices = imported_mesh.m_indices; // All levels of detail
+	auto num_indices = indices.size() / index_stide;
+	auto& meshlet_data = imported_mesh.m_meshlet_data;
 
-		model_handle.m_mesh_handles.emplace_back(ModelHandle::MeshHandle{
-			.m_id = m_next_id,
-			.m_offsets = offsets,
-			.m_num_indices = static_cast<std::uint32_t>(num_indices),
-			.m_num_vertices = static_cast<std::uint32_t>(num_vertices),
-			.m_vertex_stride = sizeof(V_T),
-			.m_index_stride = index_stide,
-			.m_material_handle = material_handle,
-			.m_bbox_min = mesh_bbox.m_min,
-			.m_bbox_max = mesh_bbox.m_max
-		});
-		m_next_id++;
+	if (settings.m_log_vertex_cache_stats)
+	{
+		auto const & before = imported_mesh.m_vertex_cache_stats_before;
+		auto const & after = imported_mesh.m_vertex_cache_stats_after;
+		LOG("Mesh {}: ACMR {:.3f} -> {:.3f}, ATVR {:.3f} -> {:.3f}", m_next_id, before.m_acmr, after.m_acmr, before.m_atvr, after.m_atvr);
 	}
 
-	return model_handle;
+	if (settings.m_log_meshlet_stats)
+	{
+		auto stats = MeshletBuilder::CalculateStats(mesh, meshlet_data);
+		LOG("Mesh {}: {} meshlets, {:.2f} vertices/meshlet, {:.1f}% fill, {} average bbox volume",
+			m_next_id, stats.m_num_meshlets, stats.m_average_vertices, stats.m_average_fill * 100.f, stats.m_average_bbox_volume);
+
+		for (std::size_t lod = 1; lod < imported_mesh.m_lods.size(); lod++)
+		{
+			auto const & info = imported_mesh.m_lods[lod];
+			LOG("Mesh {}: LOD {}: {} triangles, {} meshlets, error {}", m_next_id, lod, info.m_num_indices / 3, info.m_num_meshlets, info.m_error);
+		}
+	}
+
+	if (cooked_model_writer)
+	{
+		std::vector<CookedLOD> lods;
+		for (auto const & lod : imported_mesh.m_lods)
+		{
+			lods.push_back({ lod.m_first_index, lod.m_num_indices, lod.m_first_meshlet, lod.m_num_meshlets, lod.m_error });
+		}
+
+		cooked_model_writer->AddMesh(imported_mesh.m_vertices.data(), static_cast<std::uint32_t>(num_vertices), sizeof(V_T), indices, static_cast<std::uint32_t>(index_stide),
+			lods, meshlet_data, imported_mesh.m_bbox, mesh.m_material_id);
+	}
+
+	AllocateMeshShadingBuffers(meshlet_data.m_vertex_indices, meshlet_data.m_index_indices);
+
+	auto offsets = AllocateMesh(imported_mesh.m_vertices.data(), num_vertices, sizeof(V_T), indices.data(), num_indices, index_stide, meshlet_data.m_meshlets.data(), meshlet_data.m_meshlets.size());
+
+	ModelHandle::MeshHandle mesh_handle = {
+		.m_id = m_next_id,
+		.m_offsets = offsets,
+		.m_num_indices = imported_mesh.m_lods[0].m_num_indices,
+		.m_num_vertices = static_cast<std::uint32_t>(num_vertices),
+		.m_vertex_stride = sizeof(V_T),
+		.m_index_stride = index_stide,
+		.m_material_handle = material_handle,
+		.m_bbox_min = imported_mesh.m_bbox.m_min,
+		.m_bbox_max = imported_mesh.m_bbox.m_max,
+		.m_lods = std::move(imported_mesh.m_lods)
+	};
+	m_next_id++;
+
+	return mesh_handle;
 }
 
 #undef DEFINE_HAS_STRUCT
\ No newline at end of file
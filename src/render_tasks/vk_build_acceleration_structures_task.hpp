@@ -31,6 +31,7 @@ namespace tasks
 	{
 		std::uint32_t m_vertex_offset;
 		std::uint32_t m_index_offset;
+		std::uint32_t m_index_stride;
 	};
 
 	struct RaytracingMaterial
@@ -124,6 +125,7 @@ namespace tasks
 					geom_desc.m_indices_offset = mesh_handle.m_offsets.m_ib;
 					geom_desc.m_vertices_offset = mesh_handle.m_offsets.m_vb;
 					geom_desc.m_vertex_stride = mesh_handle.m_vertex_stride;
+					geom_desc.m_index_stride = mesh_handle.m_index_stride;
 					geom_desc.m_num_indices = mesh_handle.m_num_indices;
 					geom_desc.m_num_vertices = mesh_handle.m_num_vertices;
 					geom_desc.m_ib = model_pool->m_big_index_buffer;
@@ -141,6 +143,7 @@ namespace tasks
 						RaytracingOffset offset;
 						offset.m_vertex_offset = geom_desc.m_vertices_offset;
 						offset.m_index_offset = geom_desc.m_indices_offset;
+						offset.m_index_stride = geom_desc.m_index_stride;
 						data.m_offsets[material_id] = offset;
 
 						auto raw = material_pool->GetRawData(batch.m_material_handles[i]);
@@ -96,7 +96,9 @@ namespace tasks
 
 					cmd_list->BindDescriptorHeap(data.m_root_sig, sets);
 
-					const std::uint32_t num_tasks = ComputeTasksCount(meshlets_info.second * batch.m_num_meshes);
+					// The meshlet buffer also contains the simplified levels of detail. Only LOD 0 is drawn.
+					const std::uint32_t num_meshlets = mesh_handle.m_lods.empty() ? meshlets_info.second : mesh_handle.m_lods[0].m_num_meshlets;
+					const std::uint32_t num_tasks = ComputeTasksCount(num_meshlets * batch.m_num_meshes);
 
 					struct PushBlock
 					{
@@ -108,7 +110,7 @@ namespace tasks
 					} push_data;
 
 					push_data.batch_size = batch.m_num_meshes;
-					push_data.num_meshlets = meshlets_info.second;
+					push_data.num_meshlets = num_meshlets;
 					push_data.bbox_min = glm::vec4(mesh_handle.m_bbox_min, 0);
 					push_data.bbox_max = glm::vec4(mesh_handle.m_bbox_max, 0);
 					push_data.viewport = glm::vec2(fg.GetRenderTarget(handle)->GetWidth(), fg.GetRenderTarget(handle)->GetHeight());
@@ -6,11 +6,19 @@
 
 #include "renderer.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <limits>
+
 #include "util/log.hpp"
+#include "settings.hpp"
 #include "application.hpp"
 #include "texture_pool.hpp"
 #include "stb_image_loader.hpp"
+#include "compressed_texture_loader.hpp"
 #include "tinygltf_model_loader.hpp"
+#include "gltf_model_loader.hpp"
 #include "assimp_model_loader.hpp"
 #include "vertex.hpp"
 #include "frame_graph/frame_graph.hpp"
@@ -29,13 +37,17 @@
 #include "graphics/gpu_buffers.hpp"
 #include "graphics/fence.hpp"
 #include "graphics/descriptor_heap.hpp"
+#include "scene_graph/scene_graph.hpp"
 #include "engine_registry.hpp"
 
 Renderer::Renderer() : m_application(nullptr), m_context(nullptr), m_direct_queue(nullptr), m_render_window(nullptr), m_direct_cmd_list(nullptr)
 {
 	TexturePool::RegisterLoader<STBImageLoader>();
 	TexturePool::RegisterLoader<STBHDRImageLoader>();
+	TexturePool::RegisterLoader<KTX2Loader>();
+	TexturePool::RegisterLoader<DDSLoader>();
 	ModelPool::RegisterLoader<TinyGLTFModelLoader>();
+	ModelPool::RegisterLoader<GLTFModelLoader>();
 	ModelPool::RegisterLoader<AssimpModelLoader>();
 }
 
@@ -90,6 +102,27 @@ void Renderer::Init(Application* app)
 	m_texture_pool = new gfx::VkTexturePool(m_context);
 	m_material_pool = new gfx::VkMaterialPool(m_context);
 
+	ModelImportSettings import_settings = m_model_pool->GetImportSettings();
+	import_settings.m_cache_directory = settings::cooked_model_directory;
+	m_model_pool->SetImportSettings(import_settings);
+
+	std::error_code error;
+	bool has_cooked_textures = std::filesystem::is_directory(settings::cooked_texture_directory, error);
+	if (settings::process_textures || has_cooked_textures)
+	{
+		TextureProcessorSettings texture_processor_settings;
+		texture_processor_settings.m_cache_directory = settings::cooked_texture_directory;
+		texture_processor_settings.m_cache_only = !settings::process_textures;
+		m_texture_pool->SetProcessorSettings(texture_processor_settings);
+	}
+
+	if (settings::texture_streaming)
+	{
+		TextureResidencySettings residency_settings;
+		residency_settings.m_budget = settings::texture_streaming_budget;
+		m_texture_pool->EnableStreaming(residency_settings);
+	}
+
 	LOG("Finished Initializing Renderer");
 }
 
@@ -110,6 +143,23 @@ void Renderer::Upload()
 	m_model_pool->PostStage();
 	m_texture_pool->PostStage();
 
+	auto texture_stats = m_texture_pool->GetStats();
+	LOG("Texture pool: {} unique textures ({:.1f} MB), {} reused ({:.1f} MB saved)", texture_stats.m_num_misses,
+		texture_stats.m_uploaded_bytes / (1024.f * 1024.f), texture_stats.m_num_hits, texture_stats.m_saved_bytes / (1024.f * 1024.f));
+
+	if (auto processor_stats = m_texture_pool->GetProcessorStats())
+	{
+		LOG("Texture processor: {} processed ({:.1f} MP/s), {} from cache, {:.1f} MB compressed to {:.1f} MB", processor_stats->m_num_processed,
+			processor_stats->GetMegapixelsPerSecond(), processor_stats->m_num_cache_hits, processor_stats->m_input_bytes / (1024.f * 1024.f),
+			processor_stats->m_output_bytes / (1024.f * 1024.f));
+	}
+
+	if (auto streaming_stats = m_texture_pool->GetStreamingStats())
+	{
+		LOG("Texture streaming: {} textures, {:.1f} MB of {:.1f} MB resident", streaming_stats->m_num_textures,
+			streaming_stats->m_resident_bytes / (1024.f * 1024.f), streaming_stats->m_full_bytes / (1024.f * 1024.f));
+	}
+
 	LOG("Finished Uploading Resources");
 }
 
@@ -117,14 +167,82 @@ void Renderer::Render(sg::SceneGraph& sg, fg::FrameGraph& fg)
 {
 	auto frame_idx = m_render_window->GetFrameIdx();
 
+	// The copies of streamed textures are submitted with the frame, ahead of the frame graph.
+	std::vector<gfx::CommandList*> cmd_lists;
+	if (m_texture_pool->IsStreaming() && UpdateTextureStreaming(sg, frame_idx))
+	{
+		cmd_lists.push_back(m_direct_cmd_list);
+	}
+
 	fg.Execute(sg);
 
 	auto fg_cmd_lists = fg.GetAllCommandLists<gfx::CommandList>();
-	m_direct_queue->Execute(fg_cmd_lists, m_present_fences[frame_idx], frame_idx);
+	cmd_lists.insert(cmd_lists.end(), fg_cmd_lists.begin(), fg_cmd_lists.end());
+	m_direct_queue->Execute(cmd_lists, m_present_fences[frame_idx], frame_idx);
 
 	m_render_window->Present(m_direct_queue, m_present_fences[frame_idx]);
 }
 
+void Renderer::RequestTextureMips(sg::SceneGraph& sg)
+{
+	auto camera = sg.GetActiveCamera();
+	auto camera_pos = sg.m_positions[camera.m_transform_component].m_value;
+	auto aspect_ratio = sg.m_camera_aspect_ratios[camera.m_camera_component].m_value;
+	auto lens_properties = sg.m_camera_lens_properties[camera.m_camera_component].m_value;
+
+	// Same field of view as the camera constant buffer.
+	float fov = lens_properties.m_fov;
+	if (!lens_properties.m_use_simple_fov)
+	{
+		fov = 2.0f * std::atan2(lens_properties.m_film_size / aspect_ratio, 2.0f * lens_properties.m_focal_length);
+	}
+	float pixels_per_unit = m_application->GetHeight() / (2.0f * std::tan(0.5f * glm::radians(fov))); // At a distance of 1.
+
+	for (auto node_handle : sg.GetMeshNodeHandles())
+	{
+		auto node = sg.GetNode(node_handle);
+		auto const & model_handle = sg.m_model_handles[node.m_mesh_component].m_value;
+		auto const & materials = sg.m_model_material_handles[node.m_mesh_component].m_value;
+		auto const & model = sg.m_models[node.m_transform_component].m_value;
+		float scale = std::max({ glm::length(glm::vec3(model[0])), glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2])) });
+
+		for (std::size_t i = 0; i < model_handle.m_mesh_handles.size() && i < materials.size(); i++)
+		{
+			auto const & mesh_handle = model_handle.m_mesh_handles[i];
+			auto center = glm::vec3(model * glm::vec4((mesh_handle.m_bbox_min + mesh_handle.m_bbox_max) * 0.5f, 1.f));
+			auto radius = glm::length(mesh_handle.m_bbox_max - mesh_handle.m_bbox_min) * 0.5f * scale;
+			auto distance = glm::length(center - camera_pos);
+
+			auto screen_size = distance > radius ? 2.f * radius * pixels_per_unit / distance : std::numeric_limits<float>::max();
+			for (auto texture_id : { materials[i].m_albedo_texture_handle, materials[i].m_normal_texture_handle, materials[i].m_roughness_texture_handle,
+				materials[i].m_thickness_texture_handle, materials[i].m_displacement_texture_handle, materials[i].m_emissive_texture_handle })
+			{
+				m_texture_pool->RequestScreenSize(texture_id, screen_size);
+			}
+		}
+	}
+}
+
+bool Renderer::UpdateTextureStreaming(sg::SceneGraph& sg, std::uint32_t frame_idx)
+{
+	RequestTextureMips(sg);
+
+	// `AquireNewFrame` waited for the previous frame with this index, so its resources and descriptor sets are free.
+	bool has_copies = m_texture_pool->UpdateStreaming(frame_idx);
+	if (has_copies)
+	{
+		m_direct_cmd_list->Begin(frame_idx);
+		m_texture_pool->StageStreaming(m_direct_cmd_list, frame_idx);
+		m_direct_cmd_list->Close();
+
+		m_material_pool->QueueTextureUpdates(m_texture_pool->GetReplacedTextures());
+	}
+
+	m_material_pool->UpdateTextures(frame_idx, m_texture_pool);
+
+	return has_copies;
+}
+
 void Renderer::AquireNewFrame()
 {
 	auto frame_idx = m_render_window->GetFrameIdx();
@@ -105,6 +105,12 @@ public:
 	gfx::DescriptorHeap* GetDescHeap() { return m_desc_heap; };
 
 private:
+	// Requests the mip levels of the textures of every mesh by the screen space size of its bounding box.
+	void RequestTextureMips(sg::SceneGraph& sg);
+	// Records the copies of the streamed textures that finished loading into `m_direct_cmd_list` and updates the
+	// material descriptor sets of `frame_idx`. Returns true when copies were recorded.
+	bool UpdateTextureStreaming(sg::SceneGraph& sg, std::uint32_t frame_idx);
+
 	Application* m_application;
 	gfx::Context* m_context;
 	gfx::CommandQueue* m_direct_queue;
@@ -10,7 +10,20 @@
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <list>
+#include <mutex>
+#include <unordered_map>
 
+namespace util
+{
+	class ThreadPool;
+}
+
+// Loads resources of type `T` from disc. `T` requires a `std::size_t GetSizeInBytes() const` member.
+//
+// Loaded resources are owned by the caller. A loader only keeps resources alive in its cache, which is bounded by
+// a byte budget and evicts the least recently used resources first. The budget is 0 by default, so memory is
+// reclaimed as soon as the caller releases a resource, for example after it was uploaded to the GPU.
 template<typename T>
 class ResourceLoader
 {
@@ -20,28 +33,72 @@ protected:
 public:
 
 	explicit ResourceLoader(std::vector<std::string> const & supported_formats)
-			: m_supported_formats(supported_formats)
+			: m_supported_formats(supported_formats), m_cache_budget(0), m_retained_bytes(0)
 	{
 
 	}
 
-	virtual ~ResourceLoader()
+	virtual ~ResourceLoader() = default;
+
+	// Returns the cached resource when `path` was loaded before and is still cached. Returns nullptr when loading
+	// failed. Safe to call from multiple threads. Loaders that split a load into tasks run them on `thread_pool`, or on
+	// the calling thread when it is nullptr.
+	std::shared_ptr<T> Load(std::string const & path, util::ThreadPool* thread_pool = nullptr)
 	{
-		for (auto& data : m_loaded_resources)
 		{
-			data.reset();
+			std::lock_guard<std::mutex> lock(m_cache_mutex);
+			if (auto it = m_cache.find(path); it != m_cache.end())
+			{
+				m_lru.splice(m_lru.begin(), m_lru, it->second.m_lru_it);
+				return it->second.m_resource;
+			}
 		}
-		m_loaded_resources.clear();
+
+		// TODO: Check file extension
+		std::shared_ptr<T> resource = LoadFromDisc(path, thread_pool);
+		if (!resource)
+		{
+			return nullptr;
+		}
+
+		auto size = resource->GetSizeInBytes();
+
+		std::lock_guard<std::mutex> lock(m_cache_mutex);
+		if (m_cache_budget > 0 && size <= m_cache_budget && m_cache.find(path) == m_cache.end())
+		{
+			m_lru.push_front(path);
+			m_cache.insert({ path, { resource, size, m_lru.begin() } });
+			m_retained_bytes += size;
+			Evict(m_cache_budget);
+		}
+
+		return resource;
 	}
 
-	T* Load(std::string const & path)
+	void SetCacheBudget(std::size_t num_bytes)
 	{
-		// TODO: Check file extension
-		auto data = LoadFromDisc(path);
+		std::lock_guard<std::mutex> lock(m_cache_mutex);
+		m_cache_budget = num_bytes;
+		Evict(m_cache_budget);
+	}
+
+	std::size_t GetCacheBudget()
+	{
+		std::lock_guard<std::mutex> lock(m_cache_mutex);
+		return m_cache_budget;
+	}
 
-		m_loaded_resources.push_back(std::move(data));
+	// Bytes of the resources kept alive by the cache of this loader.
+	std::size_t GetRetainedBytes()
+	{
+		std::lock_guard<std::mutex> lock(m_cache_mutex);
+		return m_retained_bytes;
+	}
 
-		return m_loaded_resources.back().get();
+	void ClearCache()
+	{
+		std::lock_guard<std::mutex> lock(m_cache_mutex);
+		Evict(0);
 	}
 
 	bool IsSupportedExtension(std::string const & ext)
@@ -62,8 +119,33 @@ public:
 	}
 
 protected:
-	virtual AnonResource LoadFromDisc(std::string const & path) = 0;
+	virtual AnonResource LoadFromDisc(std::string const & path, util::ThreadPool* thread_pool) = 0;
 
 	std::vector<std::string> m_supported_formats;
-	std::vector<AnonResource> m_loaded_resources;
+
+private:
+	struct CacheEntry
+	{
+		std::shared_ptr<T> m_resource;
+		std::size_t m_size;
+		std::list<std::string>::iterator m_lru_it;
+	};
+
+	// Requires `m_cache_mutex` to be locked.
+	void Evict(std::size_t num_bytes)
+	{
+		while (m_retained_bytes > num_bytes)
+		{
+			auto it = m_cache.find(m_lru.back());
+			m_retained_bytes -= it->second.m_size;
+			m_cache.erase(it);
+			m_lru.pop_back();
+		}
+	}
+
+	std::unordered_map<std::string, CacheEntry> m_cache;
+	std::list<std::string> m_lru; // Most recently used first.
+	std::size_t m_cache_budget;
+	std::size_t m_retained_bytes;
+	std::mutex m_cache_mutex;
 };
@@ -6,19 +6,141 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <unordered_set>
 #include <vector>
 #include <vec2.hpp>
 #include <vec3.hpp>
+#include <mat4x4.hpp>
 #include <optional>
+#include <string>
 #include <vulkan/vulkan.h>
 
+// Block compressed formats store 4x4 pixel blocks.
+enum class TextureCompression : std::uint32_t
+{
+	NONE,
+	BC1, // RGB. 8 bytes per block.
+	BC4, // R. 8 bytes per block.
+	BC5, // RG. 16 bytes per block.
+	BC7, // RGBA. 16 bytes per block.
+	BC3, // RGBA, BC1 color with BC4 alpha. 16 bytes per block.
+};
+
 struct TextureData
 {
 	std::uint32_t m_width = -1;
 	std::uint32_t m_height = -1;
-	std::uint32_t m_channels = -1;
+	std::uint32_t m_channels = -1; // Channels of the source image.
+	// Channels stored per pixel of uncompressed LDR textures: 1 (R8) or 4 (RGBA8). HDR textures are always RGBA32F.
+	std::uint32_t m_pixel_channels = 4;
 	bool m_is_hdr = false;
+	TextureCompression m_compression = TextureCompression::NONE;
+	// Mip levels stored in `m_pixels`, largest first and tightly packed unless `m_mip_offsets` is set. Textures with
+	// a single level get their mips generated on upload when requested.
+	std::uint32_t m_num_mips = 1;
 	void* m_pixels = nullptr;
+	// Byte offsets of the mip levels from `m_pixels`, for textures that point into files which store their levels in
+	// another order. KTX2 stores the smallest level first for example. Empty when the levels are tightly packed.
+	std::vector<std::size_t> m_mip_offsets;
+	// Owns `m_pixels` when set. Copies of the texture share the pixels, which are freed with the last copy. Textures
+	// without storage point into memory owned by someone else.
+	std::shared_ptr<void> m_pixel_storage;
+	// Set on textures without pixels that reference their processed versions in the texture processor cache instead,
+	// like the textures of cooked models. Hash of the tightly packed source pixels.
+	std::uint64_t m_source_hash = 0;
+
+	// False for textures without pixels that don't reference processed pixels either.
+	bool HasContents() const
+	{
+		return m_pixels || m_source_hash != 0;
+	}
+
+	// Allocates pixels owned by this texture.
+	void* AllocatePixels(std::size_t size)
+	{
+		m_pixel_storage = std::shared_ptr<void>(std::malloc(size), std::free);
+		m_pixels = m_pixel_storage.get();
+		return m_pixels;
+	}
+
+	std::uint32_t GetMipWidth(std::uint32_t level) const
+	{
+		return std::max(m_width >> level, 1u);
+	}
+
+	std::uint32_t GetMipHeight(std::uint32_t level) const
+	{
+		return std::max(m_height >> level, 1u);
+	}
+
+	// Size of a mip level as it is uploaded: R8 or RGBA8, RGBA32F for HDR textures or 4x4 blocks.
+	std::size_t GetMipSizeInBytes(std::uint32_t level) const
+	{
+		std::size_t width = GetMipWidth(level);
+		std::size_t height = GetMipHeight(level);
+
+		switch (m_compression)
+		{
+		case TextureCompression::BC1:
+		case TextureCompression::BC4:
+			return ((width + 3) / 4) * ((height + 3) / 4) * 8;
+		case TextureCompression::BC3:
+		case TextureCompression::BC5:
+		case TextureCompression::BC7:
+			return ((width + 3) / 4) * ((height + 3) / 4) * 16;
+		default:
+			return width * height * (m_is_hdr ? 16 : m_pixel_channels);
+		}
+	}
+
+	std::size_t GetMipOffset(std::uint32_t level) const
+	{
+		if (level < m_mip_offsets.size())
+		{
+			return m_mip_offsets[level];
+		}
+
+		std::size_t offset = 0;
+		for (std::uint32_t i = 0; i < level; i++)
+		{
+			offset += GetMipSizeInBytes(i);
+		}
+
+		return offset;
+	}
+
+	// Size of the memory spanned by all mip levels.
+	std::size_t GetSizeInBytes() const
+	{
+		if (!m_pixels)
+		{
+			return 0;
+		}
+
+		if (m_mip_offsets.empty())
+		{
+			return GetMipOffset(m_num_mips);
+		}
+
+		std::size_t size = 0;
+		for (std::uint32_t level = 0; level < m_num_mips; level++)
+		{
+			size = std::max(size, GetMipOffset(level) + GetMipSizeInBytes(level));
+		}
+
+		return size;
+	}
+};
+
+// Files of the processed versions of a texture in the texture processor cache. One per role and flags it was
+// processed with.
+struct ProcessedTextureFiles
+{
+	std::uint64_t m_source_hash = 0;
+	std::vector<std::string> m_paths;
 };
 
 struct MaterialData
@@ -66,12 +188,78 @@ struct MeshData
 	std::size_t m_indices_stride;
 
 	std::uint32_t m_material_id;
+
+	std::uint32_t GetIndex(std::size_t i) const
+	{
+		auto ptr = m_indices.data() + (i * m_indices_stride);
+		switch (m_indices_stride)
+		{
+		case 1: return *ptr;
+		case 2: return *reinterpret_cast<const std::uint16_t*>(ptr);
+		default: return *reinterpret_cast<const std::uint32_t*>(ptr);
+		}
+	}
+
+	void SetIndex(std::size_t i, std::uint32_t value)
+	{
+		auto ptr = m_indices.data() + (i * m_indices_stride);
+		switch (m_indices_stride)
+		{
+		case 1: *ptr = static_cast<std::uint8_t>(value); break;
+		case 2: *reinterpret_cast<std::uint16_t*>(ptr) = static_cast<std::uint16_t>(value); break;
+		default: *reinterpret_cast<std::uint32_t*>(ptr) = value; break;
+		}
+	}
+
+	std::size_t GetSizeInBytes() const
+	{
+		return (m_positions.size() + m_normals.size() + m_uvw.size() + m_tangents.size() + m_bitangents.size()) * sizeof(glm::vec3)
+			+ m_indices.size();
+	}
+};
+
+// Instance of a mesh in the node hierarchy of a model.
+struct MeshNodeData
+{
+	std::uint32_t m_mesh_id; // Index into `ModelData::m_meshes`.
+	std::uint32_t m_material_id; // Usually the material of the mesh.
+	glm::mat4 m_transform; // Object to model space.
 };
 
 struct ModelData
 {
+	// Unique meshes in object space when the model has nodes, in model space otherwise.
 	std::vector<MeshData> m_meshes;
 	std::vector<MaterialData> m_materials;
+	// Every placement of a mesh. Meshes referenced by multiple nodes are stored once. Empty when every mesh is drawn
+	// once as is.
+	std::vector<MeshNodeData> m_nodes;
+
+	// Includes the pixels of the textures the materials own. Textures shared by materials are counted once.
+	std::size_t GetSizeInBytes() const
+	{
+		std::size_t size = 0;
+		for (auto const & mesh : m_meshes)
+		{
+			size += mesh.GetSizeInBytes();
+		}
+		size += m_nodes.size() * sizeof(MeshNodeData);
+
+		std::unordered_set<void const *> counted_pixels;
+		for (auto const & material : m_materials)
+		{
+			for (auto texture : { &material.m_albedo_texture, &material.m_metallic_texture, &material.m_roughness_texture, &material.m_ambient_occlusion_texture,
+				&material.m_normal_map_texture, &material.m_emissive_texture, &material.m_thickness_texture, &material.m_displacement_texture })
+			{
+				if (texture->m_pixel_storage && counted_pixels.insert(texture->m_pixels).second)
+				{
+					size += texture->GetSizeInBytes();
+				}
+			}
+		}
+
+		return size;
+	}
 };
 
 struct RenderTargetProperties
@@ -6,6 +6,8 @@
 
 #include "scene_graph.hpp"
 
+#include <algorithm>
+
 #include "../util/bitfield.hpp"
 #include "../renderer.hpp"
 
@@ -333,25 +335,16 @@ void sg::SceneGraph::Update(std::uint32_t frame_idx)
 		auto node_handle = requires_update.m_node_handle;
 		auto node = m_nodes[node_handle];
 		auto model_mat = m_models[node.m_transform_component].m_value;
-		auto model_handle = m_model_handles[node.m_mesh_component].m_value;
 
-		// find appropriate batch
+		// Find the batch of the mesh. Instanced meshes can fill multiple batches.
 		bool updated_batch = false;
 		for (auto& batch : m_render_batches)
 		{
-			if (FitsInBatch(batch, node))
+			auto it = std::find(batch.m_nodes.begin(), batch.m_nodes.end(), node_handle);
+			if (it != batch.m_nodes.end())
 			{
-				// Find the position of the mesh that requires a update inside of the constant buffer.
-				int update_offset = 0;
-				for (auto batch_node_handle : batch.m_nodes)
-				{
-					if (batch_node_handle == node_handle)
-					{
-						break;
-					}
-
-					update_offset++;
-				}
+				// The position of the mesh that requires a update inside of the constant buffer.
+				auto update_offset = std::distance(batch.m_nodes.begin(), it);
 
 				cb::Basic data;
 				data.m_model = model_mat;
@@ -297,7 +297,7 @@ namespace sg
 			auto model_handle = m_model_handles[node.m_mesh_component].m_value;
 			auto material_handles = m_model_material_handles[node.m_mesh_component].m_value;
 
-			return batch.m_model_handle == model_handle && batch.m_material_handles == material_handles;
+			return batch.m_num_meshes < gfx::settings::max_render_batch_size && batch.m_model_handle == model_handle && batch.m_material_handles == material_handles;
 		}
 
 	private:
@@ -425,6 +425,50 @@ namespace sg
 			sg->m_requires_camera_buffer_update[camera_handle] = { true, true, true };
 		}
 
+		// Decomposes `transform` into a position, rotation and scale. Shear is lost.
+		inline void SetTransform(SceneGraph* sg, NodeHandle handle, glm::mat4 const & transform)
+		{
+			glm::vec3 scale = { glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2])) };
+			if (glm::determinant(glm::mat3(transform)) < 0.f)
+			{
+				scale.x = -scale.x;
+			}
+
+			glm::mat3 rotation(glm::vec3(transform[0]) / scale.x, glm::vec3(transform[1]) / scale.y, glm::vec3(transform[2]) / scale.z);
+
+			SetPosition(sg, handle, glm::vec3(transform[3]));
+			SetRotation(sg, handle, glm::eulerAngles(glm::quat_cast(rotation)));
+			SetScale(sg, handle, scale);
+		}
+
+		// Creates a mesh node for every node of a model imported with `ModelImportSettings::m_preserve_instancing`,
+		// placed at `transform` times the transform of the node. Nodes that instance the same mesh with the same
+		// material share a model handle, so they are drawn by one batch. Models without nodes get a single mesh node.
+		inline std::vector<NodeHandle> CreateModelNodes(SceneGraph* sg, ModelHandle const & model_handle, glm::mat4 const & transform = glm::mat4(1))
+		{
+			if (model_handle.m_nodes.empty())
+			{
+				auto node = sg->CreateNode<MeshComponent>(model_handle);
+				SetTransform(sg, node, transform);
+				return { node };
+			}
+
+			std::vector<NodeHandle> nodes;
+			nodes.reserve(model_handle.m_nodes.size());
+			for (auto const & model_node : model_handle.m_nodes)
+			{
+				ModelHandle instance_handle;
+				instance_handle.m_mesh_handles.push_back(model_handle.m_mesh_handles[model_node.m_mesh]);
+				instance_handle.m_mesh_handles.back().m_material_handle = model_node.m_material_handle;
+
+				auto node = sg->CreateNode<MeshComponent>(instance_handle);
+				SetTransform(sg, node, transform * model_node.m_transform);
+				nodes.push_back(node);
+			}
+
+			return nodes;
+		}
+
 	} /* helper */
 
 } /* sg */
\ No newline at end of file
@@ -18,5 +18,16 @@ namespace settings
 	static const std::optional<float> m_imgui_font_size = 13;
 	static const bool use_multithreading = false;
 	static const std::uint32_t num_frame_graph_threads = 4;
+	// Empty to always import models from source. Cooked models reference the processed textures in
+	// `cooked_texture_directory` instead of storing their pixels.
+	static const char* cooked_model_directory = "cooked";
+	// Generate mips and block compress textures on the CPU. Otherwise only the textures processed by the asset cooker
+	// into `cooked_texture_directory` are used, when it exists.
+	static const bool process_textures = false;
+	static const char* cooked_texture_directory = "cooked/textures";
+	// Stream the mip levels of textures that have their mips on the CPU, within the budget. Not supported by the
+	// raytracing task, which binds every texture once.
+	static const bool texture_streaming = false;
+	static const std::size_t texture_streaming_budget = 512ull * 1024 * 1024;
 
 } /* settings */
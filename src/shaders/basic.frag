@@ -92,7 +92,9 @@ void main()
 	normal = mix(-normal, normal, float(gl_FrontFacing)); // flip to face direction
 
     mat3 TBN = mat3( normalize(g_tangent), normalize(g_bitangent), normal );
-    vec3 normal_t = normalize(texture(ts_textures[1], uv).xyz * 2.0f - 1.0f);
+    // Z is reconstructed, since BC5 normal maps only store XY.
+    vec2 normal_xy = texture(ts_textures[1], uv).xy * 2.0f - 1.0f;
+    vec3 normal_t = vec3(normal_xy, sqrt(max(1.0f - dot(normal_xy, normal_xy), 0.0f)));
 
     vec4 albedo = material.color.x > -1 ? vec4(material.color, 1) : texture(ts_textures[0], uv);
 	float thickness = texture(ts_textures[3], uv).r;
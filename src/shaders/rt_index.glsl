@@ -0,0 +1,20 @@
+#ifndef RT_INDEX_GLSL
+#define RT_INDEX_GLSL
+
+#include "structs.glsl"
+
+// Expects the index buffer to be declared as `ib`.
+
+// Index `i` of a mesh in the index buffer. 16 bit indices are packed two per uint.
+uint LoadIndex(RaytracingOffset offset, uint i)
+{
+	if (offset.idx_stride == 2)
+	{
+		const uint byte_offset = offset.idx_offset + i * 2;
+		return (ib.indices[byte_offset / 4] >> ((byte_offset & 2) * 8)) & 0xFFFF;
+	}
+
+	return ib.indices[offset.idx_offset / 4 + i];
+}
+
+#endif
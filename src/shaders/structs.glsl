@@ -46,6 +46,7 @@ struct RaytracingOffset
 {   
 	uint vertex_offset;
 	uint idx_offset;
+	uint idx_stride; // 2 or 4 bytes.
 };
 
 struct RaytracingMaterial
@@ -6,10 +6,13 @@
 
 #include "stb_image_loader.hpp"
 
+#include <algorithm>
+#include <future>
+#include <limits>
+#include <thread>
 #include <stb_image.h>
 
 #include "util/log.hpp"
-#include "graphics/gfx_enums.hpp"
 #include "resource_structs.hpp"
 
 STBImageLoader::STBImageLoader()
@@ -18,28 +21,106 @@ STBImageLoader::STBImageLoader()
 
 }
 
-STBImageLoader::AnonResource STBImageLoader::LoadFromDisc(std::string const & path)
+STBImageLoader::AnonResource STBImageLoader::LoadFromDisc(std::string const & path, util::ThreadPool*)
 {
-	auto texture = std::make_unique<TextureData>();
+	auto texture = Decode(path);
+	if (!texture)
+	{
+		LOGC("STB Failed to load texture.");
+	}
+
+	return texture;
+}
+
+namespace internal
+{
+
+	inline std::uint32_t GetDecodeChannels(std::string const & name, std::uint32_t desired_channels)
+	{
+		if (desired_channels != 1 && desired_channels != 4)
+		{
+			LOGW("Images can only be decoded to 1 or 4 channels. Decoding {} to 4 channels.", name);
+			return 4;
+		}
+
+		return desired_channels;
+	}
+
+	// Takes ownership of the pixels returned by stb. Returns nullptr when decoding failed.
+	inline std::unique_ptr<TextureData> CreateTexture(std::string const & name, unsigned char* x, int width, int height, int channels, std::uint32_t desired_channels)
+	{
+		if (!x || width <= 0 || height <=0 || channels <= 0)
+		{
+			LOGW("STB Failed to load texture {}: {}", name, stbi_failure_reason() ? stbi_failure_reason() : "unknown error");
+			stbi_image_free(x);
+			return nullptr;
+		}
+
+		auto texture = std::make_unique<TextureData>();
+		texture->m_pixel_storage = std::shared_ptr<void>(x, stbi_image_free);
+		texture->m_pixels = x;
+		texture->m_width = static_cast<std::uint32_t>(width);
+		texture->m_height = static_cast<std::uint32_t>(height);
+		texture->m_channels = static_cast<std::uint32_t>(channels);
+		texture->m_pixel_channels = desired_channels;
+		texture->m_is_hdr = false;
+
+		return texture;
+	}
+
+} /* internal */
+
+std::unique_ptr<TextureData> STBImageLoader::Decode(std::string const & path, std::uint32_t desired_channels)
+{
+	desired_channels = internal::GetDecodeChannels(path, desired_channels);
 
 	int width = 0, height = 0, channels = 0;
-	unsigned char* x = stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	unsigned char* x = stbi_load(path.c_str(), &width, &height, &channels, static_cast<int>(desired_channels));
 
-	if (!x || width <= 0 || height <=0 || channels <= 0)
+	return internal::CreateTexture(path, x, width, height, channels, desired_channels);
+}
+
+std::unique_ptr<TextureData> STBImageLoader::Decode(std::uint8_t const * data, std::size_t size, std::string const & name, std::uint32_t desired_channels)
+{
+	desired_channels = internal::GetDecodeChannels(name, desired_channels);
+
+	if (size > static_cast<std::size_t>(std::numeric_limits<int>::max()))
 	{
-		LOGC("STB Failed to load texture.");
+		LOGW("STB Failed to load texture {}: the image is too large", name);
+		return nullptr;
 	}
-	//channels = 4; //TODO: forcing a alpha component to make my job easier.
 
-	auto data_size =  width * height * 4;
-	texture->m_pixels = malloc(data_size); // TODO: Destroy this
-	memcpy(texture->m_pixels, x, data_size);
-	texture->m_width = static_cast<std::uint32_t>(width);
-	texture->m_height = static_cast<std::uint32_t>(height);
-	texture->m_channels = static_cast<std::uint32_t>(channels);
-	texture->m_is_hdr = false;
+	int width = 0, height = 0, channels = 0;
+	unsigned char* x = stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels, static_cast<int>(desired_channels));
 
-	return texture;
+	return internal::CreateTexture(name, x, width, height, channels, desired_channels);
+}
+
+std::vector<std::unique_ptr<TextureData>> STBImageLoader::LoadBatch(std::vector<STBImageRequest> const & requests, util::ThreadPool* thread_pool)
+{
+	std::unique_ptr<util::ThreadPool> batch_thread_pool;
+	if (!thread_pool)
+	{
+		auto num_threads = std::min<std::size_t>(requests.size(), std::max(1u, std::thread::hardware_concurrency()));
+		batch_thread_pool = std::make_unique<util::ThreadPool>(std::max<std::size_t>(num_threads, 1));
+		thread_pool = batch_thread_pool.get();
+	}
+
+	std::vector<std::future<std::unique_ptr<TextureData>>> futures;
+	futures.reserve(requests.size());
+	for (auto const & request : requests)
+	{
+		futures.push_back(thread_pool->Enqueue([&request]() { return Decode(request.m_path, request.m_desired_channels); }));
+	}
+
+	std::vector<std::unique_ptr<TextureData>> textures;
+	textures.reserve(requests.size());
+	for (auto& future : futures)
+	{
+		textures.push_back(future.get());
+	}
+
+	return textures;
 }
 
 STBHDRImageLoader::STBHDRImageLoader()
@@ -48,7 +129,7 @@ STBHDRImageLoader::STBHDRImageLoader()
 
 }
 
-STBHDRImageLoader::AnonResource STBHDRImageLoader::LoadFromDisc(std::string const & path)
+STBHDRImageLoader::AnonResource STBHDRImageLoader::LoadFromDisc(std::string const & path, util::ThreadPool*)
 {
 	auto texture = std::make_unique<TextureData>();
 
@@ -60,9 +141,9 @@ STBHDRImageLoader::AnonResource STBHDRImageLoader::LoadFromDisc(std::string cons
 		LOGC("STB Failed to load texture.");
 	}
 
-	auto data_size = width * height * gfx::enums::BytesPerPixel(VK_FORMAT_R32G32B32A32_SFLOAT); // TODO: 4 but only 3 components.
-	texture->m_pixels = malloc(data_size); // TODO: Destroy this
-	memcpy(texture->m_pixels, x, data_size);
+	// The pixels are used from the allocation of stb directly.
+	texture->m_pixel_storage = std::shared_ptr<void>(x, stbi_image_free);
+	texture->m_pixels = x;
 	texture->m_width = static_cast<std::uint32_t>(width);
 	texture->m_height = static_cast<std::uint32_t>(height);
 	texture->m_channels = static_cast<std::uint32_t>(channels);
@@ -9,6 +9,14 @@
 #include "resource_loader.hpp"
 
 #include "resource_structs.hpp"
+#include "util/thread_pool.hpp"
+
+// An image to decode and the channels it is decoded to: 1 for grey or 4 for RGBA.
+struct STBImageRequest
+{
+	std::string m_path;
+	std::uint32_t m_desired_channels = 4;
+};
 
 class STBImageLoader : public ResourceLoader<TextureData>
 {
@@ -16,7 +24,16 @@ public:
 	STBImageLoader();
 	~STBImageLoader() final = default;
 
-	AnonResource LoadFromDisc(std::string const & path) final;
+	AnonResource LoadFromDisc(std::string const & path, util::ThreadPool* thread_pool) final;
+
+	// The returned texture owns the allocation of stb, so the pixels are never copied. Returns nullptr when decoding
+	// failed.
+	static std::unique_ptr<TextureData> Decode(std::string const & path, std::uint32_t desired_channels = 4);
+	// Decodes an encoded image in memory, like the images embedded in glTF buffers. `name` is only used for warnings.
+	static std::unique_ptr<TextureData> Decode(std::uint8_t const * data, std::size_t size, std::string const & name, std::uint32_t desired_channels = 4);
+	// Decodes the images concurrently on `thread_pool`, or on a temporary pool of at most one thread per hardware thread
+	// when it is nullptr. The textures are in the order of the requests. Images that failed to decode are nullptr.
+	static std::vector<std::unique_ptr<TextureData>> LoadBatch(std::vector<STBImageRequest> const & requests, util::ThreadPool* thread_pool = nullptr);
 };
 
 class STBHDRImageLoader : public ResourceLoader<TextureData>
@@ -25,5 +42,5 @@ public:
 	STBHDRImageLoader();
 	~STBHDRImageLoader() final = default;
 
-	AnonResource LoadFromDisc(std::string const & path) final;
+	AnonResource LoadFromDisc(std::string const & path, util::ThreadPool* thread_pool) final;
 };
\ No newline at end of file
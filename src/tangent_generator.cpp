@@ -0,0 +1,443 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "tangent_generator.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <future>
+
+#include "util/log.hpp"
+
+namespace internal
+{
+
+	// Calls `function(first, last)` for batches of `tangent_batch_size` of `count` items on `thread_pool`, or once when
+	// no thread pool is given.
+	template<typename F>
+	inline void ForEachBatch(util::ThreadPool* thread_pool, std::size_t count, F const & function)
+	{
+		if (!thread_pool || count <= tangent_batch_size)
+		{
+			function(std::size_t(0), count);
+			return;
+		}
+
+		std::vector<std::future<void>> futures;
+		for (std::size_t first = 0; first < count; first += tangent_batch_size)
+		{
+			auto last = std::min(first + tangent_batch_size, count);
+			futures.emplace_back(thread_pool->Enqueue([&function, first, last]()
+			{
+				function(first, last);
+			}));
+		}
+
+		for (auto& future : futures)
+		{
+			future.get();
+		}
+	}
+
+	// Tangent and bitangent of every face, divided by the determinant of its UV mapping, or 0 when the mapping is
+	// degenerate. Also used for the per vertex sums. Structure of arrays, so the SIMD kernels load and store lanes.
+	struct TangentArrays
+	{
+		explicit TangentArrays(std::size_t size)
+			: m_tx(size), m_ty(size), m_tz(size), m_bx(size), m_by(size), m_bz(size)
+		{
+		}
+
+		std::vector<float> m_tx, m_ty, m_tz;
+		std::vector<float> m_bx, m_by, m_bz;
+	};
+
+	// Kernels of the face tangents. They process triangles `[first, last)`. The SIMD kernels hand their remainder to
+	// the scalar kernel.
+	template<typename I>
+	void FaceTangentsScalar(glm::vec3 const * positions, glm::vec3 const * uvs, I const * indices, std::size_t first, std::size_t last,
+		TangentArrays & out)
+	{
+		for (std::size_t t = first; t < last; t++)
+		{
+			auto i0 = indices[t * 3 + 0];
+			auto i1 = indices[t * 3 + 1];
+			auto i2 = indices[t * 3 + 2];
+
+			glm::vec3 e1 = positions[i1] - positions[i0];
+			glm::vec3 e2 = positions[i2] - positions[i0];
+			float u1 = uvs[i1].x - uvs[i0].x, v1 = uvs[i1].y - uvs[i0].y;
+			float u2 = uvs[i2].x - uvs[i0].x, v2 = uvs[i2].y - uvs[i0].y;
+
+			float det = u1 * v2 - v1 * u2;
+			float r = std::fabs(det) > FLT_MIN ? 1.f / det : 0.f;
+
+			out.m_tx[t] = (e1.x * v2 - e2.x * v1) * r;
+			out.m_ty[t] = (e1.y * v2 - e2.y * v1) * r;
+			out.m_tz[t] = (e1.z * v2 - e2.z * v1) * r;
+			out.m_bx[t] = (e2.x * u1 - e1.x * u2) * r;
+			out.m_by[t] = (e2.y * u1 - e1.y * u2) * r;
+			out.m_bz[t] = (e2.z * u1 - e1.z * u2) * r;
+		}
+	}
+
+	// Orthonormalizes the sums of vertices `[first, last)` against the normals and writes the frames. The sign of
+	// the bitangent is the handedness of the summed frame.
+	inline void WriteFrame(glm::vec3 const & n, glm::vec3 t, float tangent_length_sq, glm::vec3 const & sum_b, glm::vec3 & out_t, glm::vec3 & out_b)
+	{
+		if (tangent_length_sq > FLT_MIN)
+		{
+			t *= 1.f / std::sqrt(tangent_length_sq);
+			auto b = glm::cross(n, t);
+			out_t = t;
+			out_b = glm::dot(b, sum_b) < 0.f ? -b : b;
+			return;
+		}
+
+		// No UV mapping: any frame around the normal.
+		auto axis = std::fabs(n.x) < 0.9f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+		t = axis - n * glm::dot(n, axis);
+		out_t = t * (1.f / std::sqrt(glm::dot(t, t)));
+		out_b = glm::cross(n, out_t);
+	}
+
+	inline void OrthonormalizeScalar(glm::vec3 const * normals, TangentArrays const & sums, std::size_t first, std::size_t last,
+		glm::vec3 * tangents, glm::vec3 * bitangents)
+	{
+		for (std::size_t v = first; v < last; v++)
+		{
+			auto const & n = normals[v];
+			glm::vec3 sum_t(sums.m_tx[v], sums.m_ty[v], sums.m_tz[v]);
+			glm::vec3 sum_b(sums.m_bx[v], sums.m_by[v], sums.m_bz[v]);
+
+			float d = n.x * sum_t.x + n.y * sum_t.y + n.z * sum_t.z;
+			glm::vec3 t(sum_t.x - n.x * d, sum_t.y - n.y * d, sum_t.z - n.z * d);
+			WriteFrame(n, t, t.x * t.x + t.y * t.y + t.z * t.z, sum_b, tangents[v], bitangents[v]);
+		}
+	}
+
+#ifdef SKYGGE_SIMD_X86
+	// 4 triangles at a time in structure of arrays form.
+	template<typename I>
+	void FaceTangentsSSE2(glm::vec3 const * positions, glm::vec3 const * uvs, I const * indices, std::size_t first, std::size_t last,
+		TangentArrays & out)
+	{
+		const __m128 one = _mm_set1_ps(1.f);
+		const __m128 min = _mm_set1_ps(FLT_MIN);
+		const __m128 abs_mask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+
+		const std::size_t last_simd = first + ((last - first) & ~std::size_t(3));
+		for (std::size_t t = first; t < last_simd; t += 4)
+		{
+			I const * tri = indices + t * 3;
+			__m128 x[3], y[3], z[3], u[3], v[3];
+			for (int c = 0; c < 3; c++)
+			{
+				auto const & p0 = positions[tri[c]], & p1 = positions[tri[c + 3]], & p2 = positions[tri[c + 6]], & p3 = positions[tri[c + 9]];
+				auto const & t0 = uvs[tri[c]], & t1 = uvs[tri[c + 3]], & t2 = uvs[tri[c + 6]], & t3 = uvs[tri[c + 9]];
+				x[c] = _mm_setr_ps(p0.x, p1.x, p2.x, p3.x);
+				y[c] = _mm_setr_ps(p0.y, p1.y, p2.y, p3.y);
+				z[c] = _mm_setr_ps(p0.z, p1.z, p2.z, p3.z);
+				u[c] = _mm_setr_ps(t0.x, t1.x, t2.x, t3.x);
+				v[c] = _mm_setr_ps(t0.y, t1.y, t2.y, t3.y);
+			}
+
+			__m128 e1_x = _mm_sub_ps(x[1], x[0]), e1_y = _mm_sub_ps(y[1], y[0]), e1_z = _mm_sub_ps(z[1], z[0]);
+			__m128 e2_x = _mm_sub_ps(x[2], x[0]), e2_y = _mm_sub_ps(y[2], y[0]), e2_z = _mm_sub_ps(z[2], z[0]);
+			__m128 u1 = _mm_sub_ps(u[1], u[0]), v1 = _mm_sub_ps(v[1], v[0]);
+			__m128 u2 = _mm_sub_ps(u[2], u[0]), v2 = _mm_sub_ps(v[2], v[0]);
+
+			// Lanes with a degenerate mapping divide by 0 and are masked to 0.
+			__m128 det = _mm_sub_ps(_mm_mul_ps(u1, v2), _mm_mul_ps(v1, u2));
+			__m128 r = _mm_and_ps(_mm_cmpgt_ps(_mm_and_ps(det, abs_mask), min), _mm_div_ps(one, det));
+
+			_mm_storeu_ps(&out.m_tx[t], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e1_x, v2), _mm_mul_ps(e2_x, v1)), r));
+			_mm_storeu_ps(&out.m_ty[t], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e1_y, v2), _mm_mul_ps(e2_y, v1)), r));
+			_mm_storeu_ps(&out.m_tz[t], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e1_z, v2), _mm_mul_ps(e2_z, v1)), r));
+			_mm_storeu_ps(&out.m_bx[t], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e2_x, u1), _mm_mul_ps(e1_x, u2)), r));
+			_mm_storeu_ps(&out.m_by[t], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e2_y, u1), _mm_mul_ps(e1_y, u2)), r));
+			_mm_storeu_ps(&out.m_bz[t], _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(e2_z, u1), _mm_mul_ps(e1_z, u2)), r));
+		}
+
+		FaceTangentsScalar(positions, uvs, indices, last_simd, last, out);
+	}
+
+	inline void OrthonormalizeSSE2(glm::vec3 const * normals, TangentArrays const & sums, std::size_t first, std::size_t last,
+		glm::vec3 * tangents, glm::vec3 * bitangents)
+	{
+		const std::size_t last_simd = first + ((last - first) & ~std::size_t(3));
+		for (std::size_t v = first; v < last_simd; v += 4)
+		{
+			auto const & n0 = normals[v], & n1 = normals[v + 1], & n2 = normals[v + 2], & n3 = normals[v + 3];
+			__m128 n_x = _mm_setr_ps(n0.x, n1.x, n2.x, n3.x);
+			__m128 n_y = _mm_setr_ps(n0.y, n1.y, n2.y, n3.y);
+			__m128 n_z = _mm_setr_ps(n0.z, n1.z, n2.z, n3.z);
+			__m128 t_x = _mm_loadu_ps(&sums.m_tx[v]), t_y = _mm_loadu_ps(&sums.m_ty[v]), t_z = _mm_loadu_ps(&sums.m_tz[v]);
+
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(n_x, t_x), _mm_mul_ps(n_y, t_y)), _mm_mul_ps(n_z, t_z));
+			t_x = _mm_sub_ps(t_x, _mm_mul_ps(n_x, d));
+			t_y = _mm_sub_ps(t_y, _mm_mul_ps(n_y, d));
+			t_z = _mm_sub_ps(t_z, _mm_mul_ps(n_z, d));
+			__m128 length_sq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(t_x, t_x), _mm_mul_ps(t_y, t_y)), _mm_mul_ps(t_z, t_z));
+
+			alignas(16) float lanes[4][4];
+			_mm_store_ps(lanes[0], t_x); _mm_store_ps(lanes[1], t_y); _mm_store_ps(lanes[2], t_z); _mm_store_ps(lanes[3], length_sq);
+			for (int i = 0; i < 4; i++)
+			{
+				glm::vec3 sum_b(sums.m_bx[v + i], sums.m_by[v + i], sums.m_bz[v + i]);
+				WriteFrame(normals[v + i], glm::vec3(lanes[0][i], lanes[1][i], lanes[2][i]), lanes[3][i], sum_b, tangents[v + i], bitangents[v + i]);
+			}
+		}
+
+		OrthonormalizeScalar(normals, sums, last_simd, last, tangents, bitangents);
+	}
+
+	// 8 triangles at a time. Positions and UVs are gathered, which limits the vertex count to 2^31 / 3.
+	template<typename I>
+	SKYGGE_TARGET_AVX2 void FaceTangentsAVX2(glm::vec3 const * positions, glm::vec3 const * uvs, I const * indices, std::size_t first, std::size_t last,
+		TangentArrays & out)
+	{
+		const __m256 one = _mm256_set1_ps(1.f);
+		const __m256 min = _mm256_set1_ps(FLT_MIN);
+		const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+		const __m256i three = _mm256_set1_epi32(3);
+		const float* position_base = &positions[0].x;
+		const float* uv_base = &uvs[0].x;
+
+		const std::size_t last_simd = first + ((last - first) & ~std::size_t(7));
+		for (std::size_t t = first; t < last_simd; t += 8)
+		{
+			I const * tri = indices + t * 3;
+			__m256 x[3], y[3], z[3], u[3], v[3];
+			for (int c = 0; c < 3; c++)
+			{
+				__m256i offsets = _mm256_mullo_epi32(_mm256_setr_epi32(tri[c], tri[c + 3], tri[c + 6], tri[c + 9],
+					tri[c + 12], tri[c + 15], tri[c + 18], tri[c + 21]), three);
+				x[c] = _mm256_i32gather_ps(position_base + 0, offsets, 4);
+				y[c] = _mm256_i32gather_ps(position_base + 1, offsets, 4);
+				z[c] = _mm256_i32gather_ps(position_base + 2, offsets, 4);
+				u[c] = _mm256_i32gather_ps(uv_base + 0, offsets, 4);
+				v[c] = _mm256_i32gather_ps(uv_base + 1, offsets, 4);
+			}
+
+			__m256 e1_x = _mm256_sub_ps(x[1], x[0]), e1_y = _mm256_sub_ps(y[1], y[0]), e1_z = _mm256_sub_ps(z[1], z[0]);
+			__m256 e2_x = _mm256_sub_ps(x[2], x[0]), e2_y = _mm256_sub_ps(y[2], y[0]), e2_z = _mm256_sub_ps(z[2], z[0]);
+			__m256 u1 = _mm256_sub_ps(u[1], u[0]), v1 = _mm256_sub_ps(v[1], v[0]);
+			__m256 u2 = _mm256_sub_ps(u[2], u[0]), v2 = _mm256_sub_ps(v[2], v[0]);
+
+			__m256 det = _mm256_fmsub_ps(u1, v2, _mm256_mul_ps(v1, u2));
+			__m256 r = _mm256_and_ps(_mm256_cmp_ps(_mm256_and_ps(det, abs_mask), min, _CMP_GT_OQ), _mm256_div_ps(one, det));
+
+			_mm256_storeu_ps(&out.m_tx[t], _mm256_mul_ps(_mm256_fmsub_ps(e1_x, v2, _mm256_mul_ps(e2_x, v1)), r));
+			_mm256_storeu_ps(&out.m_ty[t], _mm256_mul_ps(_mm256_fmsub_ps(e1_y, v2, _mm256_mul_ps(e2_y, v1)), r));
+			_mm256_storeu_ps(&out.m_tz[t], _mm256_mul_ps(_mm256_fmsub_ps(e1_z, v2, _mm256_mul_ps(e2_z, v1)), r));
+			_mm256_storeu_ps(&out.m_bx[t], _mm256_mul_ps(_mm256_fmsub_ps(e2_x, u1, _mm256_mul_ps(e1_x, u2)), r));
+			_mm256_storeu_ps(&out.m_by[t], _mm256_mul_ps(_mm256_fmsub_ps(e2_y, u1, _mm256_mul_ps(e1_y, u2)), r));
+			_mm256_storeu_ps(&out.m_bz[t], _mm256_mul_ps(_mm256_fmsub_ps(e2_z, u1, _mm256_mul_ps(e1_z, u2)), r));
+		}
+
+		FaceTangentsScalar(positions, uvs, indices, last_simd, last, out);
+	}
+
+	SKYGGE_TARGET_AVX2 inline void OrthonormalizeAVX2(glm::vec3 const * normals, TangentArrays const & sums, std::size_t first, std::size_t last,
+		glm::vec3 * tangents, glm::vec3 * bitangents)
+	{
+		const __m256i three = _mm256_set1_epi32(3);
+		const __m256i lane_offsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), three);
+
+		const std::size_t last_simd = first + ((last - first) & ~std::size_t(7));
+		for (std::size_t v = first; v < last_simd; v += 8)
+		{
+			const float* base = &normals[v].x;
+			__m256 n_x = _mm256_i32gather_ps(base + 0, lane_offsets, 4);
+			__m256 n_y = _mm256_i32gather_ps(base + 1, lane_offsets, 4);
+			__m256 n_z = _mm256_i32gather_ps(base + 2, lane_offsets, 4);
+			__m256 t_x = _mm256_loadu_ps(&sums.m_tx[v]), t_y = _mm256_loadu_ps(&sums.m_ty[v]), t_z = _mm256_loadu_ps(&sums.m_tz[v]);
+
+			__m256 d = _mm256_fmadd_ps(n_x, t_x, _mm256_fmadd_ps(n_y, t_y, _mm256_mul_ps(n_z, t_z)));
+			t_x = _mm256_fnmadd_ps(n_x, d, t_x);
+			t_y = _mm256_fnmadd_ps(n_y, d, t_y);
+			t_z = _mm256_fnmadd_ps(n_z, d, t_z);
+			__m256 length_sq = _mm256_fmadd_ps(t_x, t_x, _mm256_fmadd_ps(t_y, t_y, _mm256_mul_ps(t_z, t_z)));
+
+			alignas(32) float lanes[4][8];
+			_mm256_store_ps(lanes[0], t_x); _mm256_store_ps(lanes[1], t_y); _mm256_store_ps(lanes[2], t_z); _mm256_store_ps(lanes[3], length_sq);
+			for (int i = 0; i < 8; i++)
+			{
+				glm::vec3 sum_b(sums.m_bx[v + i], sums.m_by[v + i], sums.m_bz[v + i]);
+				WriteFrame(normals[v + i], glm::vec3(lanes[0][i], lanes[1][i], lanes[2][i]), lanes[3][i], sum_b, tangents[v + i], bitangents[v + i]);
+			}
+		}
+
+		OrthonormalizeScalar(normals, sums, last_simd, last, tangents, bitangents);
+	}
+#endif
+
+	template<typename I>
+	void FaceTangents(glm::vec3 const * positions, glm::vec3 const * uvs, I const * indices, std::size_t first, std::size_t last,
+		util::SIMDLevel level, TangentArrays & out)
+	{
+#ifdef SKYGGE_SIMD_X86
+		if (level == util::SIMDLevel::AVX2)
+		{
+			FaceTangentsAVX2(positions, uvs, indices, first, last, out);
+			return;
+		}
+		if (level == util::SIMDLevel::SSE2)
+		{
+			FaceTangentsSSE2(positions, uvs, indices, first, last, out);
+			return;
+		}
+#endif
+		FaceTangentsScalar(positions, uvs, indices, first, last, out);
+	}
+
+	inline void Orthonormalize(glm::vec3 const * normals, TangentArrays const & sums, std::size_t first, std::size_t last,
+		util::SIMDLevel level, glm::vec3 * tangents, glm::vec3 * bitangents)
+	{
+#ifdef SKYGGE_SIMD_X86
+		if (level == util::SIMDLevel::AVX2)
+		{
+			OrthonormalizeAVX2(normals, sums, first, last, tangents, bitangents);
+			return;
+		}
+		if (level == util::SIMDLevel::SSE2)
+		{
+			OrthonormalizeSSE2(normals, sums, first, last, tangents, bitangents);
+			return;
+		}
+#endif
+		OrthonormalizeScalar(normals, sums, first, last, tangents, bitangents);
+	}
+
+	// Projects `v` onto the plane with normal `n` and normalizes it. Returns false when nothing is left.
+	inline bool ProjectAndNormalize(glm::vec3 const & n, glm::vec3 & v)
+	{
+		v -= n * glm::dot(n, v);
+		float length_sq = glm::dot(v, v);
+		if (length_sq <= FLT_MIN)
+		{
+			return false;
+		}
+
+		v *= 1.f / std::sqrt(length_sq);
+		return true;
+	}
+
+	// Sums the face tangents around vertices `[first, last)`. The corners of vertex `v` are
+	// `corners[corner_offsets[v]..corner_offsets[v + 1]]`, in triangle order, so the sums don't depend on the batches.
+	template<typename I>
+	void SumFaceTangents(MeshData const & mesh, I const * indices, std::vector<std::uint32_t> const & corner_offsets,
+		std::vector<std::uint32_t> const & corners, TangentArrays const & faces, TangentMode mode, std::size_t first, std::size_t last, TangentArrays & sums)
+	{
+		for (std::size_t v = first; v < last; v++)
+		{
+			glm::vec3 sum_t(0.f), sum_b(0.f);
+			for (auto i = corner_offsets[v]; i < corner_offsets[v + 1]; i++)
+			{
+				auto corner = corners[i];
+				auto f = corner / 3;
+				glm::vec3 t(faces.m_tx[f], faces.m_ty[f], faces.m_tz[f]);
+				glm::vec3 b(faces.m_bx[f], faces.m_by[f], faces.m_bz[f]);
+
+				if (mode == TangentMode::ACCUMULATE)
+				{
+					sum_t += t;
+					sum_b += b;
+					continue;
+				}
+
+				auto const & n = mesh.m_normals[v];
+				auto const & p = mesh.m_positions[v];
+				auto edge_a = mesh.m_positions[indices[f * 3 + (corner + 1) % 3]] - p;
+				auto edge_b = mesh.m_positions[indices[f * 3 + (corner + 2) % 3]] - p;
+				if (!ProjectAndNormalize(n, t) || !ProjectAndNormalize(n, edge_a) || !ProjectAndNormalize(n, edge_b))
+				{
+					continue;
+				}
+
+				float angle = std::acos(std::clamp(glm::dot(edge_a, edge_b), -1.f, 1.f));
+				sum_t += t * angle;
+				if (ProjectAndNormalize(n, b))
+				{
+					sum_b += b * angle;
+				}
+			}
+
+			sums.m_tx[v] = sum_t.x; sums.m_ty[v] = sum_t.y; sums.m_tz[v] = sum_t.z;
+			sums.m_bx[v] = sum_b.x; sums.m_by[v] = sum_b.y; sums.m_bz[v] = sum_b.z;
+		}
+	}
+
+	template<typename I>
+	void GenerateTangents(MeshData & mesh, I const * indices, TangentMode mode, util::ThreadPool* thread_pool, util::SIMDLevel level)
+	{
+		auto num_vertices = mesh.m_positions.size();
+		auto num_triangles = mesh.m_num_indices / 3;
+		TangentArrays sums(num_vertices);
+
+		if (mesh.m_uvw.size() >= num_vertices)
+		{
+			TangentArrays faces(num_triangles);
+			ForEachBatch(thread_pool, num_triangles, [&](std::size_t first, std::size_t last)
+			{
+				FaceTangents(mesh.m_positions.data(), mesh.m_uvw.data(), indices, first, last, level, faces);
+			});
+
+			// Corners around every vertex, in triangle order.
+			std::vector<std::uint32_t> corner_offsets(num_vertices + 1, 0);
+			for (std::size_t i = 0; i < num_triangles * 3; i++)
+			{
+				corner_offsets[indices[i] + 1]++;
+			}
+			for (std::size_t v = 0; v < num_vertices; v++)
+			{
+				corner_offsets[v + 1] += corner_offsets[v];
+			}
+			std::vector<std::uint32_t> corners(num_triangles * 3);
+			std::vector<std::uint32_t> fill(corner_offsets.begin(), corner_offsets.end() - 1);
+			for (std::size_t i = 0; i < num_triangles * 3; i++)
+			{
+				corners[fill[indices[i]]++] = static_cast<std::uint32_t>(i);
+			}
+
+			ForEachBatch(thread_pool, num_vertices, [&](std::size_t first, std::size_t last)
+			{
+				SumFaceTangents(mesh, indices, corner_offsets, corners, faces, mode, first, last, sums);
+				Orthonormalize(mesh.m_normals.data(), sums, first, last, level, mesh.m_tangents.data(), mesh.m_bitangents.data());
+			});
+			return;
+		}
+
+		ForEachBatch(thread_pool, num_vertices, [&](std::size_t first, std::size_t last)
+		{
+			Orthonormalize(mesh.m_normals.data(), sums, first, last, level, mesh.m_tangents.data(), mesh.m_bitangents.data());
+		});
+	}
+
+} /* internal */
+
+void TangentGenerator::Generate(MeshData & mesh, TangentMode mode, util::ThreadPool* thread_pool, util::SIMDLevel level)
+{
+	auto num_vertices = mesh.m_positions.size();
+	mesh.m_tangents.assign(num_vertices, glm::vec3(0.f));
+	mesh.m_bitangents.assign(num_vertices, glm::vec3(0.f));
+
+	if (mesh.m_normals.size() < num_vertices)
+	{
+		LOGW("Can't generate tangents for a mesh without normals.");
+		return;
+	}
+
+	level = std::min(level, util::GetSIMDLevel());
+	switch (mesh.m_indices_stride)
+	{
+	case 1: internal::GenerateTangents(mesh, mesh.m_indices.data(), mode, thread_pool, level); break;
+	case 2: internal::GenerateTangents(mesh, reinterpret_cast<std::uint16_t const *>(mesh.m_indices.data()), mode, thread_pool, level); break;
+	default: internal::GenerateTangents(mesh, reinterpret_cast<std::uint32_t const *>(mesh.m_indices.data()), mode, thread_pool, level); break;
+	}
+}
@@ -0,0 +1,40 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "resource_structs.hpp"
+#include "util/simd.hpp"
+#include "util/thread_pool.hpp"
+
+enum class TangentMode
+{
+	// Sum of the unnormalized face tangents of the faces around a vertex, orthonormalized against the normal.
+	// Faces that are large relative to their UV area weigh more.
+	ACCUMULATE,
+	// Face tangents are projected onto the plane of the vertex normal, normalized and weighted by the angle of the
+	// face at the vertex, like MikkTSpace. Matches MikkTSpace for meshes that are split at UV seams and mirrored UVs,
+	// as glTF exporters do. Vertices shared by faces of opposite handedness aren't split but take the dominant one.
+	MIKKTSPACE,
+};
+
+// Number of triangles or vertices processed by a single thread pool task.
+static inline const std::size_t tangent_batch_size = 65536;
+
+struct TangentGenerator
+{
+	// Fills `m_tangents` and `m_bitangents` of `mesh` with an orthonormal frame per vertex. The bitangent is
+	// `cross(normal, tangent)` times the handedness of the UV mapping. Expects unit normals. The result doesn't depend on
+	// the number of threads, and the triangle order and SIMD level only change it by rounding. Vertices without a valid
+	// UV mapping get an arbitrary frame around the normal. Meshes without normals get zero tangents.
+	//
+	// Face tangents are calculated by SIMD kernels, selected by `level` and clamped to what the CPU supports. Faces
+	// and vertices are split into batches of `tangent_batch_size` on `thread_pool` when given.
+	static void Generate(MeshData & mesh, TangentMode mode = TangentMode::ACCUMULATE, util::ThreadPool* thread_pool = nullptr,
+		util::SIMDLevel level = util::GetSIMDLevel());
+};
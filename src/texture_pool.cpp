@@ -6,36 +6,269 @@
 
 #include "texture_pool.hpp"
 
+#include <algorithm>
+
+#include "util/hash.hpp"
+#include "util/log.hpp"
+
 TexturePool::TexturePool()
 	: m_next_id(0)
 {
 
 }
 
-std::uint32_t TexturePool::Load(std::string const& path, bool mipmap, bool srgb)
+std::uint32_t TexturePool::Load(std::string const& path, bool mipmap, bool srgb, TextureRole role)
 {
+	auto flags = GetFlags(mipmap, srgb, role);
+	auto path_key = GetPathKey(path, flags);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (auto entry = FindPath(path_key, path, flags))
+		{
+			m_stats.m_num_hits++;
+			m_stats.m_saved_bytes += entry->m_size;
+			return entry->m_id;
+		}
+	}
+
 	auto extension = path.substr(path.find_last_of('.') + 1);
-	auto new_id = m_next_id;
 
 	for (auto& loader : m_registered_loaders)
 	{
 		if (loader->IsSupportedExtension(extension))
 		{
-			auto texture_data = loader->Load(path);
-			Load_Impl(*texture_data, new_id, mipmap, srgb);
+			// The pixels are released after uploading unless the loader caches them.
+			if (auto texture_data = loader->Load(path))
+			{
+				auto entry = LoadUnique(*texture_data, mipmap, srgb, role);
+
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if (!FindPath(path_key, path, flags))
+				{
+					m_path_cache.insert({ path_key, { path, flags, entry } });
+				}
+				return entry.m_id;
+			}
 			break;
 		}
 	}
 
-	m_next_id++;
-	return new_id;
+	// Failed loads aren't cached.
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_next_id++;
+}
+
+std::uint32_t TexturePool::Load(TextureData const & data, bool mipmap, bool srgb, TextureRole role)
+{
+	return LoadUnique(data, mipmap, srgb, role).m_id;
+}
+
+TexturePoolStats TexturePool::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
+
+void TexturePool::SetProcessorSettings(std::optional<TextureProcessorSettings> const & settings)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_texture_processor = settings.has_value() ? std::make_unique<TextureProcessor>(settings.value()) : nullptr;
+}
+
+std::optional<TextureProcessorStats> TexturePool::GetProcessorStats()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!m_texture_processor)
+	{
+		return std::nullopt;
+	}
+
+	return m_texture_processor->GetStats();
+}
+
+std::uint32_t TexturePool::GetFlags(bool mipmap, bool srgb, TextureRole role)
+{
+	return (mipmap ? 1u : 0u) | (srgb ? 2u : 0u) | (static_cast<std::uint32_t>(role) << 2);
+}
+
+TexturePool::ContentDescription TexturePool::GetContentDescription(TextureData const & data, bool mipmap, bool srgb, TextureRole role)
+{
+	return { data.m_width, data.m_height, data.m_channels, data.m_pixel_channels, data.m_is_hdr ? 1u : 0u, static_cast<std::uint32_t>(data.m_compression),
+		data.m_num_mips, mipmap ? 1u : 0u, srgb ? 1u : 0u, static_cast<std::uint32_t>(role) };
+}
+
+std::pair<void const *, std::size_t> TexturePool::GetPackedPixels(TextureData const & data, std::vector<std::uint8_t> & storage)
+{
+	if (data.m_mip_offsets.empty() || !data.m_pixels)
+	{
+		return { data.m_pixels, data.GetSizeInBytes() };
+	}
+
+	for (std::uint32_t level = 0; level < data.m_num_mips; level++)
+	{
+		auto level_pixels = static_cast<std::uint8_t const *>(data.m_pixels) + data.GetMipOffset(level);
+		storage.insert(storage.end(), level_pixels, level_pixels + data.GetMipSizeInBytes(level));
+	}
+	return { storage.data(), storage.size() };
+}
+
+std::uint64_t TexturePool::GetProcessorCacheKey()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_texture_processor ? m_texture_processor->GetCacheKey() : 0;
+}
+
+std::optional<ProcessedTextureFiles> TexturePool::GetProcessedFiles(TextureData const & data)
+{
+	std::vector<std::uint8_t> packed_storage;
+	auto [pixels, size] = GetPackedPixels(data, packed_storage);
+	auto source_hash = pixels ? util::Hash64(pixels, size) : data.m_source_hash;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto it = m_processed_files.find(source_hash);
+	if (it == m_processed_files.end())
+	{
+		return std::nullopt;
+	}
+
+	return ProcessedTextureFiles{ source_hash, it->second };
+}
+
+std::uint64_t TexturePool::GetPathKey(std::string const & path, std::uint32_t flags)
+{
+	return util::Hash64(path, util::HashValue(flags));
+}
+
+std::uint64_t TexturePool::GetContentKey(std::uint64_t source_hash, ContentDescription const & description)
+{
+	return util::HashValue(description, source_hash);
+}
+
+std::optional<std::uint64_t> TexturePool::GetVerifyHash(void const * pixels, std::size_t size)
+{
+	static constexpr std::uint64_t verify_seed = 0x5bd1e9955bd1e995ULL;
+	return pixels ? std::optional(util::Hash64(pixels, size, verify_seed)) : std::nullopt;
 }
 
-std::uint32_t TexturePool::Load(TextureData const & data, bool mipmap, bool srgb)
+TexturePool::CacheEntry const * TexturePool::FindPath(std::uint64_t path_key, std::string const & path, std::uint32_t flags) const
 {
-	auto new_id = m_next_id;
-	Load_Impl(data, new_id, mipmap, srgb);
+	auto range = m_path_cache.equal_range(path_key);
+	for (auto it = range.first; it != range.second; it++)
+	{
+		if (it->second.m_flags == flags && it->second.m_path == path)
+		{
+			return &it->second.m_entry;
+		}
+	}
+
+	return nullptr;
+}
+
+TexturePool::CacheEntry const * TexturePool::FindContent(std::uint64_t content_key, std::uint64_t source_hash, std::optional<std::uint64_t> verify_hash,
+	ContentDescription const & description) const
+{
+	auto range = m_content_cache.equal_range(content_key);
+	for (auto it = range.first; it != range.second; it++)
+	{
+		auto const & existing = it->second;
+		if (existing.m_description != description || existing.m_source_hash != source_hash)
+		{
+			continue;
+		}
+
+		if (!existing.m_verify_hash || !verify_hash || existing.m_verify_hash == verify_hash)
+		{
+			return &existing.m_entry;
+		}
+	}
+
+	return nullptr;
+}
+
+TexturePool::CacheEntry TexturePool::LoadUnique(TextureData const & data, bool mipmap, bool srgb, TextureRole role)
+{
+	std::vector<std::uint8_t> packed_storage;
+	auto [pixels, pixels_size] = GetPackedPixels(data, packed_storage);
+	auto source_hash = pixels ? util::Hash64(pixels, pixels_size) : data.m_source_hash;
+	auto verify_hash = GetVerifyHash(pixels, pixels_size);
+	auto description = GetContentDescription(data, mipmap, srgb, role);
+	auto content_key = GetContentKey(source_hash, description);
+
+	TextureProcessor* texture_processor;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (auto entry = FindContent(content_key, source_hash, verify_hash, description))
+		{
+			m_stats.m_num_hits++;
+			m_stats.m_saved_bytes += entry->m_size;
+			return *entry;
+		}
+
+		texture_processor = m_texture_processor.get();
+	}
+
+	// Processing is the expensive part, so it doesn't block other loads.
+	std::string cache_path;
+	auto processed = texture_processor ? texture_processor->Process(data, role, mipmap, srgb, &cache_path) : data;
+	auto size = processed.GetSizeInBytes();
+
+	// The processed version of a reference is missing. Failed loads aren't cached.
+	if (!processed.m_pixels && data.m_source_hash != 0)
+	{
+		if (!texture_processor)
+		{
+			LOGW("Can't load a reference to a processed texture without a texture processor");
+		}
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		return { m_next_id++, 0 };
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (!cache_path.empty())
+	{
+		auto& files = m_processed_files[source_hash];
+		if (std::find(files.begin(), files.end(), cache_path) == files.end())
+		{
+			files.push_back(cache_path);
+		}
+	}
+
+	// Another thread may have created the same texture in the meantime.
+	if (auto entry = FindContent(content_key, source_hash, verify_hash, description))
+	{
+		m_stats.m_num_hits++;
+		m_stats.m_saved_bytes += entry->m_size;
+		return *entry;
+	}
+
+	CacheEntry entry = { m_next_id, size };
+	Load_Impl(processed, entry.m_id, mipmap, srgb);
+	m_content_cache.insert({ content_key, { description, source_hash, verify_hash, entry } });
+
+	m_stats.m_num_misses++;
+	m_stats.m_uploaded_bytes += size;
 
 	m_next_id++;
-	return new_id;
-}
\ No newline at end of file
+	return entry;
+}
+
+std::size_t TexturePool::GetLoaderRetainedBytes()
+{
+	std::size_t size = 0;
+	for (auto& loader : m_registered_loaders)
+	{
+		size += loader->GetRetainedBytes();
+	}
+
+	return size;
+}
+
+void TexturePool::SetLoaderCacheBudget(std::size_t num_bytes)
+{
+	for (auto& loader : m_registered_loaders)
+	{
+		loader->SetCacheBudget(num_bytes);
+	}
+}
@@ -6,10 +6,16 @@
 
 #pragma once
 
+#include <array>
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
 
 #include "resource_loader.hpp"
 #include "resource_structs.hpp"
+#include "texture_processor.hpp"
 
 namespace gfx
 {
@@ -17,27 +23,106 @@ namespace gfx
 	class StagingTexture;
 }
 
+struct TexturePoolStats
+{
+	std::uint32_t m_num_hits = 0; // Loads that returned an existing texture.
+	std::uint32_t m_num_misses = 0; // Loads that created a texture.
+	std::size_t m_uploaded_bytes = 0; // Pixels of the created textures as uploaded. Excludes mips generated on the GPU.
+	std::size_t m_saved_bytes = 0; // Pixels that weren't uploaded again because of hits.
+};
+
+// Textures are de-duplicated. Loading a path that was loaded before, or pixels identical to a texture that was loaded
+// before (same dimensions, format, pixels, role and mipmap/srgb flags), returns the ID of the existing texture. Keys are
+// hashes, so path hits compare the path and content hits compare a second, independent hash of the pixels. The pixels
+// aren't kept, so they can be released after uploading.
 class TexturePool
 {
 public:
 	TexturePool();
 	virtual ~TexturePool() = default;
 
-	std::uint32_t Load(std::string const & path, bool mipmap, bool srgb = false);
-	std::uint32_t Load(TextureData const & data, bool mipmap, bool srgb = false);
+	std::uint32_t Load(std::string const & path, bool mipmap, bool srgb = false, TextureRole role = TextureRole::COLOR);
+	std::uint32_t Load(TextureData const & data, bool mipmap, bool srgb = false, TextureRole role = TextureRole::COLOR);
 
 	virtual void Stage(gfx::CommandList* command_list) = 0;
 	virtual void PostStage() = 0;
 	virtual std::vector<gfx::StagingTexture*> GetTextures(std::vector<std::uint32_t> texture_handles) = 0;
 
+	TexturePoolStats GetStats();
+
+	// Textures are processed before uploading when set: mips are generated on the CPU and textures are block
+	// compressed by role. Textures are uploaded as they are by default. Don't call while textures are loading.
+	void SetProcessorSettings(std::optional<TextureProcessorSettings> const & settings);
+	std::optional<TextureProcessorStats> GetProcessorStats();
+	// Identifies the processed textures this pool loads from the processor cache, see `TextureProcessor::GetCacheKey`.
+	// 0 when textures aren't processed or the processor has no cache.
+	std::uint64_t GetProcessorCacheKey();
+	// Files in the processor cache that loads of `data` processed it into or read it from. std::nullopt when `data`
+	// wasn't loaded through the processor cache. Textures with these files can be loaded as references, without pixels.
+	std::optional<ProcessedTextureFiles> GetProcessedFiles(TextureData const & data);
+
 	template<typename T>
 	static void RegisterLoader();
+	// Bytes of textures kept alive by the caches of the registered loaders.
+	static std::size_t GetLoaderRetainedBytes();
+	// Per loader. 0 (the default) releases textures as soon as they are uploaded.
+	static void SetLoaderCacheBudget(std::size_t num_bytes);
 
 private:
 	virtual void Load_Impl(TextureData const & data, std::uint32_t id, bool mipmap, bool srgb) = 0;
 
+	struct CacheEntry
+	{
+		std::uint32_t m_id;
+		std::size_t m_size;
+	};
+
+	using ContentDescription = std::array<std::uint32_t, 10>;
+
+	struct PathEntry
+	{
+		std::string m_path;
+		std::uint32_t m_flags;
+		CacheEntry m_entry;
+	};
+
+	struct ContentEntry
+	{
+		ContentDescription m_description;
+		std::uint64_t m_source_hash;
+		std::optional<std::uint64_t> m_verify_hash; // std::nullopt for textures loaded from a reference.
+		CacheEntry m_entry;
+	};
+
+	static std::uint32_t GetFlags(bool mipmap, bool srgb, TextureRole role);
+	static ContentDescription GetContentDescription(TextureData const & data, bool mipmap, bool srgb, TextureRole role);
+	// Copies the mip levels of `data` into `storage` when they aren't tightly packed.
+	static std::pair<void const *, std::size_t> GetPackedPixels(TextureData const & data, std::vector<std::uint8_t> & storage);
+	static std::uint64_t GetPathKey(std::string const & path, std::uint32_t flags);
+	static std::uint64_t GetContentKey(std::uint64_t source_hash, ContentDescription const & description);
+	// Hash of the tightly packed source pixels with another seed than the source hash, std::nullopt without pixels.
+	static std::optional<std::uint64_t> GetVerifyHash(void const * pixels, std::size_t size);
+
+	// Expects `m_mutex` to be locked. nullptr on a miss.
+	CacheEntry const * FindPath(std::uint64_t path_key, std::string const & path, std::uint32_t flags) const;
+	// Expects `m_mutex` to be locked. nullptr on a miss. Textures loaded from a reference only have the source hash
+	// to compare.
+	CacheEntry const * FindContent(std::uint64_t content_key, std::uint64_t source_hash, std::optional<std::uint64_t> verify_hash,
+		ContentDescription const & description) const;
+
+	// Returns the texture with the same contents as `data` or processes and creates it.
+	CacheEntry LoadUnique(TextureData const & data, bool mipmap, bool srgb, TextureRole role);
+
 	std::uint32_t m_next_id;
 
+	std::unordered_multimap<std::uint64_t, PathEntry> m_path_cache;
+	std::unordered_multimap<std::uint64_t, ContentEntry> m_content_cache;
+	std::unordered_map<std::uint64_t, std::vector<std::string>> m_processed_files; // By source hash.
+	TexturePoolStats m_stats;
+	std::mutex m_mutex;
+
+	std::unique_ptr<TextureProcessor> m_texture_processor;
+
 	inline static std::vector<ResourceLoader<TextureData>*> m_registered_loaders = {};
 };
 
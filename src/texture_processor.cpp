@@ -0,0 +1,498 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "texture_processor.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <glm.hpp>
+
+#include "block_compression.hpp"
+#include "util/hash.hpp"
+#include "util/log.hpp"
+#include "util/mapped_file.hpp"
+
+namespace internal
+{
+
+	// Header of a processed texture in the cache, followed by the pixels of all mip levels.
+	struct ProcessedTextureHeader
+	{
+		static inline const std::uint32_t magic = 0x58544B53; // "SKTX"
+		static inline const std::uint32_t version = 2;
+
+		std::uint32_t m_magic = magic;
+		std::uint32_t m_version = version;
+		std::uint64_t m_key = 0;
+		std::uint32_t m_width = 0;
+		std::uint32_t m_height = 0;
+		std::uint32_t m_channels = 0;
+		std::uint32_t m_is_hdr = 0;
+		std::uint32_t m_compression = 0;
+		std::uint32_t m_num_mips = 0;
+		std::uint64_t m_size = 0;
+	};
+
+	// Grey pixels are replicated to RGB with an opaque alpha.
+	inline TextureData ExpandToRGBA(TextureData const & texture)
+	{
+		TextureData result = texture;
+		result.m_pixel_channels = 4;
+		auto num_pixels = static_cast<std::size_t>(texture.m_width) * texture.m_height;
+		auto source = static_cast<std::uint8_t const *>(texture.m_pixels);
+		auto target = static_cast<std::uint8_t*>(result.AllocatePixels(num_pixels * 4));
+		for (std::size_t i = 0; i < num_pixels; i++)
+		{
+			target[i * 4 + 0] = target[i * 4 + 1] = target[i * 4 + 2] = source[i];
+			target[i * 4 + 3] = 255;
+		}
+
+		return result;
+	}
+
+	// Number of pixel rows of a mip level filtered by a single thread pool task.
+	static constexpr std::uint32_t mip_batch_size = 64;
+
+	inline std::uint32_t GetNumMips(std::uint32_t width, std::uint32_t height)
+	{
+		// Matches the mip count of textures with mips generated on the GPU.
+		auto num_mips = static_cast<std::uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+		return std::clamp(num_mips, 1u, 16u);
+	}
+
+	inline float SRGBToLinear(float value)
+	{
+		return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+	}
+
+	inline float LinearToSRGB(float value)
+	{
+		return value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.f / 2.4f) - 0.055f;
+	}
+
+	// Calls `function(first, last)` for batches of `batch_size` of `count` items on `thread_pool`, or once when no thread pool is given.
+	template<typename F>
+	inline void ParallelFor(util::ThreadPool* thread_pool, std::uint32_t count, std::uint32_t batch_size, F const & function)
+	{
+		if (!thread_pool || count <= batch_size)
+		{
+			function(0u, count);
+			return;
+		}
+
+		std::vector<std::future<void>> futures;
+		for (std::uint32_t first = 0; first < count; first += batch_size)
+		{
+			auto last = std::min(first + batch_size, count);
+			futures.emplace_back(thread_pool->Enqueue([&function, first, last]()
+			{
+				function(first, last);
+			}));
+		}
+
+		for (auto& future : futures)
+		{
+			future.get();
+		}
+	}
+
+	// Decodes RGBA8 or RGBA32F pixels into linear values. Normals are decoded to -1..1.
+	inline std::vector<glm::vec4> DecodePixels(TextureData const & texture, bool srgb, bool normal_map)
+	{
+		std::vector<glm::vec4> pixels(static_cast<std::size_t>(texture.m_width) * texture.m_height);
+
+		if (texture.m_is_hdr)
+		{
+			memcpy(pixels.data(), texture.m_pixels, pixels.size() * sizeof(glm::vec4));
+			return pixels;
+		}
+
+		float srgb_table[256];
+		for (auto i = 0; i < 256; i++)
+		{
+			srgb_table[i] = SRGBToLinear(i / 255.f);
+		}
+
+		auto bytes = static_cast<std::uint8_t const *>(texture.m_pixels);
+		for (std::size_t i = 0; i < pixels.size(); i++)
+		{
+			for (auto c = 0; c < 4; c++)
+			{
+				auto value = bytes[i * 4 + c];
+				if (normal_map && c < 3)
+				{
+					pixels[i][c] = value / 255.f * 2.f - 1.f;
+				}
+				else
+				{
+					pixels[i][c] = srgb && c < 3 ? srgb_table[value] : value / 255.f;
+				}
+			}
+		}
+
+		return pixels;
+	}
+
+	inline void EncodePixels(glm::vec4 const * pixels, std::size_t num_pixels, bool is_hdr, bool srgb, bool normal_map, std::uint8_t* target)
+	{
+		if (is_hdr)
+		{
+			memcpy(target, pixels, num_pixels * sizeof(glm::vec4));
+			return;
+		}
+
+		for (std::size_t i = 0; i < num_pixels; i++)
+		{
+			for (auto c = 0; c < 4; c++)
+			{
+				auto value = pixels[i][c];
+				if (normal_map && c < 3)
+				{
+					value = value * 0.5f + 0.5f;
+				}
+				else if (srgb && c < 3)
+				{
+					value = LinearToSRGB(value);
+				}
+
+				target[i * 4 + c] = static_cast<std::uint8_t>(std::lround(std::clamp(value, 0.f, 1.f) * 255.f));
+			}
+		}
+	}
+
+	// Averages 2x2 pixels of rows `first` up to `last` of the next level. Odd sizes repeat the last row and column.
+	inline void Downsample(glm::vec4 const * source, std::uint32_t source_width, std::uint32_t source_height, glm::vec4* target,
+		std::uint32_t target_width, std::uint32_t first, std::uint32_t last, bool normal_map)
+	{
+		for (auto y = first; y < last; y++)
+		{
+			auto y0 = std::min(y * 2, source_height - 1);
+			auto y1 = std::min(y * 2 + 1, source_height - 1);
+			for (std::uint32_t x = 0; x < target_width; x++)
+			{
+				auto x0 = std::min(x * 2, source_width - 1);
+				auto x1 = std::min(x * 2 + 1, source_width - 1);
+
+				auto value = (source[y0 * source_width + x0] + source[y0 * source_width + x1] + source[y1 * source_width + x0] + source[y1 * source_width + x1]) * 0.25f;
+				if (normal_map)
+				{
+					auto normal = glm::vec3(value);
+					auto length = glm::length(normal);
+					value = glm::vec4(length > 0 ? normal / length : glm::vec3(0, 0, 1), value.w);
+				}
+
+				target[static_cast<std::size_t>(y) * target_width + x] = value;
+			}
+		}
+	}
+
+} /* internal */
+
+TextureProcessor::TextureProcessor(TextureProcessorSettings const & settings)
+	: m_settings(settings), m_thread_pool(nullptr)
+{
+	auto num_threads = m_settings.m_num_threads;
+	if (num_threads == 0)
+	{
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	if (num_threads > 1)
+	{
+		m_thread_pool = new util::ThreadPool(num_threads);
+	}
+}
+
+TextureProcessor::~TextureProcessor()
+{
+	delete m_thread_pool;
+}
+
+TextureData TextureProcessor::Process(TextureData const & texture, TextureRole role, bool mipmap, bool srgb, std::string* cache_path)
+{
+	if (!texture.HasContents() || texture.m_compression != TextureCompression::NONE || texture.m_num_mips > 1)
+	{
+		return texture;
+	}
+
+	bool compress = m_settings.m_compress && !texture.m_is_hdr;
+	if (!compress && !mipmap)
+	{
+		return texture;
+	}
+
+	auto key = GetKey(texture, role, mipmap, srgb);
+
+	TextureData processed;
+	if (LoadFromCache(key, processed))
+	{
+		if (cache_path)
+		{
+			*cache_path = GetCachePath(key);
+		}
+
+		std::lock_guard<std::mutex> lock(m_stats_mutex);
+		m_stats.m_num_cache_hits++;
+		m_stats.m_input_bytes += texture.GetSizeInBytes();
+		m_stats.m_output_bytes += processed.GetSizeInBytes();
+		return processed;
+	}
+
+	if (!texture.m_pixels)
+	{
+		LOGW("Processed texture {} is missing", GetCachePath(key));
+		return texture;
+	}
+
+	if (m_settings.m_cache_only)
+	{
+		return texture;
+	}
+
+	auto start = std::chrono::steady_clock::now();
+
+	// Mips are filtered and blocks are compressed from RGBA8.
+	auto rgba = texture.m_is_hdr || texture.m_pixel_channels == 4 ? texture : internal::ExpandToRGBA(texture);
+
+	bool color = role == TextureRole::COLOR || role == TextureRole::COLOR_OPAQUE;
+	processed = mipmap ? GenerateMips(rgba, srgb && color, role == TextureRole::NORMAL, m_thread_pool) : rgba;
+	if (compress)
+	{
+		processed = Compress(processed, GetCompression(role), m_thread_pool);
+	}
+
+	auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	double num_pixels = 0;
+	for (std::uint32_t level = 0; level < processed.m_num_mips; level++)
+	{
+		num_pixels += static_cast<double>(processed.GetMipWidth(level)) * processed.GetMipHeight(level);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_stats_mutex);
+		m_stats.m_num_processed++;
+		m_stats.m_megapixels += num_pixels / 1e6;
+		m_stats.m_seconds += seconds;
+		m_stats.m_input_bytes += texture.GetSizeInBytes();
+		m_stats.m_output_bytes += processed.GetSizeInBytes();
+	}
+
+	if (WriteToCache(key, processed) && cache_path)
+	{
+		*cache_path = GetCachePath(key);
+	}
+
+	return processed;
+}
+
+TextureProcessorSettings const & TextureProcessor::GetSettings() const
+{
+	return m_settings;
+}
+
+std::uint64_t TextureProcessor::GetCacheKey() const
+{
+	if (m_settings.m_cache_directory.empty())
+	{
+		return 0;
+	}
+
+	std::uint32_t description[] = { internal::ProcessedTextureHeader::version, m_settings.m_compress ? 1u : 0u };
+	return util::Hash64(m_settings.m_cache_directory, util::HashValue(description));
+}
+
+TextureProcessorStats TextureProcessor::GetStats()
+{
+	std::lock_guard<std::mutex> lock(m_stats_mutex);
+	return m_stats;
+}
+
+TextureCompression TextureProcessor::GetCompression(TextureRole role)
+{
+	switch (role)
+	{
+	case TextureRole::COLOR_OPAQUE: return TextureCompression::BC1;
+	case TextureRole::NORMAL: return TextureCompression::BC5;
+	case TextureRole::SINGLE_CHANNEL: return TextureCompression::BC4;
+	default: return TextureCompression::BC7;
+	}
+}
+
+TextureData TextureProcessor::GenerateMips(TextureData const & texture, bool srgb, bool normal_map, util::ThreadPool* thread_pool)
+{
+	TextureData result = texture;
+	result.m_num_mips = internal::GetNumMips(texture.m_width, texture.m_height);
+	result.m_mip_offsets.clear();
+	auto target = static_cast<std::uint8_t*>(result.AllocatePixels(result.GetMipOffset(result.m_num_mips)));
+
+	// Level 0 is copied as is, so it doesn't lose precision to the round trip through linear space.
+	memcpy(target, texture.m_pixels, result.GetMipSizeInBytes(0));
+
+	auto level = internal::DecodePixels(texture, srgb, normal_map);
+	std::vector<glm::vec4> next_level;
+	for (std::uint32_t i = 1; i < result.m_num_mips; i++)
+	{
+		auto source_width = result.GetMipWidth(i - 1);
+		auto source_height = result.GetMipHeight(i - 1);
+		auto width = result.GetMipWidth(i);
+		auto height = result.GetMipHeight(i);
+
+		next_level.resize(static_cast<std::size_t>(width) * height);
+		internal::ParallelFor(thread_pool, height, internal::mip_batch_size, [&](std::uint32_t first, std::uint32_t last)
+		{
+			internal::Downsample(level.data(), source_width, source_height, next_level.data(), width, first, last, normal_map);
+			internal::EncodePixels(next_level.data() + static_cast<std::size_t>(first) * width, static_cast<std::size_t>(last - first) * width,
+				texture.m_is_hdr, srgb, normal_map, target + result.GetMipOffset(i) + static_cast<std::size_t>(first) * width * (texture.m_is_hdr ? 16 : 4));
+		});
+
+		std::swap(level, next_level);
+	}
+
+	return result;
+}
+
+TextureData TextureProcessor::Compress(TextureData const & texture, TextureCompression compression, util::ThreadPool* thread_pool)
+{
+	if (texture.m_is_hdr || texture.m_pixel_channels != 4 || texture.m_compression != TextureCompression::NONE || compression == TextureCompression::NONE)
+	{
+		LOGW("Only uncompressed RGBA8 textures can be compressed.");
+		return texture;
+	}
+
+	TextureData result = texture;
+	result.m_compression = compression;
+	result.m_mip_offsets.clear();
+	auto target = static_cast<std::uint8_t*>(result.AllocatePixels(result.GetMipOffset(result.m_num_mips)));
+	auto source = static_cast<std::uint8_t const *>(texture.m_pixels);
+
+	for (std::uint32_t level = 0; level < texture.m_num_mips; level++)
+	{
+		auto width = texture.GetMipWidth(level);
+		auto height = texture.GetMipHeight(level);
+		auto level_source = source + texture.GetMipOffset(level);
+		auto level_target = target + result.GetMipOffset(level);
+
+		internal::ParallelFor(thread_pool, (height + 3) / 4, texture_compression_batch_size, [&](std::uint32_t first, std::uint32_t last)
+		{
+			BlockCompression::Compress(compression, level_source, width, height, level_target, first, last - first);
+		});
+	}
+
+	return result;
+}
+
+std::uint64_t TextureProcessor::GetKey(TextureData const & texture, TextureRole role, bool mipmap, bool srgb) const
+{
+	std::uint32_t description[] = { internal::ProcessedTextureHeader::version, texture.m_width, texture.m_height, texture.m_channels, texture.m_pixel_channels,
+		texture.m_is_hdr ? 1u : 0u, static_cast<std::uint32_t>(role), mipmap ? 1u : 0u, srgb ? 1u : 0u, m_settings.m_compress ? 1u : 0u };
+	// Only textures with a single level are processed, so their pixels are tightly packed.
+	auto source_hash = texture.m_pixels ? util::Hash64(texture.m_pixels, texture.GetSizeInBytes()) : texture.m_source_hash;
+	return util::HashValue(description, source_hash);
+}
+
+std::string TextureProcessor::GetCachePath(std::uint64_t key) const
+{
+	return (std::filesystem::path(m_settings.m_cache_directory) / fmt::format("{:016x}.sktx", key)).generic_string();
+}
+
+bool TextureProcessor::LoadFromCache(std::uint64_t key, TextureData& texture) const
+{
+	if (m_settings.m_cache_directory.empty())
+	{
+		return false;
+	}
+
+	auto file = std::make_shared<util::MappedFile>(GetCachePath(key));
+	if (!file->IsOpen() || file->GetSize() < sizeof(internal::ProcessedTextureHeader))
+	{
+		return false;
+	}
+
+	internal::ProcessedTextureHeader header;
+	memcpy(&header, file->GetData(), sizeof(header));
+	if (header.m_magic != internal::ProcessedTextureHeader::magic || header.m_version != internal::ProcessedTextureHeader::version
+		|| header.m_key != key || header.m_compression > static_cast<std::uint32_t>(TextureCompression::BC3) || header.m_num_mips == 0 || header.m_num_mips > 16)
+	{
+		return false;
+	}
+
+	TextureData result;
+	result.m_width = header.m_width;
+	result.m_height = header.m_height;
+	result.m_channels = header.m_channels;
+	result.m_is_hdr = header.m_is_hdr != 0;
+	result.m_compression = static_cast<TextureCompression>(header.m_compression);
+	result.m_num_mips = header.m_num_mips;
+	if (header.m_size != result.GetMipOffset(result.m_num_mips) || header.m_size != file->GetSize() - sizeof(header))
+	{
+		LOGW("Ignoring corrupt processed texture {}", GetCachePath(key));
+		return false;
+	}
+
+	// The pixels are used from the mapping directly. The file stays mapped while the texture is alive.
+	result.m_pixels = const_cast<std::uint8_t*>(file->GetData() + sizeof(header));
+	result.m_pixel_storage = std::shared_ptr<void>(file, result.m_pixels);
+
+	texture = std::move(result);
+	return true;
+}
+
+bool TextureProcessor::WriteToCache(std::uint64_t key, TextureData const & texture) const
+{
+	if (m_settings.m_cache_directory.empty())
+	{
+		return false;
+	}
+
+	namespace fs = std::filesystem;
+
+	internal::ProcessedTextureHeader header;
+	header.m_key = key;
+	header.m_width = texture.m_width;
+	header.m_height = texture.m_height;
+	header.m_channels = texture.m_channels;
+	header.m_is_hdr = texture.m_is_hdr ? 1 : 0;
+	header.m_compression = static_cast<std::uint32_t>(texture.m_compression);
+	header.m_num_mips = texture.m_num_mips;
+	header.m_size = texture.GetSizeInBytes();
+
+	std::error_code error;
+	fs::create_directories(m_settings.m_cache_directory, error);
+
+	// Written to a temporary file that is renamed, so readers never see partially written textures. Unique per thread,
+	// since a texture can be processed by concurrent loads.
+	auto cache_path = GetCachePath(key);
+	auto temp_path = cache_path + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+	{
+		std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<char const *>(&header), sizeof(header));
+		file.write(static_cast<char const *>(texture.m_pixels), header.m_size);
+
+		if (!file)
+		{
+			LOGW("Failed to write processed texture {}", cache_path);
+			file.close();
+			fs::remove(temp_path, error);
+			return false;
+		}
+	}
+
+	fs::rename(temp_path, cache_path, error);
+	if (error)
+	{
+		LOGW("Failed to write processed texture {}: {}", cache_path, error.message());
+		fs::remove(temp_path, error);
+		return false;
+	}
+
+	return true;
+}
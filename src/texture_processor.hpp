@@ -0,0 +1,100 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "resource_structs.hpp"
+#include "util/thread_pool.hpp"
+
+// What a texture contains, which decides its compression.
+enum class TextureRole
+{
+	COLOR, // RGBA, BC7. Also used for packed data such as occlusion/roughness/metallic.
+	COLOR_OPAQUE, // RGB, BC1.
+	NORMAL, // Tangent space normal in RG, BC5. The shaders reconstruct Z.
+	SINGLE_CHANNEL, // R, BC4.
+};
+
+// Number of block rows compressed by a single thread pool task.
+static inline const std::uint32_t texture_compression_batch_size = 16;
+
+struct TextureProcessorSettings
+{
+	// HDR textures only get mips, since BC6H isn't supported.
+	bool m_compress = true;
+	// Textures are processed on the calling thread when 1, 0 uses all hardware threads.
+	std::uint32_t m_num_threads = 0;
+	// Processed textures are stored in and loaded from this directory. Empty disables the cache.
+	std::string m_cache_directory;
+	// Only loads textures that were processed before, such as by the asset cooker. Others are returned as is.
+	bool m_cache_only = false;
+};
+
+struct TextureProcessorStats
+{
+	std::uint32_t m_num_processed = 0;
+	std::uint32_t m_num_cache_hits = 0;
+	double m_megapixels = 0; // Pixels of all generated mip levels. Excludes cache hits.
+	double m_seconds = 0; // Time spent generating mips and compressing.
+	std::size_t m_input_bytes = 0; // Size of the source textures. Includes cache hits.
+	std::size_t m_output_bytes = 0; // Size of the processed textures, including mips. Includes cache hits.
+
+	double GetMegapixelsPerSecond() const
+	{
+		return m_seconds > 0 ? m_megapixels / m_seconds : 0;
+	}
+};
+
+// Generates mip chains on the CPU and block compresses textures by role before they are uploaded.
+// Processed textures are cached on disc, keyed by the hash of the pixels, the role and the flags.
+class TextureProcessor
+{
+public:
+	explicit TextureProcessor(TextureProcessorSettings const & settings = {});
+	~TextureProcessor();
+
+	TextureProcessor(TextureProcessor const &) = delete;
+	TextureProcessor& operator=(TextureProcessor const &) = delete;
+
+	// Generates mips when `mipmap` is set and compresses by `role`. Mips of color textures are filtered in linear
+	// space when `srgb` is set. Textures that are compressed or have mips already are returned as is. Textures that
+	// reference their processed version by `TextureData::m_source_hash` are only loaded from the cache, and returned
+	// without pixels when it isn't there. `cache_path` is set to the file of the processed texture when it is cached.
+	// Textures missing from the cache are returned as is when `TextureProcessorSettings::m_cache_only` is set.
+	// Safe to call from multiple threads.
+	TextureData Process(TextureData const & texture, TextureRole role, bool mipmap, bool srgb, std::string* cache_path = nullptr);
+
+	TextureProcessorSettings const & GetSettings() const;
+	// Identifies the processed textures in the cache: the settings that change them and the cache directory. 0 when
+	// there is no cache.
+	std::uint64_t GetCacheKey() const;
+	TextureProcessorStats GetStats();
+
+	static TextureCompression GetCompression(TextureRole role);
+
+	// Full mip chain of a RGBA8 or RGBA32F texture with a single level. Every level averages 2x2 pixels of the previous
+	// level. RGB is decoded from sRGB first when `srgb` is set and normal maps are renormalized.
+	static TextureData GenerateMips(TextureData const & texture, bool srgb, bool normal_map, util::ThreadPool* thread_pool = nullptr);
+	// Compresses every mip level of a RGBA8 texture. Block rows are compressed in batches of
+	// `texture_compression_batch_size` on `thread_pool` when given.
+	static TextureData Compress(TextureData const & texture, TextureCompression compression, util::ThreadPool* thread_pool = nullptr);
+
+private:
+	std::uint64_t GetKey(TextureData const & texture, TextureRole role, bool mipmap, bool srgb) const;
+	std::string GetCachePath(std::uint64_t key) const;
+	bool LoadFromCache(std::uint64_t key, TextureData& texture) const;
+	bool WriteToCache(std::uint64_t key, TextureData const & texture) const;
+
+	TextureProcessorSettings m_settings;
+	util::ThreadPool* m_thread_pool;
+
+	TextureProcessorStats m_stats;
+	std::mutex m_stats_mutex;
+};
@@ -0,0 +1,244 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "texture_residency_manager.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "util/log.hpp"
+
+namespace internal
+{
+
+	static inline const std::uint32_t no_request = std::numeric_limits<std::uint32_t>::max();
+
+} /* internal */
+
+TextureResidencyManager::TextureResidencyManager(TextureResidencySettings const & settings)
+	: m_settings(settings), m_frame(0)
+{
+}
+
+std::uint32_t TextureResidencyManager::Register(std::uint32_t id, std::uint32_t width, std::uint32_t height, std::vector<std::size_t> const & mip_sizes)
+{
+	if (mip_sizes.empty())
+	{
+		LOGE("Can't stream a texture without mip levels.");
+		return 0;
+	}
+
+	if (auto it = m_textures.find(id); it != m_textures.end())
+	{
+		return it->second.m_resident_mip;
+	}
+
+	Texture texture;
+	texture.m_width = width;
+	texture.m_height = height;
+	texture.m_requested_mip = internal::no_request;
+	texture.m_last_request_frame = m_frame;
+
+	auto num_mips = static_cast<std::uint32_t>(mip_sizes.size());
+	texture.m_sizes.resize(num_mips);
+	std::size_t size = 0;
+	for (auto level = num_mips; level-- > 0;)
+	{
+		size += mip_sizes[level];
+		texture.m_sizes[level] = size;
+	}
+
+	texture.m_base_mip = 0;
+	while (texture.m_base_mip + 1 < num_mips && std::max(width >> texture.m_base_mip, height >> texture.m_base_mip) > m_settings.m_base_size)
+	{
+		texture.m_base_mip++;
+	}
+	texture.m_resident_mip = texture.m_base_mip;
+	texture.m_target_mip = texture.m_base_mip;
+
+	m_stats.m_num_textures++;
+	m_stats.m_resident_bytes += texture.m_sizes[texture.m_base_mip];
+	m_stats.m_full_bytes += texture.m_sizes[0];
+
+	m_textures.insert({ id, std::move(texture) });
+	return m_textures[id].m_resident_mip;
+}
+
+bool TextureResidencyManager::IsRegistered(std::uint32_t id) const
+{
+	return m_textures.find(id) != m_textures.end();
+}
+
+void TextureResidencyManager::Request(std::uint32_t id, std::uint32_t mip)
+{
+	auto it = m_textures.find(id);
+	if (it == m_textures.end())
+	{
+		return;
+	}
+
+	auto& texture = it->second;
+	if (texture.m_last_request_frame != m_frame)
+	{
+		texture.m_requested_mip = internal::no_request;
+	}
+
+	auto max_mip = static_cast<std::uint32_t>(texture.m_sizes.size()) - 1;
+	texture.m_requested_mip = std::min({ texture.m_requested_mip, mip, max_mip });
+	texture.m_last_request_frame = m_frame;
+}
+
+void TextureResidencyManager::RequestScreenSize(std::uint32_t id, float screen_size)
+{
+	if (auto it = m_textures.find(id); it != m_textures.end())
+	{
+		auto const & texture = it->second;
+		Request(id, GetMipForScreenSize(texture.m_width, texture.m_height, static_cast<std::uint32_t>(texture.m_sizes.size()), screen_size));
+	}
+}
+
+std::vector<TextureResidencyChange> TextureResidencyManager::Update()
+{
+	std::vector<TextureResidencyChange> changes;
+
+	// Textures that were requested with more detail than they have. Larger deficits are loaded first.
+	std::vector<std::pair<std::uint32_t, Texture*>> loads;
+	for (auto& [id, texture] : m_textures)
+	{
+		if (texture.m_last_request_frame == m_frame && texture.m_requested_mip < texture.m_target_mip
+			&& texture.m_resident_mip == texture.m_target_mip)
+		{
+			loads.emplace_back(id, &texture);
+		}
+	}
+
+	std::sort(loads.begin(), loads.end(), [](auto const & a, auto const & b)
+	{
+		auto deficit_a = a.second->m_target_mip - a.second->m_requested_mip;
+		auto deficit_b = b.second->m_target_mip - b.second->m_requested_mip;
+		return deficit_a != deficit_b ? deficit_a > deficit_b : a.first < b.first;
+	});
+
+	std::size_t upload_bytes = 0;
+	for (auto& [id, texture] : loads)
+	{
+		auto mip = texture->m_requested_mip;
+		if (upload_bytes > 0 && upload_bytes + texture->m_sizes[mip] > m_settings.m_max_bytes_per_update)
+		{
+			break;
+		}
+
+		auto current_size = texture->m_sizes[texture->m_target_mip];
+		while (m_stats.m_resident_bytes + texture->m_sizes[mip] - current_size > m_settings.m_budget && EvictLeastRecentlyRequested(changes))
+		{
+		}
+
+		// Load as much detail as fits when nothing else can be evicted.
+		while (mip < texture->m_target_mip && m_stats.m_resident_bytes + texture->m_sizes[mip] - current_size > m_settings.m_budget)
+		{
+			mip++;
+		}
+		if (mip == texture->m_target_mip)
+		{
+			continue;
+		}
+
+		texture->m_target_mip = mip;
+		m_stats.m_resident_bytes += texture->m_sizes[mip] - current_size;
+		m_stats.m_num_pending++;
+		m_stats.m_num_loads++;
+		upload_bytes += texture->m_sizes[mip];
+
+		changes.push_back({ id, mip, false });
+	}
+
+	m_frame++;
+	return changes;
+}
+
+bool TextureResidencyManager::EvictLeastRecentlyRequested(std::vector<TextureResidencyChange>& changes)
+{
+	std::uint32_t victim_id = 0;
+	Texture* victim = nullptr;
+	for (auto& [id, texture] : m_textures)
+	{
+		if (texture.m_last_request_frame == m_frame || texture.m_target_mip >= texture.m_base_mip || texture.m_resident_mip != texture.m_target_mip)
+		{
+			continue;
+		}
+
+		if (!victim || texture.m_last_request_frame < victim->m_last_request_frame
+			|| (texture.m_last_request_frame == victim->m_last_request_frame && id < victim_id))
+		{
+			victim_id = id;
+			victim = &texture;
+		}
+	}
+
+	if (!victim)
+	{
+		return false;
+	}
+
+	m_stats.m_resident_bytes -= victim->m_sizes[victim->m_target_mip] - victim->m_sizes[victim->m_base_mip];
+	m_stats.m_num_pending++;
+	m_stats.m_num_evictions++;
+	victim->m_target_mip = victim->m_base_mip;
+
+	changes.push_back({ victim_id, victim->m_base_mip, true });
+	return true;
+}
+
+void TextureResidencyManager::Complete(std::uint32_t id)
+{
+	auto it = m_textures.find(id);
+	if (it == m_textures.end() || it->second.m_resident_mip == it->second.m_target_mip)
+	{
+		LOGW("Completed a texture residency change that isn't pending.");
+		return;
+	}
+
+	it->second.m_resident_mip = it->second.m_target_mip;
+	m_stats.m_num_pending--;
+}
+
+std::uint32_t TextureResidencyManager::GetResidentMip(std::uint32_t id) const
+{
+	if (auto it = m_textures.find(id); it != m_textures.end())
+	{
+		return it->second.m_resident_mip;
+	}
+
+	return 0;
+}
+
+TextureResidencyStats TextureResidencyManager::GetStats() const
+{
+	return m_stats;
+}
+
+TextureResidencySettings const & TextureResidencyManager::GetSettings() const
+{
+	return m_settings;
+}
+
+std::uint32_t TextureResidencyManager::GetMipForScreenSize(std::uint32_t width, std::uint32_t height, std::uint32_t num_mips, float screen_size)
+{
+	auto max_mip = num_mips > 0 ? num_mips - 1 : 0;
+	if (screen_size <= 1.f)
+	{
+		return max_mip;
+	}
+
+	auto ratio = static_cast<float>(std::max(width, height)) / screen_size;
+	if (ratio <= 1.f)
+	{
+		return 0;
+	}
+
+	return std::min(static_cast<std::uint32_t>(std::floor(std::log2(ratio))), max_mip);
+}
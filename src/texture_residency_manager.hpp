@@ -0,0 +1,97 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+struct TextureResidencySettings
+{
+	// Bytes of the resident mip levels of all textures. The levels that are always resident can exceed it.
+	std::size_t m_budget = 512ull * 1024 * 1024;
+	// Levels with a width and height of at most this many pixels are always resident.
+	std::uint32_t m_base_size = 64;
+	// Bytes of the textures that are (re)uploaded by a single update. The first change of an update always fits.
+	std::size_t m_max_bytes_per_update = 64ull * 1024 * 1024;
+};
+
+// A texture that needs to be (re)created with the levels from `m_first_mip` up resident.
+struct TextureResidencyChange
+{
+	std::uint32_t m_id;
+	std::uint32_t m_first_mip;
+	bool m_evict; // Higher levels are dropped rather than loaded.
+};
+
+struct TextureResidencyStats
+{
+	std::uint32_t m_num_textures = 0;
+	std::uint32_t m_num_pending = 0; // Changes that haven't completed yet.
+	std::uint32_t m_num_loads = 0;
+	std::uint32_t m_num_evictions = 0;
+	std::size_t m_resident_bytes = 0; // Includes the levels of pending changes.
+	std::size_t m_full_bytes = 0; // Size of all textures with every level resident.
+};
+
+// Decides which mip levels of streamed textures are resident, within a byte budget. Textures start with only their
+// base levels resident (see `m_base_size`). Higher levels are requested every frame from feedback such as the screen
+// space size of the meshes that use a texture. `Update` turns the requests into changes and evicts the least recently
+// requested textures down to their base levels when the budget is exceeded.
+//
+// Doesn't touch the GPU: the caller applies the changes, asynchronously, and reports them with `Complete`. A texture
+// has at most one pending change. Not thread safe.
+class TextureResidencyManager
+{
+public:
+	explicit TextureResidencyManager(TextureResidencySettings const & settings = {});
+
+	// Returns the first resident level. `mip_sizes` are the sizes of the levels in bytes, largest first.
+	std::uint32_t Register(std::uint32_t id, std::uint32_t width, std::uint32_t height, std::vector<std::size_t> const & mip_sizes);
+	bool IsRegistered(std::uint32_t id) const;
+
+	// Requests the levels from `mip` up for the current frame. Multiple requests keep the most detailed level.
+	void Request(std::uint32_t id, std::uint32_t mip);
+	// Requests the level that maps a texel to a pixel or less when the texture covers `screen_size` pixels.
+	void RequestScreenSize(std::uint32_t id, float screen_size);
+
+	// Ends the frame: returns the changes to apply for the requests of this frame.
+	std::vector<TextureResidencyChange> Update();
+	// The last change returned for `id` is applied.
+	void Complete(std::uint32_t id);
+
+	// First resident level. Pending changes aren't applied yet.
+	std::uint32_t GetResidentMip(std::uint32_t id) const;
+	TextureResidencyStats GetStats() const;
+	TextureResidencySettings const & GetSettings() const;
+
+	// Level of a `width` x `height` texture at which a texel covers a pixel or more, when the texture covers
+	// `screen_size` pixels in its largest dimension.
+	static std::uint32_t GetMipForScreenSize(std::uint32_t width, std::uint32_t height, std::uint32_t num_mips, float screen_size);
+
+private:
+	struct Texture
+	{
+		std::uint32_t m_width;
+		std::uint32_t m_height;
+		std::uint32_t m_base_mip;
+		std::uint32_t m_resident_mip;
+		std::uint32_t m_target_mip; // Differs from `m_resident_mip` while a change is pending.
+		std::uint32_t m_requested_mip; // Of the current frame.
+		std::uint64_t m_last_request_frame;
+		std::vector<std::size_t> m_sizes; // Bytes of the levels from a level up, so m_sizes[0] is the full texture.
+	};
+
+	// Drops the levels of the least recently requested texture that isn't requested this frame. False when there
+	// is nothing left to evict.
+	bool EvictLeastRecentlyRequested(std::vector<TextureResidencyChange>& changes);
+
+	TextureResidencySettings m_settings;
+	std::unordered_map<std::uint32_t, Texture> m_textures;
+	std::uint64_t m_frame;
+	TextureResidencyStats m_stats;
+};
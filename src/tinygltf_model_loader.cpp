@@ -18,11 +18,14 @@
 #include <gtc/quaternion.hpp>
 #include <gtc/matrix_transform.hpp>
 #include <utility>
+#include <algorithm>
 
 #include <gtx/matrix_decompose.hpp>
 
 #include "util/log.hpp"
+#include "util/thread_pool.hpp"
 #include "resource_structs.hpp"
+#include "tangent_generator.hpp"
 
 TinyGLTFModelLoader::TinyGLTFModelLoader()
 	: ResourceLoader(std::vector<std::string>{ "nothing" })
@@ -30,109 +33,59 @@ TinyGLTFModelLoader::TinyGLTFModelLoader()
 
 }
 
-inline std::pair<std::vector<glm::vec3>, std::vector<glm::vec3>> ComputeTangents(MeshData & mesh_data)
+// Decoded images, indexed by glTF image index. The pixel buffers are moved out of the glTF model and shared by
+// every material that references the image.
+inline std::vector<TextureData> LoadImages(tinygltf::Model & tg_model)
 {
-	size_t num_vertices = mesh_data.m_positions.size();
-	std::vector<glm::vec3> tanA(num_vertices, { 0, 0, 0 });
-	std::vector<glm::vec3> tanB(num_vertices, { 0, 0, 0 });
+	std::vector<TextureData> images(tg_model.images.size());
 
-	if (mesh_data.m_uvw.empty())
+	for (std::size_t i = 0; i < tg_model.images.size(); i++)
 	{
-		return { tanA, tanB };
-	}
-
-	std::vector<std::uint32_t>indices;
-	for (auto i = 0; i < mesh_data.m_indices.size(); i += mesh_data.m_indices_stride)
-	{
-		std::uint32_t val = 0;
-
-		memcpy(&val, &mesh_data.m_indices[i], mesh_data.m_indices_stride);
-
-		indices.push_back(val);
-	}
-
-	// (1)
-	for (size_t i = 0; i < indices.size(); i += 3) {
-		size_t i0 = indices[i];
-		size_t i1 = indices[i + 1];
-		size_t i2 = indices[i + 2];
-
-		glm::vec3 pos0 = mesh_data.m_positions[i0];
-		glm::vec3 pos1 = mesh_data.m_positions[i1];
-		glm::vec3 pos2 = mesh_data.m_positions[i2];
-
-		auto tex0 = glm::vec2{ mesh_data.m_uvw[i0].x, mesh_data.m_uvw[i0].y };
-		auto tex1 = glm::vec2{ mesh_data.m_uvw[i1].x, mesh_data.m_uvw[i1].y };
-		auto tex2 = glm::vec2{ mesh_data.m_uvw[i2].x, mesh_data.m_uvw[i2].y };
-
-		glm::vec3 edge1, edge2;
-		edge1 = pos1 - pos0;
-		edge2 = pos2 - pos0;
-
-		glm::vec2 uv1, uv2;
-		uv1 = tex1 - tex0;
-		uv2 = tex2 - tex0;
-
-		float r = 1.0f / (uv1.x * uv2.y - uv1.y * uv2.x);
-
-		glm::vec3 tangent(
-				((edge1.x * uv2.y) - (edge2.x * uv1.y)) * r,
-				((edge1.y * uv2.y) - (edge2.y * uv1.y)) * r,
-				((edge1.z * uv2.y) - (edge2.z * uv1.y)) * r
-		);
-
-		glm::vec3 bitangent(
-				((edge1.x * uv2.x) - (edge2.x * uv1.x)) * r,
-				((edge1.y * uv2.x) - (edge2.y * uv1.x)) * r,
-				((edge1.z * uv2.x) - (edge2.z * uv1.x)) * r
-		);
-
-		tanA[i0] = tangent;
-		tanA[i1] = tangent;
-		tanA[i2] = tangent;
-
-		tanB[i0] = bitangent;
-		tanB[i1] = bitangent;
-		tanB[i2] = bitangent;
-	}
-
-	for (std::size_t i = 0; i < mesh_data.m_positions.size(); i++)
-	{
-		const glm::vec3& n = mesh_data.m_normals[i];
-		const glm::vec3& t = tanA[i];
+		auto& image = tg_model.images[i];
+		if (image.image.empty())
+		{
+			continue;
+		}
 
-		// Gram-Schmidt orthogonalize
-		tanA[i] = glm::normalize(t - n * glm::dot(n, t));
+		auto pixels = std::make_shared<std::vector<unsigned char>>(std::move(image.image));
 
-		// Calculate handedness
-		float w = (glm::dot(glm::cross(n, t), tanB[i]) < 0.0F) ? -1.0F : 1.0F;
-		tanB[i] *= w;
+		auto& texture = images[i];
+		texture.m_pixel_storage = std::shared_ptr<void>(pixels, pixels->data());
+		texture.m_pixels = pixels->data();
+		texture.m_width = image.width;
+		texture.m_height = image.height;
+		texture.m_channels = image.component;
+		texture.m_is_hdr = false;
 	}
 
-	return { tanA, tanB };
+	return images;
 }
 
-inline void LoadMaterial(ModelData* model, tinygltf::Model tg_model, tinygltf::Material const & mat)
+inline void LoadMaterial(ModelData* model, tinygltf::Model const & tg_model, std::vector<TextureData> const & images, tinygltf::Material const & mat)
 {
 	MaterialData mat_data;
 
-	auto set_img_data = [&](auto& target, auto source)
+	// Materials reference textures, which reference images.
+	auto set_img_data = [&](auto& target, tinygltf::Parameter const & parameter)
 	{
-		auto data_size = sizeof(unsigned char) * source.width * source.height * source.component;
-		target.m_pixels = malloc(data_size); // TODO: Destroy this
-		memcpy(target.m_pixels, source.image.data(), data_size);
-		target.m_width = source.width;
-		target.m_height = source.height;
-		target.m_channels = source.component;
-		target.m_is_hdr = false;
+		auto texture_index = parameter.TextureIndex();
+		if (texture_index < 0 || texture_index >= static_cast<int>(tg_model.textures.size()))
+		{
+			return;
+		}
+
+		auto image_index = tg_model.textures[texture_index].source;
+		if (image_index >= 0 && image_index < static_cast<int>(images.size()))
+		{
+			target = images[image_index];
+		}
 	};
 
-	for (auto value : mat.values)
+	for (auto const & value : mat.values)
 	{
 		if (value.first == "baseColorTexture")
 		{
-			auto img = tg_model.images[value.second.json_double_value.begin()->second];
-			set_img_data(mat_data.m_albedo_texture, img);
+			set_img_data(mat_data.m_albedo_texture, value.second);
 
 		}
 		else if (value.first == "baseColorFactor")
@@ -143,9 +96,8 @@ inline void LoadMaterial(ModelData* model, tinygltf::Model tg_model, tinygltf::M
 		}
 		else if (value.first == "metallicRoughnessTexture")
 		{
-			auto img = tg_model.images[value.second.json_double_value.begin()->second];
-			set_img_data(mat_data.m_metallic_texture, img);
-			set_img_data(mat_data.m_roughness_texture, img);
+			set_img_data(mat_data.m_metallic_texture, value.second);
+			set_img_data(mat_data.m_roughness_texture, value.second);
 
 		}
 		else if (value.first == "roughnessFactor")
@@ -160,22 +112,19 @@ inline void LoadMaterial(ModelData* model, tinygltf::Model tg_model, tinygltf::M
 		}
 	}
 
-	for (auto value : mat.additionalValues)
+	for (auto const & value : mat.additionalValues)
 	{
 		if (value.first == "normalTexture")
 		{
-			auto img = tg_model.images[value.second.json_double_value.begin()->second];
-			set_img_data(mat_data.m_normal_map_texture, img);
+			set_img_data(mat_data.m_normal_map_texture, value.second);
 		}
 		else if (value.first == "occlusionTexture")
 		{
-			auto img = tg_model.images[value.second.json_double_value.begin()->second];
-			set_img_data(mat_data.m_ambient_occlusion_texture, img);
+			set_img_data(mat_data.m_ambient_occlusion_texture, value.second);
 		}
 		else if (value.first == "emissiveTexture")
 		{
-			auto img = tg_model.images[value.second.json_double_value.begin()->second];
-			set_img_data(mat_data.m_emissive_texture, img);
+			set_img_data(mat_data.m_emissive_texture, value.second);
 		}
 		else if (value.first == "emissiveFactor")
 		{
@@ -184,18 +133,13 @@ inline void LoadMaterial(ModelData* model, tinygltf::Model tg_model, tinygltf::M
 		}
 	}
 
-	model->m_materials.push_back(mat_data);
+	model->m_materials.push_back(std::move(mat_data));
 }
 
-inline void LoadMesh(ModelData* model, tinygltf::Model const & tg_model, tinygltf::Node const & node, glm::mat4 parent_transform)
+// Adds a `MeshData` in object space per primitive of `mesh`. Tangents of large meshes are generated on `thread_pool`
+// when given, otherwise on the calling thread.
+inline void LoadMesh(ModelData* model, tinygltf::Model const & tg_model, tinygltf::Mesh const & mesh, util::ThreadPool* thread_pool)
 {
-	auto mesh = tg_model.meshes[node.mesh];
-
-	auto translation = node.translation;
-	auto rotation = node.rotation;
-	auto scale = node.scale;
-	auto matrix = node.matrix;
-
 	for (auto const & primitive : mesh.primitives)
 	{
 		std::size_t idx_buffer_offset = 0;
@@ -206,7 +150,7 @@ inline void LoadMesh(ModelData* model, tinygltf::Model const & tg_model, tinyglt
 		mesh_data.m_num_indices = 0;
 
 		{ // GET INDICES
-			auto idx_accessor = tg_model.accessors[primitive.indices];
+			auto const & idx_accessor = tg_model.accessors[primitive.indices];
 
 			const auto& buffer_view = tg_model.bufferViews[idx_accessor.bufferView];
 			const auto& buffer = tg_model.buffers[buffer_view.buffer];
@@ -225,7 +169,7 @@ inline void LoadMesh(ModelData* model, tinygltf::Model const & tg_model, tinyglt
 		// Get other attributes
 		for (const auto& attrib : primitive.attributes)
 		{
-			const auto attrib_accessor = tg_model.accessors[attrib.second];
+			const auto& attrib_accessor = tg_model.accessors[attrib.second];
 			const auto& buffer_view = tg_model.bufferViews[attrib_accessor.bufferView];
 			const auto& buffer = tg_model.buffers[buffer_view.buffer];
 			const auto data_address = buffer.data.data() + buffer_view.byteOffset + attrib_accessor.byteOffset;
@@ -262,23 +206,15 @@ inline void LoadMesh(ModelData* model, tinygltf::Model const & tg_model, tinyglt
 			}
 		}
 
-		// Apply Transformation
-		for (auto& position : mesh_data.m_positions)
-		{
-			position = parent_transform * glm::vec4(position, 1);
-		}
-
-		auto tangent_bitangent = ComputeTangents(mesh_data);
-		mesh_data.m_tangents = tangent_bitangent.first;
-		mesh_data.m_bitangents = tangent_bitangent.second;
+		TangentGenerator::Generate(mesh_data, TangentMode::ACCUMULATE, thread_pool);
 		mesh_data.m_uvw.resize(mesh_data.m_positions.size());
 		mesh_data.m_material_id = primitive.material;
 
-		model->m_meshes.push_back(mesh_data);
+		model->m_meshes.push_back(std::move(mesh_data));
 	}
 }
 
-TinyGLTFModelLoader::AnonResource TinyGLTFModelLoader::LoadFromDisc(std::string const & path)
+TinyGLTFModelLoader::AnonResource TinyGLTFModelLoader::LoadFromDisc(std::string const & path, util::ThreadPool* thread_pool)
 {
 	tinygltf::Model tg_model;
 	tinygltf::TinyGLTF loader;
@@ -302,107 +238,89 @@ TinyGLTFModelLoader::AnonResource TinyGLTFModelLoader::LoadFromDisc(std::string
 
 	auto model = std::make_unique<ModelData>();
 
-	for (auto mat : tg_model.materials)
+	// Images are shared by materials instead of copied per material.
+	auto images = LoadImages(tg_model);
+	for (auto const & mat : tg_model.materials)
 	{
-		LoadMaterial(model.get(), tg_model, mat);
+		LoadMaterial(model.get(), tg_model, images, mat);
 	}
 
-	std::function<void(int, glm::mat4)> recursive_func = [&](int node_id, glm::mat4 parent_transform)
+	// glTF meshes are loaded when a node references them for the first time. First mesh and number of meshes.
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> loaded_meshes(tg_model.meshes.size(), { 0, 0 });
+	std::vector<bool> is_mesh_loaded(tg_model.meshes.size(), false);
+
+	std::function<void(int, glm::mat4 const &)> recursive_func = [&](int node_id, glm::mat4 const & parent_transform)
 	{
-		auto node = tg_model.nodes[node_id];
+		auto const & node = tg_model.nodes[node_id];
 
-		auto translation = node.translation;
-		auto scale = node.scale;
-		auto rotation = node.rotation;
-		auto matrix = node.matrix;
+		auto const & translation = node.translation;
+		auto const & scale = node.scale;
+		auto const & rotation = node.rotation;
+		auto const & matrix = node.matrix;
 
 		glm::mat4 transform = glm::mat4(1);
 
 		if (matrix.empty())
 		{
-			/*glm::mat4 translation_mat(1);
-			glm::mat4 rotation_mat(1);
-			glm::mat4 scale_mat(1);
+			// T * R * S, the rotation is a quaternion stored as x, y, z, w.
 			if (!translation.empty())
 			{
-				translation_mat = glm::translate(translation_mat,
-						glm::vec3{(float)translation[0], (float)translation[1], (float)translation[2]});
+				transform = glm::translate(transform,
+					glm::vec3{ (float)translation[0], (float)translation[1], (float)translation[2] });
 			}
+
 			if (!rotation.empty())
 			{
-				rotation_mat = glm::rotate(
-						glm::mat4(1), glm::radians((float)rotation[0]), glm::vec3((float)rotation[1], (float)rotation[2], (float)rotation[3]));
+				transform = transform * glm::mat4_cast(glm::quat((float)rotation[3], (float)rotation[0], (float)rotation[1], (float)rotation[2]));
 			}
-			if (!scale.empty())
-			{
-				scale_mat = glm::scale(scale_mat,
-						glm::vec3{(float)scale[0], (float)scale[1], (float)scale[2]});
-			}
-
-			transform = scale_mat * rotation_mat * translation_mat;
-			*/
 
 			if (!scale.empty())
 			{
 				transform = glm::scale(transform,
 					glm::vec3{ (float)scale[0], (float)scale[1], (float)scale[2] });
 			}
-
-			if (!rotation.empty())
-			{
-				transform = glm::rotate(transform,
-					glm::radians((float)rotation[0]), glm::vec3((float)rotation[1], (float)rotation[2], (float)rotation[3]));
-			}
-
-			if (!translation.empty())
-			{
-				transform = glm::translate(transform,
-					glm::vec3{ (float)translation[0], (float)translation[1], (float)translation[2] });
-			}
-
-
 		}
 		else
 		{
-			transform[0][0] = matrix[0];
-			transform[0][1] = matrix[1];
-			transform[0][2] = matrix[2];
-			transform[0][3] = matrix[3];
-
-			transform[1][0] = matrix[4];
-			transform[1][1] = matrix[5];
-			transform[1][2] = matrix[6];
-			transform[1][3] = matrix[7];
-
-			transform[2][0] = matrix[8];
-			transform[2][1] = matrix[9];
-			transform[2][2] = matrix[10];
-			transform[2][3] = matrix[11];
-
-			transform[3][0] = matrix[12];
-			transform[3][1] = matrix[13];
-			transform[3][2] = matrix[14];
-			transform[3][3] = matrix[15];
+			// Column major, like glm.
+			for (int i = 0; i < 16; i++)
+			{
+				transform[i / 4][i % 4] = static_cast<float>(matrix[i]);
+			}
 		}
 
-		parent_transform = transform * parent_transform;
-		//parent_transform = glm::mat4(1);
+		transform = parent_transform * transform;
 
 		if (node.mesh > -1)
 		{
-			LoadMesh(model.get(), tg_model, node, parent_transform);
+			auto& meshes = loaded_meshes[node.mesh];
+			if (!is_mesh_loaded[node.mesh])
+			{
+				meshes.first = static_cast<std::uint32_t>(model->m_meshes.size());
+				LoadMesh(model.get(), tg_model, tg_model.meshes[node.mesh], thread_pool);
+				meshes.second = static_cast<std::uint32_t>(model->m_meshes.size()) - meshes.first;
+				is_mesh_loaded[node.mesh] = true;
+			}
+
+			for (auto mesh_id = meshes.first; mesh_id < meshes.first + meshes.second; mesh_id++)
+			{
+				model->m_nodes.push_back({ mesh_id, model->m_meshes[mesh_id].m_material_id, transform });
+			}
 		}
 
 		for (auto child_id : node.children)
 		{
-			recursive_func(child_id, parent_transform);
+			recursive_func(child_id, transform);
 		}
 	};
 
-	glm::mat4 parent_transform(1);
-	for (auto node_id : tg_model.scenes[tg_model.defaultScene].nodes)
+	auto scene_id = tg_model.defaultScene < 0 ? 0 : tg_model.defaultScene;
+	if (scene_id < static_cast<int>(tg_model.scenes.size()))
 	{
-		recursive_func(node_id, parent_transform);
+		for (auto node_id : tg_model.scenes[scene_id].nodes)
+		{
+			recursive_func(node_id, glm::mat4(1));
+		}
 	}
 
 	return model;
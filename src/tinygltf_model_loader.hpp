@@ -16,5 +16,5 @@ public:
 	TinyGLTFModelLoader();
 	~TinyGLTFModelLoader() final = default;
 
-	AnonResource LoadFromDisc(std::string const & path) final;
+	AnonResource LoadFromDisc(std::string const & path, util::ThreadPool* thread_pool) final;
 };
\ No newline at end of file
@@ -0,0 +1,137 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace util
+{
+
+	namespace internal
+	{
+
+		static constexpr std::uint64_t hash_prime_1 = 0x9E3779B185EBCA87ULL;
+		static constexpr std::uint64_t hash_prime_2 = 0xC2B2AE3D27D4EB4FULL;
+		static constexpr std::uint64_t hash_prime_3 = 0x165667B19E3779F9ULL;
+		static constexpr std::uint64_t hash_prime_4 = 0x85EBCA77C2B2AE63ULL;
+		static constexpr std::uint64_t hash_prime_5 = 0x27D4EB2F165667C5ULL;
+
+		inline std::uint64_t RotateLeft(std::uint64_t x, int r)
+		{
+			return (x << r) | (x >> (64 - r));
+		}
+
+		inline std::uint64_t Read64(std::uint8_t const * p)
+		{
+			std::uint64_t v;
+			memcpy(&v, p, sizeof(v));
+			return v;
+		}
+
+		inline std::uint32_t Read32(std::uint8_t const * p)
+		{
+			std::uint32_t v;
+			memcpy(&v, p, sizeof(v));
+			return v;
+		}
+
+		inline std::uint64_t HashRound(std::uint64_t acc, std::uint64_t input)
+		{
+			acc += input * hash_prime_2;
+			acc = RotateLeft(acc, 31);
+			return acc * hash_prime_1;
+		}
+
+		inline std::uint64_t HashMergeRound(std::uint64_t acc, std::uint64_t value)
+		{
+			acc ^= HashRound(0, value);
+			return acc * hash_prime_1 + hash_prime_4;
+		}
+
+	} /* internal */
+
+	// 64 bit XXH64 hash. Fast enough to hash source assets and pixel data on every load (several GB/s).
+	inline std::uint64_t Hash64(void const * data, std::size_t size, std::uint64_t seed = 0)
+	{
+		using namespace internal;
+
+		auto p = static_cast<std::uint8_t const *>(data);
+		auto const end = p + size;
+		std::uint64_t h;
+
+		if (size >= 32)
+		{
+			std::uint64_t v1 = seed + hash_prime_1 + hash_prime_2;
+			std::uint64_t v2 = seed + hash_prime_2;
+			std::uint64_t v3 = seed;
+			std::uint64_t v4 = seed - hash_prime_1;
+
+			auto const limit = end - 32;
+			do
+			{
+				v1 = HashRound(v1, Read64(p)); p += 8;
+				v2 = HashRound(v2, Read64(p)); p += 8;
+				v3 = HashRound(v3, Read64(p)); p += 8;
+				v4 = HashRound(v4, Read64(p)); p += 8;
+			} while (p <= limit);
+
+			h = RotateLeft(v1, 1) + RotateLeft(v2, 7) + RotateLeft(v3, 12) + RotateLeft(v4, 18);
+			h = HashMergeRound(h, v1);
+			h = HashMergeRound(h, v2);
+			h = HashMergeRound(h, v3);
+			h = HashMergeRound(h, v4);
+		}
+		else
+		{
+			h = seed + hash_prime_5;
+		}
+
+		h += static_cast<std::uint64_t>(size);
+
+		for (; p + 8 <= end; p += 8)
+		{
+			h ^= HashRound(0, Read64(p));
+			h = RotateLeft(h, 27) * hash_prime_1 + hash_prime_4;
+		}
+
+		if (p + 4 <= end)
+		{
+			h ^= static_cast<std::uint64_t>(Read32(p)) * hash_prime_1;
+			h = RotateLeft(h, 23) * hash_prime_2 + hash_prime_3;
+			p += 4;
+		}
+
+		for (; p < end; p++)
+		{
+			h ^= (*p) * hash_prime_5;
+			h = RotateLeft(h, 11) * hash_prime_1;
+		}
+
+		h ^= h >> 33;
+		h *= hash_prime_2;
+		h ^= h >> 29;
+		h *= hash_prime_3;
+		h ^= h >> 32;
+
+		return h;
+	}
+
+	inline std::uint64_t Hash64(std::string const & str, std::uint64_t seed = 0)
+	{
+		return Hash64(str.data(), str.size(), seed);
+	}
+
+	// Hashes the bytes of a trivially copyable value. Mind padding bytes.
+	template<typename T>
+	inline std::uint64_t HashValue(T const & value, std::uint64_t seed = 0)
+	{
+		return Hash64(&value, sizeof(T), seed);
+	}
+
+} /* util */
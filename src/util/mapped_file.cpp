@@ -0,0 +1,122 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include "mapped_file.hpp"
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+util::MappedFile::MappedFile(std::string const & path)
+	: m_data(nullptr), m_size(0), m_open(false), m_file_handle(INVALID_HANDLE_VALUE), m_mapping_handle(nullptr)
+{
+	m_file_handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (m_file_handle == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_file_handle, &size))
+	{
+		return;
+	}
+
+	m_size = static_cast<std::size_t>(size.QuadPart);
+	m_open = true;
+
+	// Empty files can't be mapped.
+	if (m_size == 0)
+	{
+		return;
+	}
+
+	m_mapping_handle = CreateFileMappingA(m_file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping_handle)
+	{
+		m_data = static_cast<std::uint8_t const *>(MapViewOfFile(m_mapping_handle, FILE_MAP_READ, 0, 0, 0));
+	}
+
+	if (!m_data)
+	{
+		m_size = 0;
+		m_open = false;
+	}
+}
+
+util::MappedFile::~MappedFile()
+{
+	if (m_data)
+	{
+		UnmapViewOfFile(m_data);
+	}
+
+	if (m_mapping_handle)
+	{
+		CloseHandle(m_mapping_handle);
+	}
+
+	if (m_file_handle != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file_handle);
+	}
+}
+
+#else
+
+util::MappedFile::MappedFile(std::string const & path)
+	: m_data(nullptr), m_size(0), m_open(false)
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		return;
+	}
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) == 0)
+	{
+		m_size = static_cast<std::size_t>(file_stat.st_size);
+		m_open = true;
+
+		// Empty files can't be mapped.
+		if (m_size > 0)
+		{
+			void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (data != MAP_FAILED)
+			{
+				m_data = static_cast<std::uint8_t const *>(data);
+			}
+			else
+			{
+				m_size = 0;
+				m_open = false;
+			}
+		}
+	}
+
+	// The mapping stays valid after closing the file.
+	close(fd);
+}
+
+util::MappedFile::~MappedFile()
+{
+	if (m_data)
+	{
+		munmap(const_cast<std::uint8_t*>(m_data), m_size);
+	}
+}
+
+#endif
@@ -0,0 +1,42 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace util
+{
+
+	// Read only memory mapping of a whole file. Pages are loaded on first access and can be dropped by the OS at any
+	// time, so mapped data doesn't count towards the private memory of the process.
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(std::string const & path);
+		~MappedFile();
+
+		MappedFile(MappedFile const &) = delete;
+		MappedFile& operator=(MappedFile const &) = delete;
+
+		// False when the file doesn't exist or couldn't be mapped. Empty files are open but have no data.
+		bool IsOpen() const { return m_open; }
+		std::uint8_t const * GetData() const { return m_data; }
+		std::size_t GetSize() const { return m_size; }
+
+	private:
+		std::uint8_t const * m_data;
+		std::size_t m_size;
+		bool m_open;
+
+#ifdef _WIN32
+		void* m_file_handle;
+		void* m_mapping_handle;
+#endif
+	};
+
+} /* util */
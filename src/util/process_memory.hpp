@@ -0,0 +1,95 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <fstream>
+#include <string>
+#include <sys/resource.h>
+#endif
+
+// Resident memory of the process, for measuring the memory used by loading resources.
+namespace util
+{
+
+	namespace internal
+	{
+
+#ifdef __linux__
+		// Reads a "<key>: <value> kB" line of /proc/self/status. Returns 0 when the key doesn't exist.
+		inline std::size_t ReadProcStatus(std::string const & key)
+		{
+			std::ifstream file("/proc/self/status");
+			std::string line;
+			while (std::getline(file, line))
+			{
+				if (line.compare(0, key.size(), key) == 0 && line.size() > key.size() && line[key.size()] == ':')
+				{
+					return std::stoull(line.substr(key.size() + 1)) * 1024;
+				}
+			}
+
+			return 0;
+		}
+#endif
+
+	} /* internal */
+
+	// In bytes.
+	inline std::size_t GetResidentMemory()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.WorkingSetSize : 0;
+#elif defined(__linux__)
+		return internal::ReadProcStatus("VmRSS");
+#else
+		return 0;
+#endif
+	}
+
+	// In bytes, since the start of the process or the last successful `ResetPeakResidentMemory`.
+	inline std::size_t GetPeakResidentMemory()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize : 0;
+#elif defined(__linux__)
+		return internal::ReadProcStatus("VmHWM");
+#else
+		rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+		return static_cast<std::size_t>(usage.ru_maxrss); // Bytes on macOS.
+#endif
+	}
+
+	// Resets the peak to the current resident memory. Only supported on Linux, returns false elsewhere.
+	inline bool ResetPeakResidentMemory()
+	{
+#ifdef __linux__
+		std::ofstream file("/proc/self/clear_refs");
+		file << "5";
+		file.close();
+		return !file.fail();
+#else
+		return false;
+#endif
+	}
+
+} /* util */
@@ -0,0 +1,77 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+// Runtime selection of SIMD kernels. Kernels using instructions above the compiler's baseline are compiled with
+// `SKYGGE_TARGET_AVX2` and only called when `GetSIMDLevel` reports support, so no global compiler flags are needed.
+#if defined(_M_X64) || defined(__x86_64__)
+#define SKYGGE_SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SKYGGE_TARGET_AVX2
+#else
+#define SKYGGE_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+namespace util
+{
+
+	enum class SIMDLevel
+	{
+		SCALAR,
+		SSE2, // Baseline of x86-64.
+		AVX2,
+	};
+
+	inline SIMDLevel DetectSIMDLevel()
+	{
+#ifdef SKYGGE_SIMD_X86
+#ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] >= 7)
+		{
+			__cpuid(info, 1);
+			bool os_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (info[2] & (1 << 12)) && (_xgetbv(0) & 6) == 6;
+			__cpuidex(info, 7, 0);
+			if (os_avx && (info[1] & (1 << 5)))
+			{
+				return SIMDLevel::AVX2;
+			}
+		}
+#else
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+		{
+			return SIMDLevel::AVX2;
+		}
+#endif
+		return SIMDLevel::SSE2;
+#else
+		return SIMDLevel::SCALAR;
+#endif
+	}
+
+	// Highest level supported by the compiler and the CPU.
+	inline SIMDLevel GetSIMDLevel()
+	{
+		static const SIMDLevel level = DetectSIMDLevel();
+		return level;
+	}
+
+	inline const char* SIMDLevelToString(SIMDLevel level)
+	{
+		switch (level)
+		{
+		case SIMDLevel::SSE2: return "SSE2";
+		case SIMDLevel::AVX2: return "AVX2";
+		default: return "Scalar";
+		}
+	}
+
+} /* util */
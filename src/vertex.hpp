@@ -10,6 +10,7 @@
 #include "graphics/pipeline_state.hpp"
 
 #include <vulkan/vulkan.h>
+#include <cstdint>
 #include <vector>
 #include <vec2.hpp>
 #include <vec3.hpp>
@@ -88,5 +89,53 @@ struct Vertex
 	}
 };
 
+// 20 byte version of `Vertex`. See vertex_compression.hpp for the encoding.
+// CPU only: it shrinks imported and cooked models, such as for the asset cooker and tools, but no shader decodes it.
+// The shaders, the ray tracing shaders in particular, read the vertex buffer as `Vertex`, so `VkModelPool` fails
+// loads with any other layout.
+struct CompressedVertex
+{
+	std::uint16_t m_quantized_pos[4]; // UNORM16 relative to the mesh bounding box. w is the bitangent sign. (0 = -1, 1 = +1)
+	std::uint16_t m_half_uv[2];
+	std::int16_t m_oct_normal[2]; // SNORM16 octahedral
+	std::int16_t m_oct_tangent[2]; // SNORM16 octahedral
+
+	static gfx::PipelineState::InputLayout GetInputLayout()
+	{
+		std::vector<VkVertexInputBindingDescription> binding_descs(1);
+		binding_descs[0].binding = 0;
+		binding_descs[0].stride = sizeof(CompressedVertex);
+		binding_descs[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+		std::vector<VkVertexInputAttributeDescription> attribute_descs(4);
+		// position attribute + bitangent sign
+		attribute_descs[0].binding = 0;
+		attribute_descs[0].location = 0;
+		attribute_descs[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+		attribute_descs[0].offset = offsetof(CompressedVertex, m_quantized_pos);
+		// uv attribute
+		attribute_descs[1].binding = 0;
+		attribute_descs[1].location = 1;
+		attribute_descs[1].format = VK_FORMAT_R16G16_SFLOAT;
+		attribute_descs[1].offset = offsetof(CompressedVertex, m_half_uv);
+		// normal
+		attribute_descs[2].binding = 0;
+		attribute_descs[2].location = 2;
+		attribute_descs[2].format = VK_FORMAT_R16G16_SNORM;
+		attribute_descs[2].offset = offsetof(CompressedVertex, m_oct_normal);
+		// tangent
+		attribute_descs[3].binding = 0;
+		attribute_descs[3].location = 3;
+		attribute_descs[3].format = VK_FORMAT_R16G16_SNORM;
+		attribute_descs[3].offset = offsetof(CompressedVertex, m_oct_tangent);
+
+		return { binding_descs, attribute_descs };
+	}
+};
+
 IS_PROPER_VERTEX_CLASS(Vertex2D)
-IS_PROPER_VERTEX_CLASS(Vertex)
\ No newline at end of file
+IS_PROPER_VERTEX_CLASS(Vertex)
+IS_PROPER_VERTEX_CLASS(CompressedVertex)
+
+// The ray tracing shaders divide vertex buffer offsets by the size of `Vertex`.
+static_assert(sizeof(Vertex) == 56, "Update the vertex stride in rt_any_hit.comp and rt_closest_hit.comp");
\ No newline at end of file
@@ -0,0 +1,73 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <glm.hpp>
+#include <gtc/packing.hpp>
+
+#include "meshlet_builder.hpp"
+
+// Encoding and decoding of the quantized vertex attributes used by `CompressedVertex`.
+// The decode functions are used to validate the encoding. No shader decodes `CompressedVertex` yet.
+
+// UNORM16 relative to the bounding box. Maximum error is half a step: `extent / 65535 / 2` per axis.
+inline void QuantizePosition(glm::vec3 const & pos, glm::vec3 const & bbox_min, glm::vec3 const & bbox_max, std::uint16_t out[3])
+{
+	for (int i = 0; i < 3; i++)
+	{
+		float extent = bbox_max[i] - bbox_min[i];
+		float normalized = extent > 0.f ? (pos[i] - bbox_min[i]) / extent : 0.f;
+		out[i] = static_cast<std::uint16_t>(std::lround(std::clamp(normalized, 0.f, 1.f) * 65535.f));
+	}
+}
+
+inline glm::vec3 DequantizePosition(std::uint16_t const in[3], glm::vec3 const & bbox_min, glm::vec3 const & bbox_max)
+{
+	return bbox_min + glm::vec3(in[0], in[1], in[2]) * (1.f / 65535.f) * (bbox_max - bbox_min);
+}
+
+// SNORM16 octahedral encoding. Zero length vectors encode to +Z.
+inline void EncodeOctUnitVector(glm::vec3 const & v, std::int16_t out[2])
+{
+	float length = glm::length(v);
+	if (length <= FLT_EPSILON)
+	{
+		out[0] = out[1] = 0;
+		return;
+	}
+
+	auto oct = FVec3ToOctnPrecise(v / length, 32);
+	out[0] = static_cast<std::int16_t>(std::lround(std::clamp(oct.x, -1.f, 1.f) * 32767.f));
+	out[1] = static_cast<std::int16_t>(std::lround(std::clamp(oct.y, -1.f, 1.f) * 32767.f));
+}
+
+inline glm::vec3 DecodeOctUnitVector(std::int16_t const in[2])
+{
+	// SNORM to float conversion as defined by Vulkan.
+	return OctToFVec3(glm::vec3(std::max(in[0] / 32767.f, -1.f), std::max(in[1] / 32767.f, -1.f), 0.f));
+}
+
+inline void EncodeHalf2(glm::vec2 const & v, std::uint16_t out[2])
+{
+	out[0] = glm::packHalf1x16(v.x);
+	out[1] = glm::packHalf1x16(v.y);
+}
+
+inline glm::vec2 DecodeHalf2(std::uint16_t const in[2])
+{
+	return glm::vec2(glm::unpackHalf1x16(in[0]), glm::unpackHalf1x16(in[1]));
+}
+
+// Handedness of the tangent frame. The bitangent is reconstructed as `cross(normal, tangent) * sign`.
+inline float BitangentSign(glm::vec3 const & normal, glm::vec3 const & tangent, glm::vec3 const & bitangent)
+{
+	return glm::dot(glm::cross(normal, tangent), bitangent) < 0.f ? -1.f : 1.f;
+}
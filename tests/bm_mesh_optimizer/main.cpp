@@ -0,0 +1,137 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <array>
+#include <random>
+
+#include <mesh_optimizer.hpp>
+#include <resource_structs.hpp>
+#include <assimp_model_loader.hpp>
+
+// Creates a regular grid of `num_quads` x `num_quads` quads with the triangles in random order.
+static MeshData CreateShuffledGridMesh(std::uint32_t num_quads)
+{
+	MeshData mesh_data{};
+
+	const auto num_vertices_per_side = num_quads + 1;
+	for (std::uint32_t y = 0; y < num_vertices_per_side; y++)
+	{
+		for (std::uint32_t x = 0; x < num_vertices_per_side; x++)
+		{
+			mesh_data.m_positions.emplace_back(glm::vec3(x, std::sin(x * 0.1f) * std::cos(y * 0.1f), y));
+		}
+	}
+
+	std::vector<std::array<std::uint32_t, 3>> triangles;
+	for (std::uint32_t y = 0; y < num_quads; y++)
+	{
+		for (std::uint32_t x = 0; x < num_quads; x++)
+		{
+			auto i0 = y * num_vertices_per_side + x;
+			auto i1 = i0 + 1;
+			auto i2 = i0 + num_vertices_per_side;
+			auto i3 = i2 + 1;
+
+			triangles.push_back({ i0, i2, i1 });
+			triangles.push_back({ i1, i2, i3 });
+		}
+	}
+
+	std::shuffle(triangles.begin(), triangles.end(), std::mt19937(0));
+
+	mesh_data.m_indices_stride = sizeof(std::uint32_t);
+	mesh_data.m_num_indices = triangles.size() * 3;
+	mesh_data.m_indices.resize(triangles.size() * sizeof(triangles[0]));
+	memcpy(mesh_data.m_indices.data(), triangles.data(), mesh_data.m_indices.size());
+
+	return mesh_data;
+}
+
+static void SetVertexCacheCounters(benchmark::State& state, std::vector<MeshData> const & before, std::vector<MeshData> const & after)
+{
+	auto average = [](std::vector<MeshData> const & meshes)
+	{
+		// Triangle weighted ACMR, vertex weighted ATVR
+		double acmr = 0, atvr = 0, num_triangles = 0, num_vertices = 0;
+		for (auto const & mesh : meshes)
+		{
+			auto stats = MeshOptimizer::AnalyzeVertexCache(mesh);
+			acmr += stats.m_acmr * (mesh.m_num_indices / 3);
+			atvr += stats.m_atvr * mesh.m_positions.size();
+			num_triangles += mesh.m_num_indices / 3;
+			num_vertices += mesh.m_positions.size();
+		}
+		return std::make_pair(acmr / std::max(1.0, num_triangles), atvr / std::max(1.0, num_vertices));
+	};
+
+	auto [acmr_before, atvr_before] = average(before);
+	auto [acmr_after, atvr_after] = average(after);
+	state.counters["ACMR before"] = acmr_before;
+	state.counters["ACMR after"] = acmr_after;
+	state.counters["ATVR before"] = atvr_before;
+	state.counters["ATVR after"] = atvr_after;
+}
+
+static void BM_MeshOptimizerGrid(benchmark::State& state)
+{
+	std::vector<MeshData> meshes = { CreateShuffledGridMesh(static_cast<std::uint32_t>(state.range(0))) };
+	std::vector<MeshData> optimized;
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		optimized = meshes;
+		state.ResumeTiming();
+
+		MeshOptimizer::Optimize(optimized[0]);
+	}
+
+	SetVertexCacheCounters(state, meshes, optimized);
+	state.counters["triangles/s"] = benchmark::Counter(static_cast<double>(state.iterations() * (meshes[0].m_num_indices / 3)), benchmark::Counter::kIsRate);
+}
+
+// Optimizes every mesh of a model on disc. Skipped when the model isn't available.
+static void BM_MeshOptimizerModel(benchmark::State& state, std::string const & path)
+{
+	static AssimpModelLoader loader;
+	auto model_data = loader.Load(path);
+	if (!model_data || model_data->m_meshes.empty())
+	{
+		state.SkipWithError(("Failed to load " + path).c_str());
+		return;
+	}
+
+	std::size_t num_triangles = 0;
+	for (auto const & mesh : model_data->m_meshes)
+	{
+		num_triangles += mesh.m_num_indices / 3;
+	}
+
+	std::vector<MeshData> optimized;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		optimized = model_data->m_meshes;
+		state.ResumeTiming();
+
+		for (auto & mesh : optimized)
+		{
+			MeshOptimizer::Optimize(mesh);
+		}
+	}
+
+	SetVertexCacheCounters(state, model_data->m_meshes, optimized);
+	state.counters["triangles/s"] = benchmark::Counter(static_cast<double>(state.iterations() * num_triangles), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK(BM_MeshOptimizerGrid)->Arg(128)->Arg(512)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MeshOptimizerModel, sponza, std::string("sponza/sponza.obj"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MeshOptimizerModel, market, std::string("market/scene.gltf"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MeshOptimizerModel, robot, std::string("robot/scene.gltf"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MeshOptimizerModel, tree, std::string("tree/scene.gltf"))->Unit(benchmark::kMillisecond);
+BENCHMARK_MAIN();
@@ -0,0 +1,273 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+
+#include <meshlet_builder.hpp>
+#include <resource_structs.hpp>
+#include <assimp_model_loader.hpp>
+#include <vertex.hpp>
+
+#include "../common/test_util.hpp"
+
+static void SetMeshletStatsCounters(benchmark::State& state, MeshletStats const & stats)
+{
+	state.counters["meshlets"] = static_cast<double>(stats.m_num_meshlets);
+	state.counters["vertices/meshlet"] = stats.m_average_vertices;
+	state.counters["fill"] = stats.m_average_fill;
+	state.counters["bbox volume"] = stats.m_average_bbox_volume;
+	state.counters["cone cullable"] = stats.m_cone_cullable;
+}
+
+static void BM_MeshletBuilderBuild(benchmark::State& state)
+{
+	auto mesh_data = CreateGridMesh(static_cast<std::uint32_t>(state.range(0)), WaveHeight);
+	auto mesh_bbox = MeshletBuilder::CalculateBoundingBox(mesh_data);
+	auto mode = static_cast<MeshletClusteringMode>(state.range(1));
+	const auto num_triangles = mesh_data.m_num_indices / 3;
+
+	MeshletData meshlet_data;
+	for (auto _ : state)
+	{
+		meshlet_data = {};
+		MeshletBuilder::Build(mesh_data, mesh_bbox, meshlet_data, mode);
+		benchmark::DoNotOptimize(meshlet_data.m_meshlets.data());
+	}
+
+	SetMeshletStatsCounters(state, MeshletBuilder::CalculateStats(mesh_data, meshlet_data));
+	state.counters["triangles/s"] = benchmark::Counter(static_cast<double>(state.iterations() * num_triangles), benchmark::Counter::kIsRate);
+}
+
+// Builds the meshlets of every mesh of a model on disc. Skipped when the model isn't available.
+static void BM_MeshletBuilderModel(benchmark::State& state, std::string const & path)
+{
+	static AssimpModelLoader loader;
+	auto model_data = loader.Load(path);
+	if (!model_data || model_data->m_meshes.empty())
+	{
+		state.SkipWithError(("Failed to load " + path).c_str());
+		return;
+	}
+
+	auto mode = static_cast<MeshletClusteringMode>(state.range(0));
+
+	std::vector<MeshBoundingBox> mesh_bboxes;
+	std::size_t num_triangles = 0;
+	for (auto const & mesh : model_data->m_meshes)
+	{
+		mesh_bboxes.push_back(MeshletBuilder::CalculateBoundingBox(mesh));
+		num_triangles += mesh.m_num_indices / 3;
+	}
+
+	std::vector<MeshletData> meshlet_data(model_data->m_meshes.size());
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < model_data->m_meshes.size(); i++)
+		{
+			meshlet_data[i] = {};
+			MeshletBuilder::Build(model_data->m_meshes[i], mesh_bboxes[i], meshlet_data[i], mode);
+		}
+		benchmark::DoNotOptimize(meshlet_data.data());
+	}
+
+	// Meshlet weighted averages over all meshes.
+	// The bounding box volume is relative to the volume of the mesh it belongs to since meshes differ in scale.
+	MeshletStats total = {};
+	double relative_volume = 0;
+	for (std::size_t i = 0; i < model_data->m_meshes.size(); i++)
+	{
+		auto stats = MeshletBuilder::CalculateStats(model_data->m_meshes[i], meshlet_data[i]);
+		auto extent = mesh_bboxes[i].m_max - mesh_bboxes[i].m_min;
+		auto mesh_volume = double(extent.x) * double(extent.y) * double(extent.z);
+
+		total.m_num_meshlets += stats.m_num_meshlets;
+		total.m_average_vertices += stats.m_average_vertices * stats.m_num_meshlets;
+		total.m_average_fill += stats.m_average_fill * stats.m_num_meshlets;
+		total.m_cone_cullable += stats.m_cone_cullable * stats.m_num_meshlets;
+		relative_volume += mesh_volume > 0 ? stats.m_average_bbox_volume / mesh_volume * stats.m_num_meshlets : 0;
+	}
+
+	if (total.m_num_meshlets > 0)
+	{
+		total.m_average_vertices /= total.m_num_meshlets;
+		total.m_average_fill /= total.m_num_meshlets;
+		total.m_cone_cullable /= total.m_num_meshlets;
+		total.m_average_bbox_volume = static_cast<float>(relative_volume / total.m_num_meshlets);
+	}
+
+	SetMeshletStatsCounters(state, total);
+	state.counters["triangles/s"] = benchmark::Counter(static_cast<double>(state.iterations() * num_triangles), benchmark::Counter::kIsRate);
+}
+
+static void SetMeshletHierarchyCounters(benchmark::State& state, std::vector<MeshletHierarchy> const & hierarchies, std::size_t num_triangles)
+{
+	std::size_t num_meshlets = 0, num_roots = 0;
+	std::uint32_t num_levels = 0;
+	for (auto const & hierarchy : hierarchies)
+	{
+		num_meshlets += hierarchy.m_nodes.size();
+		num_levels = std::max(num_levels, hierarchy.m_num_levels);
+		num_roots += std::count_if(hierarchy.m_nodes.begin(), hierarchy.m_nodes.end(), [](auto const & node) { return node.m_parent_error == FLT_MAX; });
+	}
+
+	state.counters["levels"] = num_levels;
+	state.counters["meshlets"] = static_cast<double>(num_meshlets);
+	state.counters["roots"] = static_cast<double>(num_roots);
+	state.counters["triangles/s"] = benchmark::Counter(static_cast<double>(state.iterations() * num_triangles), benchmark::Counter::kIsRate);
+}
+
+static void BM_MeshletBuilderHierarchy(benchmark::State& state)
+{
+	auto mesh_data = CreateGridMesh(static_cast<std::uint32_t>(state.range(0)), WaveHeight);
+	auto mesh_bbox = MeshletBuilder::CalculateBoundingBox(mesh_data);
+
+	std::vector<MeshletHierarchy> hierarchy(1);
+	for (auto _ : state)
+	{
+		MeshletBuilder::BuildHierarchy(mesh_data, mesh_bbox, hierarchy[0]);
+		benchmark::DoNotOptimize(hierarchy[0].m_nodes.data());
+	}
+
+	SetMeshletHierarchyCounters(state, hierarchy, mesh_data.m_num_indices / 3);
+}
+
+// Builds the meshlet hierarchy of every mesh of a model on disc. Skipped when the model isn't available.
+static void BM_MeshletBuilderHierarchyModel(benchmark::State& state, std::string const & path)
+{
+	static AssimpModelLoader loader;
+	auto model_data = loader.Load(path);
+	if (!model_data || model_data->m_meshes.empty())
+	{
+		state.SkipWithError(("Failed to load " + path).c_str());
+		return;
+	}
+
+	std::vector<MeshBoundingBox> mesh_bboxes;
+	std::size_t num_triangles = 0;
+	for (auto const & mesh : model_data->m_meshes)
+	{
+		mesh_bboxes.push_back(MeshletBuilder::CalculateBoundingBox(mesh));
+		num_triangles += mesh.m_num_indices / 3;
+	}
+
+	std::vector<MeshletHierarchy> hierarchies(model_data->m_meshes.size());
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < model_data->m_meshes.size(); i++)
+		{
+			MeshletBuilder::BuildHierarchy(model_data->m_meshes[i], mesh_bboxes[i], hierarchies[i]);
+		}
+		benchmark::DoNotOptimize(hierarchies.data());
+	}
+
+	SetMeshletHierarchyCounters(state, hierarchies, num_triangles);
+}
+
+// Grid of `num_triangles` triangles with `index_stride` byte indices. 16 bit index buffers repeat the triangles of a
+// 255 x 255 quad grid since they can only address 64K vertices.
+static MeshData CreateBoundingBoxMesh(std::uint32_t num_triangles, std::uint32_t index_stride)
+{
+	if (index_stride == sizeof(std::uint32_t))
+	{
+		return CreateGridMesh(static_cast<std::uint32_t>(std::sqrt(num_triangles / 2.0)), WaveHeight);
+	}
+
+	auto mesh_data = CreateGridMesh(255, WaveHeight);
+	const auto num_grid_indices = mesh_data.m_num_indices;
+	const auto num_indices = static_cast<std::size_t>(num_triangles) * 3;
+
+	std::vector<std::uint8_t> indices(num_indices * sizeof(std::uint16_t));
+	for (std::size_t i = 0; i < num_indices; i++)
+	{
+		auto index = static_cast<std::uint16_t>(mesh_data.GetIndex(i % num_grid_indices));
+		memcpy(indices.data() + i * sizeof(std::uint16_t), &index, sizeof(index));
+	}
+
+	mesh_data.m_indices_stride = sizeof(std::uint16_t);
+	mesh_data.m_num_indices = num_indices;
+	mesh_data.m_indices = std::move(indices);
+
+	return mesh_data;
+}
+
+// Compares the SIMD kernels of `CalculateBoundingBox` with the scalar fallback.
+static void BM_MeshletBuilderBoundingBox(benchmark::State& state)
+{
+	auto level = static_cast<util::SIMDLevel>(state.range(2));
+	if (level > util::GetSIMDLevel())
+	{
+		state.SkipWithError("Not supported by this CPU");
+		return;
+	}
+
+	auto mesh_data = CreateBoundingBoxMesh(static_cast<std::uint32_t>(state.range(0)) * 1000000, static_cast<std::uint32_t>(state.range(1)) / 8);
+
+	// The bounding box has to be exact, the summed normals differ by the order of the additions.
+	auto reference = MeshletBuilder::CalculateBoundingBox(mesh_data, util::SIMDLevel::SCALAR);
+	auto bbox = MeshletBuilder::CalculateBoundingBox(mesh_data, level);
+	if (bbox.m_min != reference.m_min || bbox.m_max != reference.m_max || glm::dot(bbox.m_average_normal, reference.m_average_normal) < 0.999f)
+	{
+		state.SkipWithError("Result doesn't match the scalar kernel");
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		bbox = MeshletBuilder::CalculateBoundingBox(mesh_data, level);
+		benchmark::DoNotOptimize(bbox);
+	}
+
+	state.SetLabel(util::SIMDLevelToString(level));
+	state.counters["triangles/s"] = benchmark::Counter(static_cast<double>(state.iterations() * (mesh_data.m_num_indices / 3)), benchmark::Counter::kIsRate);
+}
+
+static void ClusteringModes(benchmark::internal::Benchmark* b)
+{
+	b->ArgName("mode");
+	b->Arg(static_cast<int>(MeshletClusteringMode::SEQUENTIAL));
+	b->Arg(static_cast<int>(MeshletClusteringMode::SPATIAL));
+}
+
+// 2 * 128^2 (32K) up to 2 * 700^2 (980K) triangles. `MeshletDesc` can't address more than 2^20 primitives per mesh.
+static void GridSizesAndClusteringModes(benchmark::internal::Benchmark* b)
+{
+	b->ArgNames({ "quads", "mode" });
+	for (auto num_quads : { 128, 256, 512, 700 })
+	{
+		b->Args({ num_quads, static_cast<int>(MeshletClusteringMode::SEQUENTIAL) });
+		b->Args({ num_quads, static_cast<int>(MeshletClusteringMode::SPATIAL) });
+	}
+}
+
+// 2M and 8M triangles with 16 and 32 bit indices for every kernel.
+static void BoundingBoxSizesAndKernels(benchmark::internal::Benchmark* b)
+{
+	b->ArgNames({ "Mtris", "index bits", "kernel" });
+	for (auto num_triangles : { 2, 8 })
+	{
+		for (auto index_bits : { 16, 32 })
+		{
+			for (auto level : { util::SIMDLevel::SCALAR, util::SIMDLevel::SSE2, util::SIMDLevel::AVX2 })
+			{
+				b->Args({ num_triangles, index_bits, static_cast<int>(level) });
+			}
+		}
+	}
+}
+
+BENCHMARK(BM_MeshletBuilderBuild)->Apply(GridSizesAndClusteringModes)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MeshletBuilderModel, sponza, std::string("sponza/sponza.obj"))->Apply(ClusteringModes)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MeshletBuilderModel, market, std::string("market/scene.gltf"))->Apply(ClusteringModes)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MeshletBuilderModel, robot, std::string("robot/scene.gltf"))->Apply(ClusteringModes)->Unit(benchmark::kMillisecond);
+// The hierarchy roughly doubles the number of primitives, so the largest grid stays below the `MeshletDesc` limit.
+BENCHMARK(BM_MeshletBuilderHierarchy)->ArgName("quads")->Arg(64)->Arg(128)->Arg(256)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MeshletBuilderHierarchyModel, market, std::string("market/scene.gltf"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MeshletBuilderHierarchyModel, robot, std::string("robot/scene.gltf"))->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_MeshletBuilderBoundingBox)->Apply(BoundingBoxSizesAndKernels)->Unit(benchmark::kMillisecond);
+BENCHMARK_MAIN();
@@ -0,0 +1,248 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <thread>
+
+#include <meshlet_builder.hpp>
+#include <meshlet_compression.hpp>
+#include <resource_structs.hpp>
+#include <assimp_model_loader.hpp>
+#include <vertex.hpp>
+
+#include "../common/test_util.hpp"
+
+// Meshlet data of every mesh of a model on disc, or a grid when `path` is empty.
+static std::vector<MeshletData> BuildMeshlets(std::string const & path, std::uint32_t num_quads, MeshletClusteringMode mode)
+{
+	std::vector<MeshletData> meshlet_data;
+
+	std::vector<MeshData> meshes;
+	if (path.empty())
+	{
+		meshes.push_back(CreateGridMesh(num_quads, WaveHeight));
+	}
+	else
+	{
+		static AssimpModelLoader loader;
+		auto model_data = loader.Load(path);
+		if (!model_data)
+		{
+			return meshlet_data;
+		}
+		meshes = model_data->m_meshes;
+	}
+
+	for (auto const & mesh : meshes)
+	{
+		meshlet_data.emplace_back();
+		MeshletBuilder::Build(mesh, MeshletBuilder::CalculateBoundingBox(mesh), meshlet_data.back(), mode);
+	}
+
+	return meshlet_data;
+}
+
+// The vertex indices have to match exactly. Triangles may be rotated but keep their order and winding.
+static bool IsEqual(MeshletData const & original, MeshletData const & decoded)
+{
+	if (original.m_meshlets.size() != decoded.m_meshlets.size() || original.m_index_indices.size() != decoded.m_index_indices.size())
+	{
+		return false;
+	}
+
+	for (auto const & desc : original.m_meshlets)
+	{
+		for (std::uint32_t i = 0; i < desc.GetNumVertices(); i++)
+		{
+			if (original.m_vertex_indices[desc.GetVertexBegin() + i] != decoded.m_vertex_indices[desc.GetVertexBegin() + i])
+			{
+				return false;
+			}
+		}
+
+		for (std::uint32_t t = 0; t < desc.GetNumPrims(); t++)
+		{
+			auto a = &original.m_index_indices[(desc.GetPrimBegin() + t) * 3];
+			auto b = &decoded.m_index_indices[(desc.GetPrimBegin() + t) * 3];
+
+			bool match = false;
+			for (std::uint32_t r = 0; r < 3; r++)
+			{
+				match |= a[0] == b[r] && a[1] == b[(r + 1) % 3] && a[2] == b[(r + 2) % 3];
+			}
+			if (!match)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+static std::size_t GetNumTriangles(std::vector<MeshletData> const & meshlet_data)
+{
+	std::size_t num_triangles = 0;
+	for (auto const & data : meshlet_data)
+	{
+		num_triangles += data.m_index_indices.size() / 3;
+	}
+	return num_triangles;
+}
+
+// Size of the uncompressed vertex and primitive index buffers.
+static std::size_t GetRawSize(std::vector<MeshletData> const & meshlet_data)
+{
+	std::size_t size = 0;
+	for (auto const & data : meshlet_data)
+	{
+		size += data.m_vertex_indices.size() * sizeof(std::uint32_t) + data.m_index_indices.size();
+	}
+	return size;
+}
+
+static void SetCompressionCounters(benchmark::State& state, std::vector<MeshletData> const & meshlet_data, std::vector<CompressedMeshletData> const & compressed)
+{
+	std::size_t compressed_size = 0;
+	for (auto const & data : compressed)
+	{
+		compressed_size += data.m_data.size();
+	}
+
+	auto num_triangles = static_cast<double>(GetNumTriangles(meshlet_data));
+	state.counters["bytes/tri"] = compressed_size / num_triangles;
+	state.counters["raw bytes/tri"] = GetRawSize(meshlet_data) / num_triangles;
+}
+
+static void BM_MeshletCompressionEncode(benchmark::State& state, std::string const & path)
+{
+	auto meshlet_data = BuildMeshlets(path, static_cast<std::uint32_t>(state.range(0)), static_cast<MeshletClusteringMode>(state.range(1)));
+	if (meshlet_data.empty())
+	{
+		state.SkipWithError(("Failed to load " + path).c_str());
+		return;
+	}
+
+	std::vector<CompressedMeshletData> compressed(meshlet_data.size());
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < meshlet_data.size(); i++)
+		{
+			compressed[i] = MeshletCompression::Encode(meshlet_data[i]);
+		}
+		benchmark::DoNotOptimize(compressed.data());
+	}
+
+	SetCompressionCounters(state, meshlet_data, compressed);
+	state.counters["triangles/s"] = benchmark::Counter(static_cast<double>(state.iterations() * GetNumTriangles(meshlet_data)), benchmark::Counter::kIsRate);
+}
+
+// Decodes on `state.range(2)` threads. 0 decodes on the calling thread.
+// The bytes per second are of the decoded index buffers.
+static void BM_MeshletCompressionDecode(benchmark::State& state, std::string const & path)
+{
+	auto meshlet_data = BuildMeshlets(path, static_cast<std::uint32_t>(state.range(0)), static_cast<MeshletClusteringMode>(state.range(1)));
+	if (meshlet_data.empty())
+	{
+		state.SkipWithError(("Failed to load " + path).c_str());
+		return;
+	}
+
+	std::vector<CompressedMeshletData> compressed;
+	for (auto const & data : meshlet_data)
+	{
+		compressed.push_back(MeshletCompression::Encode(data));
+	}
+
+	std::unique_ptr<util::ThreadPool> thread_pool;
+	if (state.range(2) > 0)
+	{
+		thread_pool = std::make_unique<util::ThreadPool>(static_cast<std::size_t>(state.range(2)));
+	}
+
+	std::vector<MeshletData> decoded(meshlet_data.size());
+	for (std::size_t i = 0; i < meshlet_data.size(); i++)
+	{
+		MeshletCompression::Decode(compressed[i], decoded[i], thread_pool.get());
+		if (!IsEqual(meshlet_data[i], decoded[i]))
+		{
+			state.SkipWithError("Decoded meshlets don't match the original");
+			return;
+		}
+	}
+
+	for (auto _ : state)
+	{
+		for (std::size_t i = 0; i < meshlet_data.size(); i++)
+		{
+			MeshletCompression::Decode(compressed[i], decoded[i], thread_pool.get());
+		}
+		benchmark::DoNotOptimize(decoded.data());
+	}
+
+	SetCompressionCounters(state, meshlet_data, compressed);
+	state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * GetRawSize(meshlet_data)));
+	state.counters["triangles/s"] = benchmark::Counter(static_cast<double>(state.iterations() * GetNumTriangles(meshlet_data)), benchmark::Counter::kIsRate);
+}
+
+static int GetNumThreads()
+{
+	return static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+}
+
+// 2 * 256^2 (131K) and 2 * 700^2 (980K) triangles.
+static void GridSizesAndClusteringModes(benchmark::internal::Benchmark* b)
+{
+	b->ArgNames({ "quads", "mode" });
+	for (auto num_quads : { 256, 700 })
+	{
+		b->Args({ num_quads, static_cast<int>(MeshletClusteringMode::SEQUENTIAL) });
+		b->Args({ num_quads, static_cast<int>(MeshletClusteringMode::SPATIAL) });
+	}
+}
+
+static void GridSizesClusteringModesAndThreads(benchmark::internal::Benchmark* b)
+{
+	b->ArgNames({ "quads", "mode", "threads" });
+	for (auto num_quads : { 256, 700 })
+	{
+		for (auto threads : { 0, GetNumThreads() })
+		{
+			b->Args({ num_quads, static_cast<int>(MeshletClusteringMode::SEQUENTIAL), threads });
+			b->Args({ num_quads, static_cast<int>(MeshletClusteringMode::SPATIAL), threads });
+		}
+	}
+}
+
+// The grid size is unused for models.
+static void ClusteringModes(benchmark::internal::Benchmark* b)
+{
+	b->ArgNames({ "", "mode" });
+	b->Args({ 0, static_cast<int>(MeshletClusteringMode::SEQUENTIAL) });
+	b->Args({ 0, static_cast<int>(MeshletClusteringMode::SPATIAL) });
+}
+
+static void ClusteringModesAndThreads(benchmark::internal::Benchmark* b)
+{
+	b->ArgNames({ "", "mode", "threads" });
+	for (auto threads : { 0, GetNumThreads() })
+	{
+		b->Args({ 0, static_cast<int>(MeshletClusteringMode::SEQUENTIAL), threads });
+		b->Args({ 0, static_cast<int>(MeshletClusteringMode::SPATIAL), threads });
+	}
+}
+
+BENCHMARK_CAPTURE(BM_MeshletCompressionEncode, grid, std::string())->Apply(GridSizesAndClusteringModes)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MeshletCompressionEncode, sponza, std::string("sponza/sponza.obj"))->Apply(ClusteringModes)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MeshletCompressionEncode, market, std::string("market/scene.gltf"))->Apply(ClusteringModes)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MeshletCompressionEncode, robot, std::string("robot/scene.gltf"))->Apply(ClusteringModes)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_MeshletCompressionDecode, grid, std::string())->Apply(GridSizesClusteringModesAndThreads)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_MeshletCompressionDecode, sponza, std::string("sponza/sponza.obj"))->Apply(ClusteringModesAndThreads)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_MeshletCompressionDecode, market, std::string("market/scene.gltf"))->Apply(ClusteringModesAndThreads)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_MeshletCompressionDecode, robot, std::string("robot/scene.gltf"))->Apply(ClusteringModesAndThreads)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_MAIN();
@@ -0,0 +1,166 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <filesystem>
+#include <thread>
+
+#include <model_pool.hpp>
+#include <assimp_model_loader.hpp>
+#include <vertex.hpp>
+
+#include "../common/test_util.hpp"
+
+static void RegisterModelLoader()
+{
+	static bool registered_loader = false;
+	if (!registered_loader)
+	{
+		ModelPool::RegisterLoader<AssimpModelLoader>();
+		registered_loader = true;
+	}
+}
+
+// Imports a model that was loaded from disc up front with `state.range(0)` threads.
+static void BM_ModelPoolImport(benchmark::State& state, std::string const & path)
+{
+	static AssimpModelLoader loader;
+	auto model_data = loader.Load(path);
+	if (!model_data || model_data->m_meshes.empty())
+	{
+		state.SkipWithError(("Failed to load " + path).c_str());
+		return;
+	}
+
+	ModelImportSettings settings;
+	settings.m_meshlet_clustering = static_cast<MeshletClusteringMode>(state.range(1));
+	settings.m_num_threads = static_cast<std::uint32_t>(state.range(0));
+
+	CPUModelPool model_pool(false); // Only the import is measured, the data isn't copied.
+	model_pool.SetImportSettings(settings);
+
+	std::size_t num_triangles = 0;
+	for (auto const & mesh : model_data->m_meshes)
+	{
+		num_triangles += mesh.m_num_indices / 3;
+	}
+
+	for (auto _ : state)
+	{
+		auto handle = model_pool.Load<Vertex>(model_data.get());
+		benchmark::DoNotOptimize(handle.m_mesh_handles.data());
+	}
+
+	state.counters["meshes"] = static_cast<double>(model_data->m_meshes.size());
+	state.counters["triangles/s"] = benchmark::Counter(static_cast<double>(state.iterations() * num_triangles), benchmark::Counter::kIsRate);
+}
+
+// Loads a model from disc without (cold) and with (warm) a cooked model cache. `state.range(0)` enables the cache.
+static void BM_ModelPoolLoadFromDisc(benchmark::State& state, std::string const & path)
+{
+	RegisterModelLoader();
+
+	const auto cache_directory = std::filesystem::temp_directory_path() / "skygge_bm_model_pool";
+	const bool warm = state.range(0) != 0;
+
+	ModelImportSettings settings;
+	settings.m_cache_directory = warm ? cache_directory.generic_string() : "";
+
+	CPUModelPool model_pool(false);
+	model_pool.SetImportSettings(settings);
+
+	// Cook the model up front.
+	if (model_pool.LoadWithMaterials<Vertex>(path, nullptr, nullptr).m_mesh_handles.empty())
+	{
+		state.SkipWithError(("Failed to load " + path).c_str());
+		return;
+	}
+
+	for (auto _ : state)
+	{
+		auto handle = model_pool.LoadWithMaterials<Vertex>(path, nullptr, nullptr);
+		benchmark::DoNotOptimize(handle.m_mesh_handles.data());
+	}
+
+	state.SetLabel(warm ? "warm" : "cold");
+
+	if (warm)
+	{
+		std::filesystem::remove_all(cache_directory);
+	}
+}
+
+// Loads five models one after another or concurrently. `state.range(0)` enables asynchronous loading.
+static void BM_ModelPoolLoadConcurrently(benchmark::State& state)
+{
+	RegisterModelLoader();
+
+	const std::vector<std::string> paths = { "robot/scene.gltf", "baby_robot/scene.gltf", "tie/scene.gltf", "tree/scene.gltf", "market/scene.gltf" };
+	const bool async = state.range(0) != 0;
+
+	CPUModelPool model_pool(false);
+
+	for (auto _ : state)
+	{
+		std::vector<ModelHandle> handles;
+		if (async)
+		{
+			std::vector<std::future<ModelHandle>> futures;
+			for (auto const & path : paths)
+			{
+				futures.push_back(model_pool.LoadAsync<Vertex>(path));
+			}
+			for (auto& future : futures)
+			{
+				handles.push_back(future.get());
+			}
+		}
+		else
+		{
+			for (auto const & path : paths)
+			{
+				handles.push_back(model_pool.Load<Vertex>(path));
+			}
+		}
+
+		for (std::size_t i = 0; i < paths.size(); i++)
+		{
+			if (handles[i].m_mesh_handles.empty())
+			{
+				state.SkipWithError(("Failed to load " + paths[i]).c_str());
+				return;
+			}
+		}
+	}
+
+	state.SetLabel(async ? "async" : "sync");
+}
+
+// 1 to N threads, for both clustering modes.
+static void ThreadCounts(benchmark::internal::Benchmark* b)
+{
+	b->ArgNames({ "threads", "mode" });
+	for (auto mode : { MeshletClusteringMode::SEQUENTIAL, MeshletClusteringMode::SPATIAL })
+	{
+		for (std::uint32_t num_threads = 1; num_threads <= std::max(1u, std::thread::hardware_concurrency()); num_threads *= 2)
+		{
+			b->Args({ num_threads, static_cast<int>(mode) });
+		}
+	}
+	b->UseRealTime();
+	b->Unit(benchmark::kMillisecond);
+}
+
+BENCHMARK_CAPTURE(BM_ModelPoolImport, robot, std::string("robot/scene.gltf"))->Apply(ThreadCounts);
+BENCHMARK_CAPTURE(BM_ModelPoolImport, baby_robot, std::string("baby_robot/scene.gltf"))->Apply(ThreadCounts);
+BENCHMARK_CAPTURE(BM_ModelPoolImport, tie, std::string("tie/scene.gltf"))->Apply(ThreadCounts);
+BENCHMARK_CAPTURE(BM_ModelPoolImport, tree, std::string("tree/scene.gltf"))->Apply(ThreadCounts);
+BENCHMARK_CAPTURE(BM_ModelPoolImport, market, std::string("market/scene.gltf"))->Apply(ThreadCounts);
+BENCHMARK_CAPTURE(BM_ModelPoolLoadFromDisc, robot, std::string("robot/scene.gltf"))->ArgName("warm")->Arg(0)->Arg(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_ModelPoolLoadFromDisc, market, std::string("market/scene.gltf"))->ArgName("warm")->Arg(0)->Arg(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ModelPoolLoadConcurrently)->ArgName("async")->Arg(0)->Arg(1)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_MAIN();
@@ -0,0 +1,179 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include <tangent_generator.hpp>
+
+#include "../common/test_util.hpp"
+
+// Shared wave grid with analytic normals and UVs from 0 to 1. (2 triangles per quad)
+static MeshData CreateCurvedGridMesh(std::uint32_t num_quads)
+{
+	auto mesh_data = CreateGridMesh(num_quads, WaveHeight);
+
+	for (std::size_t i = 0; i < mesh_data.m_positions.size(); i++)
+	{
+		auto const & pos = mesh_data.m_positions[i];
+		float dx = 0.1f * std::cos(pos.x * 0.1f) * std::cos(pos.z * 0.1f);
+		float dz = -0.1f * std::sin(pos.x * 0.1f) * std::sin(pos.z * 0.1f);
+		mesh_data.m_normals[i] = glm::normalize(glm::vec3(-dx, 1, -dz));
+		mesh_data.m_uvw[i] /= float(num_quads);
+	}
+
+	return mesh_data;
+}
+
+// The tangent generation the glTF loader used before `TangentGenerator`, as the baseline.
+static std::pair<std::vector<glm::vec3>, std::vector<glm::vec3>> LegacyComputeTangents(MeshData & mesh_data)
+{
+	size_t num_vertices = mesh_data.m_positions.size();
+	std::vector<glm::vec3> tanA(num_vertices, { 0, 0, 0 });
+	std::vector<glm::vec3> tanB(num_vertices, { 0, 0, 0 });
+
+	if (mesh_data.m_uvw.empty())
+	{
+		return { tanA, tanB };
+	}
+
+	std::vector<std::uint32_t>indices;
+	for (auto i = 0; i < mesh_data.m_indices.size(); i += mesh_data.m_indices_stride)
+	{
+		std::uint32_t val = 0;
+
+		memcpy(&val, &mesh_data.m_indices[i], mesh_data.m_indices_stride);
+
+		indices.push_back(val);
+	}
+
+	for (size_t i = 0; i < indices.size(); i += 3) {
+		size_t i0 = indices[i];
+		size_t i1 = indices[i + 1];
+		size_t i2 = indices[i + 2];
+
+		glm::vec3 pos0 = mesh_data.m_positions[i0];
+		glm::vec3 pos1 = mesh_data.m_positions[i1];
+		glm::vec3 pos2 = mesh_data.m_positions[i2];
+
+		auto tex0 = glm::vec2{ mesh_data.m_uvw[i0].x, mesh_data.m_uvw[i0].y };
+		auto tex1 = glm::vec2{ mesh_data.m_uvw[i1].x, mesh_data.m_uvw[i1].y };
+		auto tex2 = glm::vec2{ mesh_data.m_uvw[i2].x, mesh_data.m_uvw[i2].y };
+
+		glm::vec3 edge1, edge2;
+		edge1 = pos1 - pos0;
+		edge2 = pos2 - pos0;
+
+		glm::vec2 uv1, uv2;
+		uv1 = tex1 - tex0;
+		uv2 = tex2 - tex0;
+
+		float r = 1.0f / (uv1.x * uv2.y - uv1.y * uv2.x);
+
+		glm::vec3 tangent(
+				((edge1.x * uv2.y) - (edge2.x * uv1.y)) * r,
+				((edge1.y * uv2.y) - (edge2.y * uv1.y)) * r,
+				((edge1.z * uv2.y) - (edge2.z * uv1.y)) * r
+		);
+
+		glm::vec3 bitangent(
+				((edge1.x * uv2.x) - (edge2.x * uv1.x)) * r,
+				((edge1.y * uv2.x) - (edge2.y * uv1.x)) * r,
+				((edge1.z * uv2.x) - (edge2.z * uv1.x)) * r
+		);
+
+		tanA[i0] = tangent;
+		tanA[i1] = tangent;
+		tanA[i2] = tangent;
+
+		tanB[i0] = bitangent;
+		tanB[i1] = bitangent;
+		tanB[i2] = bitangent;
+	}
+
+	for (std::size_t i = 0; i < mesh_data.m_positions.size(); i++)
+	{
+		const glm::vec3& n = mesh_data.m_normals[i];
+		const glm::vec3& t = tanA[i];
+
+		tanA[i] = glm::normalize(t - n * glm::dot(n, t));
+
+		float w = (glm::dot(glm::cross(n, t), tanB[i]) < 0.0F) ? -1.0F : 1.0F;
+		tanB[i] *= w;
+	}
+
+	return { tanA, tanB };
+}
+
+static void SetVertexCounter(benchmark::State& state, MeshData const & mesh_data)
+{
+	state.counters["vertices/s"] = benchmark::Counter(static_cast<double>(state.iterations() * mesh_data.m_positions.size()), benchmark::Counter::kIsRate);
+}
+
+static void BM_TangentsLegacy(benchmark::State& state)
+{
+	auto mesh_data = CreateCurvedGridMesh(static_cast<std::uint32_t>(state.range(0)));
+
+	for (auto _ : state)
+	{
+		auto tangent_bitangent = LegacyComputeTangents(mesh_data);
+		mesh_data.m_tangents = std::move(tangent_bitangent.first);
+		mesh_data.m_bitangents = std::move(tangent_bitangent.second);
+		benchmark::DoNotOptimize(mesh_data.m_tangents.data());
+	}
+
+	SetVertexCounter(state, mesh_data);
+}
+
+// Arguments: quads per side, mode, SIMD level and number of threads. (0 runs without a thread pool)
+static void BM_TangentsGenerate(benchmark::State& state)
+{
+	auto level = static_cast<util::SIMDLevel>(state.range(2));
+	if (level > util::GetSIMDLevel())
+	{
+		state.SkipWithError("Not supported by this CPU");
+		return;
+	}
+
+	auto mesh_data = CreateCurvedGridMesh(static_cast<std::uint32_t>(state.range(0)));
+	auto mode = static_cast<TangentMode>(state.range(1));
+	auto num_threads = static_cast<std::size_t>(state.range(3));
+	auto thread_pool = num_threads > 0 ? std::make_unique<util::ThreadPool>(num_threads) : nullptr;
+
+	for (auto _ : state)
+	{
+		TangentGenerator::Generate(mesh_data, mode, thread_pool.get(), level);
+		benchmark::DoNotOptimize(mesh_data.m_tangents.data());
+	}
+
+	SetVertexCounter(state, mesh_data);
+}
+
+// 1M and 4M vertices.
+BENCHMARK(BM_TangentsLegacy)->Arg(1000)->Arg(2000)->Unit(benchmark::kMillisecond);
+
+static void GenerateArguments(benchmark::internal::Benchmark* b)
+{
+	const long long num_threads = std::max(2u, std::thread::hardware_concurrency());
+	for (long long num_quads : { 1000, 2000 })
+	{
+		for (auto mode : { TangentMode::ACCUMULATE, TangentMode::MIKKTSPACE })
+		{
+			for (auto level : { util::SIMDLevel::SCALAR, util::SIMDLevel::SSE2, util::SIMDLevel::AVX2 })
+			{
+				b->Args({ num_quads, static_cast<long long>(mode), static_cast<long long>(level), 0 });
+			}
+			b->Args({ num_quads, static_cast<long long>(mode), static_cast<long long>(util::GetSIMDLevel()), num_threads });
+		}
+	}
+}
+BENCHMARK(BM_TangentsGenerate)->Apply(GenerateArguments)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
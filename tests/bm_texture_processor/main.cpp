@@ -0,0 +1,104 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <thread>
+
+#include <texture_processor.hpp>
+
+// Smooth gradients with a little noise, like typical albedo textures.
+static TextureData CreateTexture(std::uint32_t size)
+{
+	std::mt19937 rng(0);
+	std::uniform_int_distribution<int> noise(-6, 6);
+
+	TextureData texture;
+	texture.m_width = size;
+	texture.m_height = size;
+	texture.m_channels = 4;
+	auto pixels = static_cast<std::uint8_t*>(texture.AllocatePixels(size * size * 4));
+	for (std::uint32_t y = 0; y < size; y++)
+	{
+		for (std::uint32_t x = 0; x < size; x++)
+		{
+			auto pixel = &pixels[(y * size + x) * 4];
+			int values[4] = { static_cast<int>(x * 255 / size), static_cast<int>(y * 255 / size), static_cast<int>((x + y) * 127 / (2 * size)) + 64, 255 };
+			for (auto c = 0; c < 4; c++)
+			{
+				pixel[c] = static_cast<std::uint8_t>(std::clamp(values[c] + noise(rng), 0, 255));
+			}
+		}
+	}
+
+	return texture;
+}
+
+static std::unique_ptr<util::ThreadPool> CreateThreadPool(benchmark::State& state)
+{
+	if (state.range(1) > 0)
+	{
+		return std::make_unique<util::ThreadPool>(static_cast<std::size_t>(state.range(1)));
+	}
+	return nullptr;
+}
+
+static void SetPixelCounters(benchmark::State& state, TextureData const & texture)
+{
+	auto megapixels = static_cast<double>(texture.m_width) * texture.m_height / 1e6;
+	state.counters["MP/s"] = benchmark::Counter(static_cast<double>(state.iterations()) * megapixels, benchmark::Counter::kIsRate);
+}
+
+// Compresses level 0 of a `state.range(0)`^2 texture on `state.range(1)` threads. 0 compresses on the calling thread.
+static void BM_TextureCompress(benchmark::State& state, TextureCompression compression)
+{
+	auto texture = CreateTexture(static_cast<std::uint32_t>(state.range(0)));
+	auto thread_pool = CreateThreadPool(state);
+
+	for (auto _ : state)
+	{
+		auto compressed = TextureProcessor::Compress(texture, compression, thread_pool.get());
+		benchmark::DoNotOptimize(compressed.m_pixels);
+	}
+
+	SetPixelCounters(state, texture);
+}
+
+static void BM_TextureGenerateMips(benchmark::State& state)
+{
+	auto texture = CreateTexture(static_cast<std::uint32_t>(state.range(0)));
+	auto thread_pool = CreateThreadPool(state);
+
+	for (auto _ : state)
+	{
+		auto mipmapped = TextureProcessor::GenerateMips(texture, true, false, thread_pool.get());
+		benchmark::DoNotOptimize(mipmapped.m_pixels);
+	}
+
+	SetPixelCounters(state, texture);
+}
+
+static void SizesAndThreads(benchmark::internal::Benchmark* b)
+{
+	b->ArgNames({ "size", "threads" });
+	for (auto size : { 512, 2048 })
+	{
+		for (auto threads : { 0, static_cast<int>(std::max(1u, std::thread::hardware_concurrency())) })
+		{
+			b->Args({ size, threads });
+		}
+	}
+}
+
+BENCHMARK_CAPTURE(BM_TextureCompress, bc1, TextureCompression::BC1)->Apply(SizesAndThreads)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_TextureCompress, bc4, TextureCompression::BC4)->Apply(SizesAndThreads)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_TextureCompress, bc5, TextureCompression::BC5)->Apply(SizesAndThreads)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_TextureCompress, bc7, TextureCompression::BC7)->Apply(SizesAndThreads)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK(BM_TextureGenerateMips)->Apply(SizesAndThreads)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_MAIN();
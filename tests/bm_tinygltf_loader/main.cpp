@@ -0,0 +1,75 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+
+#include <gltf_model_loader.hpp>
+#include <tinygltf_model_loader.hpp>
+#include <util/process_memory.hpp>
+#include <util/thread_pool.hpp>
+
+// Loads a glTF model and reports the peak resident memory of loading it, relative to the memory in use before loading.
+// The peak can only be reset on Linux. Elsewhere run one model per process with `--benchmark_filter`. Pages of the
+// buffers `GLTFModelLoader` maps count towards the peak while they are resident.
+template<typename T>
+static void MeasureLoad(benchmark::State& state, std::string const & path)
+{
+	if (!std::filesystem::exists(path))
+	{
+		state.SkipWithError(("Failed to find " + path).c_str());
+		return;
+	}
+
+	T loader;
+	// Shared by the loads like the import pool of `ModelPool`. `TinyGLTFModelLoader` loads on the calling thread.
+	util::ThreadPool thread_pool(std::max(1u, std::thread::hardware_concurrency()));
+
+	std::size_t peak_memory = 0;
+	std::size_t model_size = 0;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		util::ResetPeakResidentMemory();
+		auto baseline = util::GetResidentMemory();
+		state.ResumeTiming();
+
+		auto model_data = loader.Load(path, &thread_pool);
+		benchmark::DoNotOptimize(model_data.get());
+
+		state.PauseTiming();
+		auto peak = util::GetPeakResidentMemory();
+		peak_memory = std::max(peak_memory, peak > baseline ? peak - baseline : 0);
+		model_size = model_data ? model_data->GetSizeInBytes() : 0;
+		model_data.reset();
+		state.ResumeTiming();
+	}
+
+	const double mb = 1024.0 * 1024.0;
+	state.counters["peak_rss_MB"] = static_cast<double>(peak_memory) / mb;
+	state.counters["model_MB"] = static_cast<double>(model_size) / mb;
+}
+
+static void BM_TinyGLTFLoad(benchmark::State& state, std::string const & path)
+{
+	MeasureLoad<TinyGLTFModelLoader>(state, path);
+}
+
+static void BM_MappedGLTFLoad(benchmark::State& state, std::string const & path)
+{
+	MeasureLoad<GLTFModelLoader>(state, path);
+}
+
+BENCHMARK_CAPTURE(BM_TinyGLTFLoad, bb8, std::string("bb8/scene.gltf"))->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK_CAPTURE(BM_TinyGLTFLoad, robot, std::string("robot/scene.gltf"))->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK_CAPTURE(BM_TinyGLTFLoad, baby_robot, std::string("baby_robot/scene.gltf"))->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK_CAPTURE(BM_MappedGLTFLoad, bb8, std::string("bb8/scene.gltf"))->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK_CAPTURE(BM_MappedGLTFLoad, robot, std::string("robot/scene.gltf"))->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK_CAPTURE(BM_MappedGLTFLoad, baby_robot, std::string("baby_robot/scene.gltf"))->Unit(benchmark::kMillisecond)->Iterations(3);
+BENCHMARK_MAIN();
@@ -19,23 +19,24 @@ DisplacementScene::DisplacementScene() :
 
 void DisplacementScene::LoadResources(std::optional<std::reference_wrapper<util::Progress>> progress)
 {
-	auto image_loader = new STBImageLoader(); // TODO: Memory leak
-
-	auto load_texture_func = [&](std::string path) { return image_loader->LoadFromDisc(path); };
-
-	auto albedo_f = std::async(std::launch::async, load_texture_func, "medieval_blocks/medieval_blocks_06_diff_4k.jpg");
-	auto roughness_f = std::async(std::launch::async, load_texture_func, "medieval_blocks/medieval_blocks_06_ao_rough_metal_4k.jpg");
-	auto displacement_f = std::async(std::launch::async, load_texture_func, "medieval_blocks/medieval_blocks_06_disp_4k.jpg");
-	auto normal_map_f = std::async(std::launch::async, load_texture_func, "medieval_blocks/medieval_blocks_06_nor_4k.jpg");
+	auto textures_f = std::async(std::launch::async, []()
+	{
+		return STBImageLoader::LoadBatch({
+			{ "medieval_blocks/medieval_blocks_06_diff_4k.jpg" },
+			{ "medieval_blocks/medieval_blocks_06_ao_rough_metal_4k.jpg" },
+			{ "medieval_blocks/medieval_blocks_06_disp_4k.jpg", 1 },
+			{ "medieval_blocks/medieval_blocks_06_nor_4k.jpg" } });
+	});
 
 	m_sphere_model = m_model_pool->LoadWithMaterials<Vertex>("jezus/scene.gltf", m_material_pool, m_texture_pool, false);
 
 	MaterialData mat = {};
 	mat.m_base_reflectivity = 0.4f;
-	mat.m_albedo_texture = *albedo_f.get();
-	mat.m_roughness_texture = *roughness_f.get();
-	mat.m_displacement_texture = *displacement_f.get();
-	mat.m_normal_map_texture = *normal_map_f.get();
+	auto textures = textures_f.get();
+	if (textures[0]) mat.m_albedo_texture = *textures[0];
+	if (textures[1]) mat.m_roughness_texture = *textures[1];
+	if (textures[2]) mat.m_displacement_texture = *textures[2];
+	if (textures[3]) mat.m_normal_map_texture = *textures[3];
 	mat.m_base_metallic = 0;
 
 	m_sphere_material_handle = m_material_pool->Load(mat, m_texture_pool);
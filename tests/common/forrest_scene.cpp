@@ -25,30 +25,25 @@ ForrestScene::ForrestScene() :
 
 void ForrestScene::LoadResources(std::optional<std::reference_wrapper<util::Progress>> progress)
 {
-	if (progress) MAKE_CHILD_PROGRESS((*progress).get(), 10);
+	if (progress) MAKE_CHILD_PROGRESS((*progress).get(), 2 + 5 * ModelPool::num_async_load_steps);
 
-	if (progress) PROGRESS((*progress).get(), "Loading `forrest_ground_01_diff_4k`")
+	if (progress) PROGRESS((*progress).get(), "Loading `forrest_ground_01_4k` textures")
 
-	auto image_loader = new STBImageLoader(); // TODO: Memory leak
-
-	auto load_texture_func = [&](std::string path) { return image_loader->LoadFromDisc(path); };
-
-	auto albedo_f = std::async(std::launch::async, load_texture_func, "forrest_ground/forrest_ground_01_diff_4k.jpg");
-	if (progress) PROGRESS((*progress).get(), "Loading `forrest_ground_01_rough_ao_rough_metallic`")
-	auto roughness_f = std::async(std::launch::async, load_texture_func, "forrest_ground/forrest_ground_01_rough_ao_rough_metallic.jpg");
-	if (progress) PROGRESS((*progress).get(), "Loading `forrest_ground_01_disp_4k`")
-	auto displacement_f = std::async(std::launch::async, load_texture_func, "forrest_ground/forrest_ground_01_disp_4k.jpg");
-	if (progress) PROGRESS((*progress).get(), "Loading `forrest_ground_01_nor_4k`")
-	auto normal_map_f = std::async(std::launch::async, load_texture_func, "forrest_ground/forrest_ground_01_nor_4k.jpg");
+	// The textures are decoded concurrently. The displacement map only needs its grey channel.
+	auto textures = STBImageLoader::LoadBatch({
+		{ "forrest_ground/forrest_ground_01_diff_4k.jpg" },
+		{ "forrest_ground/forrest_ground_01_rough_ao_rough_metallic.jpg" },
+		{ "forrest_ground/forrest_ground_01_disp_4k.jpg", 1 },
+		{ "forrest_ground/forrest_ground_01_nor_4k.jpg" } });
 
 	if (progress) PROGRESS((*progress).get(), "Loading forrest material")
 
 	MaterialData mat = {};
 	mat.m_base_reflectivity = 0.4f;
-	mat.m_albedo_texture = *albedo_f.get();
-	mat.m_roughness_texture = *roughness_f.get();
-	mat.m_displacement_texture = *displacement_f.get();
-	mat.m_normal_map_texture = *normal_map_f.get();
+	if (textures[0]) mat.m_albedo_texture = *textures[0];
+	if (textures[1]) mat.m_roughness_texture = *textures[1];
+	if (textures[2]) mat.m_displacement_texture = *textures[2];
+	if (textures[3]) mat.m_normal_map_texture = *textures[3];
 	mat.m_base_metallic = 0;
 	mat.m_base_uv_scale = glm::vec2(5);
 
@@ -60,16 +55,18 @@ void ForrestScene::LoadResources(std::optional<std::reference_wrapper<util::Prog
 	ExtraMaterialData data_tree;
 	data_tree.m_thickness_texture_paths = { "white.png", "black.png" };
 
-	m_tree_model = m_model_pool->LoadWithMaterials<Vertex>("tree/scene.gltf", m_material_pool, m_texture_pool, false, data_tree);
-	if (progress) PROGRESS((*progress).get(), "Loading Floor Model")
-	m_plane_model = m_model_pool->LoadWithMaterials<Vertex>("plane.fbx", m_material_pool, m_texture_pool, false);
-	if (progress) PROGRESS((*progress).get(), "Loading Robot Model")
-	m_object_model = m_model_pool->LoadWithMaterials<Vertex>("robot/scene.gltf", m_material_pool, m_texture_pool, false);
-	if (progress) PROGRESS((*progress).get(), "Loading Baby Robot Model")
-	m_object2_model = m_model_pool->LoadWithMaterials<Vertex>("baby_robot/scene.gltf", m_material_pool, m_texture_pool, false);
-	if (progress) PROGRESS((*progress).get(), "Loading Grass Model")
-	m_grass_model = m_model_pool->LoadWithMaterials<Vertex>("grass/scene.gltf", m_material_pool, m_texture_pool, false, data_gass);
-	if (progress) PROGRESS((*progress).get(), "Loading Tree Model")
+	// Models are parsed and imported concurrently.
+	auto tree_f = m_model_pool->LoadWithMaterialsAsync<Vertex>("tree/scene.gltf", m_material_pool, m_texture_pool, data_tree, progress);
+	auto plane_f = m_model_pool->LoadWithMaterialsAsync<Vertex>("plane.fbx", m_material_pool, m_texture_pool, std::nullopt, progress);
+	auto object_f = m_model_pool->LoadWithMaterialsAsync<Vertex>("robot/scene.gltf", m_material_pool, m_texture_pool, std::nullopt, progress);
+	auto object2_f = m_model_pool->LoadWithMaterialsAsync<Vertex>("baby_robot/scene.gltf", m_material_pool, m_texture_pool, std::nullopt, progress);
+	auto grass_f = m_model_pool->LoadWithMaterialsAsync<Vertex>("grass/scene.gltf", m_material_pool, m_texture_pool, data_gass, progress);
+
+	m_tree_model = tree_f.get();
+	m_plane_model = plane_f.get();
+	m_object_model = object_f.get();
+	m_object2_model = object2_f.get();
+	m_grass_model = grass_f.get();
 
 	if (progress) POP_CHILD_PROGRESS((*progress).get());
 	int x = 0;
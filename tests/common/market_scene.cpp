@@ -23,7 +23,13 @@ void MarketScene::LoadResources(std::optional<std::reference_wrapper<util::Progr
 	if (progress) MAKE_CHILD_PROGRESS((*progress).get(), 2);
 
 	if (progress) PROGRESS((*progress).get(), "Loading Market Model");
+	// The market repeats its props, which are imported once.
+	auto import_settings = m_model_pool->GetImportSettings();
+	auto instanced_import_settings = import_settings;
+	instanced_import_settings.m_preserve_instancing = true;
+	m_model_pool->SetImportSettings(instanced_import_settings);
 	m_market_model = m_model_pool->LoadWithMaterials<Vertex>("market/scene.gltf", m_material_pool, m_texture_pool, false);
+	m_model_pool->SetImportSettings(import_settings);
 
 	/*if (progress) PROGRESS((*progress).get(), "Loading Human Model");
 	m_human_model = m_model_pool->LoadWithMaterials<Vertex>("aguilar/scene.gltf", m_material_pool, m_texture_pool, false);*/
@@ -45,9 +51,7 @@ void MarketScene::BuildScene(std::optional<std::reference_wrapper<util::Progress
 	sg::helper::SetFieldOfView(m_scene_graph, m_camera_node, 40.f);
 	sg::helper::SetFocalDistance(m_scene_graph, m_camera_node, 6.0f);
 
-	auto object = m_scene_graph->CreateNode<sg::MeshComponent>(m_market_model);
-	sg::helper::SetPosition(m_scene_graph, object, glm::vec3(0, 0, 0));
-	sg::helper::SetScale(m_scene_graph, object, glm::vec3(0.1));
+	sg::helper::CreateModelNodes(m_scene_graph, m_market_model, glm::scale(glm::mat4(1), glm::vec3(0.1)));
 	//sg::helper::SetRotation(m_scene_graph, object, glm::vec3(0, 0_deg, 0g));
 
 
@@ -24,9 +24,9 @@ void SpaceshipScene::LoadResources(std::optional<std::reference_wrapper<util::Pr
 
 	if (progress) PROGRESS((*progress).get(), "Loading `forrest_ground_01_diff_4k`")
 
-	auto image_loader = new STBImageLoader(); // TODO: Memory leak
+	STBImageLoader image_loader;
 
-	auto load_texture_func = [&](std::string path) { return image_loader->LoadFromDisc(path); };
+	auto load_texture_func = [&](std::string path) { return image_loader.LoadFromDisc(path, nullptr); };
 
 	if (progress) PROGRESS((*progress).get(), "Loading Floor Model");
 	m_plane_model = m_model_pool->LoadWithMaterials<Vertex>("plane.fbx", m_material_pool, m_texture_pool, false);
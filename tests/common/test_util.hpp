@@ -0,0 +1,178 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <model_pool.hpp>
+#include <util/log.hpp>
+
+// Helpers shared by the tests that run without a GPU.
+
+inline int num_failures = 0;
+
+inline void Check(bool condition, std::string const & message)
+{
+	if (!condition)
+	{
+		LOGE("FAILED: {}", message);
+		num_failures++;
+	}
+}
+
+// Meshlet compression may rotate triangles, so every triangle starts with its smallest local index before comparing.
+inline std::vector<std::uint8_t> NormalizeTriangles(std::vector<std::uint8_t> index_indices)
+{
+	for (std::size_t i = 0; i + 2 < index_indices.size(); i += 3)
+	{
+		auto first = std::min_element(index_indices.begin() + i, index_indices.begin() + i + 3);
+		std::rotate(index_indices.begin() + i, first, index_indices.begin() + i + 3);
+	}
+	return index_indices;
+}
+
+// Everything the pool hands to the GPU backend for a mesh.
+struct MeshAllocation
+{
+	std::uint32_t m_num_vertices = 0;
+	std::uint32_t m_vertex_stride = 0;
+	std::uint32_t m_num_indices = 0;
+	std::uint32_t m_index_stride = 0;
+	std::uint32_t m_num_meshlets = 0;
+
+	// Only copied when the pool keeps the data.
+	std::vector<std::uint8_t> m_vertices;
+	std::vector<std::uint8_t> m_indices;
+	std::vector<std::uint8_t> m_meshlets;
+	std::vector<std::uint32_t> m_vertex_indices;
+	std::vector<std::uint8_t> m_flat_indices;
+
+	bool operator==(MeshAllocation const & other) const = default;
+};
+
+// Model pool without a GPU backend. Only exercises the CPU side of the import. Records every allocation and keeps a
+// copy of its data when `keep_data` is set. The offsets are those of buffers the meshes are appended to.
+class CPUModelPool : public ModelPool
+{
+public:
+	explicit CPUModelPool(bool keep_data = true) : m_keep_data(keep_data) {}
+
+	void Stage(gfx::CommandList*) final {}
+	void PostStage() final {}
+
+	std::vector<MeshAllocation> m_allocations;
+	std::uint64_t m_vertex_buffer_size = 0;
+	std::uint64_t m_index_buffer_size = 0;
+	std::optional<std::uint32_t> m_supported_vertex_stride; // Like a GPU pool with fixed shaders when set.
+
+protected:
+	bool IsVertexStrideSupported(std::uint32_t vertex_stride) const final
+	{
+		return !m_supported_vertex_stride || m_supported_vertex_stride == vertex_stride;
+	}
+
+	ModelHandle::MeshOffsets AllocateMesh(void* vertex_data, std::uint32_t num_vertices, std::uint32_t vertex_stride,
+		void* index_data, std::uint32_t num_indices, std::uint32_t index_stride, void* meshlet_data, std::uint32_t num_meshlets) final
+	{
+		auto& allocation = m_allocations.emplace_back();
+		allocation.m_num_vertices = num_vertices;
+		allocation.m_vertex_stride = vertex_stride;
+		allocation.m_num_indices = num_indices;
+		allocation.m_index_stride = index_stride;
+		allocation.m_num_meshlets = num_meshlets;
+
+		if (m_keep_data)
+		{
+			auto copy = [](std::vector<std::uint8_t>& target, void* data, std::size_t size)
+			{
+				target.resize(size);
+				if (size > 0)
+				{
+					memcpy(target.data(), data, size);
+				}
+			};
+			copy(allocation.m_vertices, vertex_data, static_cast<std::size_t>(num_vertices) * vertex_stride);
+			copy(allocation.m_indices, index_data, static_cast<std::size_t>(num_indices) * index_stride);
+			copy(allocation.m_meshlets, meshlet_data, num_meshlets * sizeof(MeshletDesc));
+			allocation.m_vertex_indices = std::move(m_vertex_indices);
+			allocation.m_flat_indices = std::move(m_flat_indices);
+		}
+
+		ModelHandle::MeshOffsets offsets = { m_vertex_buffer_size, m_index_buffer_size };
+		m_vertex_buffer_size += static_cast<std::uint64_t>(num_vertices) * vertex_stride;
+		m_index_buffer_size += static_cast<std::uint64_t>(num_indices) * index_stride;
+		return offsets;
+	}
+
+	// Called right before `AllocateMesh` for the same mesh.
+	void AllocateMeshShadingBuffers(std::vector<std::uint32_t> vertex_indices, std::vector<std::uint8_t> flat_indices) final
+	{
+		if (m_keep_data)
+		{
+			m_vertex_indices = std::move(vertex_indices);
+			m_flat_indices = std::move(flat_indices);
+		}
+	}
+
+private:
+	bool m_keep_data;
+	std::vector<std::uint32_t> m_vertex_indices;
+	std::vector<std::uint8_t> m_flat_indices;
+};
+
+// Grid of `num_quads` x `num_quads` quads in the xz plane with 32 bit indices, in row order. Texture coordinates are
+// the grid coordinates and the tangent frames are constant. `height` displaces the vertices along y when given.
+inline MeshData CreateGridMesh(std::uint32_t num_quads, std::function<float(float x, float z)> const & height = {})
+{
+	MeshData mesh_data{};
+
+	const auto num_vertices_per_side = num_quads + 1;
+	for (std::uint32_t z = 0; z < num_vertices_per_side; z++)
+	{
+		for (std::uint32_t x = 0; x < num_vertices_per_side; x++)
+		{
+			mesh_data.m_positions.emplace_back(glm::vec3(x, height ? height(float(x), float(z)) : 0.f, z));
+			mesh_data.m_normals.emplace_back(glm::vec3(0, 1, 0));
+			mesh_data.m_uvw.emplace_back(glm::vec3(x, z, 0));
+			mesh_data.m_tangents.emplace_back(glm::vec3(1, 0, 0));
+			mesh_data.m_bitangents.emplace_back(glm::vec3(0, 0, 1));
+		}
+	}
+
+	std::vector<std::uint32_t> indices;
+	for (std::uint32_t z = 0; z < num_quads; z++)
+	{
+		for (std::uint32_t x = 0; x < num_quads; x++)
+		{
+			auto i0 = z * num_vertices_per_side + x;
+			auto i1 = i0 + 1;
+			auto i2 = i0 + num_vertices_per_side;
+			auto i3 = i2 + 1;
+			indices.insert(indices.end(), { i0, i2, i1, i1, i2, i3 });
+		}
+	}
+
+	mesh_data.m_indices_stride = sizeof(std::uint32_t);
+	mesh_data.m_num_indices = indices.size();
+	mesh_data.m_indices.resize(indices.size() * sizeof(std::uint32_t));
+	memcpy(mesh_data.m_indices.data(), indices.data(), mesh_data.m_indices.size());
+
+	return mesh_data;
+}
+
+// Smooth waves, so simplification and optimization have something to preserve.
+inline float WaveHeight(float x, float z)
+{
+	return std::sin(x * 0.1f) * std::cos(z * 0.1f);
+}
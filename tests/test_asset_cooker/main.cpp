@@ -0,0 +1,288 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <asset_cooker.hpp>
+#include <model_pool.hpp>
+#include <material_pool.hpp>
+#include <texture_pool.hpp>
+#include <vertex.hpp>
+#include <util/log.hpp>
+
+#include "../common/test_util.hpp"
+
+namespace fs = std::filesystem;
+
+// Loads `.grid` files. The file contains the number of quads per side of a grid with a single textured material.
+class GridModelLoader : public ResourceLoader<ModelData>
+{
+public:
+	GridModelLoader() : ResourceLoader({ "grid" }) {}
+
+	inline static int m_num_loads = 0;
+
+protected:
+	AnonResource LoadFromDisc(std::string const & path, util::ThreadPool*) final
+	{
+		std::uint32_t num_quads = 0;
+		if (!(std::ifstream(path) >> num_quads))
+		{
+			return nullptr;
+		}
+
+		m_num_loads++;
+
+		auto model_data = std::make_unique<ModelData>();
+		model_data->m_meshes.push_back(CreateGridMesh(num_quads, [](float x, float) { return std::sin(x * 0.3f); }));
+
+		auto& material = model_data->m_materials.emplace_back();
+		memset(material.m_albedo_texture.AllocatePixels(16 * 16 * 4), static_cast<int>(num_quads), 16 * 16 * 4);
+		material.m_albedo_texture.m_width = 16;
+		material.m_albedo_texture.m_height = 16;
+		material.m_albedo_texture.m_channels = 4;
+
+		return model_data;
+	}
+};
+
+// Loads `.tex` files. The file contains the value of every byte of a 8x8 texture.
+class TestTextureLoader : public ResourceLoader<TextureData>
+{
+public:
+	TestTextureLoader() : ResourceLoader({ "tex" }) {}
+
+	inline static int m_num_loads = 0;
+
+protected:
+	AnonResource LoadFromDisc(std::string const & path, util::ThreadPool*) final
+	{
+		int value = 0;
+		if (!(std::ifstream(path) >> value))
+		{
+			return nullptr;
+		}
+
+		m_num_loads++;
+
+		auto texture = std::make_unique<TextureData>();
+		texture->m_width = 8;
+		texture->m_height = 8;
+		texture->m_channels = 4;
+		memset(texture->AllocatePixels(8 * 8 * 4), value, 8 * 8 * 4);
+
+		return texture;
+	}
+};
+
+static const fs::path test_directory = fs::temp_directory_path() / "skygge_test_asset_cooker";
+static const fs::path root_directory = test_directory / "root";
+static const std::string manifest_path = (test_directory / "scene.json").generic_string();
+
+static void WriteFile(fs::path const & path, std::string const & contents)
+{
+	fs::create_directories(path.parent_path());
+	std::ofstream(path, std::ios::trunc) << contents;
+}
+
+static void WriteManifest(bool compress_textures, std::string const & extra_texture = "")
+{
+	auto textures = std::string(R"({ "path": "textures/height.tex", "role": "single_channel", "srgb": false })");
+	if (!extra_texture.empty())
+	{
+		textures += R"(, { "path": ")" + extra_texture + R"(" })";
+	}
+
+	WriteFile(manifest_path, R"({
+		"root": "root",
+		"threads": 2,
+		"compress_textures": )" + std::string(compress_textures ? "true" : "false") + R"(,
+		"models": [
+			{ "path": "grid/model.grid", "vertex": "compressed", "lods": 1, "clustering": "spatial", "optimize": true }
+		],
+		"textures": [ )" + textures + R"( ]
+	})");
+}
+
+static std::size_t CountFiles(fs::path const & directory, std::string const & extension)
+{
+	std::size_t count = 0;
+	for (auto const & entry : fs::directory_iterator(directory))
+	{
+		count += entry.path().extension() == extension ? 1 : 0;
+	}
+
+	return count;
+}
+
+// Cooks the manifest from the root directory, like the cooker tool does. Writes the report.
+static CookerReport Cook(bool force = false)
+{
+	auto manifest = CookerManifest::Load(manifest_path);
+	if (!manifest)
+	{
+		return {};
+	}
+
+	auto working_directory = fs::current_path();
+	fs::current_path(manifest->m_root);
+
+	AssetCooker cooker(*manifest);
+	auto report = cooker.Cook(force);
+	report.Write(manifest->m_report_path);
+
+	fs::current_path(working_directory);
+
+	return report;
+}
+
+static bool HasStatus(CookerReport const & report, CookStatus model, CookStatus texture)
+{
+	return report.m_assets.size() == 2 && report.m_assets[0].m_status == model && report.m_assets[1].m_status == texture;
+}
+
+static void TestManifest()
+{
+	WriteManifest(true);
+	auto manifest = CookerManifest::Load(manifest_path);
+	Check(manifest.has_value(), "manifest: load");
+	if (!manifest)
+	{
+		return;
+	}
+
+	Check(fs::equivalent(manifest->m_root, root_directory), "manifest: root is relative to the manifest");
+	Check(manifest->m_model_directory == "cooked" && manifest->m_texture_directory == "cooked/textures", "manifest: default directories");
+	Check(manifest->m_report_path == "cooked/build_report.json", "manifest: default report");
+	Check(manifest->m_num_threads == 2 && manifest->m_compress_textures, "manifest: options");
+	Check(manifest->m_models.size() == 1 && manifest->m_textures.size() == 1, "manifest: assets");
+	if (manifest->m_models.size() == 1 && manifest->m_textures.size() == 1)
+	{
+		auto const & model = manifest->m_models[0];
+		Check(model.m_path == "grid/model.grid" && model.m_vertex_layout == CookerVertexLayout::COMPRESSED_VERTEX, "manifest: model");
+		Check(model.m_settings.m_num_lods == 1 && model.m_settings.m_optimize_meshes && model.m_settings.m_meshlet_clustering == MeshletClusteringMode::SPATIAL
+			&& model.m_settings.m_compact_indices, "manifest: import settings");
+
+		auto const & texture = manifest->m_textures[0];
+		Check(texture.m_role == TextureRole::SINGLE_CHANNEL && texture.m_mipmap && !texture.m_srgb, "manifest: texture");
+	}
+
+	WriteFile(manifest_path, R"({ "textures": [ { "path": "a.tex", "role": "height" } ] })");
+	Check(!CookerManifest::Load(manifest_path), "manifest: unknown role");
+	WriteFile(manifest_path, R"({ "models": [ { "vertex": "vertex" } ] })");
+	Check(!CookerManifest::Load(manifest_path), "manifest: model without a path");
+	WriteFile(manifest_path, "models:");
+	Check(!CookerManifest::Load(manifest_path), "manifest: not JSON");
+	Check(!CookerManifest::Load((test_directory / "missing.json").generic_string()), "manifest: missing");
+}
+
+static void TestIncrementalBuild()
+{
+	WriteManifest(true);
+	WriteFile(root_directory / "grid" / "model.grid", "16");
+	WriteFile(root_directory / "textures" / "height.tex", "64");
+
+	auto report = Cook();
+	Check(HasStatus(report, CookStatus::COOKED, CookStatus::COOKED), "incremental: first build cooks everything");
+	Check(report.m_assets.size() == 2 && report.m_assets[0].m_num_meshes == 1 && fs::exists(root_directory / report.m_assets[0].m_output), "incremental: cooked model");
+	Check(report.m_texture_stats.m_num_processed == 2 && CountFiles(root_directory / "cooked" / "textures", ".sktx") == 2, "incremental: processed textures");
+
+	auto written = CookerReport::Read((root_directory / "cooked" / "build_report.json").generic_string());
+	Check(written.has_value() && written->m_assets.size() == 2, "incremental: report");
+	if (written && written->m_assets.size() == 2)
+	{
+		for (std::size_t i = 0; i < 2; i++)
+		{
+			auto const & a = report.m_assets[i];
+			auto const & b = written->m_assets[i];
+			Check(a.m_path == b.m_path && a.m_is_model == b.m_is_model && a.m_status == b.m_status && a.m_key == b.m_key && a.m_output == b.m_output
+				&& a.m_num_meshes == b.m_num_meshes && a.m_source_size == b.m_source_size && a.m_source_write_time == b.m_source_write_time, "incremental: report round trip");
+		}
+	}
+
+	auto model_loads = GridModelLoader::m_num_loads;
+	auto texture_loads = TestTextureLoader::m_num_loads;
+	Check(HasStatus(Cook(), CookStatus::UP_TO_DATE, CookStatus::UP_TO_DATE), "incremental: unchanged build");
+	Check(model_loads == GridModelLoader::m_num_loads && texture_loads == TestTextureLoader::m_num_loads, "incremental: unchanged sources aren't loaded");
+
+	// Same size, different contents.
+	WriteFile(root_directory / "textures" / "height.tex", "32");
+	fs::last_write_time(root_directory / "textures" / "height.tex", fs::last_write_time(root_directory / "textures" / "height.tex") + std::chrono::hours(1));
+	Check(HasStatus(Cook(), CookStatus::UP_TO_DATE, CookStatus::COOKED), "incremental: changed texture");
+
+	WriteFile(root_directory / "grid" / "model.grid", "24");
+	report = Cook();
+	Check(HasStatus(report, CookStatus::COOKED, CookStatus::UP_TO_DATE), "incremental: changed model");
+
+	WriteManifest(false);
+	Check(HasStatus(Cook(), CookStatus::COOKED, CookStatus::COOKED), "incremental: changed texture settings");
+	Check(HasStatus(Cook(true), CookStatus::COOKED, CookStatus::COOKED), "incremental: forced build");
+
+	// The client finds the cooked model instead of importing the source.
+	ModelImportSettings settings;
+	settings.m_cache_directory = "cooked";
+	settings.m_num_lods = 1;
+	settings.m_optimize_meshes = true;
+	settings.m_meshlet_clustering = MeshletClusteringMode::SPATIAL;
+
+	auto working_directory = fs::current_path();
+	fs::current_path(root_directory);
+	{
+		CPUModelPool model_pool(false);
+		model_pool.SetImportSettings(settings);
+
+		model_loads = GridModelLoader::m_num_loads;
+		auto handle = model_pool.Load<CompressedVertex>("grid/model.grid");
+		Check(handle.m_mesh_handles.size() == 1 && handle.m_mesh_handles[0].m_num_indices == 24 * 24 * 6, "incremental: client loads the cooked model");
+		Check(model_loads == GridModelLoader::m_num_loads, "incremental: client doesn't import the source");
+	}
+	fs::current_path(working_directory);
+}
+
+static void TestFailures()
+{
+	WriteManifest(true, "textures/missing.tex");
+	auto report = Cook();
+	Check(report.m_assets.size() == 3 && report.m_assets[2].m_status == CookStatus::FAILED, "failures: missing texture");
+	Check(report.GetCount(CookStatus::FAILED) == 1, "failures: other assets are cooked");
+
+	// Failed assets are retried.
+	WriteFile(root_directory / "textures" / "missing.tex", "16");
+	report = Cook();
+	Check(report.m_assets.size() == 3 && report.m_assets[2].m_status == CookStatus::COOKED, "failures: retried");
+
+	WriteFile(root_directory / "grid" / "model.grid", "not a grid");
+	report = Cook();
+	Check(report.m_assets.size() == 3 && report.m_assets[0].m_status == CookStatus::FAILED, "failures: invalid model");
+}
+
+int main()
+{
+	ModelPool::RegisterLoader<GridModelLoader>();
+	TexturePool::RegisterLoader<TestTextureLoader>();
+
+	fs::remove_all(test_directory);
+	fs::create_directories(root_directory);
+
+	TestManifest();
+	TestIncrementalBuild();
+	TestFailures();
+
+	fs::remove_all(test_directory);
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
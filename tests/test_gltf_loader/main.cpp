@@ -0,0 +1,444 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <nlohmann/json.hpp>
+
+#include <gltf_model_loader.hpp>
+#include <util/log.hpp>
+#include <util/thread_pool.hpp>
+
+#include "../common/test_util.hpp"
+
+namespace fs = std::filesystem;
+using json = nlohmann::json;
+
+static bool Near(glm::vec3 const & a, glm::vec3 const & b, float epsilon = 1e-5f)
+{
+	return glm::length(a - b) <= epsilon;
+}
+
+// 1x1 red RGBA image.
+static const std::vector<std::uint8_t> png_image = {
+	0x89, 0x50, 0x4E, 0x47, 0x0D, 0x0A, 0x1A, 0x0A, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x00, 0x01,
+	0x00, 0x00, 0x00, 0x01, 0x08, 0x06, 0x00, 0x00, 0x00, 0x1F, 0x15, 0xC4, 0x89, 0x00, 0x00, 0x00, 0x0D, 0x49, 0x44, 0x41,
+	0x54, 0x78, 0x9C, 0x63, 0xF8, 0xCF, 0xC0, 0xF0, 0x1F, 0x00, 0x05, 0x00, 0x01, 0xFF, 0x89, 0x99, 0x3D, 0x1D, 0x00, 0x00,
+	0x00, 0x00, 0x49, 0x45, 0x4E, 0x44, 0xAE, 0x42, 0x60, 0x82
+};
+
+// Appends `size` bytes to `bin`, padded to 4 bytes, and returns the buffer view.
+static json AddBufferView(std::vector<std::uint8_t> & bin, void const * data, std::size_t size, std::size_t byte_stride = 0)
+{
+	json buffer_view = { { "buffer", 0 }, { "byteOffset", bin.size() }, { "byteLength", size } };
+	if (byte_stride != 0)
+	{
+		buffer_view["byteStride"] = byte_stride;
+	}
+
+	auto bytes = static_cast<std::uint8_t const *>(data);
+	bin.insert(bin.end(), bytes, bytes + size);
+	bin.resize((bin.size() + 3) & ~std::size_t(3), 0);
+
+	return buffer_view;
+}
+
+// Two meshes. The first is a quad with interleaved positions and normals, normalized 16 bit uvs and 8 bit indices,
+// placed by a node and its child. The second is a non indexed triangle with sparse positions, placed by a rotated
+// node, and a line primitive that is skipped. The material uses the image embedded in the buffer.
+static json CreateDocument(std::vector<std::uint8_t> & bin)
+{
+	const float vertices[] = {
+		0, 0, 0, 0, 0, 1,
+		1, 0, 0, 0, 0, 1,
+		0, 1, 0, 0, 0, 1,
+		1, 1, 0, 0, 0, 1,
+	};
+	const std::uint16_t uvs[] = { 0, 0, 65535, 0, 0, 65535, 65535, 65535 };
+	const std::uint8_t indices[] = { 0, 1, 2, 2, 1, 3 };
+	const std::uint8_t sparse_indices[] = { 0, 1, 2 };
+	const float sparse_positions[] = { 0, 0, 0, 2, 0, 0, 0, 2, 0 };
+
+	json document;
+	document["asset"] = { { "version", "2.0" } };
+	document["bufferViews"] = {
+		AddBufferView(bin, vertices, sizeof(vertices), 6 * sizeof(float)),
+		AddBufferView(bin, uvs, sizeof(uvs)),
+		AddBufferView(bin, indices, sizeof(indices)),
+		AddBufferView(bin, sparse_indices, sizeof(sparse_indices)),
+		AddBufferView(bin, sparse_positions, sizeof(sparse_positions)),
+		AddBufferView(bin, png_image.data(), png_image.size()),
+	};
+	document["buffers"] = { { { "byteLength", bin.size() } } };
+
+	document["accessors"] = {
+		{ { "bufferView", 0 }, { "componentType", 5126 }, { "count", 4 }, { "type", "VEC3" } },
+		{ { "bufferView", 0 }, { "byteOffset", 12 }, { "componentType", 5126 }, { "count", 4 }, { "type", "VEC3" } },
+		{ { "bufferView", 1 }, { "componentType", 5123 }, { "normalized", true }, { "count", 4 }, { "type", "VEC2" } },
+		{ { "bufferView", 2 }, { "componentType", 5121 }, { "count", 6 }, { "type", "SCALAR" } },
+		{ { "componentType", 5126 }, { "count", 3 }, { "type", "VEC3" }, { "sparse", {
+			{ "count", 3 },
+			{ "indices", { { "bufferView", 3 }, { "componentType", 5121 } } },
+			{ "values", { { "bufferView", 4 } } },
+		} } },
+	};
+
+	document["meshes"] = {
+		{ { "primitives", { { { "attributes", { { "POSITION", 0 }, { "NORMAL", 1 }, { "TEXCOORD_0", 2 } } }, { "indices", 3 }, { "material", 0 } } } } },
+		{ { "primitives", {
+			{ { "attributes", { { "POSITION", 4 } } } },
+			{ { "attributes", { { "POSITION", 0 } } }, { "mode", 1 } },
+		} } },
+	};
+
+	document["nodes"] = {
+		{ { "mesh", 0 }, { "translation", { 1, 2, 3 } }, { "children", { 1 } } },
+		{ { "mesh", 0 }, { "scale", { 2, 2, 2 } } },
+		{ { "mesh", 1 }, { "rotation", { 0, 0, 0.70710678, 0.70710678 } } },
+	};
+	document["scenes"] = { { { "nodes", { 0, 2 } } } };
+	document["scene"] = 0;
+
+	document["materials"] = { { { "pbrMetallicRoughness", { { "baseColorTexture", { { "index", 0 } } } } }, { "emissiveFactor", { 1, 0.5, 0 } } } };
+	document["textures"] = { { { "source", 0 } } };
+	document["images"] = { { { "bufferView", 5 }, { "mimeType", "image/png" } } };
+
+	return document;
+}
+
+static void WriteFile(fs::path const & path, void const * data, std::size_t size)
+{
+	std::ofstream file(path, std::ios::binary);
+	file.write(static_cast<char const *>(data), static_cast<std::streamsize>(size));
+}
+
+static void WriteGLTF(fs::path const & path, json const & document)
+{
+	auto text = document.dump();
+	WriteFile(path, text.data(), text.size());
+}
+
+static void WriteGLB(fs::path const & path, json const & document, std::vector<std::uint8_t> const & bin)
+{
+	auto text = document.dump();
+	text.resize((text.size() + 3) & ~std::size_t(3), ' ');
+
+	std::vector<std::uint32_t> header = { 0x46546C67, 2, static_cast<std::uint32_t>(12 + 8 + text.size() + 8 + bin.size()) };
+	std::vector<std::uint8_t> glb(reinterpret_cast<std::uint8_t const *>(header.data()), reinterpret_cast<std::uint8_t const *>(header.data() + header.size()));
+
+	auto add_chunk = [&](std::uint32_t type, void const * data, std::size_t size)
+	{
+		std::uint32_t chunk_header[] = { static_cast<std::uint32_t>(size), type };
+		glb.insert(glb.end(), reinterpret_cast<std::uint8_t const *>(chunk_header), reinterpret_cast<std::uint8_t const *>(chunk_header) + sizeof(chunk_header));
+		glb.insert(glb.end(), static_cast<std::uint8_t const *>(data), static_cast<std::uint8_t const *>(data) + size);
+	};
+	add_chunk(0x4E4F534A, text.data(), text.size());
+	add_chunk(0x004E4942, bin.data(), bin.size());
+
+	WriteFile(path, glb.data(), glb.size());
+}
+
+static std::string EncodeBase64(std::vector<std::uint8_t> const & bytes)
+{
+	static const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+	std::string text;
+	for (std::size_t i = 0; i < bytes.size(); i += 3)
+	{
+		std::uint32_t bits = bytes[i] << 16;
+		bits |= i + 1 < bytes.size() ? bytes[i + 1] << 8 : 0;
+		bits |= i + 2 < bytes.size() ? bytes[i + 2] : 0;
+
+		text.push_back(alphabet[(bits >> 18) & 63]);
+		text.push_back(alphabet[(bits >> 12) & 63]);
+		text.push_back(i + 1 < bytes.size() ? alphabet[(bits >> 6) & 63] : '=');
+		text.push_back(i + 2 < bytes.size() ? alphabet[bits & 63] : '=');
+	}
+
+	return text;
+}
+
+static void CheckModel(std::shared_ptr<ModelData> const & model, std::string const & name)
+{
+	Check(model && model->m_meshes.size() == 2 && model->m_nodes.size() == 3, name + ": meshes and nodes");
+	if (!model || model->m_meshes.size() != 2 || model->m_nodes.size() != 3)
+	{
+		return;
+	}
+
+	auto const & quad = model->m_meshes[0];
+	Check(quad.m_positions.size() == 4 && Near(quad.m_positions[3], glm::vec3(1, 1, 0)), name + ": interleaved positions");
+	Check(quad.m_normals.size() == 4 && Near(quad.m_normals[2], glm::vec3(0, 0, 1)), name + ": interleaved normals");
+	Check(quad.m_uvw.size() == 4 && Near(quad.m_uvw[3], glm::vec3(1, -1, 0)), name + ": normalized uvs");
+	Check(quad.m_indices_stride == 1 && quad.m_num_indices == 6 && quad.GetIndex(5) == 3, name + ": 8 bit indices are kept");
+	Check(quad.m_tangents.size() == 4 && quad.m_bitangents.size() == 4, name + ": tangents");
+	Check(quad.m_material_id == 0, name + ": material");
+
+	auto const & triangle = model->m_meshes[1];
+	Check(triangle.m_positions.size() == 3 && Near(triangle.m_positions[1], glm::vec3(2, 0, 0)), name + ": sparse positions");
+	Check(triangle.m_num_indices == 3 && triangle.GetIndex(2) == 2, name + ": generated indices");
+	Check(triangle.m_normals.size() == 3 && triangle.m_material_id == std::numeric_limits<std::uint32_t>::max(), name + ": missing attributes");
+
+	auto const & nodes = model->m_nodes;
+	Check(nodes[0].m_mesh_id == 0 && nodes[1].m_mesh_id == 0 && nodes[2].m_mesh_id == 1, name + ": node meshes");
+	Check(Near(glm::vec3(nodes[0].m_transform * glm::vec4(0, 0, 0, 1)), glm::vec3(1, 2, 3)), name + ": node translation");
+	Check(Near(glm::vec3(nodes[1].m_transform * glm::vec4(1, 0, 0, 1)), glm::vec3(3, 2, 3)), name + ": child transform");
+	Check(Near(glm::vec3(nodes[2].m_transform * glm::vec4(1, 0, 0, 1)), glm::vec3(0, 1, 0)), name + ": node rotation");
+
+	Check(model->m_materials.size() == 1, name + ": materials");
+	if (model->m_materials.size() == 1)
+	{
+		auto const & material = model->m_materials[0];
+		Check(material.m_albedo_texture.m_pixels && material.m_albedo_texture.m_width == 1
+			&& static_cast<std::uint8_t const *>(material.m_albedo_texture.m_pixels)[0] == 255, name + ": embedded image");
+		Check(!material.m_metallic_texture.m_pixels && std::abs(material.m_base_emissive - 1.5f) < 1e-5f, name + ": material properties");
+	}
+}
+
+static void TestFormats(fs::path const & test_directory, util::ThreadPool* thread_pool)
+{
+	GLTFModelLoader loader;
+
+	std::vector<std::uint8_t> bin;
+	auto document = CreateDocument(bin);
+
+	// External buffers are memory mapped, their URIs are percent encoded.
+	WriteFile(test_directory / "quad data.bin", bin.data(), bin.size());
+	auto external = document;
+	external["buffers"][0]["uri"] = "quad%20data.bin";
+	WriteGLTF(test_directory / "external.gltf", external);
+	CheckModel(loader.Load((test_directory / "external.gltf").generic_string(), thread_pool), "external buffer");
+
+	WriteGLB(test_directory / "binary.glb", document, bin);
+	CheckModel(loader.Load((test_directory / "binary.glb").generic_string(), thread_pool), "glb");
+
+	auto embedded = document;
+	embedded["buffers"][0]["uri"] = "data:application/octet-stream;base64," + EncodeBase64(bin);
+	WriteGLTF(test_directory / "embedded.gltf", embedded);
+	CheckModel(loader.Load((test_directory / "embedded.gltf").generic_string(), thread_pool), "data uri");
+}
+
+// Vertex stream that stores every delta as a full byte. Valid, but larger than what the reference encoder writes.
+static std::vector<std::uint8_t> EncodeVertices(std::vector<std::uint8_t> const & vertices, std::size_t stride)
+{
+	std::vector<std::uint8_t> data = { 0xA0 };
+	const auto count = vertices.size() / stride;
+	const auto block_size = std::min<std::size_t>((8192 / stride) & ~std::size_t(15), 256);
+
+	// The first vertex is relative to the zeros at the end of the tail.
+	std::vector<std::uint8_t> last(stride, 0);
+	for (std::size_t first = 0; first < count; first += block_size)
+	{
+		const auto num_vertices = std::min(block_size, count - first);
+		const auto num_groups = (num_vertices + 15) / 16;
+		for (std::size_t k = 0; k < stride; k++)
+		{
+			for (std::size_t group = 0; group < num_groups; group += 4)
+			{
+				std::uint8_t header = 0;
+				for (std::size_t i = group; i < std::min(group + 4, num_groups); i++)
+				{
+					header |= 3 << ((i - group) * 2);
+				}
+				data.push_back(header);
+			}
+
+			for (std::size_t i = 0; i < num_groups * 16; i++)
+			{
+				std::uint8_t zigzag = 0;
+				if (i < num_vertices)
+				{
+					auto value = vertices[(first + i) * stride + k];
+					auto delta = static_cast<std::int8_t>(value - last[k]);
+					zigzag = static_cast<std::uint8_t>((delta << 1) ^ (delta >> 7));
+					last[k] = value;
+				}
+				data.push_back(zigzag);
+			}
+		}
+	}
+
+	data.resize(data.size() + std::max<std::size_t>(32, stride), 0);
+	return data;
+}
+
+// Index sequence that encodes every index relative to the previous one.
+static std::vector<std::uint8_t> EncodeIndexSequence(std::vector<std::uint32_t> const & indices)
+{
+	std::vector<std::uint8_t> data = { 0xD1 };
+	std::uint32_t last = 0;
+	for (auto index : indices)
+	{
+		auto delta = static_cast<std::int32_t>(index - last);
+		auto v = ((static_cast<std::uint32_t>(delta) << 1) ^ static_cast<std::uint32_t>(delta >> 31)) << 1;
+		last = index;
+
+		do
+		{
+			data.push_back(static_cast<std::uint8_t>((v & 127) | (v > 127 ? 128 : 0)));
+			v >>= 7;
+		} while (v != 0);
+	}
+
+	data.resize(data.size() + 4, 0);
+	return data;
+}
+
+// A quantized triangle like gltfpack writes: 16 bit positions, octahedral 8 bit normals, normalized 16 bit uvs with a
+// texture transform and 16 bit indices. Every buffer view is compressed into `bin`, the fallback buffer has no data.
+static json CreateMeshoptDocument(std::vector<std::uint8_t> & bin)
+{
+	const std::vector<std::uint16_t> positions = { 0, 0, 0, 0, 2, 0, 0, 0, 0, 2, 0, 0 };
+	const std::vector<std::int8_t> normals = { 0, 0, 127, 0, 0, 0, 127, 0, 0, 0, 127, 0 };
+	const std::vector<std::uint16_t> uvs = { 0, 0, 65535, 0, 0, 65535 };
+
+	auto bytes = [](auto const & values)
+	{
+		auto data = reinterpret_cast<std::uint8_t const *>(values.data());
+		return std::vector<std::uint8_t>(data, data + values.size() * sizeof(values[0]));
+	};
+
+	std::size_t fallback_size = 0;
+	auto add_view = [&](std::vector<std::uint8_t> const & compressed, std::size_t stride, std::size_t count, std::string const & mode, std::string const & filter)
+	{
+		json buffer_view = { { "buffer", 1 }, { "byteOffset", fallback_size }, { "byteLength", stride * count } };
+		if (mode == "ATTRIBUTES")
+		{
+			buffer_view["byteStride"] = stride;
+		}
+		buffer_view["extensions"]["EXT_meshopt_compression"] = { { "buffer", 0 }, { "byteOffset", bin.size() }, { "byteLength", compressed.size() },
+			{ "byteStride", stride }, { "count", count }, { "mode", mode }, { "filter", filter } };
+
+		bin.insert(bin.end(), compressed.begin(), compressed.end());
+		bin.resize((bin.size() + 3) & ~std::size_t(3), 0);
+		fallback_size += (stride * count + 3) & ~std::size_t(3);
+
+		return buffer_view;
+	};
+
+	json document;
+	document["asset"] = { { "version", "2.0" } };
+	document["extensionsUsed"] = { "EXT_meshopt_compression", "KHR_mesh_quantization", "KHR_texture_transform" };
+	document["extensionsRequired"] = { "EXT_meshopt_compression", "KHR_mesh_quantization" };
+	document["bufferViews"] = {
+		add_view(EncodeVertices(bytes(positions), 8), 8, 3, "ATTRIBUTES", "NONE"),
+		add_view(EncodeVertices(bytes(normals), 4), 4, 3, "ATTRIBUTES", "OCTAHEDRAL"),
+		add_view(EncodeVertices(bytes(uvs), 4), 4, 3, "ATTRIBUTES", "NONE"),
+		add_view(EncodeIndexSequence({ 0, 1, 2 }), 2, 3, "INDICES", "NONE"),
+	};
+	document["buffers"] = {
+		{ { "byteLength", bin.size() }, { "uri", "meshopt.bin" } },
+		{ { "byteLength", fallback_size }, { "extensions", { { "EXT_meshopt_compression", { { "fallback", true } } } } } },
+	};
+
+	document["accessors"] = {
+		{ { "bufferView", 0 }, { "componentType", 5123 }, { "count", 3 }, { "type", "VEC3" } },
+		{ { "bufferView", 1 }, { "componentType", 5120 }, { "normalized", true }, { "count", 3 }, { "type", "VEC3" } },
+		{ { "bufferView", 2 }, { "componentType", 5123 }, { "normalized", true }, { "count", 3 }, { "type", "VEC2" } },
+		{ { "bufferView", 3 }, { "componentType", 5123 }, { "count", 3 }, { "type", "SCALAR" } },
+	};
+
+	document["meshes"] = { { { "primitives", { { { "attributes", { { "POSITION", 0 }, { "NORMAL", 1 }, { "TEXCOORD_0", 2 } } }, { "indices", 3 }, { "material", 0 } } } } } };
+	document["nodes"] = { { { "mesh", 0 } } };
+	document["scenes"] = { { { "nodes", { 0 } } } };
+
+	json texture_transform = { { "offset", { 0.5, 0 } }, { "scale", { 2, 2 } } };
+	document["materials"] = { { { "pbrMetallicRoughness", { { "baseColorTexture", { { "index", 0 }, { "extensions", { { "KHR_texture_transform", texture_transform } } } } } } } } };
+	document["textures"] = { json::object() };
+
+	return document;
+}
+
+static void TestMeshopt(fs::path const & test_directory, util::ThreadPool* thread_pool)
+{
+	GLTFModelLoader loader;
+
+	std::vector<std::uint8_t> bin;
+	auto document = CreateMeshoptDocument(bin);
+	WriteFile(test_directory / "meshopt.bin", bin.data(), bin.size());
+	WriteGLTF(test_directory / "meshopt.gltf", document);
+
+	auto model = loader.Load((test_directory / "meshopt.gltf").generic_string(), thread_pool);
+	Check(model && model->m_meshes.size() == 1 && model->m_nodes.size() == 1, "meshopt: decoded");
+	if (model && model->m_meshes.size() == 1)
+	{
+		auto const & mesh = model->m_meshes[0];
+		Check(mesh.m_positions.size() == 3 && Near(mesh.m_positions[1], glm::vec3(2, 0, 0)) && Near(mesh.m_positions[2], glm::vec3(0, 2, 0)), "meshopt: quantized positions");
+		Check(mesh.m_normals.size() == 3 && Near(mesh.m_normals[1], glm::vec3(0, 0, 1)), "meshopt: octahedral normals");
+		Check(mesh.m_uvw.size() == 3 && Near(mesh.m_uvw[1], glm::vec3(2.5f, 0, 0)) && Near(mesh.m_uvw[2], glm::vec3(0.5f, -2, 0)), "meshopt: texture transform");
+		Check(mesh.m_indices_stride == 2 && mesh.m_num_indices == 3 && mesh.GetIndex(1) == 1 && mesh.GetIndex(2) == 2, "meshopt: index sequence");
+	}
+
+	// The index stream is corrupt and the fallback buffer has no data, so the primitive is skipped.
+	auto index_stream = document["bufferViews"][3]["extensions"]["EXT_meshopt_compression"]["byteOffset"].get<std::size_t>();
+	bin[index_stream] = 0;
+	WriteFile(test_directory / "meshopt.bin", bin.data(), bin.size());
+	auto corrupt = loader.Load((test_directory / "meshopt.gltf").generic_string(), thread_pool);
+	Check(corrupt && corrupt->m_meshes.empty() && corrupt->m_nodes.empty(), "meshopt: corrupt streams");
+}
+
+static void TestInvalidFiles(fs::path const & test_directory, util::ThreadPool* thread_pool)
+{
+	GLTFModelLoader loader;
+
+	std::vector<std::uint8_t> bin;
+	auto document = CreateDocument(bin);
+	document["buffers"][0]["uri"] = "model.bin";
+
+	Check(!loader.Load((test_directory / "missing.gltf").generic_string(), thread_pool), "invalid: missing file");
+
+	// The buffer is shorter than its byte length.
+	WriteFile(test_directory / "model.bin", bin.data(), bin.size() / 2);
+	WriteGLTF(test_directory / "truncated.gltf", document);
+	Check(!loader.Load((test_directory / "truncated.gltf").generic_string(), thread_pool), "invalid: truncated buffer");
+	WriteFile(test_directory / "model.bin", bin.data(), bin.size());
+
+	auto required = document;
+	required["extensionsRequired"] = { "KHR_draco_mesh_compression" };
+	WriteGLTF(test_directory / "required.gltf", required);
+	Check(!loader.Load((test_directory / "required.gltf").generic_string(), thread_pool), "invalid: unsupported required extension");
+
+	// Indices outside their buffer view. The quad and its nodes are skipped.
+	auto out_of_bounds = document;
+	out_of_bounds["accessors"][3]["count"] = 600;
+	WriteGLTF(test_directory / "out_of_bounds.gltf", out_of_bounds);
+	auto model = loader.Load((test_directory / "out_of_bounds.gltf").generic_string(), thread_pool);
+	Check(model && model->m_meshes.size() == 1 && model->m_nodes.size() == 1 && model->m_nodes[0].m_mesh_id == 0, "invalid: invalid primitives are skipped");
+
+	const std::string not_json = "{ \"asset\": ";
+	WriteFile(test_directory / "not_json.gltf", not_json.data(), not_json.size());
+	Check(!loader.Load((test_directory / "not_json.gltf").generic_string(), thread_pool), "invalid: invalid json");
+}
+
+int main()
+{
+	const auto test_directory = fs::temp_directory_path() / "skygge_test_gltf_loader";
+	fs::remove_all(test_directory);
+	fs::create_directories(test_directory);
+
+	// Loaded on the calling thread and with the tasks on a thread pool.
+	util::ThreadPool thread_pool(4);
+	for (auto pool : { static_cast<util::ThreadPool*>(nullptr), &thread_pool })
+	{
+		TestFormats(test_directory, pool);
+		TestMeshopt(test_directory, pool);
+		TestInvalidFiles(test_directory, pool);
+	}
+
+	fs::remove_all(test_directory);
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
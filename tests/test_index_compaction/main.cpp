@@ -0,0 +1,144 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <cstring>
+
+#include <index_compaction.hpp>
+#include <model_pool.hpp>
+#include <vertex.hpp>
+#include <util/log.hpp>
+
+#include "../common/test_util.hpp"
+
+static void TestIndexStride()
+{
+	Check(IndexCompaction::GetIndexStride(3) == 2, "stride: small meshes use 16 bit");
+	Check(IndexCompaction::GetIndexStride(65536) == 2, "stride: 65536 vertices use 16 bit");
+	Check(IndexCompaction::GetIndexStride(65537) == 4, "stride: larger meshes use 32 bit");
+
+	auto mesh = CreateGridMesh(8);
+	auto reference = mesh;
+	bool same = true;
+	for (std::uint32_t stride : { 2, 1, 4 })
+	{
+		IndexCompaction::SetIndexStride(mesh, stride);
+		same &= mesh.m_indices_stride == stride && mesh.m_indices.size() == mesh.m_num_indices * stride;
+		for (std::size_t i = 0; i < mesh.m_num_indices; i++)
+		{
+			same &= mesh.GetIndex(i) == reference.GetIndex(i);
+		}
+	}
+	Check(same, "stride: indices are preserved");
+}
+
+static void TestSplit()
+{
+	// 90601 vertices.
+	auto mesh = CreateGridMesh(300);
+	auto parts = IndexCompaction::Split(mesh, sizeof(Vertex));
+	Check(parts.size() == 2, "split: two parts");
+
+	// The parts draw the same triangles in the same order.
+	std::size_t num_indices = 0, num_vertices = 0;
+	bool same = true, fits = true;
+	for (auto const & part : parts)
+	{
+		fits &= part.m_positions.size() <= max_16bit_vertices && part.m_indices_stride == 2;
+		fits &= part.m_num_indices % (max_primitive_count_limit * 3) == 0 || &part == &parts.back();
+		fits &= part.m_normals.size() == part.m_positions.size() && part.m_bitangents.size() == part.m_positions.size();
+		for (std::size_t i = 0; i < part.m_num_indices; i++)
+		{
+			same &= part.m_positions[part.GetIndex(i)] == mesh.m_positions[mesh.GetIndex(num_indices + i)];
+			same &= part.m_uvw[part.GetIndex(i)] == mesh.m_uvw[mesh.GetIndex(num_indices + i)];
+		}
+		num_indices += part.m_num_indices;
+		num_vertices += part.m_positions.size();
+	}
+	Check(fits, "split: parts use 16 bit indices and end on meshlet boundaries");
+	Check(same && num_indices == mesh.m_num_indices, "split: same triangles");
+	Check(num_vertices - mesh.m_positions.size() <= 2 * 301, "split: only the shared row is duplicated");
+
+	Check(IndexCompaction::Split(CreateGridMesh(200), sizeof(Vertex)).empty(), "split: meshes that fit aren't split");
+	Check(IndexCompaction::Split(mesh, 65536).empty(), "split: not when the duplicated vertices cost more");
+
+	auto small_parts = IndexCompaction::Split(CreateGridMesh(40), sizeof(Vertex), 256);
+	bool small = !small_parts.empty();
+	for (auto const & part : small_parts)
+	{
+		small &= part.m_positions.size() <= 256;
+	}
+	Check(small, "split: vertex limit");
+}
+
+static void TestModelPool()
+{
+	ModelData model_data;
+	model_data.m_meshes.push_back(CreateGridMesh(8));
+	model_data.m_meshes.push_back(CreateGridMesh(300));
+	model_data.m_meshes[0].m_material_id = 0;
+	model_data.m_meshes[1].m_material_id = 0;
+
+	{
+		CPUModelPool model_pool;
+		auto handle = model_pool.Load<Vertex>(&model_data);
+
+		Check(handle.m_mesh_handles.size() == 3, "model pool: large mesh is split");
+		bool compact = model_pool.m_allocations.size() == 3;
+		for (std::size_t i = 0; i < handle.m_mesh_handles.size() && compact; i++)
+		{
+			compact &= handle.m_mesh_handles[i].m_index_stride == 2 && model_pool.m_allocations[i].m_index_stride == 2;
+		}
+		Check(compact, "model pool: 16 bit indices in the handles and the allocations");
+	}
+
+	// Optimized before it is split, the parts are still small enough for 16 bit indices.
+	{
+		ModelImportSettings settings;
+		settings.m_optimize_meshes = true;
+		CPUModelPool model_pool;
+		model_pool.SetImportSettings(settings);
+		auto handle = model_pool.Load<Vertex>(&model_data);
+
+		bool compact = handle.m_mesh_handles.size() == 3;
+		std::uint32_t num_indices = 0;
+		for (std::size_t i = 0; i < handle.m_mesh_handles.size() && compact; i++)
+		{
+			compact &= handle.m_mesh_handles[i].m_index_stride == 2 && model_pool.m_allocations[i].m_num_vertices <= max_16bit_vertices;
+			num_indices += handle.m_mesh_handles[i].m_num_indices;
+		}
+		Check(compact, "model pool: optimized meshes are split");
+		Check(num_indices == (8 * 8 + 300 * 300) * 6, "model pool: optimized meshes keep their triangles");
+	}
+
+	ModelData uncompacted_data;
+	uncompacted_data.m_meshes.push_back(CreateGridMesh(8));
+	uncompacted_data.m_meshes.push_back(CreateGridMesh(8));
+	IndexCompaction::SetIndexStride(uncompacted_data.m_meshes[1], 1);
+
+	ModelImportSettings settings;
+	settings.m_compact_indices = false;
+	CPUModelPool model_pool;
+	model_pool.SetImportSettings(settings);
+	auto handle = model_pool.Load<Vertex>(&uncompacted_data);
+	Check(handle.m_mesh_handles[0].m_index_stride == 4, "model pool: 32 bit indices are kept when disabled");
+	Check(handle.m_mesh_handles[1].m_index_stride == 2, "model pool: 8 bit indices are widened");
+}
+
+int main()
+{
+	TestIndexStride();
+	TestSplit();
+	TestModelPool();
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
@@ -0,0 +1,358 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+
+#include <mesh_simplifier.hpp>
+#include <model_pool.hpp>
+#include <util/log.hpp>
+
+#include "../common/test_util.hpp"
+
+static void SetIndices(MeshData & mesh_data, std::vector<std::uint32_t> const & indices)
+{
+	mesh_data.m_indices_stride = sizeof(std::uint32_t);
+	mesh_data.m_num_indices = indices.size();
+	mesh_data.m_indices.resize(indices.size() * sizeof(std::uint32_t));
+	memcpy(mesh_data.m_indices.data(), indices.data(), mesh_data.m_indices.size());
+}
+
+// Planar mapped texture coordinates and constant tangent frames. Only used for the vertex layout.
+static void SetAttributes(MeshData & mesh_data)
+{
+	for (auto const & p : mesh_data.m_positions)
+	{
+		mesh_data.m_uvw.emplace_back(glm::vec3(p.x, p.z, 0));
+		mesh_data.m_tangents.emplace_back(glm::vec3(1, 0, 0));
+		mesh_data.m_bitangents.emplace_back(glm::vec3(0, 0, 1));
+	}
+}
+
+static std::vector<std::uint32_t> GetIndices(MeshData const & mesh_data)
+{
+	std::vector<std::uint32_t> indices(mesh_data.m_num_indices);
+	for (std::size_t i = 0; i < indices.size(); i++)
+	{
+		indices[i] = mesh_data.GetIndex(i);
+	}
+	return indices;
+}
+
+// Closed unit sphere without seams. Subdivided icosahedron.
+static MeshData CreateSphereMesh(std::uint32_t num_subdivisions)
+{
+	MeshData mesh_data{};
+
+	const float t = (1.0f + std::sqrt(5.0f)) / 2.0f;
+	mesh_data.m_positions = {
+		{ -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+		{ 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+		{ t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 }
+	};
+	std::vector<std::uint32_t> indices = {
+		0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+		1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+		3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+		4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1
+	};
+
+	for (auto & p : mesh_data.m_positions)
+	{
+		p = glm::normalize(p);
+	}
+
+	for (std::uint32_t s = 0; s < num_subdivisions; s++)
+	{
+		std::map<std::pair<std::uint32_t, std::uint32_t>, std::uint32_t> midpoints;
+		auto midpoint = [&](std::uint32_t a, std::uint32_t b)
+		{
+			auto key = std::make_pair(std::min(a, b), std::max(a, b));
+			if (auto it = midpoints.find(key); it != midpoints.end())
+			{
+				return it->second;
+			}
+
+			auto index = static_cast<std::uint32_t>(mesh_data.m_positions.size());
+			mesh_data.m_positions.push_back(glm::normalize(mesh_data.m_positions[a] + mesh_data.m_positions[b]));
+			midpoints.insert({ key, index });
+			return index;
+		};
+
+		std::vector<std::uint32_t> subdivided;
+		for (std::size_t i = 0; i < indices.size(); i += 3)
+		{
+			auto i0 = indices[i + 0], i1 = indices[i + 1], i2 = indices[i + 2];
+			auto m01 = midpoint(i0, i1), m12 = midpoint(i1, i2), m20 = midpoint(i2, i0);
+			subdivided.insert(subdivided.end(), { i0, m01, m20, i1, m12, m01, i2, m20, m12, m01, m12, m20 });
+		}
+		indices = subdivided;
+	}
+
+	mesh_data.m_normals = mesh_data.m_positions;
+	SetAttributes(mesh_data);
+	SetIndices(mesh_data, indices);
+
+	return mesh_data;
+}
+
+static float PointTriangleDistance(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c)
+{
+	// Ericson, Real-Time Collision Detection 5.1.5
+	auto ab = b - a, ac = c - a, ap = p - a;
+	float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+	if (d1 <= 0 && d2 <= 0) return glm::length(p - a);
+
+	auto bp = p - b;
+	float d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+	if (d3 >= 0 && d4 <= d3) return glm::length(p - b);
+
+	float vc = d1 * d4 - d3 * d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0) return glm::length(p - (a + ab * (d1 / (d1 - d3))));
+
+	auto cp = p - c;
+	float d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+	if (d6 >= 0 && d5 <= d6) return glm::length(p - c);
+
+	float vb = d5 * d2 - d1 * d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0) return glm::length(p - (a + ac * (d2 / (d2 - d6))));
+
+	float va = d3 * d6 - d5 * d4;
+	if (va <= 0 && (d4 - d3) >= 0 && (d5 - d6) >= 0) return glm::length(p - (b + (c - b) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)))));
+
+	float denom = 1.0f / (va + vb + vc);
+	return glm::length(p - (a + ab * (vb * denom) + ac * (vc * denom)));
+}
+
+// Largest distance from a vertex of the original mesh to the simplified surface.
+static float MeasureError(MeshData const & mesh_data, std::vector<std::uint32_t> const & indices)
+{
+	float max_distance = 0;
+	for (auto const & p : mesh_data.m_positions)
+	{
+		float distance = std::numeric_limits<float>::max();
+		for (std::size_t i = 0; i < indices.size(); i += 3)
+		{
+			distance = std::min(distance, PointTriangleDistance(p,
+				mesh_data.m_positions[indices[i + 0]], mesh_data.m_positions[indices[i + 1]], mesh_data.m_positions[indices[i + 2]]));
+		}
+		max_distance = std::max(max_distance, distance);
+	}
+	return max_distance;
+}
+
+static void TestReduction(MeshData const & mesh_data, std::string const & name)
+{
+	auto indices = GetIndices(mesh_data);
+
+	for (float ratio : { 0.5f, 0.25f, 0.1f })
+	{
+		auto target = static_cast<std::size_t>(indices.size() * ratio) / 3 * 3;
+
+		float error = 0;
+		auto result = MeshSimplifier::Simplify(mesh_data, indices, target, 1e10f, {}, &error);
+		auto measured_error = MeasureError(mesh_data, result);
+
+		LOG("{}: ratio {}: {} -> {} triangles, reported error {}, measured error {}", name, ratio, indices.size() / 3, result.size() / 3, error, measured_error);
+
+		// A collapse removes at most a couple of triangles more than needed.
+		Check(result.size() <= target && result.size() + 3 * 4 >= target, name + ": reduction ratio");
+		Check(result.size() % 3 == 0, name + ": whole triangles");
+		// The quadric error is a sum of squared plane distances, so it is not a strict upper bound. Allow some slack.
+		Check(measured_error <= error * 2.0f + 1e-5f, name + ": reported error bounds the measured error");
+	}
+}
+
+static void TestErrorLimit(MeshData const & mesh_data, std::string const & name)
+{
+	auto indices = GetIndices(mesh_data);
+	std::size_t previous_size = 0;
+
+	for (float max_error : { 1e-1f, 1e-2f, 1e-3f })
+	{
+		float error = 0;
+		auto result = MeshSimplifier::Simplify(mesh_data, indices, 0, max_error, {}, &error);
+
+		Check(error <= max_error, name + ": error is below the limit");
+		Check(result.size() >= previous_size, name + ": a stricter limit removes fewer triangles");
+		previous_size = result.size();
+	}
+}
+
+static void TestBorder(MeshData const & mesh_data, std::uint32_t num_quads)
+{
+	auto indices = GetIndices(mesh_data);
+	// Simplify as far as possible
+	auto result = MeshSimplifier::Simplify(mesh_data, indices, 0, 1e10f);
+
+	std::vector<bool> referenced(mesh_data.m_positions.size(), false);
+	for (auto index : result)
+	{
+		referenced[index] = true;
+	}
+
+	const auto num_vertices_per_side = num_quads + 1;
+	bool border_preserved = true;
+	for (std::uint32_t i = 0; i < num_vertices_per_side; i++)
+	{
+		border_preserved &= referenced[i];
+		border_preserved &= referenced[num_quads * num_vertices_per_side + i];
+		border_preserved &= referenced[i * num_vertices_per_side];
+		border_preserved &= referenced[i * num_vertices_per_side + num_quads];
+	}
+	Check(border_preserved, "grid: border vertices are locked");
+
+	SimplifySettings unlocked;
+	unlocked.m_lock_border = false;
+	auto unlocked_result = MeshSimplifier::Simplify(mesh_data, indices, 0, 1e10f, unlocked);
+	Check(unlocked_result.size() < result.size(), "grid: unlocked borders simplify further");
+}
+
+static void TestModelPoolLODs(MeshData const & mesh_data)
+{
+	ModelData model_data;
+	model_data.m_meshes.push_back(mesh_data);
+
+	ModelImportSettings settings;
+	settings.m_num_lods = 4;
+	settings.m_lod_max_error = 0.1f;
+
+	CPUModelPool model_pool;
+	model_pool.SetImportSettings(settings);
+	auto model_handle = model_pool.Load<Vertex>(&model_data);
+
+	auto const & lods = model_handle.m_mesh_handles[0].m_lods;
+	LOG("model pool: {} levels of detail", lods.size());
+
+	Check(lods.size() > 1, "model pool: generates levels of detail");
+	Check(lods[0].m_num_indices == model_handle.m_mesh_handles[0].m_num_indices, "model pool: LOD 0 is the full resolution mesh");
+	for (std::size_t i = 1; i < lods.size(); i++)
+	{
+		Check(lods[i].m_num_indices < lods[i - 1].m_num_indices, "model pool: triangle count decreases");
+		Check(lods[i].m_error >= lods[i - 1].m_error, "model pool: error increases");
+		Check(lods[i].m_first_index == lods[i - 1].m_first_index + lods[i - 1].m_num_indices, "model pool: indices are consecutive");
+		Check(lods[i].m_first_meshlet == lods[i - 1].m_first_meshlet + lods[i - 1].m_num_meshlets, "model pool: meshlets are consecutive");
+		Check(lods[i].m_num_meshlets > 0, "model pool: every level has meshlets");
+	}
+}
+
+// Triangles of the selected meshlets as indices into the vertex buffer of the mesh.
+static std::vector<std::uint32_t> GetCutIndices(MeshletHierarchy const & hierarchy, std::vector<std::uint32_t> const & cut)
+{
+	auto const & meshlet_data = hierarchy.m_meshlet_data;
+
+	std::vector<std::uint32_t> indices;
+	for (auto meshlet : cut)
+	{
+		auto const & desc = meshlet_data.m_meshlets[meshlet];
+		for (std::uint32_t i = 0; i < desc.GetNumPrims() * 3; i++)
+		{
+			indices.push_back(meshlet_data.m_vertex_indices[desc.GetVertexBegin() + meshlet_data.m_index_indices[desc.GetPrimBegin() * 3 + i]]);
+		}
+	}
+	return indices;
+}
+
+// Every edge is used exactly once in each direction, so there are no cracks and no overlapping triangles.
+static bool IsWatertight(std::vector<std::uint32_t> const & indices)
+{
+	std::map<std::pair<std::uint32_t, std::uint32_t>, std::uint32_t> edges;
+	for (std::size_t i = 0; i < indices.size(); i += 3)
+	{
+		for (std::size_t k = 0; k < 3; k++)
+		{
+			edges[{ indices[i + k], indices[i + (k + 1) % 3] }]++;
+		}
+	}
+
+	for (auto const & [edge, count] : edges)
+	{
+		auto opposite = edges.find({ edge.second, edge.first });
+		if (count != 1 || opposite == edges.end() || opposite->second != 1)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void TestMeshletHierarchy(MeshData const & mesh_data)
+{
+	auto bbox = MeshletBuilder::CalculateBoundingBox(mesh_data);
+
+	MeshletHierarchy hierarchy;
+	MeshletBuilder::BuildHierarchy(mesh_data, bbox, hierarchy);
+
+	std::size_t num_roots = 0;
+	bool monotonic = true;
+	for (auto const & node : hierarchy.m_nodes)
+	{
+		if (node.m_parent_error == FLT_MAX)
+		{
+			num_roots++;
+			continue;
+		}
+
+		monotonic &= node.m_parent_error >= node.m_error;
+		monotonic &= glm::length(node.m_parent_center - node.m_center) + node.m_radius <= node.m_parent_radius * 1.0001f + 1e-5f;
+	}
+
+	LOG("hierarchy: {} levels, {} meshlets, {} roots", hierarchy.m_num_levels, hierarchy.m_nodes.size(), num_roots);
+
+	Check(hierarchy.m_num_levels > 2, "hierarchy: builds multiple levels");
+	Check(hierarchy.m_nodes.size() == hierarchy.m_meshlet_data.m_meshlets.size(), "hierarchy: one node per meshlet");
+	Check(monotonic, "hierarchy: parent bounds contain the meshlet bounds and the error is monotonic");
+
+	// A threshold of 0 selects the full resolution mesh, an infinite threshold the roots.
+	auto full_cut = GetCutIndices(hierarchy, MeshletBuilder::SelectCut(hierarchy, glm::vec3(0, 0, 10), 0.f));
+	auto root_cut = MeshletBuilder::SelectCut(hierarchy, glm::vec3(0, 0, 10), FLT_MAX);
+	Check(full_cut.size() == mesh_data.m_num_indices, "hierarchy: zero threshold selects level 0");
+	Check(root_cut.size() == num_roots, "hierarchy: infinite threshold selects the roots");
+	Check(IsWatertight(GetCutIndices(hierarchy, root_cut)), "hierarchy: roots are watertight");
+
+	bool watertight = true;
+	for (auto const & view_pos : { glm::vec3(0, 0, 1.5f), glm::vec3(3, 0, 0), glm::vec3(-2, 5, 1), glm::vec3(0, -30, 0), glm::vec3(0.5f, 0.2f, 0.1f) })
+	{
+		for (float threshold : { 1e-3f, 1e-2f, 3e-2f, 1e-1f })
+		{
+			auto cut = GetCutIndices(hierarchy, MeshletBuilder::SelectCut(hierarchy, view_pos, threshold));
+			watertight &= IsWatertight(cut);
+		}
+	}
+	Check(watertight, "hierarchy: every cut is watertight");
+
+	// Serialization round trip
+	auto serialized = MeshletBuilder::SerializeHierarchy(hierarchy);
+	MeshletHierarchy deserialized;
+	Check(MeshletBuilder::DeserializeHierarchy(serialized.data(), serialized.size(), deserialized), "hierarchy: deserializes");
+	Check(MeshletBuilder::SerializeHierarchy(deserialized) == serialized, "hierarchy: serialization round trip");
+	Check(!MeshletBuilder::DeserializeHierarchy(serialized.data(), serialized.size() / 2, deserialized), "hierarchy: rejects truncated data");
+}
+
+int main()
+{
+	auto sphere = CreateSphereMesh(4);
+	auto grid = CreateGridMesh(32, WaveHeight);
+
+	TestReduction(sphere, "sphere");
+	TestReduction(grid, "grid");
+	TestErrorLimit(sphere, "sphere");
+	TestErrorLimit(grid, "grid");
+	TestBorder(grid, 32);
+	TestModelPoolLODs(sphere);
+	TestMeshletHierarchy(CreateSphereMesh(5));
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
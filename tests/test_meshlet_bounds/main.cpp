@@ -0,0 +1,119 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <string>
+#include <vector>
+
+#include <meshlet_builder.hpp>
+#include <util/log.hpp>
+
+#include "../common/test_util.hpp"
+
+static bool IsBackfacing(MeshletBounds const & bounds, glm::vec3 const & view_pos)
+{
+	return glm::dot(glm::normalize(bounds.m_cone_apex - view_pos), bounds.m_cone_axis) >= bounds.m_cone_cutoff;
+}
+
+static MeshletData BuildMeshlets(MeshData const & mesh_data, MeshletClusteringMode mode)
+{
+	MeshletData meshlet_data;
+	MeshletBuilder::Build(mesh_data, MeshletBuilder::CalculateBoundingBox(mesh_data), meshlet_data, mode);
+	return meshlet_data;
+}
+
+// A single quad facing +y. Visible from above, backfacing from below.
+static void TestQuad()
+{
+	auto quad = CreateGridMesh(1);
+	auto meshlet_data = BuildMeshlets(quad, MeshletClusteringMode::SEQUENTIAL);
+
+	Check(meshlet_data.m_meshlets.size() == 1 && meshlet_data.m_bounds.size() == 1, "quad: one meshlet with bounds");
+	if (meshlet_data.m_bounds.size() != 1)
+	{
+		return;
+	}
+
+	auto const & bounds = meshlet_data.m_bounds[0];
+	for (auto const & pos : quad.m_positions)
+	{
+		Check(glm::length(pos - bounds.m_sphere_center) <= bounds.m_sphere_radius + 1e-5f, "quad: sphere contains the vertices");
+	}
+
+	Check(glm::dot(bounds.m_cone_axis, glm::vec3(0, 1, 0)) > 0.999f, "quad: cone axis is the face normal");
+	Check(bounds.m_cone_cutoff < 1e-3f, "quad: flat meshlet has a half sphere cone");
+	Check(IsBackfacing(bounds, glm::vec3(0.5f, -5.f, 0.5f)), "quad: rejected from below");
+	Check(IsBackfacing(bounds, glm::vec3(3.f, -1.f, -2.f)), "quad: rejected from below at an angle");
+	Check(!IsBackfacing(bounds, glm::vec3(0.5f, 5.f, 0.5f)), "quad: not rejected from above");
+	Check(!IsBackfacing(bounds, glm::vec3(3.f, 1.f, -2.f)), "quad: not rejected from above at an angle");
+}
+
+// Every meshlet of a curved surface: the sphere contains its vertices and a view that the cone rejects sees the back of
+// every triangle of the meshlet.
+static void TestGrid(MeshletClusteringMode mode, std::string const & name)
+{
+	auto grid = CreateGridMesh(64, WaveHeight);
+	auto meshlet_data = BuildMeshlets(grid, mode);
+
+	Check(meshlet_data.m_bounds.size() == meshlet_data.m_meshlets.size(), name + ": bounds per meshlet");
+	if (meshlet_data.m_bounds.size() != meshlet_data.m_meshlets.size())
+	{
+		return;
+	}
+
+	std::size_t num_cullable = 0;
+	for (std::size_t i = 0; i < meshlet_data.m_meshlets.size(); i++)
+	{
+		auto const & meshlet = meshlet_data.m_meshlets[i];
+		auto const & bounds = meshlet_data.m_bounds[i];
+		auto vertex_index = [&](std::uint32_t local) { return meshlet_data.m_vertex_indices[meshlet.GetVertexBegin() + local]; };
+
+		bool contained = true;
+		for (std::uint32_t v = 0; v < meshlet.GetNumVertices(); v++)
+		{
+			contained &= glm::length(grid.m_positions[vertex_index(v)] - bounds.m_sphere_center) <= bounds.m_sphere_radius * 1.0001f + 1e-5f;
+		}
+		Check(contained, name + ": sphere of meshlet " + std::to_string(i) + " contains its vertices");
+
+		if (bounds.m_cone_cutoff >= 1.f)
+		{
+			continue;
+		}
+		num_cullable++;
+
+		// Straight behind the apex, against the axis.
+		auto view_pos = bounds.m_cone_apex - bounds.m_cone_axis * 10.f;
+		Check(IsBackfacing(bounds, view_pos), name + ": meshlet " + std::to_string(i) + " rejected from behind");
+
+		bool all_backfacing = true;
+		for (std::uint32_t p = 0; p < meshlet.GetNumPrims(); p++)
+		{
+			auto prim = (meshlet.GetPrimBegin() + p) * 3;
+			auto const & v0 = grid.m_positions[vertex_index(meshlet_data.m_index_indices[prim + 0])];
+			auto const & v1 = grid.m_positions[vertex_index(meshlet_data.m_index_indices[prim + 1])];
+			auto const & v2 = grid.m_positions[vertex_index(meshlet_data.m_index_indices[prim + 2])];
+			all_backfacing &= glm::dot(glm::cross(v1 - v0, v2 - v0), v0 - view_pos) >= -1e-5f;
+		}
+		Check(all_backfacing, name + ": triangles of meshlet " + std::to_string(i) + " are backfacing when rejected");
+	}
+
+	Check(num_cullable > 0, name + ": smooth surface has cullable meshlets");
+}
+
+int main()
+{
+	TestQuad();
+	TestGrid(MeshletClusteringMode::SEQUENTIAL, "sequential");
+	TestGrid(MeshletClusteringMode::SPATIAL, "spatial");
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
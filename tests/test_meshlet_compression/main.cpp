@@ -0,0 +1,114 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include <meshlet_builder.hpp>
+#include <meshlet_compression.hpp>
+#include <util/log.hpp>
+#include <util/thread_pool.hpp>
+
+#include "../common/test_util.hpp"
+
+// The codec may rotate triangles. The winding and everything else has to match exactly.
+static bool IsEqual(MeshletData const & a, MeshletData const & b)
+{
+	return a.m_meshlets.size() == b.m_meshlets.size()
+		&& (a.m_meshlets.empty() || memcmp(a.m_meshlets.data(), b.m_meshlets.data(), a.m_meshlets.size() * sizeof(MeshletDesc)) == 0)
+		&& a.m_vertex_indices == b.m_vertex_indices
+		&& NormalizeTriangles(a.m_index_indices) == NormalizeTriangles(b.m_index_indices);
+}
+
+// Shuffles the vertex order, so the vertex indices of a meshlet jump back and forth.
+static void ShuffleVertices(MeshData & mesh_data)
+{
+	std::vector<std::uint32_t> remap(mesh_data.m_positions.size());
+	std::iota(remap.begin(), remap.end(), 0);
+	std::shuffle(remap.begin(), remap.end(), std::mt19937(0));
+
+	auto positions = mesh_data.m_positions;
+	for (std::size_t i = 0; i < remap.size(); i++)
+	{
+		mesh_data.m_positions[remap[i]] = positions[i];
+	}
+
+	auto indices = reinterpret_cast<std::uint32_t*>(mesh_data.m_indices.data());
+	for (std::size_t i = 0; i < mesh_data.m_num_indices; i++)
+	{
+		indices[i] = remap[indices[i]];
+	}
+}
+
+static MeshletData BuildMeshlets(std::vector<MeshData> const & meshes, MeshletClusteringMode mode)
+{
+	MeshletData meshlet_data;
+	for (auto const & mesh_data : meshes)
+	{
+		MeshletBuilder::Build(mesh_data, MeshletBuilder::CalculateBoundingBox(mesh_data), meshlet_data, mode);
+	}
+	return meshlet_data;
+}
+
+static void TestRoundTrip(MeshletData const & meshlet_data, util::ThreadPool & thread_pool, std::string const & name)
+{
+	auto compressed = MeshletCompression::Encode(meshlet_data);
+
+	MeshletData decoded;
+	MeshletCompression::Decode(compressed, decoded);
+	Check(IsEqual(decoded, meshlet_data), name + ": single threaded decode");
+
+	// Decoding replaces what is in `out`.
+	MeshletData batched = meshlet_data;
+	MeshletCompression::Decode(compressed, batched, &thread_pool);
+	Check(IsEqual(batched, meshlet_data), name + ": batched decode");
+
+	if (!meshlet_data.m_meshlets.empty())
+	{
+		auto raw_size = meshlet_data.m_vertex_indices.size() * sizeof(std::uint32_t) + meshlet_data.m_index_indices.size();
+		Check(compressed.m_data.size() < raw_size, name + ": smaller than the raw index buffers");
+		LOG("{}: {} meshlets, {} bytes instead of {}", name, meshlet_data.m_meshlets.size(), compressed.m_data.size(), raw_size);
+	}
+}
+
+int main()
+{
+	util::ThreadPool thread_pool(4);
+
+	auto grid = CreateGridMesh(300, WaveHeight);
+	auto shuffled_grid = grid;
+	ShuffleVertices(shuffled_grid);
+	auto small_grid = CreateGridMesh(4, WaveHeight);
+
+	const std::pair<MeshletClusteringMode, std::string> modes[] = {
+		{ MeshletClusteringMode::SEQUENTIAL, "sequential" },
+		{ MeshletClusteringMode::SPATIAL, "spatial" }
+	};
+
+	for (auto const & [mode, mode_name] : modes)
+	{
+		auto meshlet_data = BuildMeshlets({ grid }, mode);
+		Check(meshlet_data.m_meshlets.size() > meshlet_decode_batch_size, mode_name + ": decoded in more than one batch");
+		TestRoundTrip(meshlet_data, thread_pool, mode_name);
+
+		TestRoundTrip(BuildMeshlets({ shuffled_grid }, mode), thread_pool, mode_name + " shuffled vertices");
+		TestRoundTrip(BuildMeshlets({ small_grid, grid }, mode), thread_pool, mode_name + " multiple meshes");
+	}
+
+	TestRoundTrip(MeshletData{}, thread_pool, "empty");
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
@@ -0,0 +1,135 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#include <meshopt_decoder.hpp>
+#include <util/log.hpp>
+
+#include "../common/test_util.hpp"
+
+// Version 0 index stream from the reference implementation.
+static const std::vector<std::uint8_t> index_data_v0 = {
+	0xE0, 0xF0, 0x10, 0xFE, 0xFF, 0xF0, 0x0C, 0xFF, 0x02, 0x02, 0x02, 0x00, 0x76, 0x87, 0x56, 0x67,
+	0x78, 0xA9, 0x86, 0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0x00, 0x00,
+};
+static const std::vector<std::uint32_t> index_buffer = { 0, 1, 2, 2, 1, 3, 4, 6, 5, 7, 8, 9 };
+
+// 3 vertices of 4 bytes, every byte uses another group encoding.
+static const std::vector<std::uint8_t> vertex_data = {
+	0xA0,
+	0x02, 0x02, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,    // 4 bits: deltas 0, 1, 1
+	0x01, 0x3C, 0x00, 0x00, 0x00, 0x03, 0x03,                // 2 bits with explicit bytes: deltas 0, -2, -2
+	0x00,                                                    // 0 bits: no deltas
+	0x03, 0x00, 0xBF, 0xC7, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 8 bits: deltas 0, 160, 100
+	// Tail, ends with the vertex the first deltas are relative to.
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 10, 20, 30, 40,
+};
+static const std::vector<std::uint8_t> vertex_buffer = { 10, 20, 30, 40, 11, 18, 30, 200, 12, 16, 30, 100 };
+
+// 5, 6, 100 relative to the second baseline and 7.
+static const std::vector<std::uint8_t> sequence_data = { 0xD1, 20, 4, 0x91, 0x03, 4, 0x00, 0x00, 0x00, 0x00 };
+static const std::vector<std::uint32_t> sequence_buffer = { 5, 6, 100, 7 };
+
+static void TestIndexBuffer()
+{
+	std::vector<std::uint32_t> indices(index_buffer.size());
+	bool decoded = MeshoptDecoder::DecodeIndexBuffer(reinterpret_cast<std::uint8_t*>(indices.data()), indices.size(), 4, index_data_v0.data(), index_data_v0.size());
+	Check(decoded && indices == index_buffer, "index buffer: 32 bit");
+
+	std::vector<std::uint16_t> short_indices(index_buffer.size());
+	decoded = MeshoptDecoder::Decode(reinterpret_cast<std::uint8_t*>(short_indices.data()), short_indices.size(), 2, index_data_v0.data(), index_data_v0.size(), MeshoptMode::TRIANGLES);
+	Check(decoded && std::equal(short_indices.begin(), short_indices.end(), index_buffer.begin()), "index buffer: 16 bit");
+
+	// Every truncation is detected.
+	bool rejected = true;
+	for (std::size_t size = 0; size < index_data_v0.size(); size++)
+	{
+		std::vector<std::uint8_t> truncated(index_data_v0.begin(), index_data_v0.begin() + size);
+		rejected &= !MeshoptDecoder::DecodeIndexBuffer(reinterpret_cast<std::uint8_t*>(indices.data()), indices.size(), 4, truncated.data(), truncated.size());
+	}
+	Check(rejected, "index buffer: truncated streams");
+
+	auto wrong_header = index_data_v0;
+	wrong_header[0] = 0xE2;
+	Check(!MeshoptDecoder::DecodeIndexBuffer(reinterpret_cast<std::uint8_t*>(indices.data()), indices.size(), 4, wrong_header.data(), wrong_header.size()), "index buffer: unknown version");
+	Check(!MeshoptDecoder::DecodeIndexBuffer(reinterpret_cast<std::uint8_t*>(indices.data()), 10, 4, index_data_v0.data(), index_data_v0.size()), "index buffer: count is a multiple of 3");
+}
+
+static void TestVertexBuffer()
+{
+	std::vector<std::uint8_t> vertices(vertex_buffer.size());
+	Check(MeshoptDecoder::DecodeVertexBuffer(vertices.data(), 3, 4, vertex_data.data(), vertex_data.size()) && vertices == vertex_buffer, "vertex buffer: group encodings");
+
+	bool rejected = true;
+	for (std::size_t size = 0; size < vertex_data.size(); size++)
+	{
+		std::vector<std::uint8_t> truncated(vertex_data.begin(), vertex_data.begin() + size);
+		rejected &= !MeshoptDecoder::DecodeVertexBuffer(vertices.data(), 3, 4, truncated.data(), truncated.size());
+	}
+	Check(rejected, "vertex buffer: truncated streams");
+	Check(!MeshoptDecoder::DecodeVertexBuffer(vertices.data(), 2, 6, vertex_data.data(), vertex_data.size()), "vertex buffer: stride is a multiple of 4");
+}
+
+static void TestIndexSequence()
+{
+	std::vector<std::uint32_t> indices(sequence_buffer.size());
+	bool decoded = MeshoptDecoder::Decode(reinterpret_cast<std::uint8_t*>(indices.data()), indices.size(), 4, sequence_data.data(), sequence_data.size(), MeshoptMode::INDICES);
+	Check(decoded && indices == sequence_buffer, "index sequence: two baselines");
+
+	std::vector<std::uint8_t> truncated(sequence_data.begin(), sequence_data.end() - 1);
+	Check(!MeshoptDecoder::DecodeIndexSequence(reinterpret_cast<std::uint8_t*>(indices.data()), indices.size(), 4, truncated.data(), truncated.size()), "index sequence: truncated stream");
+}
+
+static void TestFilters()
+{
+	// Octahedral: z stores 1.0, the fourth component is kept.
+	std::int8_t octahedral[] = { 0, 0, 127, 5, 64, 0, 127, 0, -64, 0, 127, 0 };
+	MeshoptDecoder::ApplyFilter(reinterpret_cast<std::uint8_t*>(octahedral), 3, 4, MeshoptFilter::OCTAHEDRAL);
+	Check(octahedral[0] == 0 && octahedral[1] == 0 && octahedral[2] == 127 && octahedral[3] == 5, "octahedral: +z");
+	float length = std::sqrt(float(octahedral[4] * octahedral[4] + octahedral[5] * octahedral[5] + octahedral[6] * octahedral[6]));
+	Check(std::abs(length - 127) < 1.5f && octahedral[4] > 0 && octahedral[6] > 0 && octahedral[8] == -octahedral[4], "octahedral: normalized");
+
+	// The corners of the octahedral map are -z.
+	std::int16_t octahedral16[] = { 32767, 32767, 32767, 0 };
+	MeshoptDecoder::ApplyFilter(reinterpret_cast<std::uint8_t*>(octahedral16), 1, 8, MeshoptFilter::OCTAHEDRAL);
+	Check(octahedral16[0] == 0 && octahedral16[1] == 0 && octahedral16[2] == -32767, "octahedral: 16 bit");
+
+	// Mantissa 3 with exponent -1 and mantissa -5 with exponent 2.
+	std::uint32_t exponential[] = { 0xFF000003, 0x02FFFFFB };
+	MeshoptDecoder::ApplyFilter(reinterpret_cast<std::uint8_t*>(exponential), 2, 4, MeshoptFilter::EXPONENTIAL);
+	float floats[2];
+	memcpy(floats, exponential, sizeof(floats));
+	Check(floats[0] == 1.5f && floats[1] == -20.f, "exponential");
+
+	// Identity quaternion with w dropped: x, y and z are 0.
+	std::int16_t quaternion[] = { 0, 0, 0, static_cast<std::int16_t>(0x7FFC | 3) };
+	MeshoptDecoder::ApplyFilter(reinterpret_cast<std::uint8_t*>(quaternion), 1, 8, MeshoptFilter::QUATERNION);
+	Check(quaternion[0] == 0 && quaternion[1] == 0 && quaternion[2] == 0 && quaternion[3] == 32767, "quaternion");
+
+	Check(!MeshoptDecoder::ApplyFilter(reinterpret_cast<std::uint8_t*>(quaternion), 1, 4, MeshoptFilter::QUATERNION), "filter: invalid stride");
+}
+
+int main()
+{
+	TestIndexBuffer();
+	TestVertexBuffer();
+	TestIndexSequence();
+	TestFilters();
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
@@ -0,0 +1,377 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <model_pool.hpp>
+#include <model_cache.hpp>
+#include <material_pool.hpp>
+#include <texture_pool.hpp>
+#include <vertex.hpp>
+#include <util/log.hpp>
+
+#include "../common/test_util.hpp"
+
+namespace fs = std::filesystem;
+
+// Texture pool without a GPU backend. Keeps a copy of the pixels of every texture.
+class CPUTexturePool : public TexturePool
+{
+public:
+	void Stage(gfx::CommandList*) final {}
+	void PostStage() final {}
+	std::vector<gfx::StagingTexture*> GetTextures(std::vector<std::uint32_t>) final { return {}; }
+
+	std::vector<std::vector<std::uint8_t>> m_pixels;
+
+protected:
+	void Load_Impl(TextureData const & data, std::uint32_t, bool, bool) final
+	{
+		auto pixels = static_cast<std::uint8_t*>(data.m_pixels);
+		m_pixels.emplace_back(pixels, pixels + data.GetSizeInBytes());
+	}
+};
+
+class CPUMaterialPool : public MaterialPool
+{
+public:
+	void Update(MaterialHandle, MaterialData const &) final {}
+
+protected:
+	void Load_Impl(MaterialHandle&, MaterialData const &, TexturePool*) final {}
+};
+
+static const std::uint32_t texture_size = 16;
+
+// Loads `.grid` files. The file contains the number of quads per side of a grid. Every grid has two meshes and two
+// materials with the same texture.
+class GridModelLoader : public ResourceLoader<ModelData>
+{
+public:
+	GridModelLoader() : ResourceLoader({ "grid" }) {}
+
+	static inline int m_num_loads = 0;
+
+protected:
+	AnonResource LoadFromDisc(std::string const & path, util::ThreadPool*) final
+	{
+		m_num_loads++;
+
+		std::uint32_t num_quads = 0;
+		std::ifstream(path) >> num_quads;
+
+		auto model_data = std::make_unique<ModelData>();
+		for (std::uint32_t m = 0; m < 2; m++)
+		{
+			model_data->m_meshes.push_back(CreateGridMesh(num_quads, [m](float x, float) { return m + std::sin(x * 0.3f); }));
+			model_data->m_meshes.back().m_material_id = m;
+
+			MaterialData material;
+			material.m_albedo_texture.m_width = texture_size;
+			material.m_albedo_texture.m_height = texture_size;
+			material.m_albedo_texture.m_channels = 4;
+			material.m_albedo_texture.m_is_hdr = false;
+			material.m_albedo_texture.m_pixels = m_pixels.data();
+			material.m_base_roughness = 0.25f * (m + 1);
+			model_data->m_materials.push_back(material);
+		}
+
+		return model_data;
+	}
+
+private:
+	std::vector<std::uint8_t> m_pixels = std::vector<std::uint8_t>(texture_size * texture_size * 4, 0x7F);
+};
+
+static const fs::path test_directory = fs::temp_directory_path() / "skygge_test_model_cache";
+static const std::string source_path = (test_directory / "grid" / "model.grid").generic_string();
+static const std::string cache_directory = (test_directory / "cooked").generic_string();
+static const std::string texture_directory = (test_directory / "textures").generic_string();
+
+static void WriteSource(std::string const & contents)
+{
+	std::ofstream(source_path, std::ios::trunc) << contents;
+}
+
+struct LoadResult
+{
+	ModelHandle m_handle;
+	std::vector<MeshAllocation> m_allocations;
+	std::vector<std::vector<std::uint8_t>> m_textures;
+	std::optional<TextureProcessorStats> m_processor_stats;
+	bool m_loaded_from_source = false;
+};
+
+static LoadResult Load(ModelImportSettings settings, std::optional<TextureProcessorSettings> const & texture_settings = std::nullopt)
+{
+	settings.m_cache_directory = cache_directory;
+
+	CPUModelPool model_pool;
+	CPUTexturePool texture_pool;
+	CPUMaterialPool material_pool;
+	model_pool.SetImportSettings(settings);
+	texture_pool.SetProcessorSettings(texture_settings);
+
+	auto num_loads = GridModelLoader::m_num_loads;
+
+	LoadResult result;
+	result.m_handle = model_pool.LoadWithMaterials<Vertex>(source_path, &material_pool, &texture_pool);
+	result.m_allocations = model_pool.m_allocations;
+	// Cooked meshlets are stored compressed.
+	for (auto& allocation : result.m_allocations)
+	{
+		allocation.m_flat_indices = NormalizeTriangles(std::move(allocation.m_flat_indices));
+	}
+	result.m_textures = texture_pool.m_pixels;
+	result.m_processor_stats = texture_pool.GetProcessorStats();
+	result.m_loaded_from_source = GridModelLoader::m_num_loads != num_loads;
+
+	return result;
+}
+
+static bool IsEqual(LoadResult const & a, LoadResult const & b)
+{
+	if (a.m_handle.m_mesh_handles.size() != b.m_handle.m_mesh_handles.size())
+	{
+		return false;
+	}
+
+	for (std::size_t i = 0; i < a.m_handle.m_mesh_handles.size(); i++)
+	{
+		auto const & mesh_a = a.m_handle.m_mesh_handles[i];
+		auto const & mesh_b = b.m_handle.m_mesh_handles[i];
+		if (mesh_a.m_num_indices != mesh_b.m_num_indices || mesh_a.m_num_vertices != mesh_b.m_num_vertices || mesh_a.m_index_stride != mesh_b.m_index_stride
+			|| mesh_a.m_bbox_min != mesh_b.m_bbox_min || mesh_a.m_bbox_max != mesh_b.m_bbox_max || mesh_a.m_lods.size() != mesh_b.m_lods.size()
+			|| mesh_a.m_material_handle.has_value() != mesh_b.m_material_handle.has_value())
+		{
+			return false;
+		}
+
+		for (std::size_t lod = 0; lod < mesh_a.m_lods.size(); lod++)
+		{
+			if (memcmp(&mesh_a.m_lods[lod], &mesh_b.m_lods[lod], sizeof(ModelHandle::MeshHandle::LOD)) != 0)
+			{
+				return false;
+			}
+		}
+	}
+
+	return a.m_allocations == b.m_allocations && a.m_textures == b.m_textures;
+}
+
+static void TestWarmStart()
+{
+	ModelImportSettings settings;
+	settings.m_num_lods = 2;
+	settings.m_meshlet_clustering = MeshletClusteringMode::SPATIAL;
+
+	WriteSource("32");
+	auto cold = Load(settings);
+	Check(cold.m_loaded_from_source, "warm start: cold load parses the source");
+	Check(cold.m_handle.m_mesh_handles.size() == 2 && cold.m_handle.m_mesh_handles[0].m_lods.size() > 1, "warm start: meshes with levels of detail");
+
+	auto warm = Load(settings);
+	Check(!warm.m_loaded_from_source, "warm start: warm load uses the cooked model");
+	Check(IsEqual(cold, warm), "warm start: cooked model matches the import");
+
+	// Touching a file without changing it falls back to comparing hashes.
+	fs::last_write_time(source_path, fs::last_write_time(source_path) + std::chrono::hours(1));
+	Check(!Load(settings).m_loaded_from_source, "warm start: touched but unchanged source");
+}
+
+static void TestInvalidation()
+{
+	ModelImportSettings settings;
+
+	WriteSource("32");
+	Load(settings);
+	Check(!Load(settings).m_loaded_from_source, "invalidation: cooked");
+
+	settings.m_optimize_meshes = true;
+	Check(Load(settings).m_loaded_from_source, "invalidation: changed settings");
+	Check(!Load(settings).m_loaded_from_source, "invalidation: changed settings are cooked separately");
+
+	// Same size, different contents.
+	WriteSource("24");
+	auto changed = Load(settings);
+	Check(changed.m_loaded_from_source, "invalidation: changed source");
+	Check(changed.m_handle.m_mesh_handles[0].m_num_indices == 24 * 24 * 6, "invalidation: changed source is imported");
+	Check(!Load(settings).m_loaded_from_source, "invalidation: changed source is cooked");
+
+	// Other files next to the model, like buffers and textures.
+	std::ofstream((test_directory / "grid" / "texture.png").generic_string()) << "pixels";
+	Check(Load(settings).m_loaded_from_source, "invalidation: added dependency");
+	Check(!Load(settings).m_loaded_from_source, "invalidation: added dependency is cooked");
+
+	// Corrupt cooked models are ignored and replaced.
+	for (auto const & entry : fs::directory_iterator(cache_directory))
+	{
+		fs::resize_file(entry.path(), 100);
+	}
+	Check(Load(settings).m_loaded_from_source, "invalidation: corrupt cooked model");
+	Check(!Load(settings).m_loaded_from_source, "invalidation: corrupt cooked model is replaced");
+}
+
+static void TestUnsupportedVertexLayout()
+{
+	ModelImportSettings settings;
+	settings.m_cache_directory = cache_directory;
+
+	WriteSource("16");
+	fs::remove_all(cache_directory);
+
+	CPUModelPool model_pool;
+	model_pool.m_supported_vertex_stride = sizeof(Vertex);
+	model_pool.SetImportSettings(settings);
+
+	auto num_loads = GridModelLoader::m_num_loads;
+	Check(model_pool.Load<CompressedVertex>(source_path).m_mesh_handles.empty(), "vertex layout: unsupported layout fails");
+	Check(model_pool.m_allocations.empty() && GridModelLoader::m_num_loads == num_loads, "vertex layout: nothing is imported or allocated");
+	Check(!fs::exists(cache_directory) || fs::is_empty(cache_directory), "vertex layout: nothing is cooked");
+	Check(!model_pool.Load<Vertex>(source_path).m_mesh_handles.empty(), "vertex layout: supported layout loads");
+}
+
+static std::uintmax_t GetCacheSize()
+{
+	std::uintmax_t size = 0;
+	for (auto const & entry : fs::directory_iterator(cache_directory))
+	{
+		size += entry.file_size();
+	}
+	return size;
+}
+
+// Textures that were processed into the cache of the texture processor are referenced instead of stored again.
+static void TestTextureReferences()
+{
+	ModelImportSettings settings;
+
+	TextureProcessorSettings texture_settings;
+	texture_settings.m_compress = false;
+	texture_settings.m_num_threads = 1;
+	texture_settings.m_cache_directory = texture_directory;
+
+	fs::remove_all(cache_directory);
+	WriteSource("16");
+	Load(settings);
+	auto stored_size = GetCacheSize();
+
+	auto cold = Load(settings, texture_settings);
+	Check(cold.m_loaded_from_source, "references: cold load parses the source");
+	Check(cold.m_textures.size() == 1 && cold.m_textures[0].size() > texture_size * texture_size * 4, "references: texture is processed");
+	Check(GetCacheSize() - stored_size + texture_size * texture_size * 2 < stored_size, "references: pixels aren't stored in the cooked model");
+
+	auto warm = Load(settings, texture_settings);
+	Check(!warm.m_loaded_from_source, "references: warm load uses the cooked model");
+	Check(IsEqual(cold, warm), "references: cooked model matches the import");
+	Check(warm.m_processor_stats && warm.m_processor_stats->m_num_processed == 0 && warm.m_processor_stats->m_num_cache_hits == 1,
+		"references: texture is loaded from the processor cache");
+
+	fs::remove_all(texture_directory);
+	Check(Load(settings, texture_settings).m_loaded_from_source, "references: missing processed texture");
+	Check(!Load(settings, texture_settings).m_loaded_from_source, "references: missing processed texture is cooked");
+
+	// Textures aren't processed without a processor, so its cooked model has to store them.
+	Check(Load(settings).m_loaded_from_source, "references: pool without a processor doesn't use references");
+	Check(!Load(settings).m_loaded_from_source, "references: stored textures are cooked");
+}
+
+static TextureData CreateTexture(std::vector<std::uint8_t> & pixels, std::uint32_t channels)
+{
+	TextureData texture;
+	texture.m_width = 8;
+	texture.m_height = 8;
+	texture.m_channels = channels;
+	texture.m_pixel_channels = channels;
+	texture.m_pixels = pixels.data();
+	return texture;
+}
+
+static void TestTextureDeduplication()
+{
+	std::vector<std::uint8_t> pixels_a(8 * 8 * 4, 1), pixels_b(8 * 8 * 4, 1), pixels_c(8 * 8 * 4, 2), pixels_d(8 * 8, 3);
+
+	// Two mip levels, stored smallest first like KTX2 does.
+	std::vector<std::uint8_t> pixels_e(4 * 4 * 4 + 8 * 8 * 4);
+	std::fill(pixels_e.begin(), pixels_e.begin() + 4 * 4 * 4, 5);
+	std::fill(pixels_e.begin() + 4 * 4 * 4, pixels_e.end(), 4);
+
+	std::vector<MaterialData> materials(4);
+	materials[0].m_albedo_texture = CreateTexture(pixels_a, 4);
+	materials[1].m_albedo_texture = CreateTexture(pixels_b, 4);
+	materials[1].m_normal_map_texture = CreateTexture(pixels_c, 4);
+	materials[1].m_roughness_texture = CreateTexture(pixels_d, 1);
+	materials[2].m_base_metallic = 0.5f;
+	materials[3].m_albedo_texture = CreateTexture(pixels_e, 4);
+	materials[3].m_albedo_texture.m_num_mips = 2;
+	materials[3].m_albedo_texture.m_mip_offsets = { 4 * 4 * 4, 0 };
+
+	auto cache_path = (test_directory / "materials.skmc").generic_string();
+
+	CookedModelWriter writer;
+	writer.AddMaterials(materials);
+	Check(writer.Write(cache_path, source_path, cache_directory, 42), "textures: write");
+
+	auto cooked_model = CookedModel::Open(cache_path, source_path, cache_directory, 42, 0);
+	Check(cooked_model != nullptr, "textures: open");
+	Check(CookedModel::Open(cache_path, source_path, cache_directory, 43, 0) == nullptr, "textures: different key");
+	if (!cooked_model)
+	{
+		return;
+	}
+
+	Check(cooked_model->GetHeader().m_num_textures == 4, "textures: identical pixels are stored once");
+
+	auto cooked_materials = cooked_model->GetMaterials();
+	Check(cooked_materials.size() == 4, "textures: material count");
+	if (cooked_materials.size() != 4)
+	{
+		return;
+	}
+
+	Check(cooked_materials[0].m_albedo_texture.m_pixels == cooked_materials[1].m_albedo_texture.m_pixels, "textures: shared texture");
+	Check(memcmp(cooked_materials[1].m_normal_map_texture.m_pixels, pixels_c.data(), pixels_c.size()) == 0, "textures: pixels");
+	Check(!cooked_materials[2].m_albedo_texture.m_pixels && cooked_materials[2].m_base_metallic == 0.5f, "textures: material without textures");
+
+	auto const & single_channel = cooked_materials[1].m_roughness_texture;
+	Check(single_channel.m_pixel_channels == 1 && single_channel.GetSizeInBytes() == pixels_d.size()
+		&& memcmp(single_channel.m_pixels, pixels_d.data(), pixels_d.size()) == 0, "textures: single channel");
+
+	auto const & mipmapped = cooked_materials[3].m_albedo_texture;
+	auto packed = static_cast<std::uint8_t const *>(mipmapped.m_pixels);
+	Check(mipmapped.m_num_mips == 2 && mipmapped.m_mip_offsets.empty() && mipmapped.GetSizeInBytes() == pixels_e.size()
+		&& packed[0] == 4 && packed[8 * 8 * 4] == 5, "textures: mip levels are packed largest first");
+}
+
+int main()
+{
+	ModelPool::RegisterLoader<GridModelLoader>();
+
+	fs::remove_all(test_directory);
+	fs::create_directories(test_directory / "grid");
+
+	TestWarmStart();
+	TestInvalidation();
+	TestUnsupportedVertexLayout();
+	TestTextureReferences();
+	TestTextureDeduplication();
+
+	fs::remove_all(test_directory);
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
@@ -0,0 +1,183 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include <model_instancing.hpp>
+#include <model_pool.hpp>
+#include <gtc/matrix_transform.hpp>
+#include <vertex.hpp>
+#include <util/log.hpp>
+
+#include "../common/test_util.hpp"
+
+namespace fs = std::filesystem;
+
+static bool Near(glm::vec3 const & a, glm::vec3 const & b, float epsilon = 1e-5f)
+{
+	return glm::length(a - b) <= epsilon;
+}
+
+static bool IsEqual(glm::mat4 const & a, glm::mat4 const & b)
+{
+	return memcmp(&a, &b, sizeof(glm::mat4)) == 0;
+}
+
+// Two meshes. The first is placed three times, once with another material, and the second once.
+static ModelData CreateInstancedModel(std::uint32_t num_quads = 4)
+{
+	ModelData model_data;
+	model_data.m_meshes.push_back(CreateGridMesh(num_quads));
+	model_data.m_meshes.push_back(CreateGridMesh(2));
+	model_data.m_meshes[1].m_material_id = 1;
+	model_data.m_materials.resize(2);
+
+	model_data.m_nodes.push_back({ 0, 0, glm::translate(glm::mat4(1), glm::vec3(10, 0, 0)) });
+	model_data.m_nodes.push_back({ 0, 0, glm::scale(glm::mat4(1), glm::vec3(2, 1, 1)) });
+	model_data.m_nodes.push_back({ 0, 1, glm::mat4(1) });
+	model_data.m_nodes.push_back({ 1, 1, glm::translate(glm::mat4(1), glm::vec3(0, 5, 0)) });
+
+	return model_data;
+}
+
+// Loads `.instanced` files. The file contains the number of quads per side of the first mesh.
+class InstancedModelLoader : public ResourceLoader<ModelData>
+{
+public:
+	InstancedModelLoader() : ResourceLoader({ "instanced" }) {}
+
+	static inline int m_num_loads = 0;
+
+protected:
+	AnonResource LoadFromDisc(std::string const & path, util::ThreadPool*) final
+	{
+		m_num_loads++;
+
+		std::uint32_t num_quads = 0;
+		std::ifstream(path) >> num_quads;
+		return std::make_unique<ModelData>(CreateInstancedModel(num_quads));
+	}
+};
+
+static void TestFlatten()
+{
+	auto model_data = CreateInstancedModel();
+	ModelInstancing::Flatten(model_data);
+
+	Check(model_data.m_meshes.size() == 4 && model_data.m_nodes.empty(), "flatten: a mesh per node");
+	if (model_data.m_meshes.size() != 4)
+	{
+		return;
+	}
+
+	Check(Near(model_data.m_meshes[0].m_positions[1], glm::vec3(11, 0, 0)), "flatten: translation");
+	Check(Near(model_data.m_meshes[1].m_positions[1], glm::vec3(2, 0, 0)), "flatten: scale");
+	Check(Near(model_data.m_meshes[3].m_positions[0], glm::vec3(0, 5, 0)), "flatten: second mesh");
+	Check(model_data.m_meshes[1].m_material_id == 0 && model_data.m_meshes[2].m_material_id == 1, "flatten: material of the node");
+
+	// Normals stay perpendicular under non uniform scales and every direction is normalized.
+	MeshData sloped = CreateGridMesh(1);
+	sloped.m_normals.assign(sloped.m_positions.size(), glm::normalize(glm::vec3(1, 1, 0)));
+	ModelInstancing::Transform(sloped, glm::scale(glm::mat4(1), glm::vec3(2, 1, 1)));
+	Check(Near(sloped.m_normals[0], glm::normalize(glm::vec3(0.5f, 1, 0))), "transform: inverse transpose normals");
+	Check(Near(sloped.m_tangents[0], glm::vec3(1, 0, 0)) && Near(sloped.m_bitangents[0], glm::vec3(0, 0, 1)), "transform: normalized tangents");
+}
+
+static void TestModelPool()
+{
+	auto model_data = CreateInstancedModel();
+	{
+		CPUModelPool model_pool;
+		auto handle = model_pool.Load<Vertex>(&model_data);
+		Check(handle.m_mesh_handles.size() == 4 && handle.m_nodes.empty() && model_pool.m_allocations.size() == 4, "model pool: flattened by default");
+		Check(model_data.m_meshes.size() == 2 && model_data.m_nodes.size() == 4, "model pool: the model data isn't modified");
+	}
+
+	// The same data imported again.
+	ModelImportSettings settings;
+	settings.m_preserve_instancing = true;
+
+	CPUModelPool model_pool;
+	model_pool.SetImportSettings(settings);
+	auto handle = model_pool.Load<Vertex>(&model_data);
+
+	Check(handle.m_mesh_handles.size() == 2 && model_pool.m_allocations.size() == 2, "model pool: meshes are imported once");
+	Check(handle.m_nodes.size() == 4, "model pool: nodes");
+	if (handle.m_nodes.size() == 4)
+	{
+		Check(handle.m_nodes[0].m_mesh == 0 && handle.m_nodes[3].m_mesh == 1, "model pool: node meshes");
+		Check(IsEqual(handle.m_nodes[3].m_transform, glm::translate(glm::mat4(1), glm::vec3(0, 5, 0))), "model pool: node transforms");
+	}
+
+	// Split meshes are placed by every node of the original mesh.
+	auto large_model_data = CreateInstancedModel(300);
+	CPUModelPool large_model_pool;
+	large_model_pool.SetImportSettings(settings);
+	auto large_handle = large_model_pool.Load<Vertex>(&large_model_data);
+
+	Check(large_handle.m_mesh_handles.size() == 3, "model pool: split mesh");
+	bool split_nodes = large_handle.m_nodes.size() == 7;
+	for (std::size_t i = 0; i < 6 && split_nodes; i++)
+	{
+		split_nodes &= large_handle.m_nodes[i].m_mesh == i % 2;
+	}
+	Check(split_nodes && large_handle.m_nodes[6].m_mesh == 2, "model pool: nodes of split meshes");
+}
+
+static void TestCookedModel()
+{
+	const auto test_directory = fs::temp_directory_path() / "skygge_test_model_instancing";
+	const auto source_path = (test_directory / "model" / "model.instanced").generic_string();
+
+	fs::remove_all(test_directory);
+	fs::create_directories(test_directory / "model");
+	std::ofstream(source_path) << 4;
+
+	ModelImportSettings settings;
+	settings.m_preserve_instancing = true;
+	settings.m_cache_directory = (test_directory / "cooked").generic_string();
+
+	auto load = [&]()
+	{
+		CPUModelPool model_pool;
+		model_pool.SetImportSettings(settings);
+		return model_pool.Load<Vertex>(source_path);
+	};
+
+	auto cooked = load();
+	auto num_loads = InstancedModelLoader::m_num_loads;
+	auto warm = load();
+
+	Check(InstancedModelLoader::m_num_loads == num_loads, "cooked: loaded from the cooked model");
+	bool same = warm.m_nodes.size() == cooked.m_nodes.size() && warm.m_nodes.size() == 4 && warm.m_mesh_handles.size() == 2;
+	for (std::size_t i = 0; i < warm.m_nodes.size() && same; i++)
+	{
+		same &= warm.m_nodes[i].m_mesh == cooked.m_nodes[i].m_mesh && IsEqual(warm.m_nodes[i].m_transform, cooked.m_nodes[i].m_transform);
+	}
+	Check(same, "cooked: same nodes");
+
+	fs::remove_all(test_directory);
+}
+
+int main()
+{
+	ModelPool::RegisterLoader<InstancedModelLoader>();
+
+	TestFlatten();
+	TestModelPool();
+	TestCookedModel();
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
@@ -0,0 +1,173 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <cstring>
+
+#include <resource_loader.hpp>
+#include <resource_structs.hpp>
+#include <material_pool.hpp>
+#include <texture_pool.hpp>
+#include <util/log.hpp>
+
+#include "../common/test_util.hpp"
+
+// Creates a `size`x`size` texture for a path like "16.tex" and counts the loads.
+class TestTextureLoader : public ResourceLoader<TextureData>
+{
+public:
+	TestTextureLoader() : ResourceLoader({ "tex" }) {}
+
+	int m_num_loads = 0;
+
+protected:
+	AnonResource LoadFromDisc(std::string const & path, util::ThreadPool*) final
+	{
+		m_num_loads++;
+
+		auto size = static_cast<std::uint32_t>(std::stoul(path));
+		auto texture = std::make_unique<TextureData>();
+		texture->m_width = size;
+		texture->m_height = size;
+		texture->m_channels = 4;
+		memset(texture->AllocatePixels(size * size * 4), 0xFF, size * size * 4);
+
+		return texture;
+	}
+};
+
+// Texture pool without a GPU backend. Keeps a copy of the pixels of every texture.
+class CPUTexturePool : public TexturePool
+{
+public:
+	void Stage(gfx::CommandList*) final {}
+	void PostStage() final {}
+	std::vector<gfx::StagingTexture*> GetTextures(std::vector<std::uint32_t>) final { return {}; }
+
+	std::vector<std::vector<std::uint8_t>> m_pixels;
+
+protected:
+	void Load_Impl(TextureData const & data, std::uint32_t, bool, bool) final
+	{
+		auto pixels = static_cast<std::uint8_t*>(data.m_pixels);
+		m_pixels.emplace_back(pixels, pixels + data.GetSizeInBytes());
+	}
+};
+
+class CPUMaterialPool : public MaterialPool
+{
+public:
+	void Update(MaterialHandle, MaterialData const &) final {}
+
+protected:
+	void Load_Impl(MaterialHandle&, MaterialData const &, TexturePool*) final {}
+};
+
+static void TestOwnership()
+{
+	TestTextureLoader loader;
+
+	std::weak_ptr<TextureData> weak;
+	std::weak_ptr<void> weak_pixels;
+	{
+		auto texture = loader.Load("16.tex");
+		Check(texture && texture->GetSizeInBytes() == 16 * 16 * 4, "ownership: load");
+		Check(loader.GetRetainedBytes() == 0, "ownership: nothing is retained without a budget");
+
+		weak = texture;
+		weak_pixels = texture->m_pixel_storage;
+	}
+	Check(weak.expired() && weak_pixels.expired(), "ownership: released with the last reference");
+
+	// Copies of a texture share its pixels.
+	TextureData copy;
+	{
+		auto texture = loader.Load("16.tex");
+		copy = *texture;
+		weak_pixels = texture->m_pixel_storage;
+	}
+	Check(!weak_pixels.expired() && copy.m_pixels == copy.m_pixel_storage.get(), "ownership: copies keep the pixels alive");
+	copy = {};
+	Check(weak_pixels.expired(), "ownership: pixels released with the last copy");
+	Check(loader.m_num_loads == 2, "ownership: no cache without a budget");
+}
+
+static void TestCache()
+{
+	TestTextureLoader loader;
+	const std::size_t size_16 = 16 * 16 * 4;
+	const std::size_t size_32 = 32 * 32 * 4;
+
+	loader.SetCacheBudget(size_16 + size_32);
+	auto first = loader.Load("16.tex");
+	Check(loader.Load("16.tex") == first && loader.m_num_loads == 1, "cache: hit");
+	Check(loader.GetRetainedBytes() == size_16, "cache: retained bytes");
+
+	loader.Load("32.tex");
+	Check(loader.GetRetainedBytes() == size_16 + size_32, "cache: retained bytes of two textures");
+
+	// "16.tex" was used least recently since "32.tex" was loaded after it.
+	loader.Load("15.tex");
+	Check(loader.GetRetainedBytes() <= loader.GetCacheBudget(), "cache: within budget");
+	auto num_loads = loader.m_num_loads;
+	loader.Load("32.tex");
+	Check(loader.m_num_loads == num_loads, "cache: recently used texture is kept");
+	loader.Load("16.tex");
+	Check(loader.m_num_loads == num_loads + 1, "cache: least recently used texture is evicted");
+
+	// Resources larger than the budget aren't cached.
+	loader.Load("64.tex");
+	Check(loader.GetRetainedBytes() <= loader.GetCacheBudget(), "cache: large texture isn't cached");
+
+	std::weak_ptr<TextureData> weak = loader.Load("32.tex");
+	first.reset();
+	loader.ClearCache();
+	Check(loader.GetRetainedBytes() == 0 && weak.expired(), "cache: clear releases the textures");
+
+	loader.SetCacheBudget(size_32);
+	loader.Load("32.tex");
+	loader.SetCacheBudget(0);
+	Check(loader.GetRetainedBytes() == 0, "cache: lowering the budget evicts");
+}
+
+static void TestMaterialPool()
+{
+	CPUTexturePool texture_pool;
+	CPUMaterialPool material_pool;
+	TestTextureLoader loader;
+
+	std::weak_ptr<void> weak_pixels;
+	MaterialHandle handle;
+	{
+		MaterialData material;
+		material.m_albedo_texture = *loader.Load("8.tex");
+		material.m_base_roughness = 0.3f;
+		weak_pixels = material.m_albedo_texture.m_pixel_storage;
+
+		handle = material_pool.Load(material, &texture_pool);
+	}
+
+	Check(!texture_pool.m_pixels.empty() && texture_pool.m_pixels.back().size() == 8 * 8 * 4, "material pool: texture uploaded");
+	Check(weak_pixels.expired(), "material pool: pixels released after uploading");
+
+	auto raw_data = material_pool.GetRawData(handle);
+	Check(raw_data.m_base_roughness == 0.3f && !raw_data.m_albedo_texture.m_pixels, "material pool: raw data keeps the parameters");
+}
+
+int main()
+{
+	TestOwnership();
+	TestCache();
+	TestMaterialPool();
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
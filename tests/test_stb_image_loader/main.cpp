@@ -0,0 +1,106 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <filesystem>
+#include <vector>
+
+#include <stb_image_write.h>
+
+#include <stb_image_loader.hpp>
+#include <util/log.hpp>
+
+#include "../common/test_util.hpp"
+
+static std::filesystem::path GetDirectory()
+{
+	return std::filesystem::temp_directory_path() / "skygge_test_stb_image_loader";
+}
+
+// Writes a `width` x `height` RGB PNG where every pixel is `rgb`.
+static std::string WriteImage(std::string const & name, std::uint32_t width, std::uint32_t height, std::uint8_t const (&rgb)[3])
+{
+	std::vector<std::uint8_t> pixels(static_cast<std::size_t>(width) * height * 3);
+	for (std::size_t i = 0; i < pixels.size(); i++)
+	{
+		pixels[i] = rgb[i % 3];
+	}
+
+	auto path = (GetDirectory() / name).string();
+	stbi_write_png(path.c_str(), static_cast<int>(width), static_cast<int>(height), 3, pixels.data(), static_cast<int>(width * 3));
+	return path;
+}
+
+static void TestDecode()
+{
+	auto path = WriteImage("red.png", 8, 4, { 255, 0, 0 });
+
+	auto texture = STBImageLoader::Decode(path);
+	Check(texture && texture->m_width == 8 && texture->m_height == 4 && texture->m_channels == 3 && texture->m_pixel_channels == 4, "decode: rgba");
+	if (texture)
+	{
+		auto pixels = static_cast<std::uint8_t const *>(texture->m_pixels);
+		Check(pixels[0] == 255 && pixels[1] == 0 && pixels[2] == 0 && pixels[3] == 255 && pixels[31 * 4 + 3] == 255, "decode: rgba pixels");
+		Check(texture->m_pixel_storage.get() == texture->m_pixels, "decode: owns the stb allocation");
+		Check(texture->GetSizeInBytes() == 8 * 4 * 4, "decode: rgba size");
+	}
+
+	auto grey = STBImageLoader::Decode(path, 1);
+	Check(grey && grey->m_pixel_channels == 1 && grey->GetSizeInBytes() == 8 * 4, "decode: grey");
+	if (grey)
+	{
+		// stb converts to grey with the weights (77, 150, 29) / 256.
+		Check(static_cast<std::uint8_t const *>(grey->m_pixels)[0] == (255 * 77) >> 8, "decode: grey pixels");
+	}
+
+	Check(STBImageLoader::Decode((GetDirectory() / "missing.png").string()) == nullptr, "decode: missing file");
+}
+
+static void TestBatch()
+{
+	std::vector<STBImageRequest> requests;
+	for (std::uint8_t i = 0; i < 8; i++)
+	{
+		requests.push_back({ WriteImage(fmt::format("{}.png", i), 4 + i, 4, { i, static_cast<std::uint8_t>(i * 2), static_cast<std::uint8_t>(i * 3) }), i % 2 ? 1u : 4u });
+	}
+	requests.push_back({ (GetDirectory() / "missing.png").string() });
+
+	util::ThreadPool thread_pool(3);
+	for (auto pool : { static_cast<util::ThreadPool*>(nullptr), &thread_pool })
+	{
+		auto textures = STBImageLoader::LoadBatch(requests, pool);
+		Check(textures.size() == requests.size(), "batch: a texture per request");
+
+		bool in_order = true;
+		for (std::uint32_t i = 0; i < 8; i++)
+		{
+			in_order &= textures[i] && textures[i]->m_width == 4 + i && textures[i]->m_pixel_channels == requests[i].m_desired_channels;
+		}
+		Check(in_order, "batch: textures are in the order of the requests");
+		Check(textures.back() == nullptr, "batch: failed images are nullptr");
+	}
+
+	Check(STBImageLoader::LoadBatch({}).empty(), "batch: empty");
+}
+
+int main()
+{
+	std::filesystem::remove_all(GetDirectory());
+	std::filesystem::create_directories(GetDirectory());
+
+	TestDecode();
+	TestBatch();
+
+	std::filesystem::remove_all(GetDirectory());
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
@@ -0,0 +1,244 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+
+#include <tangent_generator.hpp>
+#include <util/log.hpp>
+
+#include "../common/test_util.hpp"
+
+static bool Near(glm::vec3 const & a, glm::vec3 const & b, float epsilon = 1e-4f)
+{
+	return glm::length(a - b) <= epsilon;
+}
+
+static void SetIndices(MeshData& mesh, std::vector<std::uint32_t> const & indices, std::uint32_t stride)
+{
+	mesh.m_indices_stride = stride;
+	mesh.m_num_indices = indices.size();
+	mesh.m_indices.resize(indices.size() * stride);
+	for (std::size_t i = 0; i < indices.size(); i++)
+	{
+		mesh.SetIndex(i, indices[i]);
+	}
+}
+
+// Shared grid with UVs from 0 to 1 and `stride` byte indices. Curved meshes have a height field with analytic normals,
+// so the tangents differ per vertex. The tangent frames are cleared.
+static MeshData CreateTangentMesh(std::uint32_t num_quads, bool curved, std::uint32_t stride = sizeof(std::uint32_t))
+{
+	auto height = [](float x, float z) { return std::sin(x * 0.3f) * std::cos(z * 0.2f); };
+	auto mesh = curved ? CreateGridMesh(num_quads, height) : CreateGridMesh(num_quads);
+
+	for (std::size_t i = 0; i < mesh.m_positions.size(); i++)
+	{
+		auto const & pos = mesh.m_positions[i];
+		float dx = curved ? 0.3f * std::cos(pos.x * 0.3f) * std::cos(pos.z * 0.2f) : 0.f;
+		float dz = curved ? -0.2f * std::sin(pos.x * 0.3f) * std::sin(pos.z * 0.2f) : 0.f;
+
+		mesh.m_normals[i] = glm::normalize(glm::vec3(-dx, 1, -dz));
+		mesh.m_uvw[i] /= float(num_quads);
+	}
+	mesh.m_tangents.clear();
+	mesh.m_bitangents.clear();
+
+	std::vector<std::uint32_t> indices(mesh.m_num_indices);
+	for (std::size_t i = 0; i < indices.size(); i++)
+	{
+		indices[i] = mesh.GetIndex(i);
+	}
+	SetIndices(mesh, indices, stride);
+
+	return mesh;
+}
+
+static float MaxDifference(MeshData const & a, MeshData const & b)
+{
+	float difference = 0;
+	for (std::size_t i = 0; i < a.m_tangents.size(); i++)
+	{
+		difference = std::max(difference, glm::length(a.m_tangents[i] - b.m_tangents[i]));
+		difference = std::max(difference, glm::length(a.m_bitangents[i] - b.m_bitangents[i]));
+	}
+	return difference;
+}
+
+static bool IsOrthonormal(MeshData const & mesh)
+{
+	for (std::size_t i = 0; i < mesh.m_positions.size(); i++)
+	{
+		auto const & n = mesh.m_normals[i], & t = mesh.m_tangents[i], & b = mesh.m_bitangents[i];
+		if (std::fabs(glm::length(t) - 1.f) > 1e-4f || std::fabs(glm::length(b) - 1.f) > 1e-4f
+			|| std::fabs(glm::dot(t, n)) > 1e-4f || std::fabs(glm::dot(b, n)) > 1e-4f || std::fabs(glm::dot(t, b)) > 1e-4f)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void TestPlane()
+{
+	for (auto mode : { TangentMode::ACCUMULATE, TangentMode::MIKKTSPACE })
+	{
+		auto mesh = CreateTangentMesh(4, false, sizeof(std::uint16_t));
+		TangentGenerator::Generate(mesh, mode);
+
+		bool along_uvs = true;
+		for (std::size_t i = 0; i < mesh.m_positions.size(); i++)
+		{
+			along_uvs &= Near(mesh.m_tangents[i], glm::vec3(1, 0, 0)) && Near(mesh.m_bitangents[i], glm::vec3(0, 0, 1));
+		}
+		Check(along_uvs, "plane: tangents along u and bitangents along v");
+	}
+}
+
+static void TestMirrored()
+{
+	auto mesh = CreateTangentMesh(4, false);
+	auto mirrored = mesh;
+	for (auto& uv : mirrored.m_uvw)
+	{
+		uv.x = 1.f - uv.x;
+	}
+
+	TangentGenerator::Generate(mesh);
+	TangentGenerator::Generate(mirrored);
+
+	auto const & n = mesh.m_normals[0];
+	Check(Near(mirrored.m_tangents[0], glm::vec3(-1, 0, 0)) && Near(mirrored.m_bitangents[0], glm::vec3(0, 0, 1)), "mirrored: follows the UVs");
+	Check(glm::dot(glm::cross(n, mesh.m_tangents[0]), mesh.m_bitangents[0]) * glm::dot(glm::cross(n, mirrored.m_tangents[0]), mirrored.m_bitangents[0]) < 0.f,
+		"mirrored: opposite handedness");
+}
+
+static void TestOrthonormal()
+{
+	for (auto mode : { TangentMode::ACCUMULATE, TangentMode::MIKKTSPACE })
+	{
+		auto mesh = CreateTangentMesh(32, true);
+		TangentGenerator::Generate(mesh, mode);
+		Check(IsOrthonormal(mesh), "orthonormal: curved grid");
+	}
+}
+
+static void TestTriangleOrder()
+{
+	for (auto mode : { TangentMode::ACCUMULATE, TangentMode::MIKKTSPACE })
+	{
+		auto mesh = CreateTangentMesh(32, true);
+		auto shuffled = mesh;
+
+		// Shuffles the triangles and rotates their corners.
+		std::vector<std::uint32_t> order(mesh.m_num_indices / 3);
+		std::iota(order.begin(), order.end(), 0);
+		std::shuffle(order.begin(), order.end(), std::mt19937(0));
+		std::vector<std::uint32_t> indices;
+		for (std::size_t t = 0; t < order.size(); t++)
+		{
+			for (std::uint32_t c = 0; c < 3; c++)
+			{
+				indices.push_back(mesh.GetIndex(order[t] * 3 + (c + t) % 3));
+			}
+		}
+		SetIndices(shuffled, indices, sizeof(std::uint32_t));
+
+		TangentGenerator::Generate(mesh, mode);
+		TangentGenerator::Generate(shuffled, mode);
+		Check(MaxDifference(mesh, shuffled) < 1e-4f, "triangle order: same tangents");
+	}
+}
+
+static void TestSIMDAndThreads()
+{
+	util::ThreadPool thread_pool(4);
+
+	// More triangles and vertices than a batch, with a remainder for the scalar kernels. 16 bit indices address fewer
+	// vertices.
+	for (auto stride : { sizeof(std::uint16_t), sizeof(std::uint32_t) })
+	{
+		auto reference = CreateTangentMesh(stride == sizeof(std::uint16_t) ? 200 : 300, true, static_cast<std::uint32_t>(stride));
+		reference.m_uvw[5] = reference.m_uvw[6]; // Degenerate UV mappings.
+		auto input = reference;
+		TangentGenerator::Generate(reference, TangentMode::ACCUMULATE, nullptr, util::SIMDLevel::SCALAR);
+
+		auto threaded = input;
+		TangentGenerator::Generate(threaded, TangentMode::ACCUMULATE, &thread_pool, util::SIMDLevel::SCALAR);
+		Check(threaded.m_tangents == reference.m_tangents && threaded.m_bitangents == reference.m_bitangents,
+			fmt::format("threads: {} byte indices identical to a single thread", stride));
+
+		for (auto level : { util::SIMDLevel::SSE2, util::SIMDLevel::AVX2 })
+		{
+			if (level > util::GetSIMDLevel())
+			{
+				LOGW("Skipped {}, not supported by this CPU", util::SIMDLevelToString(level));
+				continue;
+			}
+
+			auto mesh = input;
+			TangentGenerator::Generate(mesh, TangentMode::ACCUMULATE, &thread_pool, level);
+			Check(MaxDifference(mesh, reference) < 1e-4f, fmt::format("simd: {} matches scalar with {} byte indices", util::SIMDLevelToString(level), stride));
+			Check(IsOrthonormal(mesh), fmt::format("simd: {} is orthonormal", util::SIMDLevelToString(level)));
+		}
+	}
+}
+
+static void TestIndexStrides()
+{
+	auto reference = CreateTangentMesh(8, true);
+	TangentGenerator::Generate(reference);
+
+	for (auto stride : { sizeof(std::uint8_t), sizeof(std::uint16_t) })
+	{
+		auto mesh = CreateTangentMesh(8, true, static_cast<std::uint32_t>(stride));
+		TangentGenerator::Generate(mesh);
+		Check(MaxDifference(mesh, reference) == 0.f, fmt::format("strides: {} byte indices", stride));
+	}
+}
+
+static void TestMissingAttributes()
+{
+	auto mesh = CreateTangentMesh(8, true);
+	mesh.m_uvw.clear();
+	TangentGenerator::Generate(mesh);
+	Check(IsOrthonormal(mesh), "missing attributes: frame around the normal without UVs");
+
+	mesh = CreateTangentMesh(8, false);
+	for (auto& uv : mesh.m_uvw)
+	{
+		uv = glm::vec3(0.5f, 0.5f, 0);
+	}
+	TangentGenerator::Generate(mesh, TangentMode::MIKKTSPACE);
+	Check(IsOrthonormal(mesh), "missing attributes: frame around the normal with degenerate UVs");
+
+	mesh = CreateTangentMesh(8, true);
+	mesh.m_normals.clear();
+	TangentGenerator::Generate(mesh);
+	Check(mesh.m_tangents.size() == mesh.m_positions.size() && mesh.m_tangents[0] == glm::vec3(0), "missing attributes: zero without normals");
+}
+
+int main()
+{
+	TestPlane();
+	TestMirrored();
+	TestOrthonormal();
+	TestTriangleOrder();
+	TestSIMDAndThreads();
+	TestIndexStrides();
+	TestMissingAttributes();
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
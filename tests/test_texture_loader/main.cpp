@@ -0,0 +1,213 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <compressed_texture_loader.hpp>
+#include <util/log.hpp>
+
+#include "../common/test_util.hpp"
+
+static std::filesystem::path GetDirectory()
+{
+	return std::filesystem::temp_directory_path() / "skygge_test_texture_loader";
+}
+
+template<typename T>
+static void Append(std::vector<std::uint8_t>& data, T const & value)
+{
+	auto bytes = reinterpret_cast<std::uint8_t const *>(&value);
+	data.insert(data.end(), bytes, bytes + sizeof(T));
+}
+
+static std::string WriteFile(std::string const & name, std::vector<std::uint8_t> const & data)
+{
+	auto path = (GetDirectory() / name).string();
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<char const *>(data.data()), static_cast<std::streamsize>(data.size()));
+	return path;
+}
+
+// Mip levels of a `size` x `size` texture with `block_size` bytes per 4x4 block, largest first. Every level is filled
+// with its index so misplaced levels are detected.
+static std::vector<std::vector<std::uint8_t>> CreateLevels(std::uint32_t size, std::uint32_t num_mips, std::uint32_t block_size)
+{
+	std::vector<std::vector<std::uint8_t>> levels;
+	for (std::uint32_t level = 0; level < num_mips; level++)
+	{
+		auto num_blocks = (std::max(size >> level, 1u) + 3) / 4;
+		levels.emplace_back(num_blocks * num_blocks * block_size, static_cast<std::uint8_t>(level + 1));
+	}
+	return levels;
+}
+
+// KTX2 file with the levels stored smallest first, as KTX2 writers do.
+static std::vector<std::uint8_t> CreateKTX2(std::uint32_t vk_format, std::uint32_t size, std::vector<std::vector<std::uint8_t>> const & levels)
+{
+	std::vector<std::uint8_t> data = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+	for (auto value : { vk_format, 1u, size, size, 0u, 0u, 1u, static_cast<std::uint32_t>(levels.size()), 0u, 0u, 0u, 0u, 0u })
+	{
+		Append(data, value);
+	}
+	Append(data, std::uint64_t(0));
+	Append(data, std::uint64_t(0));
+
+	std::vector<std::uint64_t> offsets(levels.size());
+	std::uint64_t offset = data.size() + levels.size() * 3 * sizeof(std::uint64_t);
+	for (auto level = levels.size(); level-- > 0;)
+	{
+		offsets[level] = offset;
+		offset += levels[level].size();
+	}
+
+	for (std::size_t level = 0; level < levels.size(); level++)
+	{
+		Append(data, offsets[level]);
+		Append(data, std::uint64_t(levels[level].size()));
+		Append(data, std::uint64_t(levels[level].size()));
+	}
+
+	for (auto level = levels.size(); level-- > 0;)
+	{
+		data.insert(data.end(), levels[level].begin(), levels[level].end());
+	}
+
+	return data;
+}
+
+// DDS file with the levels stored largest first. A DX10 header follows when `dxgi_format` isn't 0.
+static std::vector<std::uint8_t> CreateDDS(std::uint32_t four_cc, std::uint32_t dxgi_format, std::uint32_t size, std::vector<std::vector<std::uint8_t>> const & levels,
+	std::uint32_t caps2 = 0)
+{
+	std::vector<std::uint8_t> data;
+	for (auto value : { 0x20534444u, 124u, 0x1007u | 0x20000u, size, size, 0u, 0u, static_cast<std::uint32_t>(levels.size()) })
+	{
+		Append(data, value);
+	}
+	for (auto i = 0; i < 11; i++)
+	{
+		Append(data, 0u);
+	}
+	for (auto value : { 32u, 0x4u, dxgi_format ? 0x30315844u : four_cc, 0u, 0u, 0u, 0u, 0u, 0x1000u, caps2, 0u, 0u, 0u })
+	{
+		Append(data, value);
+	}
+	if (dxgi_format)
+	{
+		for (auto value : { dxgi_format, 3u, 0u, 1u, 0u })
+		{
+			Append(data, value);
+		}
+	}
+
+	for (auto const & level : levels)
+	{
+		data.insert(data.end(), level.begin(), level.end());
+	}
+
+	return data;
+}
+
+static bool HasLevels(TextureData const & texture, std::vector<std::vector<std::uint8_t>> const & levels)
+{
+	if (texture.m_num_mips != levels.size())
+	{
+		return false;
+	}
+
+	for (std::uint32_t level = 0; level < texture.m_num_mips; level++)
+	{
+		if (texture.GetMipSizeInBytes(level) != levels[level].size()
+			|| memcmp(static_cast<std::uint8_t const *>(texture.m_pixels) + texture.GetMipOffset(level), levels[level].data(), levels[level].size()) != 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void TestKTX2()
+{
+	KTX2Loader loader;
+	Check(loader.IsSupportedExtension("ktx2") && !loader.IsSupportedExtension("dds"), "ktx2: extensions");
+
+	auto levels = CreateLevels(8, 4, 16);
+	auto path = WriteFile("bc7.ktx2", CreateKTX2(VK_FORMAT_BC7_SRGB_BLOCK, 8, levels));
+	auto texture = loader.Load(path);
+	Check(texture != nullptr, "ktx2: loads");
+	if (texture)
+	{
+		Check(texture->m_width == 8 && texture->m_height == 8 && texture->m_compression == TextureCompression::BC7 && !texture->m_is_hdr, "ktx2: format");
+		Check(HasLevels(*texture, levels), "ktx2: levels");
+		Check(texture->GetMipOffset(0) > texture->GetMipOffset(3), "ktx2: smallest level first in the file");
+		Check(texture->GetSizeInBytes() == 64 + 16 * 3, "ktx2: size");
+		Check(texture->m_pixel_storage != nullptr, "ktx2: keeps the file mapped");
+	}
+
+	auto rgba = CreateLevels(4, 1, 64);
+	texture = loader.Load(WriteFile("rgba.ktx2", CreateKTX2(VK_FORMAT_R8G8B8A8_UNORM, 4, rgba)));
+	Check(texture && texture->m_compression == TextureCompression::NONE && HasLevels(*texture, rgba), "ktx2: rgba8");
+
+	auto data = CreateKTX2(VK_FORMAT_BC7_UNORM_BLOCK, 8, levels);
+	data.resize(data.size() - 1);
+	Check(loader.Load(WriteFile("truncated.ktx2", data)) == nullptr, "ktx2: truncated file");
+
+	data = CreateKTX2(VK_FORMAT_BC7_UNORM_BLOCK, 8, levels);
+	data[1] = 'X';
+	Check(loader.Load(WriteFile("identifier.ktx2", data)) == nullptr, "ktx2: wrong identifier");
+
+	Check(loader.Load(WriteFile("format.ktx2", CreateKTX2(VK_FORMAT_BC6H_UFLOAT_BLOCK, 8, levels))) == nullptr, "ktx2: unsupported format");
+	Check(loader.Load(WriteFile("levels.ktx2", CreateKTX2(VK_FORMAT_BC7_UNORM_BLOCK, 8, CreateLevels(8, 5, 16)))) == nullptr, "ktx2: too many levels");
+	Check(loader.Load((GetDirectory() / "missing.ktx2").string()) == nullptr, "ktx2: missing file");
+}
+
+static void TestDDS()
+{
+	DDSLoader loader;
+
+	auto levels = CreateLevels(16, 5, 16);
+	auto texture = loader.Load(WriteFile("dxt5.dds", CreateDDS(0x35545844u, 0, 16, levels))); // "DXT5"
+	Check(texture && texture->m_compression == TextureCompression::BC3 && texture->m_mip_offsets.empty() && HasLevels(*texture, levels), "dds: dxt5");
+
+	auto bc1_levels = CreateLevels(8, 1, 8);
+	texture = loader.Load(WriteFile("dxt1.dds", CreateDDS(0x31545844u, 0, 8, bc1_levels))); // "DXT1"
+	Check(texture && texture->m_compression == TextureCompression::BC1 && HasLevels(*texture, bc1_levels), "dds: dxt1");
+
+	auto bc5_levels = CreateLevels(8, 4, 16);
+	texture = loader.Load(WriteFile("bc5.dds", CreateDDS(0, 83, 8, bc5_levels)));
+	Check(texture && texture->m_compression == TextureCompression::BC5 && texture->m_channels == 2 && HasLevels(*texture, bc5_levels), "dds: dx10 bc5");
+
+	auto data = CreateDDS(0x35545844u, 0, 16, levels);
+	data.resize(data.size() - 1);
+	Check(loader.Load(WriteFile("truncated.dds", data)) == nullptr, "dds: truncated file");
+	Check(loader.Load(WriteFile("cube.dds", CreateDDS(0x35545844u, 0, 16, levels, 0x200))) == nullptr, "dds: cube map");
+	Check(loader.Load(WriteFile("format.dds", CreateDDS(0, 95, 16, levels))) == nullptr, "dds: unsupported format");
+}
+
+int main()
+{
+	std::filesystem::remove_all(GetDirectory());
+	std::filesystem::create_directories(GetDirectory());
+
+	TestKTX2();
+	TestDDS();
+
+	std::filesystem::remove_all(GetDirectory());
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
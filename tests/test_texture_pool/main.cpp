@@ -0,0 +1,171 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <cstring>
+
+#include <resource_loader.hpp>
+#include <resource_structs.hpp>
+#include <material_pool.hpp>
+#include <texture_pool.hpp>
+#include <util/log.hpp>
+
+#include "../common/test_util.hpp"
+
+// Creates a 4x4 texture filled with the value in a path like "7.tex" or "7_copy.tex" and counts the loads.
+class TestTextureLoader : public ResourceLoader<TextureData>
+{
+public:
+	TestTextureLoader() : ResourceLoader({ "tex" }) {}
+
+	inline static int m_num_loads = 0;
+
+protected:
+	AnonResource LoadFromDisc(std::string const & path, util::ThreadPool*) final
+	{
+		m_num_loads++;
+
+		auto texture = std::make_unique<TextureData>();
+		texture->m_width = 4;
+		texture->m_height = 4;
+		texture->m_channels = 4;
+		memset(texture->AllocatePixels(4 * 4 * 4), std::stoi(path), 4 * 4 * 4);
+
+		return texture;
+	}
+};
+
+// Texture pool without a GPU backend. Counts the created textures.
+class CPUTexturePool : public TexturePool
+{
+public:
+	void Stage(gfx::CommandList*) final {}
+	void PostStage() final {}
+	std::vector<gfx::StagingTexture*> GetTextures(std::vector<std::uint32_t>) final { return {}; }
+
+	int m_num_textures = 0;
+
+protected:
+	void Load_Impl(TextureData const &, std::uint32_t, bool, bool) final
+	{
+		m_num_textures++;
+	}
+};
+
+class CPUMaterialPool : public MaterialPool
+{
+public:
+	void Update(MaterialHandle, MaterialData const &) final {}
+
+protected:
+	void Load_Impl(MaterialHandle&, MaterialData const &, TexturePool*) final {}
+};
+
+static TextureData CreateTexture(std::uint8_t value, std::uint32_t size = 4)
+{
+	TextureData texture;
+	texture.m_width = size;
+	texture.m_height = size;
+	texture.m_channels = 4;
+	memset(texture.AllocatePixels(size * size * 4), value, size * size * 4);
+
+	return texture;
+}
+
+static void TestPaths()
+{
+	CPUTexturePool pool;
+	TestTextureLoader::m_num_loads = 0;
+
+	auto first = pool.Load("1.tex", true);
+	Check(pool.Load("1.tex", true) == first, "paths: same path returns the same texture");
+	Check(TestTextureLoader::m_num_loads == 1, "paths: a cached path isn't loaded again");
+
+	Check(pool.Load("1_copy.tex", true) == first, "paths: identical pixels at another path return the same texture");
+	Check(pool.Load("1.tex", false) != first, "paths: different mipmap flag creates a texture");
+	Check(pool.Load("1.tex", true, true) != first, "paths: different srgb flag creates a texture");
+	Check(pool.Load("2.tex", true) != first, "paths: different pixels create a texture");
+	Check(pool.m_num_textures == 4, "paths: number of created textures");
+
+	auto stats = pool.GetStats();
+	Check(stats.m_num_hits == 2 && stats.m_num_misses == 4, "paths: hits and misses");
+	Check(stats.m_saved_bytes == 2 * 4 * 4 * 4 && stats.m_uploaded_bytes == 4 * 4 * 4 * 4, "paths: saved and uploaded bytes");
+}
+
+static void TestContent()
+{
+	CPUTexturePool pool;
+
+	auto first = pool.Load(CreateTexture(3), true);
+	Check(pool.Load(CreateTexture(3), true) == first, "content: identical pixels return the same texture");
+	Check(pool.Load(CreateTexture(4), true) != first, "content: different pixels create a texture");
+	Check(pool.Load(CreateTexture(3, 2), true) != first, "content: different dimensions create a texture");
+
+	auto hdr = CreateTexture(3, 2);
+	hdr.m_is_hdr = true;
+	hdr.AllocatePixels(hdr.GetSizeInBytes());
+	memset(hdr.m_pixels, 3, hdr.GetSizeInBytes());
+	Check(pool.Load(hdr, true) != first, "content: different format creates a texture");
+
+	// A texture loaded from a path is found by its content.
+	Check(pool.Load("3.tex", true) == first, "content: path load finds a texture loaded from data");
+	Check(pool.m_num_textures == 4, "content: number of created textures");
+
+	// Levels stored out of order are compared as if they were packed.
+	auto packed = CreateTexture(6, 2);
+	packed.m_num_mips = 2;
+	packed.AllocatePixels(packed.GetSizeInBytes());
+	memset(packed.m_pixels, 6, 2 * 2 * 4);
+	memset(static_cast<std::uint8_t*>(packed.m_pixels) + 2 * 2 * 4, 7, 4);
+	auto unpacked = packed;
+	unpacked.m_mip_offsets = { 4, 0 };
+	unpacked.AllocatePixels(packed.GetSizeInBytes());
+	memset(unpacked.m_pixels, 7, 4);
+	memset(static_cast<std::uint8_t*>(unpacked.m_pixels) + 4, 6, 2 * 2 * 4);
+	Check(pool.Load(packed, true) == pool.Load(unpacked, true), "content: levels in another order return the same texture");
+
+	// Hits are verified without keeping the pixels.
+	auto released = CreateTexture(8);
+	pool.Load(released, true);
+	Check(released.m_pixel_storage.use_count() == 1, "content: source pixels aren't retained");
+	Check(pool.Load(CreateTexture(8), true) == pool.Load(released, true), "content: released texture is found by its content");
+}
+
+static void TestMaterials()
+{
+	CPUTexturePool texture_pool;
+	CPUMaterialPool material_pool;
+
+	// Many materials sharing one albedo texture upload it once.
+	MaterialData material;
+	material.m_albedo_texture = CreateTexture(5);
+	auto first = material_pool.Load(material, &texture_pool);
+	for (auto i = 0; i < 8; i++)
+	{
+		material.m_albedo_texture = CreateTexture(5);
+		auto handle = material_pool.Load(material, &texture_pool);
+		Check(handle.m_albedo_texture_handle == first.m_albedo_texture_handle, "materials: shared albedo texture");
+	}
+
+	Check(texture_pool.GetStats().m_saved_bytes == 8 * 4 * 4 * 4, "materials: saved bytes");
+}
+
+int main()
+{
+	TexturePool::RegisterLoader<TestTextureLoader>();
+
+	TestPaths();
+	TestContent();
+	TestMaterials();
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
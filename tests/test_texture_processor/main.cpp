@@ -0,0 +1,295 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#include <block_compression.hpp>
+#include <texture_processor.hpp>
+#include <util/log.hpp>
+
+#include "../common/test_util.hpp"
+
+// Smooth gradients with a little noise, like typical albedo textures.
+static TextureData CreateTexture(std::uint32_t width, std::uint32_t height, std::uint32_t seed = 0)
+{
+	std::mt19937 rng(seed);
+	std::uniform_int_distribution<int> noise(-6, 6);
+
+	TextureData texture;
+	texture.m_width = width;
+	texture.m_height = height;
+	texture.m_channels = 4;
+	auto pixels = static_cast<std::uint8_t*>(texture.AllocatePixels(width * height * 4));
+	for (std::uint32_t y = 0; y < height; y++)
+	{
+		for (std::uint32_t x = 0; x < width; x++)
+		{
+			auto pixel = &pixels[(y * width + x) * 4];
+			int values[4] = { static_cast<int>(x * 255 / width), static_cast<int>(y * 255 / height), static_cast<int>((x + y) * 127 / (width + height)) + 64, 255 - static_cast<int>(x * 128 / width) };
+			for (auto c = 0; c < 4; c++)
+			{
+				pixel[c] = static_cast<std::uint8_t>(std::clamp(values[c] + noise(rng), 0, 255));
+			}
+		}
+	}
+
+	return texture;
+}
+
+// Peak signal to noise ratio of the first `num_channels` channels, in dB.
+static double CalculatePSNR(std::uint8_t const * a, std::uint8_t const * b, std::size_t num_pixels, int num_channels)
+{
+	double error = 0;
+	for (std::size_t i = 0; i < num_pixels; i++)
+	{
+		for (auto c = 0; c < num_channels; c++)
+		{
+			double diff = static_cast<double>(a[i * 4 + c]) - b[i * 4 + c];
+			error += diff * diff;
+		}
+	}
+
+	auto mse = error / (num_pixels * num_channels);
+	return mse == 0 ? 100.0 : 10.0 * std::log10(255.0 * 255.0 / mse);
+}
+
+static void TestBlockCompression()
+{
+	auto texture = CreateTexture(64, 48);
+	auto source = static_cast<std::uint8_t const *>(texture.m_pixels);
+	std::vector<std::uint8_t> decoded(64 * 48 * 4);
+
+	struct Expectation
+	{
+		TextureCompression m_compression;
+		int m_num_channels;
+		double m_min_psnr;
+		char const * m_name;
+	};
+
+	for (auto const & expectation : { Expectation{ TextureCompression::BC1, 3, 33, "BC1" }, Expectation{ TextureCompression::BC3, 4, 33, "BC3" }, Expectation{ TextureCompression::BC4, 1, 40, "BC4" },
+		Expectation{ TextureCompression::BC5, 2, 40, "BC5" }, Expectation{ TextureCompression::BC7, 4, 35, "BC7" } })
+	{
+		auto compressed = TextureProcessor::Compress(texture, expectation.m_compression);
+		Check(compressed.m_compression == expectation.m_compression && compressed.GetSizeInBytes() == 16 * 12 * BlockCompression::GetBlockSize(expectation.m_compression),
+			fmt::format("block compression: {} size", expectation.m_name));
+
+		BlockCompression::Decompress(expectation.m_compression, static_cast<std::uint8_t const *>(compressed.m_pixels), 64, 48, decoded.data());
+		auto psnr = CalculatePSNR(source, decoded.data(), 64 * 48, expectation.m_num_channels);
+		Check(psnr >= expectation.m_min_psnr, fmt::format("block compression: {} PSNR {:.1f} dB", expectation.m_name, psnr));
+	}
+
+	// Solid blocks.
+	std::uint8_t solid[16 * 4];
+	for (auto i = 0; i < 16; i++)
+	{
+		solid[i * 4 + 0] = 200; solid[i * 4 + 1] = 100; solid[i * 4 + 2] = 50; solid[i * 4 + 3] = 255;
+	}
+
+	std::uint8_t block[16];
+	std::uint8_t decoded_block[16 * 4] = {};
+	BlockCompression::EncodeBC4(solid, block);
+	BlockCompression::DecodeBC4(block, decoded_block);
+	Check(decoded_block[0] == 200, "block compression: solid BC4 is exact");
+
+	BlockCompression::EncodeBC7(solid, block);
+	Check(BlockCompression::DecodeBC7(block, decoded_block), "block compression: BC7 mode 6");
+	Check(std::abs(decoded_block[0] - 200) <= 1 && std::abs(decoded_block[1] - 100) <= 1 && std::abs(decoded_block[2] - 50) <= 1 && decoded_block[3] >= 254,
+		"block compression: solid BC7");
+
+	// Edge blocks of sizes that aren't a multiple of 4 repeat the last column and row.
+	auto odd = CreateTexture(13, 7, 1);
+	auto compressed = TextureProcessor::Compress(odd, TextureCompression::BC7);
+	Check(compressed.GetSizeInBytes() == 4 * 2 * 16, "block compression: odd size");
+
+	TextureData padded;
+	padded.m_width = 16;
+	padded.m_height = 8;
+	padded.m_channels = 4;
+	auto padded_pixels = static_cast<std::uint8_t*>(padded.AllocatePixels(16 * 8 * 4));
+	for (std::uint32_t y = 0; y < 8; y++)
+	{
+		for (std::uint32_t x = 0; x < 16; x++)
+		{
+			memcpy(&padded_pixels[(y * 16 + x) * 4], &static_cast<std::uint8_t const *>(odd.m_pixels)[(std::min(y, 6u) * 13 + std::min(x, 12u)) * 4], 4);
+		}
+	}
+
+	auto compressed_padded = TextureProcessor::Compress(padded, TextureCompression::BC7);
+	Check(memcmp(compressed.m_pixels, compressed_padded.m_pixels, 4 * 2 * 16) == 0, "block compression: odd size edge blocks");
+}
+
+static void TestMips()
+{
+	auto texture = CreateTexture(16, 8);
+	auto mips = TextureProcessor::GenerateMips(texture, false, false);
+	Check(mips.m_num_mips == 5 && mips.GetMipWidth(4) == 1 && mips.GetMipHeight(3) == 1, "mips: number of levels");
+	Check(mips.GetSizeInBytes() == (16 * 8 + 8 * 4 + 4 * 2 + 2 * 1 + 1 * 1) * 4, "mips: size");
+	Check(memcmp(mips.m_pixels, texture.m_pixels, 16 * 8 * 4) == 0, "mips: level 0 is unchanged");
+
+	// A black and white checker averages to 50% linear intensity, which is 188 in sRGB.
+	TextureData checker;
+	checker.m_width = 2;
+	checker.m_height = 2;
+	checker.m_channels = 4;
+	auto pixels = static_cast<std::uint8_t*>(checker.AllocatePixels(2 * 2 * 4));
+	for (auto i = 0; i < 4; i++)
+	{
+		auto value = static_cast<std::uint8_t>(i == 0 || i == 3 ? 255 : 0);
+		pixels[i * 4 + 0] = pixels[i * 4 + 1] = pixels[i * 4 + 2] = value;
+		pixels[i * 4 + 3] = value;
+	}
+
+	auto srgb_mips = TextureProcessor::GenerateMips(checker, true, false);
+	auto srgb_level = static_cast<std::uint8_t const *>(srgb_mips.m_pixels) + srgb_mips.GetMipOffset(1);
+	Check(srgb_level[0] == 188 && srgb_level[3] == 128, "mips: srgb color is averaged in linear space, alpha is linear");
+
+	auto linear_mips = TextureProcessor::GenerateMips(checker, false, false);
+	auto linear_level = static_cast<std::uint8_t const *>(linear_mips.m_pixels) + linear_mips.GetMipOffset(1);
+	Check(linear_level[0] == 128, "mips: linear color");
+
+	// Opposite normals tilted by 45 degrees average to a straight normal.
+	for (auto i = 0; i < 4; i++)
+	{
+		pixels[i * 4 + 0] = static_cast<std::uint8_t>(i % 2 == 0 ? 38 : 218);
+		pixels[i * 4 + 1] = 128;
+		pixels[i * 4 + 2] = 218;
+	}
+	auto normal_mips = TextureProcessor::GenerateMips(checker, false, true);
+	auto normal_level = static_cast<std::uint8_t const *>(normal_mips.m_pixels) + normal_mips.GetMipOffset(1);
+	Check(std::abs(normal_level[0] - 128) <= 1 && normal_level[2] == 255, "mips: normals are renormalized");
+
+	// HDR
+	TextureData hdr;
+	hdr.m_width = 4;
+	hdr.m_height = 4;
+	hdr.m_channels = 4;
+	hdr.m_is_hdr = true;
+	auto hdr_pixels = static_cast<float*>(hdr.AllocatePixels(4 * 4 * 16));
+	for (auto i = 0; i < 4 * 4 * 4; i++)
+	{
+		hdr_pixels[i] = static_cast<float>(i % 4 == 0 ? 10 : 1);
+	}
+	auto hdr_mips = TextureProcessor::GenerateMips(hdr, false, false);
+	auto hdr_last = reinterpret_cast<float const *>(static_cast<std::uint8_t const *>(hdr_mips.m_pixels) + hdr_mips.GetMipOffset(2));
+	Check(hdr_mips.m_num_mips == 3 && hdr_last[0] == 10.f && hdr_last[1] == 1.f, "mips: hdr");
+}
+
+static void TestThreading()
+{
+	auto texture = CreateTexture(256, 200, 2);
+
+	util::ThreadPool thread_pool(4);
+	auto serial = TextureProcessor::Compress(TextureProcessor::GenerateMips(texture, true, false), TextureCompression::BC7);
+	auto parallel = TextureProcessor::Compress(TextureProcessor::GenerateMips(texture, true, false, &thread_pool), TextureCompression::BC7, &thread_pool);
+	Check(serial.GetSizeInBytes() == parallel.GetSizeInBytes() && memcmp(serial.m_pixels, parallel.m_pixels, serial.GetSizeInBytes()) == 0,
+		"threading: same result on a thread pool");
+}
+
+// Grey textures are expanded to RGBA before they are processed.
+static void TestGreyTexture()
+{
+	TextureData grey;
+	grey.m_width = 8;
+	grey.m_height = 8;
+	grey.m_channels = 1;
+	grey.m_pixel_channels = 1;
+	memset(grey.AllocatePixels(8 * 8), 100, 8 * 8);
+	Check(grey.GetSizeInBytes() == 8 * 8, "grey: size");
+
+	TextureProcessor processor({ true, 1, "" });
+	auto processed = processor.Process(grey, TextureRole::SINGLE_CHANNEL, true, false);
+	Check(processed.m_compression == TextureCompression::BC4 && processed.m_pixel_channels == 4 && processed.m_num_mips == 4, "grey: BC4 with mips");
+
+	std::vector<std::uint8_t> decoded(8 * 8 * 4);
+	BlockCompression::Decompress(TextureCompression::BC4, static_cast<std::uint8_t const *>(processed.m_pixels), 8, 8, decoded.data());
+	Check(decoded[0] == 100 && decoded[63 * 4] == 100, "grey: values");
+
+	Check(TextureProcessor::Compress(grey, TextureCompression::BC4).m_pixels == grey.m_pixels, "grey: Compress requires RGBA8");
+}
+
+static void TestProcessor()
+{
+	auto directory = (std::filesystem::temp_directory_path() / "skygge_test_texture_processor").generic_string();
+	std::filesystem::remove_all(directory);
+
+	TextureProcessorSettings settings;
+	settings.m_cache_directory = directory;
+	settings.m_num_threads = 2;
+
+	auto texture = CreateTexture(64, 64, 3);
+	TextureData first;
+	{
+		TextureProcessor processor(settings);
+		first = processor.Process(texture, TextureRole::NORMAL, true, false);
+		Check(first.m_compression == TextureCompression::BC5 && first.m_num_mips == 7, "processor: normal maps are BC5 with mips");
+		Check(processor.Process(texture, TextureRole::SINGLE_CHANNEL, false, false).m_compression == TextureCompression::BC4, "processor: single channel is BC4");
+		Check(processor.Process(texture, TextureRole::COLOR_OPAQUE, false, true).m_compression == TextureCompression::BC1, "processor: opaque color is BC1");
+		Check(processor.Process(first, TextureRole::COLOR, true, true).m_pixels == first.m_pixels, "processor: processed textures are returned as is");
+
+		auto stats = processor.GetStats();
+		Check(stats.m_num_processed == 3 && stats.m_num_cache_hits == 0 && stats.m_megapixels > 0 && stats.GetMegapixelsPerSecond() > 0, "processor: stats");
+	}
+
+	// Warm start
+	{
+		TextureProcessor processor(settings);
+		auto cached = processor.Process(texture, TextureRole::NORMAL, true, false);
+		Check(processor.GetStats().m_num_cache_hits == 1 && processor.GetStats().m_num_processed == 0, "processor: cache hit");
+		Check(cached.GetSizeInBytes() == first.GetSizeInBytes() && memcmp(cached.m_pixels, first.m_pixels, first.GetSizeInBytes()) == 0, "processor: cached pixels");
+
+		// Different flags are different entries.
+		processor.Process(texture, TextureRole::NORMAL, false, false);
+		Check(processor.GetStats().m_num_processed == 1, "processor: flags are part of the key");
+	}
+
+	// Only cached textures are used, others aren't processed.
+	{
+		auto cache_only_settings = settings;
+		cache_only_settings.m_cache_only = true;
+		TextureProcessor processor(cache_only_settings);
+		auto cached = processor.Process(texture, TextureRole::NORMAL, true, false);
+		Check(cached.m_compression == TextureCompression::BC5 && processor.GetStats().m_num_cache_hits == 1, "processor: cache only hit");
+		Check(processor.Process(texture, TextureRole::COLOR, true, false).m_pixels == texture.m_pixels, "processor: cache only miss is returned as is");
+		Check(processor.GetStats().m_num_processed == 0, "processor: cache only doesn't process");
+	}
+
+	// Corrupt cache files are ignored.
+	for (auto const & entry : std::filesystem::directory_iterator(directory))
+	{
+		std::filesystem::resize_file(entry.path(), 100);
+	}
+	{
+		TextureProcessor processor(settings);
+		auto processed = processor.Process(texture, TextureRole::NORMAL, true, false);
+		Check(processor.GetStats().m_num_processed == 1 && memcmp(processed.m_pixels, first.m_pixels, first.GetSizeInBytes()) == 0, "processor: corrupt cache");
+	}
+
+	std::filesystem::remove_all(directory);
+}
+
+int main()
+{
+	TestBlockCompression();
+	TestMips();
+	TestThreading();
+	TestGreyTexture();
+	TestProcessor();
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
@@ -0,0 +1,230 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include <texture_residency_manager.hpp>
+#include <util/log.hpp>
+
+#include "../common/test_util.hpp"
+
+// Level sizes of a square RGBA8 texture with a full mip chain.
+static std::vector<std::size_t> GetMipSizes(std::uint32_t size)
+{
+	std::vector<std::size_t> sizes;
+	for (; size > 0; size /= 2)
+	{
+		sizes.push_back(static_cast<std::size_t>(size) * size * 4);
+	}
+	return sizes;
+}
+
+static std::size_t GetSize(std::uint32_t size, std::uint32_t first_mip)
+{
+	auto sizes = GetMipSizes(size);
+	std::size_t total = 0;
+	for (auto level = first_mip; level < sizes.size(); level++)
+	{
+		total += sizes[level];
+	}
+	return total;
+}
+
+static bool HasChange(std::vector<TextureResidencyChange> const & changes, std::uint32_t id, std::uint32_t first_mip, bool evict)
+{
+	return std::any_of(changes.begin(), changes.end(), [&](auto const & change)
+	{
+		return change.m_id == id && change.m_first_mip == first_mip && change.m_evict == evict;
+	});
+}
+
+// Applies every change, as if the uploads finished before the next frame.
+static void CompleteAll(TextureResidencyManager& manager, std::vector<TextureResidencyChange> const & changes)
+{
+	for (auto const & change : changes)
+	{
+		manager.Complete(change.m_id);
+	}
+}
+
+static void TestScreenSize()
+{
+	Check(TextureResidencyManager::GetMipForScreenSize(1024, 1024, 11, 1024) == 0, "screen size: full size");
+	Check(TextureResidencyManager::GetMipForScreenSize(1024, 1024, 11, 4096) == 0, "screen size: magnified");
+	Check(TextureResidencyManager::GetMipForScreenSize(1024, 1024, 11, 256) == 2, "screen size: quarter");
+	Check(TextureResidencyManager::GetMipForScreenSize(1024, 1024, 11, 300) == 1, "screen size: rounds to more detail");
+	Check(TextureResidencyManager::GetMipForScreenSize(2048, 512, 12, 512) == 2, "screen size: largest dimension");
+	Check(TextureResidencyManager::GetMipForScreenSize(1024, 1024, 11, 0) == 10, "screen size: invisible");
+	Check(TextureResidencyManager::GetMipForScreenSize(1024, 1024, 4, 1) == 3, "screen size: clamped to the last level");
+}
+
+static void TestRegister()
+{
+	TextureResidencySettings settings;
+	settings.m_base_size = 64;
+	TextureResidencyManager manager(settings);
+
+	Check(manager.Register(0, 1024, 1024, GetMipSizes(1024)) == 4, "register: 64x64 and down are resident");
+	Check(manager.Register(1, 32, 32, GetMipSizes(32)) == 0, "register: small textures are fully resident");
+	Check(manager.Register(2, 1024, 256, GetMipSizes(1024)) == 4, "register: largest dimension");
+	Check(manager.Register(0, 1024, 1024, GetMipSizes(1024)) == 4, "register: twice");
+
+	auto stats = manager.GetStats();
+	Check(stats.m_num_textures == 3, "register: num textures");
+	Check(stats.m_resident_bytes == GetSize(1024, 4) * 2 + GetSize(32, 0), "register: resident bytes");
+	Check(stats.m_full_bytes == GetSize(1024, 0) * 2 + GetSize(32, 0), "register: full bytes");
+
+	Check(manager.Update().empty(), "register: nothing to do without requests");
+}
+
+static void TestRequests()
+{
+	TextureResidencyManager manager;
+	manager.Register(0, 1024, 1024, GetMipSizes(1024));
+
+	manager.Request(0, 2);
+	manager.Request(0, 1);
+	manager.Request(0, 3);
+	auto changes = manager.Update();
+	Check(changes.size() == 1 && HasChange(changes, 0, 1, false), "requests: most detailed request of the frame");
+	Check(manager.GetResidentMip(0) == 4 && manager.GetStats().m_num_pending == 1, "requests: pending until complete");
+
+	manager.Request(0, 0);
+	Check(manager.Update().empty(), "requests: one pending change per texture");
+
+	manager.Complete(0);
+	Check(manager.GetResidentMip(0) == 1 && manager.GetStats().m_num_pending == 0, "requests: complete");
+
+	manager.Request(0, 3);
+	Check(manager.Update().empty(), "requests: less detail than resident");
+
+	Check(manager.Update().empty(), "requests: requests only last a frame");
+
+	manager.RequestScreenSize(0, 1024);
+	Check(HasChange(manager.Update(), 0, 0, false), "requests: screen size");
+
+	manager.Request(7, 0);
+	Check(manager.Update().empty(), "requests: unknown textures are ignored");
+}
+
+static void TestBudget()
+{
+	// Fits one 1024 texture with all levels, the base levels of the others and levels 2 and up of another.
+	TextureResidencySettings settings;
+	settings.m_budget = GetSize(1024, 0) + GetSize(1024, 4) * 2 + GetSize(1024, 2) - GetSize(1024, 4);
+	TextureResidencyManager manager(settings);
+	for (std::uint32_t id = 0; id < 3; id++)
+	{
+		manager.Register(id, 1024, 1024, GetMipSizes(1024));
+	}
+
+	manager.Request(0, 0);
+	auto changes = manager.Update();
+	Check(changes.size() == 1 && HasChange(changes, 0, 0, false), "budget: fits");
+	CompleteAll(manager, changes);
+
+	// Texture 0 isn't requested anymore, so it's evicted to make room.
+	manager.Request(1, 0);
+	changes = manager.Update();
+	Check(changes.size() == 2 && HasChange(changes, 0, 4, true) && HasChange(changes, 1, 0, false), "budget: evicts the unused texture");
+	Check(manager.GetStats().m_resident_bytes <= settings.m_budget, "budget: within budget");
+	CompleteAll(manager, changes);
+	Check(manager.GetResidentMip(0) == 4 && manager.GetResidentMip(1) == 0, "budget: resident after completing");
+
+	// Requested textures aren't evicted, so the second one gets what is left.
+	manager.Request(1, 0);
+	manager.Request(2, 0);
+	changes = manager.Update();
+	Check(changes.size() == 1 && HasChange(changes, 2, 2, false), "budget: partial load");
+	Check(manager.GetStats().m_resident_bytes <= settings.m_budget, "budget: partial load within budget");
+
+	auto stats = manager.GetStats();
+	Check(stats.m_num_loads == 3 && stats.m_num_evictions == 1, "budget: stats");
+}
+
+static void TestLeastRecentlyRequested()
+{
+	// Fits two 512 textures with all levels.
+	TextureResidencySettings settings;
+	settings.m_budget = GetSize(512, 0) * 2 + GetSize(512, 3) * 2;
+	TextureResidencyManager manager(settings);
+	for (std::uint32_t id = 0; id < 4; id++)
+	{
+		manager.Register(id, 512, 512, GetMipSizes(512));
+	}
+
+	// 1 is requested after 0, so 0 is evicted first.
+	manager.Request(0, 0);
+	CompleteAll(manager, manager.Update());
+	manager.Request(1, 0);
+	CompleteAll(manager, manager.Update());
+
+	manager.Request(2, 0);
+	auto changes = manager.Update();
+	Check(changes.size() == 2 && HasChange(changes, 0, 3, true) && HasChange(changes, 2, 0, false), "lru: evicts the oldest");
+	CompleteAll(manager, changes);
+
+	// Requesting 1 again makes it more recent than 2.
+	manager.Request(1, 0);
+	CompleteAll(manager, manager.Update());
+	manager.Request(3, 0);
+	changes = manager.Update();
+	Check(changes.size() == 2 && HasChange(changes, 2, 3, true) && HasChange(changes, 3, 0, false), "lru: recent requests are kept");
+
+	// Textures with pending changes aren't evicted.
+	manager.Request(0, 0);
+	changes = manager.Update();
+	Check(!HasChange(changes, 3, 3, true), "lru: pending textures aren't evicted");
+}
+
+static void TestUploadLimit()
+{
+	TextureResidencySettings settings;
+	settings.m_max_bytes_per_update = GetSize(1024, 0) + GetSize(1024, 1) / 2;
+	TextureResidencyManager manager(settings);
+	for (std::uint32_t id = 0; id < 3; id++)
+	{
+		manager.Register(id, 1024, 1024, GetMipSizes(1024));
+	}
+
+	// The largest deficit goes first, the rest is spread over the next frames.
+	manager.Request(0, 2);
+	manager.Request(1, 0);
+	manager.Request(2, 1);
+	auto changes = manager.Update();
+	Check(changes.size() == 1 && HasChange(changes, 1, 0, false), "upload limit: largest deficit first");
+
+	manager.Request(0, 2);
+	manager.Request(2, 1);
+	changes = manager.Update();
+	Check(changes.size() == 2 && HasChange(changes, 0, 2, false) && HasChange(changes, 2, 1, false), "upload limit: next frame");
+
+	settings.m_max_bytes_per_update = 1;
+	TextureResidencyManager small_limit(settings);
+	small_limit.Register(0, 1024, 1024, GetMipSizes(1024));
+	small_limit.Request(0, 0);
+	Check(small_limit.Update().size() == 1, "upload limit: the first change always fits");
+}
+
+int main()
+{
+	TestScreenSize();
+	TestRegister();
+	TestRequests();
+	TestBudget();
+	TestLeastRecentlyRequested();
+	TestUploadLimit();
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
@@ -0,0 +1,237 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <cmath>
+#include <cstring>
+#include <random>
+
+#include <model_pool.hpp>
+#include <vertex.hpp>
+#include <vertex_compression.hpp>
+#include <util/log.hpp>
+
+#include "../common/test_util.hpp"
+
+static std::mt19937 rng(0);
+
+static glm::vec3 RandomUnitVector()
+{
+	std::normal_distribution<float> distribution;
+	glm::vec3 v;
+	do
+	{
+		v = glm::vec3(distribution(rng), distribution(rng), distribution(rng));
+	} while (glm::length(v) < 1e-3f);
+	return glm::normalize(v);
+}
+
+// More precise than the arc cosine of the dot product for small angles.
+static float AngleBetween(glm::vec3 const & a, glm::vec3 const & b)
+{
+	return std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b));
+}
+
+// UNORM16 positions are within half a quantization step of the original.
+static void TestPositions()
+{
+	const glm::vec3 bbox_min(-3.f, 0.f, 10.f);
+	const glm::vec3 bbox_max(5.f, 0.001f, 1000.f);
+	const glm::vec3 max_error = (bbox_max - bbox_min) * (0.5f / 65535.f);
+
+	std::uniform_real_distribution<float> distribution(0.f, 1.f);
+	glm::vec3 measured_error(0.f);
+	for (int i = 0; i < 100000; i++)
+	{
+		auto pos = bbox_min + glm::vec3(distribution(rng), distribution(rng), distribution(rng)) * (bbox_max - bbox_min);
+
+		std::uint16_t quantized[3];
+		QuantizePosition(pos, bbox_min, bbox_max, quantized);
+		measured_error = glm::max(measured_error, glm::abs(DequantizePosition(quantized, bbox_min, bbox_max) - pos));
+	}
+
+	LOG("position: max error ({}, {}, {}), bound ({}, {}, {})", measured_error.x, measured_error.y, measured_error.z, max_error.x, max_error.y, max_error.z);
+
+	for (int i = 0; i < 3; i++)
+	{
+		// Allow for the float error of the dequantization itself.
+		Check(measured_error[i] <= max_error[i] * 1.01f + std::abs(bbox_max[i]) * FLT_EPSILON, "position: error within half a step");
+	}
+
+	// The corners of the bounding box are exact and flat boxes don't divide by zero.
+	std::uint16_t quantized[3];
+	QuantizePosition(bbox_max, bbox_min, bbox_max, quantized);
+	Check(quantized[0] == 65535 && quantized[1] == 65535 && quantized[2] == 65535, "position: bbox max maps to 1");
+	QuantizePosition(glm::vec3(1.f), glm::vec3(1.f), glm::vec3(1.f), quantized);
+	Check(DequantizePosition(quantized, glm::vec3(1.f), glm::vec3(1.f)) == glm::vec3(1.f), "position: flat bounding box");
+}
+
+static void TestUnitVectors()
+{
+	float max_angle = 0.f;
+	for (int i = 0; i < 100000; i++)
+	{
+		auto v = RandomUnitVector();
+
+		std::int16_t oct[2];
+		EncodeOctUnitVector(v, oct);
+		max_angle = std::max(max_angle, AngleBetween(DecodeOctUnitVector(oct), v));
+	}
+
+	for (auto const & v : { glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1) })
+	{
+		std::int16_t oct[2];
+		EncodeOctUnitVector(v, oct);
+		max_angle = std::max(max_angle, AngleBetween(DecodeOctUnitVector(oct), v));
+	}
+
+	LOG("octahedral: max error {} degrees", glm::degrees(max_angle));
+
+	// SNORM16 octahedral vectors are accurate to less than 0.01 degrees.
+	Check(max_angle < glm::radians(0.01f), "octahedral: error below 0.01 degrees");
+
+	std::int16_t oct[2];
+	EncodeOctUnitVector(glm::vec3(0.f), oct);
+	Check(DecodeOctUnitVector(oct) == glm::vec3(0, 0, 1), "octahedral: zero vector decodes to +Z");
+}
+
+static void TestTangentFrames()
+{
+	float max_angle = 0.f;
+	bool signs_match = true;
+	for (int i = 0; i < 10000; i++)
+	{
+		auto normal = RandomUnitVector();
+		auto tangent = glm::normalize(glm::cross(normal, RandomUnitVector()));
+		float sign = (i % 2) ? 1.f : -1.f;
+		auto bitangent = glm::cross(normal, tangent) * sign;
+
+		std::int16_t oct_normal[2], oct_tangent[2];
+		EncodeOctUnitVector(normal, oct_normal);
+		EncodeOctUnitVector(tangent, oct_tangent);
+		float decoded_sign = BitangentSign(normal, tangent, bitangent);
+
+		auto decoded_bitangent = glm::cross(DecodeOctUnitVector(oct_normal), DecodeOctUnitVector(oct_tangent)) * decoded_sign;
+		max_angle = std::max(max_angle, AngleBetween(decoded_bitangent, bitangent));
+		signs_match &= decoded_sign == sign;
+	}
+
+	LOG("tangent frame: max bitangent error {} degrees", glm::degrees(max_angle));
+
+	Check(signs_match, "tangent frame: handedness is preserved");
+	Check(max_angle < glm::radians(0.02f), "tangent frame: bitangent error below 0.02 degrees");
+}
+
+static void TestHalfUVs()
+{
+	std::uniform_real_distribution<float> distribution(-8.f, 8.f);
+	float max_relative_error = 0.f;
+	for (int i = 0; i < 100000; i++)
+	{
+		glm::vec2 uv(distribution(rng), distribution(rng));
+
+		std::uint16_t half[2];
+		EncodeHalf2(uv, half);
+		auto decoded = DecodeHalf2(half);
+
+		for (int c = 0; c < 2; c++)
+		{
+			// Below the smallest normal half the error is absolute.
+			float error = std::abs(decoded[c] - uv[c]) / std::max(std::abs(uv[c]), 6.1e-5f);
+			max_relative_error = std::max(max_relative_error, error);
+		}
+	}
+
+	LOG("half uv: max relative error {}", max_relative_error);
+
+	// 10 bit mantissa, rounded to nearest.
+	Check(max_relative_error <= std::ldexp(1.f, -11), "half uv: error within half an ulp");
+}
+
+static void TestModelPoolImport()
+{
+	const std::uint32_t num_vertices = 1000;
+
+	MeshData mesh_data{};
+	std::uniform_real_distribution<float> distribution(-10.f, 10.f);
+	for (std::uint32_t i = 0; i < num_vertices; i++)
+	{
+		auto normal = RandomUnitVector();
+		auto tangent = glm::normalize(glm::cross(normal, RandomUnitVector()));
+
+		mesh_data.m_positions.push_back(glm::vec3(distribution(rng), distribution(rng), distribution(rng)));
+		mesh_data.m_uvw.push_back(glm::vec3(distribution(rng), distribution(rng), 0.f));
+		mesh_data.m_normals.push_back(normal);
+		mesh_data.m_tangents.push_back(tangent);
+		mesh_data.m_bitangents.push_back(glm::cross(normal, tangent) * ((i % 3) ? 1.f : -1.f));
+	}
+
+	std::vector<std::uint32_t> indices;
+	for (std::uint32_t i = 0; i + 2 < num_vertices; i++)
+	{
+		indices.insert(indices.end(), { i, i + 1, i + 2 });
+	}
+	mesh_data.m_indices_stride = sizeof(std::uint32_t);
+	mesh_data.m_num_indices = indices.size();
+	mesh_data.m_indices.resize(indices.size() * sizeof(std::uint32_t));
+	memcpy(mesh_data.m_indices.data(), indices.data(), mesh_data.m_indices.size());
+
+	ModelData model_data;
+	model_data.m_meshes.push_back(mesh_data);
+
+	CPUModelPool model_pool;
+	auto model_handle = model_pool.Load<CompressedVertex>(&model_data);
+	auto const & mesh_handle = model_handle.m_mesh_handles[0];
+
+	Check(mesh_handle.m_vertex_stride == sizeof(CompressedVertex), "import: vertex stride");
+	auto const & vertex_data = model_pool.m_allocations.back().m_vertices;
+	Check(vertex_data.size() == num_vertices * sizeof(CompressedVertex), "import: vertex data size");
+
+	auto vertices = reinterpret_cast<CompressedVertex const *>(vertex_data.data());
+	const auto max_position_error = glm::length(mesh_handle.m_bbox_max - mesh_handle.m_bbox_min) / 65535.f;
+
+	bool positions_match = true, uvs_match = true, frames_match = true;
+	for (std::uint32_t i = 0; i < num_vertices; i++)
+	{
+		auto const & v = vertices[i];
+
+		auto pos = DequantizePosition(v.m_quantized_pos, mesh_handle.m_bbox_min, mesh_handle.m_bbox_max);
+		positions_match &= glm::length(pos - mesh_data.m_positions[i]) <= max_position_error;
+
+		auto uv = DecodeHalf2(v.m_half_uv);
+		uvs_match &= glm::length(uv - glm::vec2(mesh_data.m_uvw[i].x, mesh_data.m_uvw[i].y)) <= 0.01f;
+
+		auto normal = DecodeOctUnitVector(v.m_oct_normal);
+		auto tangent = DecodeOctUnitVector(v.m_oct_tangent);
+		auto bitangent = glm::cross(normal, tangent) * (v.m_quantized_pos[3] / 65535.f * 2.f - 1.f);
+		frames_match &= AngleBetween(normal, mesh_data.m_normals[i]) < glm::radians(0.01f);
+		frames_match &= AngleBetween(tangent, mesh_data.m_tangents[i]) < glm::radians(0.01f);
+		frames_match &= AngleBetween(bitangent, mesh_data.m_bitangents[i]) < glm::radians(0.02f);
+	}
+
+	LOG("import: {} bytes per vertex instead of {} ({:.2f}x smaller)", sizeof(CompressedVertex), sizeof(Vertex), float(sizeof(Vertex)) / sizeof(CompressedVertex));
+
+	Check(positions_match, "import: positions decode with the mesh bounding box");
+	Check(uvs_match, "import: uvs");
+	Check(frames_match, "import: tangent frames");
+}
+
+int main()
+{
+	TestPositions();
+	TestUnitVectors();
+	TestTangentFrames();
+	TestHalfUVs();
+	TestModelPoolImport();
+
+	if (num_failures > 0)
+	{
+		LOGE("{} checks failed", num_failures);
+		return 1;
+	}
+
+	LOG("All checks passed");
+	return 0;
+}
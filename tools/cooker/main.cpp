@@ -0,0 +1,85 @@
+/*!
+ *  \author    Viktor Zoutman
+ *  \date      2019-2020
+ *  \copyright GNU General Public License v3.0
+ */
+
+#include <filesystem>
+#include <string>
+
+#include <asset_cooker.hpp>
+#include <assimp_model_loader.hpp>
+#include <compressed_texture_loader.hpp>
+#include <gltf_model_loader.hpp>
+#include <stb_image_loader.hpp>
+#include <tinygltf_model_loader.hpp>
+#include <util/log.hpp>
+
+// Cooks the assets of a scene manifest, see `CookerManifest`.
+//   Cooker <manifest> [--force]
+// Returns 1 when an asset failed to cook.
+int main(int argc, char** argv)
+{
+	std::string manifest_path;
+	bool force = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--force")
+		{
+			force = true;
+		}
+		else if (manifest_path.empty())
+		{
+			manifest_path = argument;
+		}
+		else
+		{
+			manifest_path.clear();
+			break;
+		}
+	}
+
+	if (manifest_path.empty())
+	{
+		LOGE("Usage: Cooker <manifest> [--force]");
+		return 1;
+	}
+
+	auto manifest = CookerManifest::Load(manifest_path);
+	if (!manifest)
+	{
+		return 1;
+	}
+
+	// Same loaders as `Renderer`, in the same order.
+	TexturePool::RegisterLoader<STBImageLoader>();
+	TexturePool::RegisterLoader<STBHDRImageLoader>();
+	TexturePool::RegisterLoader<KTX2Loader>();
+	TexturePool::RegisterLoader<DDSLoader>();
+	ModelPool::RegisterLoader<TinyGLTFModelLoader>();
+	ModelPool::RegisterLoader<GLTFModelLoader>();
+	ModelPool::RegisterLoader<AssimpModelLoader>();
+
+	// Paths are resolved like the client resolves them.
+	std::error_code error;
+	std::filesystem::current_path(manifest->m_root, error);
+	if (error)
+	{
+		LOGE("Failed to enter the root directory {}: {}", manifest->m_root, error.message());
+		return 1;
+	}
+
+	AssetCooker cooker(*manifest);
+	auto report = cooker.Cook(force);
+	if (!report.Write(manifest->m_report_path))
+	{
+		return 1;
+	}
+
+	LOG("{} cooked, {} up to date, {} failed in {:.2f}s", report.GetCount(CookStatus::COOKED), report.GetCount(CookStatus::UP_TO_DATE),
+		report.GetCount(CookStatus::FAILED), report.m_seconds);
+
+	return report.GetCount(CookStatus::FAILED) > 0 ? 1 : 0;
+}